@@ -88,8 +88,17 @@ static ACVP_RESULT app_aes_handler(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_des_keywrap_handler(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_des_handler(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_sha_handler(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_sha_stream_init(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_sha_stream_update(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_sha_stream_final(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_hmac_handler(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_hmac_stream_init(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_hmac_stream_update(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_hmac_stream_final(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_cmac_handler(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_cmac_stream_init(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_cmac_stream_update(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_cmac_stream_final(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_dsa_handler(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_kas_ecc_handler(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_kas_ffc_handler(ACVP_TEST_CASE *test_case);
@@ -110,6 +119,8 @@ static ACVP_RESULT app_drbg_handler(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_rsa_keygen_handler(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_rsa_sig_handler(ACVP_TEST_CASE *test_case);
 static ACVP_RESULT app_ecdsa_handler(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_dsa_group_begin(ACVP_TEST_CASE *test_case);
+static ACVP_RESULT app_dsa_group_end(ACVP_TEST_CASE *test_case);
 #endif
 
 #define JSON_FILENAME_LENGTH 24
@@ -186,6 +197,23 @@ ACVP_RESULT progress(char *msg)
     return ACVP_SUCCESS;
 }
 
+/*
+ * This handler receives the structured events, it is called
+ * from the libacvp logging thread.
+ */
+ACVP_RESULT event_log(ACVP_LOG_EVENT *event)
+{
+    int i;
+
+    printf("%lld.%06lld type=%d level=%d vsId=%d tcId=%d", event->timestamp / 1000000,
+           event->timestamp % 1000000, event->type, event->level, event->vs_id, event->tc_id);
+    for (i = 0; i < event->field_cnt; i++) {
+        printf(" %s=%s", event->fields[i].key, event->fields[i].value);
+    }
+    printf(" %s%s", event->msg, strchr(event->msg, '\n') ? "" : "\n");
+    return ACVP_SUCCESS;
+}
+
 static void print_usage(void)
 {
     printf("\nInvalid usage...\n");
@@ -205,6 +233,39 @@ static void print_usage(void)
     printf("in addition to the normal registration flow) use:\n");
     printf("      -sample\n");
     printf("\n");
+    printf("To process vector sets saved in a directory or bundle file without\n");
+    printf("contacting the server, writing the responses to a directory, use:\n");
+    printf("      -offline <vectors> <response dir>\n");
+    printf("\n");
+    printf("To record the session traffic to an archive, or to replay a recorded\n");
+    printf("archive instead of contacting the server, use:\n");
+    printf("      -record <archive>\n");
+    printf("      -replay <archive> <latency in ms>\n");
+    printf("\n");
+    printf("To keep the downloaded vector sets in a directory for later runs use:\n");
+    printf("      -cache <dir>\n");
+    printf("\n");
+    printf("To keep the registration message in a directory for later runs use:\n");
+    printf("      -regcache <dir>\n");
+    printf("\n");
+    printf("To write the full request and response bodies to a file use:\n");
+    printf("      -dump <file>\n");
+    printf("\n");
+    printf("To log structured events from a logging thread use:\n");
+    printf("      -events <ring size>\n");
+    printf("\n");
+    printf("To save the session progress in a checkpoint file, or to continue the\n");
+    printf("session saved in a checkpoint file, use:\n");
+    printf("      -checkpoint <file>\n");
+    printf("      -resume <file>\n");
+    printf("\n");
+    printf("To register only the capabilities that changed since the last passing\n");
+    printf("run, use:\n");
+    printf("      -manifest <file>\n");
+    printf("\n");
+    printf("To save the timing and throughput metrics of every vector set as JSON use:\n");
+    printf("      -metrics <file>\n");
+    printf("\n");
     printf("In addition some options are passed to acvp_app using\n");
     printf("environment variables.  The following variables can be set:\n\n");
     printf("    ACV_SERVER (when not set, defaults to %s)\n", DEFAULT_SERVER);
@@ -226,6 +287,20 @@ int main(int argc, char **argv) {
     int sample = 0;
     int json = 0;
     char json_file[JSON_FILENAME_LENGTH];
+    int offline = 0;
+    char *offline_vectors = NULL;
+    char *offline_resp_dir = NULL;
+    char *record_file = NULL;
+    char *replay_file = NULL;
+    int replay_latency = 0;
+    char *cache_dir = NULL;
+    char *reg_cache_dir = NULL;
+    char *dump_file = NULL;
+    int event_ring = 0;
+    char *checkpoint_file = NULL;
+    char *resume_file = NULL;
+    char *manifest_file = NULL;
+    char *metrics_file = NULL;
 
     int aes = 1;
     int tdes = 1;
@@ -242,11 +317,6 @@ int main(int argc, char **argv) {
     int ecdsa = 0;
     int kas_ecc = 0;
     int kas_ffc = 0;
-    
-    if (argc > 4) {
-        print_usage();
-        return 1;
-    }
 
     argv++;
     argc--;
@@ -277,11 +347,112 @@ int main(int argc, char **argv) {
             return 1;
         }
         if (strcmp(*argv, "-json") == 0) {
+            if (argc < 2 || strlen(argv[1]) >= JSON_FILENAME_LENGTH) {
+                print_usage();
+                return 1;
+            }
             json = 1;
             argc--;
             argv++;
             strcpy(json_file, *argv);
         }
+        if (strcmp(*argv, "-offline") == 0) {
+            if (argc < 3) {
+                print_usage();
+                return 1;
+            }
+            offline = 1;
+            offline_vectors = argv[1];
+            offline_resp_dir = argv[2];
+            argc -= 2;
+            argv += 2;
+        }
+        if (strcmp(*argv, "-record") == 0) {
+            if (argc < 2) {
+                print_usage();
+                return 1;
+            }
+            argc--;
+            argv++;
+            record_file = *argv;
+        }
+        if (strcmp(*argv, "-cache") == 0) {
+            if (argc < 2) {
+                print_usage();
+                return 1;
+            }
+            argc--;
+            argv++;
+            cache_dir = *argv;
+        }
+        if (strcmp(*argv, "-regcache") == 0) {
+            if (argc < 2) {
+                print_usage();
+                return 1;
+            }
+            argc--;
+            argv++;
+            reg_cache_dir = *argv;
+        }
+        if (strcmp(*argv, "-dump") == 0) {
+            if (argc < 2) {
+                print_usage();
+                return 1;
+            }
+            argc--;
+            argv++;
+            dump_file = *argv;
+        }
+        if (strcmp(*argv, "-events") == 0) {
+            if (argc < 2) {
+                print_usage();
+                return 1;
+            }
+            argc--;
+            argv++;
+            event_ring = atoi(*argv);
+        }
+        if (strcmp(*argv, "-manifest") == 0) {
+            if (argc < 2) {
+                print_usage();
+                return 1;
+            }
+            argc--;
+            argv++;
+            manifest_file = *argv;
+        }
+        if (strcmp(*argv, "-metrics") == 0) {
+            if (argc < 2) {
+                print_usage();
+                return 1;
+            }
+            argc--;
+            argv++;
+            metrics_file = *argv;
+        }
+        if (strcmp(*argv, "-checkpoint") == 0 || strcmp(*argv, "-resume") == 0) {
+            if (argc < 2) {
+                print_usage();
+                return 1;
+            }
+            if (strcmp(*argv, "-resume") == 0) {
+                resume_file = argv[1];
+            } else {
+                checkpoint_file = argv[1];
+            }
+            argc--;
+            argv++;
+        }
+        if (strcmp(*argv, "-replay") == 0) {
+            if (argc < 3) {
+                print_usage();
+                return 1;
+            }
+            replay_file = argv[1];
+            replay_latency = atoi(argv[2]);
+            argc -= 2;
+            argv += 2;
+        }
         argv++;
         argc--;
     }
@@ -378,6 +549,70 @@ int main(int argc, char **argv) {
         acvp_mark_as_sample(ctx);
     }
 
+    if (record_file) {
+        rv = acvp_set_transport_record(ctx, record_file);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to set session archive (rv=%d)\n", rv);
+            exit(1);
+        }
+    }
+    if (replay_file) {
+        rv = acvp_set_transport_replay(ctx, replay_file, replay_latency);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to load session archive (rv=%d)\n", rv);
+            exit(1);
+        }
+    }
+    if (cache_dir) {
+        rv = acvp_set_vector_cache(ctx, cache_dir);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to set vector set cache (rv=%d)\n", rv);
+            exit(1);
+        }
+    }
+    if (reg_cache_dir) {
+        rv = acvp_set_registration_cache(ctx, reg_cache_dir, NULL);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to set registration cache (rv=%d)\n", rv);
+            exit(1);
+        }
+    }
+    if (dump_file) {
+        rv = acvp_set_payload_dump(ctx, dump_file);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to set payload dump (rv=%d)\n", rv);
+            exit(1);
+        }
+    }
+    if (event_ring) {
+        rv = acvp_set_event_logger(ctx, &event_log, event_ring);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to set event logger (rv=%d)\n", rv);
+            exit(1);
+        }
+    }
+    if (checkpoint_file) {
+        rv = acvp_set_checkpoint_file(ctx, checkpoint_file);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to set checkpoint file (rv=%d)\n", rv);
+            exit(1);
+        }
+    }
+    if (manifest_file) {
+        rv = acvp_set_capability_manifest(ctx, manifest_file);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to set capability manifest (rv=%d)\n", rv);
+            exit(1);
+        }
+    }
+    if (metrics_file) {
+        rv = acvp_set_metrics(ctx, 1);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to enable metrics (rv=%d)\n", rv);
+            exit(1);
+        }
+    }
+
     if (json) {
         /*
          * Using a JSON to register allows us to skip the
@@ -444,15 +679,37 @@ int main(int argc, char **argv) {
     }
 #endif
     }
-    /*
-     * Now that we have a test session, we register with
-     * the server to advertise our capabilities and receive
-     * the KAT vector sets the server demands that we process.
-     */
-    rv = acvp_register(ctx);
-    if (rv != ACVP_SUCCESS) {
-        printf("Failed to register with ACVP server (rv=%d)\n", rv);
-        exit(1);
+    if (offline) {
+        /*
+         * The vector sets were saved earlier, there is no
+         * registration and the responses are written to disk.
+         */
+        rv = acvp_set_offline_vectors(ctx, offline_vectors, offline_resp_dir);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to set offline vector sets (rv=%d)\n", rv);
+            exit(1);
+        }
+    } else if (resume_file) {
+        /*
+         * Continue the session saved in the checkpoint, only
+         * the outstanding vector sets are processed.
+         */
+        rv = acvp_resume_session(ctx, resume_file);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to resume session from %s (rv=%d)\n", resume_file, rv);
+            exit(1);
+        }
+    } else {
+        /*
+         * Now that we have a test session, we register with
+         * the server to advertise our capabilities and receive
+         * the KAT vector sets the server demands that we process.
+         */
+        rv = acvp_register(ctx);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to register with ACVP server (rv=%d)\n", rv);
+            exit(1);
+        }
     }
 
     /*
@@ -465,11 +722,32 @@ int main(int argc, char **argv) {
         exit(1);
     }
 
-    printf("\nTests complete, checking results...\n");
-    rv = acvp_check_test_results(ctx);
-    if (rv != ACVP_SUCCESS) {
-        printf("Unable to retrieve test results (%d)\n", rv);
-        exit(1);
+    if (metrics_file) {
+        rv = acvp_export_metrics(ctx, metrics_file);
+        if (rv != ACVP_SUCCESS) {
+            printf("Failed to save metrics (rv=%d)\n", rv);
+            exit(1);
+        }
+    }
+
+    if (offline) {
+        printf("\nTests complete, responses saved to %s\n", offline_resp_dir);
+    } else {
+        printf("\nTests complete, checking results...\n");
+        rv = acvp_check_test_results(ctx);
+        if (rv != ACVP_SUCCESS) {
+            printf("Unable to retrieve test results (%d)\n", rv);
+            exit(1);
+        }
+        if (manifest_file && !json && !resume_file) {
+            rv = acvp_save_capability_manifest(ctx);
+            if (rv == ACVP_TEST_FAIL) {
+                printf("Not all vector sets passed, the capability manifest is not saved\n");
+            } else if (rv != ACVP_SUCCESS) {
+                printf("Failed to save capability manifest (rv=%d)\n", rv);
+                exit(1);
+            }
+        }
     }
     /*
      * Finally, we free the test session context and cleanup
@@ -838,6 +1116,11 @@ static void enable_hash (ACVP_CTX *ctx) {
     CHECK_ENABLE_CAP_RV(rv);
     rv = acvp_enable_hash_cap_parm(ctx, ACVP_SHA256, ACVP_HASH_IN_EMPTY, 1);
     CHECK_ENABLE_CAP_RV(rv);
+    rv = acvp_enable_hash_stream_cb(ctx, ACVP_SHA256, &app_sha_stream_init,
+                                    &app_sha_stream_update, &app_sha_stream_final);
+    CHECK_ENABLE_CAP_RV(rv);
+    rv = acvp_enable_hash_cap_parm(ctx, ACVP_SHA256, ACVP_HASH_LARGE_DATA, 1);
+    CHECK_ENABLE_CAP_RV(rv);
 
     rv = acvp_enable_hash_cap(ctx, ACVP_SHA384, &app_sha_handler);
     CHECK_ENABLE_CAP_RV(rv);
@@ -863,6 +1146,9 @@ static void enable_cmac (ACVP_CTX *ctx) {
      */
     rv = acvp_enable_cmac_cap(ctx, ACVP_CMAC_AES, &app_cmac_handler);
     CHECK_ENABLE_CAP_RV(rv);
+    rv = acvp_enable_cmac_stream_cb(ctx, ACVP_CMAC_AES, &app_cmac_stream_init,
+                                    &app_cmac_stream_update, &app_cmac_stream_final);
+    CHECK_ENABLE_CAP_RV(rv);
     rv = acvp_enable_cmac_cap_parm(ctx, ACVP_CMAC_AES, ACVP_CMAC_BLK_DIVISIBLE_1, 1024);
     CHECK_ENABLE_CAP_RV(rv);
     rv = acvp_enable_cmac_cap_parm(ctx, ACVP_CMAC_AES, ACVP_CMAC_BLK_NOT_DIVISIBLE_1, 2048);
@@ -927,6 +1213,9 @@ static void enable_hmac (ACVP_CTX *ctx) {
 
     rv = acvp_enable_hmac_cap(ctx, ACVP_HMAC_SHA2_256, &app_hmac_handler);
     CHECK_ENABLE_CAP_RV(rv);
+    rv = acvp_enable_hmac_stream_cb(ctx, ACVP_HMAC_SHA2_256, &app_hmac_stream_init,
+                                    &app_hmac_stream_update, &app_hmac_stream_final);
+    CHECK_ENABLE_CAP_RV(rv);
     rv = acvp_enable_hmac_cap_parm(ctx, ACVP_HMAC_SHA2_256, ACVP_HMAC_KEYLEN_MIN, 32 * 8);
     CHECK_ENABLE_CAP_RV(rv);
     rv = acvp_enable_hmac_cap_parm(ctx, ACVP_HMAC_SHA2_256, ACVP_HMAC_KEYLEN_MAX, 56 * 8);
@@ -1306,6 +1595,8 @@ static void enable_dsa (ACVP_CTX *ctx) {
 
     rv = acvp_enable_dsa_cap(ctx, ACVP_DSA_KEYGEN, &app_dsa_handler);
     CHECK_ENABLE_CAP_RV(rv);
+    rv = acvp_enable_dsa_group_cb(ctx, ACVP_DSA_KEYGEN, &app_dsa_group_begin, &app_dsa_group_end);
+    CHECK_ENABLE_CAP_RV(rv);
     rv = acvp_enable_prereq_cap(ctx, ACVP_DSA_KEYGEN, ACVP_PREREQ_SHA, value);
     CHECK_ENABLE_CAP_RV(rv);
     rv = acvp_enable_prereq_cap(ctx, ACVP_DSA_KEYGEN, ACVP_PREREQ_DRBG, value);
@@ -1338,6 +1629,8 @@ static void enable_dsa (ACVP_CTX *ctx) {
 
     rv = acvp_enable_dsa_cap(ctx, ACVP_DSA_SIGGEN, &app_dsa_handler);
     CHECK_ENABLE_CAP_RV(rv);
+    rv = acvp_enable_dsa_group_cb(ctx, ACVP_DSA_SIGGEN, &app_dsa_group_begin, &app_dsa_group_end);
+    CHECK_ENABLE_CAP_RV(rv);
     rv = acvp_enable_prereq_cap(ctx, ACVP_DSA_SIGGEN, ACVP_PREREQ_SHA, value);
     CHECK_ENABLE_CAP_RV(rv);
     rv = acvp_enable_prereq_cap(ctx, ACVP_DSA_SIGGEN, ACVP_PREREQ_DRBG, value);
@@ -2707,6 +3000,102 @@ static ACVP_RESULT app_sha_handler(ACVP_TEST_CASE *test_case)
     return ACVP_SUCCESS;
 }
 
+/*
+ * Streaming callbacks used by libacvp for hash messages that
+ * are too large to be passed in a single buffer.  The digest
+ * context is kept in the test case, so concurrent test cases
+ * don't share it.
+ */
+
+static ACVP_RESULT app_sha_stream_init(ACVP_TEST_CASE *test_case)
+{
+    ACVP_HASH_TC    *tc;
+    const EVP_MD    *md;
+    EVP_MD_CTX      *md_ctx;
+
+    if (!test_case) {
+        return ACVP_INVALID_ARG;
+    }
+
+    tc = test_case->tc.hash;
+
+    switch (tc->cipher) {
+    case ACVP_SHA1:
+        md = EVP_sha1();
+        break;
+    case ACVP_SHA224:
+        md = EVP_sha224();
+        break;
+    case ACVP_SHA256:
+        md = EVP_sha256();
+        break;
+    case ACVP_SHA384:
+        md = EVP_sha384();
+        break;
+    case ACVP_SHA512:
+        md = EVP_sha512();
+        break;
+    default:
+        printf("Error: Unsupported hash algorithm requested by ACVP server\n");
+        return ACVP_NO_CAP;
+    }
+
+    md_ctx = EVP_MD_CTX_create();
+    if (!md_ctx) {
+        return ACVP_MALLOC_FAIL;
+    }
+    if (!EVP_DigestInit_ex(md_ctx, md, NULL)) {
+        printf("\nCrypto module error, EVP_DigestInit_ex failed\n");
+        EVP_MD_CTX_destroy(md_ctx);
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+    tc->stream_ctx = md_ctx;
+
+    return ACVP_SUCCESS;
+}
+
+static ACVP_RESULT app_sha_stream_update(ACVP_TEST_CASE *test_case)
+{
+    ACVP_HASH_TC    *tc;
+
+    if (!test_case) {
+        return ACVP_INVALID_ARG;
+    }
+
+    tc = test_case->tc.hash;
+
+    if (!EVP_DigestUpdate(tc->stream_ctx, tc->msg, tc->msg_len)) {
+        printf("\nCrypto module error, EVP_DigestUpdate failed\n");
+        EVP_MD_CTX_destroy(tc->stream_ctx);
+        tc->stream_ctx = NULL;
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+
+    return ACVP_SUCCESS;
+}
+
+static ACVP_RESULT app_sha_stream_final(ACVP_TEST_CASE *test_case)
+{
+    ACVP_HASH_TC    *tc;
+
+    if (!test_case) {
+        return ACVP_INVALID_ARG;
+    }
+
+    tc = test_case->tc.hash;
+
+    if (!EVP_DigestFinal(tc->stream_ctx, tc->md, &tc->md_len)) {
+        printf("\nCrypto module error, EVP_DigestFinal failed\n");
+        EVP_MD_CTX_destroy(tc->stream_ctx);
+        tc->stream_ctx = NULL;
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+    EVP_MD_CTX_destroy(tc->stream_ctx);
+    tc->stream_ctx = NULL;
+
+    return ACVP_SUCCESS;
+}
+
 static ACVP_RESULT app_hmac_handler(ACVP_TEST_CASE *test_case)
 {
     ACVP_HMAC_TC    *tc;
@@ -2767,45 +3156,136 @@ static ACVP_RESULT app_hmac_handler(ACVP_TEST_CASE *test_case)
     return ACVP_SUCCESS;
 }
 
-static ACVP_RESULT app_cmac_handler(ACVP_TEST_CASE *test_case)
+/*
+ * Streaming callbacks used by libacvp for HMAC messages that
+ * are too large to be passed in a single buffer.  The HMAC
+ * context is kept in the test case like the digest context of
+ * the hash ones.
+ */
+
+static ACVP_RESULT app_hmac_stream_init(ACVP_TEST_CASE *test_case)
 {
-    ACVP_CMAC_TC    *tc;
-    ACVP_RESULT rv;
-    const EVP_CIPHER    *c = NULL;
-    CMAC_CTX       *cmac_ctx;
-    int key_len, i;
-    unsigned char mac_compare[16] = {0};
-    char full_key[65] = {0};
-    int mac_cmp_len;
+    ACVP_HMAC_TC    *tc;
+    const EVP_MD    *md;
+    HMAC_CTX        *hmac_ctx;
 
     if (!test_case) {
         return ACVP_INVALID_ARG;
     }
 
-    tc = test_case->tc.cmac;
+    tc = test_case->tc.hmac;
+
+    switch (tc->cipher) {
+    case ACVP_HMAC_SHA1:
+        md = EVP_sha1();
+        break;
+    case ACVP_HMAC_SHA2_224:
+        md = EVP_sha224();
+        break;
+    case ACVP_HMAC_SHA2_256:
+        md = EVP_sha256();
+        break;
+    case ACVP_HMAC_SHA2_384:
+        md = EVP_sha384();
+        break;
+    case ACVP_HMAC_SHA2_512:
+        md = EVP_sha512();
+        break;
+    default:
+        printf("Error: Unsupported hash algorithm requested by ACVP server\n");
+        return ACVP_NO_CAP;
+    }
+
+    hmac_ctx = malloc(sizeof(HMAC_CTX));
+    if (!hmac_ctx) {
+        return ACVP_MALLOC_FAIL;
+    }
+    HMAC_CTX_init(hmac_ctx);
+    if (!HMAC_Init_ex(hmac_ctx, tc->key, tc->key_len, md, NULL)) {
+        printf("\nCrypto module error, HMAC_Init_ex failed\n");
+        HMAC_CTX_cleanup(hmac_ctx);
+        free(hmac_ctx);
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+    tc->stream_ctx = hmac_ctx;
+
+    return ACVP_SUCCESS;
+}
+
+static ACVP_RESULT app_hmac_stream_update(ACVP_TEST_CASE *test_case)
+{
+    ACVP_HMAC_TC    *tc;
+
+    if (!test_case) {
+        return ACVP_INVALID_ARG;
+    }
+
+    tc = test_case->tc.hmac;
+
+    if (!HMAC_Update(tc->stream_ctx, tc->msg, tc->msg_len)) {
+        printf("\nCrypto module error, HMAC_Update failed\n");
+        HMAC_CTX_cleanup(tc->stream_ctx);
+        free(tc->stream_ctx);
+        tc->stream_ctx = NULL;
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+
+    return ACVP_SUCCESS;
+}
+
+static ACVP_RESULT app_hmac_stream_final(ACVP_TEST_CASE *test_case)
+{
+    ACVP_HMAC_TC    *tc;
+    ACVP_RESULT     rv = ACVP_SUCCESS;
+
+    if (!test_case) {
+        return ACVP_INVALID_ARG;
+    }
+
+    tc = test_case->tc.hmac;
+
+    if (!HMAC_Final(tc->stream_ctx, tc->mac, &tc->mac_len)) {
+        printf("\nCrypto module error, HMAC_Final failed\n");
+        rv = ACVP_CRYPTO_MODULE_FAIL;
+    }
+    HMAC_CTX_cleanup(tc->stream_ctx);
+    free(tc->stream_ctx);
+    tc->stream_ctx = NULL;
+
+    return rv;
+}
+
+/*
+ * Picks the cipher and assembles the key of a CMAC test case,
+ * the three TDES keys are concatenated
+ */
+static ACVP_RESULT app_cmac_key(ACVP_CMAC_TC *tc, const EVP_CIPHER **c,
+                                char *full_key, int *key_len)
+{
+    int i;
 
     switch (tc->cipher) {
         case ACVP_CMAC_AES:
             switch (tc->key_len) {
             case 128:
-                c = EVP_aes_128_cbc();
+                *c = EVP_aes_128_cbc();
                 break;
             case 192:
-                c = EVP_aes_192_cbc();
+                *c = EVP_aes_192_cbc();
                 break;
             case 256:
-                c = EVP_aes_256_cbc();
+                *c = EVP_aes_256_cbc();
                 break;
             default:
                 break;
             }
-            key_len = (tc->key_len)/8;
-            for (i = 0; i < key_len; i++) {
+            *key_len = (tc->key_len)/8;
+            for (i = 0; i < *key_len; i++) {
                 full_key[i] = tc->key[i];
             }
             break;
         case ACVP_CMAC_TDES:
-            c = EVP_des_ede3_cbc();
+            *c = EVP_des_ede3_cbc();
             for (i = 0; i < 8; i++) {
                 full_key[i] = tc->key[i];
             }
@@ -2815,7 +3295,7 @@ static ACVP_RESULT app_cmac_handler(ACVP_TEST_CASE *test_case)
             for (; i < 24; i++) {
                 full_key[i] = tc->key3[i%8];
             }
-            key_len = 24;
+            *key_len = 24;
             break;
         default:
             printf("Error: Unsupported CMAC algorithm requested by ACVP server\n");
@@ -2823,22 +3303,23 @@ static ACVP_RESULT app_cmac_handler(ACVP_TEST_CASE *test_case)
             break;
     }
 
-    full_key[key_len] = '\0';
+    full_key[*key_len] = '\0';
 
-    cmac_ctx = CMAC_CTX_new();
-
-    if (!CMAC_Init(cmac_ctx, full_key, key_len, c, NULL)) {
-        printf("\nCrypto module error, CMAC_Init_ex failed\n");
-        return ACVP_CRYPTO_MODULE_FAIL;
-    }
+    return ACVP_SUCCESS;
+}
 
-    if (!CMAC_Update(cmac_ctx, tc->msg, tc->msg_len)) {
-        printf("\nCrypto module error, CMAC_Update failed\n");
-        return ACVP_CRYPTO_MODULE_FAIL;
-    }
+/*
+ * Finishes the mac of a CMAC test case.  In "gen" mode the mac
+ * is returned, in "ver" mode it is compared with the one given.
+ */
+static ACVP_RESULT app_cmac_final(ACVP_CMAC_TC *tc, CMAC_CTX *cmac_ctx)
+{
+    ACVP_RESULT rv;
+    unsigned char mac_compare[16] = {0};
+    size_t mac_cmp_len;
 
     if (strncmp((const char *)tc->direction, "ver", 3) == 0) {
-        if (!CMAC_Final(cmac_ctx, mac_compare, (size_t *)&mac_cmp_len)) {
+        if (!CMAC_Final(cmac_ctx, mac_compare, &mac_cmp_len)) {
             printf("\nCrypto module error, CMAC_Final failed\n");
             return ACVP_CRYPTO_MODULE_FAIL;
         }
@@ -2861,16 +3342,135 @@ static ACVP_RESULT app_cmac_handler(ACVP_TEST_CASE *test_case)
             strncpy((char *)tc->ver_disposition, "fail", 5);
         }
     } else {
-        if (!CMAC_Final(cmac_ctx, tc->mac, (size_t *)&tc->mac_len)) {
+        if (!CMAC_Final(cmac_ctx, tc->mac, &mac_cmp_len)) {
             printf("\nCrypto module error, CMAC_Final failed\n");
             return ACVP_CRYPTO_MODULE_FAIL;
         }
+        tc->mac_len = mac_cmp_len;
+    }
+
+    return ACVP_SUCCESS;
+}
+
+static ACVP_RESULT app_cmac_handler(ACVP_TEST_CASE *test_case)
+{
+    ACVP_CMAC_TC    *tc;
+    ACVP_RESULT rv;
+    const EVP_CIPHER    *c = NULL;
+    CMAC_CTX       *cmac_ctx;
+    int key_len;
+    char full_key[65] = {0};
+
+    if (!test_case) {
+        return ACVP_INVALID_ARG;
+    }
+
+    tc = test_case->tc.cmac;
+
+    rv = app_cmac_key(tc, &c, full_key, &key_len);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
+
+    cmac_ctx = CMAC_CTX_new();
+
+    if (!CMAC_Init(cmac_ctx, full_key, key_len, c, NULL)) {
+        printf("\nCrypto module error, CMAC_Init_ex failed\n");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+
+    if (!CMAC_Update(cmac_ctx, tc->msg, tc->msg_len)) {
+        printf("\nCrypto module error, CMAC_Update failed\n");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+
+    rv = app_cmac_final(tc, cmac_ctx);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
     }
     CMAC_CTX_cleanup(cmac_ctx);
 
     return ACVP_SUCCESS;
 }
 
+/*
+ * Streaming callbacks used by libacvp for CMAC messages that
+ * are too large to be passed in a single buffer.  The CMAC
+ * context is kept in the test case like the HMAC one.
+ */
+
+static ACVP_RESULT app_cmac_stream_init(ACVP_TEST_CASE *test_case)
+{
+    ACVP_CMAC_TC    *tc;
+    ACVP_RESULT rv;
+    const EVP_CIPHER    *c = NULL;
+    CMAC_CTX       *cmac_ctx;
+    int key_len;
+    char full_key[65] = {0};
+
+    if (!test_case) {
+        return ACVP_INVALID_ARG;
+    }
+
+    tc = test_case->tc.cmac;
+
+    rv = app_cmac_key(tc, &c, full_key, &key_len);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
+
+    cmac_ctx = CMAC_CTX_new();
+    if (!cmac_ctx) {
+        return ACVP_MALLOC_FAIL;
+    }
+    if (!CMAC_Init(cmac_ctx, full_key, key_len, c, NULL)) {
+        printf("\nCrypto module error, CMAC_Init_ex failed\n");
+        CMAC_CTX_free(cmac_ctx);
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+    tc->stream_ctx = cmac_ctx;
+
+    return ACVP_SUCCESS;
+}
+
+static ACVP_RESULT app_cmac_stream_update(ACVP_TEST_CASE *test_case)
+{
+    ACVP_CMAC_TC    *tc;
+
+    if (!test_case) {
+        return ACVP_INVALID_ARG;
+    }
+
+    tc = test_case->tc.cmac;
+
+    if (!CMAC_Update(tc->stream_ctx, tc->msg, tc->msg_len)) {
+        printf("\nCrypto module error, CMAC_Update failed\n");
+        CMAC_CTX_free(tc->stream_ctx);
+        tc->stream_ctx = NULL;
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+
+    return ACVP_SUCCESS;
+}
+
+static ACVP_RESULT app_cmac_stream_final(ACVP_TEST_CASE *test_case)
+{
+    ACVP_CMAC_TC    *tc;
+    ACVP_RESULT rv;
+
+    if (!test_case) {
+        return ACVP_INVALID_ARG;
+    }
+
+    tc = test_case->tc.cmac;
+
+    rv = app_cmac_final(tc, tc->stream_ctx);
+    CMAC_CTX_free(tc->stream_ctx);
+    tc->stream_ctx = NULL;
+
+    return rv;
+}
+
 #ifdef OPENSSL_KDF_SUPPORT
 static ACVP_RESULT app_kdf135_srtp_handler(ACVP_TEST_CASE *test_case) {
     ACVP_RESULT rv = ACVP_CRYPTO_MODULE_FAIL;
@@ -3167,6 +3767,100 @@ static ACVP_RESULT app_kdf135_ssh_handler(ACVP_TEST_CASE *test_case)
 
 //Must be commented out if the user is Making with Makefile.fom
 #ifdef ACVP_NO_RUNTIME
+/*
+ * Generate the domain parameters once per keyGen/sigGen test group,
+ * every test case in the group reuses them from group_ctx.
+ */
+static ACVP_RESULT app_dsa_group_begin(ACVP_TEST_CASE *test_case)
+{
+    const EVP_MD        *md = NULL;
+    ACVP_DSA_TC         *tc;
+    DSA                 *dsa = NULL;
+
+    tc = test_case->tc.dsa;
+    if (tc->mode == ACVP_DSA_MODE_SIGGEN) {
+        switch (tc->sha)
+        {
+        case ACVP_DSA_SHA1:
+            md = EVP_sha1();
+            break;
+        case ACVP_DSA_SHA224:
+            md = EVP_sha224();
+            break;
+        case ACVP_DSA_SHA256:
+            md = EVP_sha256();
+            break;
+        case ACVP_DSA_SHA384:
+            md = EVP_sha384();
+            break;
+        case ACVP_DSA_SHA512:
+            md = EVP_sha512();
+            break;
+        case ACVP_DSA_SHA512_224:
+        case ACVP_DSA_SHA512_256:
+        default:
+            printf("DSA sha value not supported %d\n", tc->sha);
+            return ACVP_CRYPTO_MODULE_FAIL;
+            break;
+        }
+    }
+
+    dsa = FIPS_dsa_new();
+    if (!dsa) {
+        printf("Failed to allocate DSA strcut\n");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+    if (dsa_builtin_paramgen2(dsa, tc->l, tc->n, md, NULL, 0, -1,
+                    NULL, NULL, NULL, NULL) <= 0) {
+        printf("Parameter Generation error\n");
+        FIPS_dsa_free(dsa);
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+    tc->group_ctx = dsa;
+    return ACVP_SUCCESS;
+}
+
+static ACVP_RESULT app_dsa_group_end(ACVP_TEST_CASE *test_case)
+{
+    ACVP_DSA_TC         *tc;
+
+    tc = test_case->tc.dsa;
+    if (tc->group_ctx) {
+        FIPS_dsa_free((DSA *)tc->group_ctx);
+        tc->group_ctx = NULL;
+    }
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Load the domain parameters generated by app_dsa_group_begin()
+ * into a fresh DSA so the group copy is never modified.
+ */
+static DSA *app_dsa_group_params(ACVP_DSA_TC *tc)
+{
+    DSA                 *grp = (DSA *)tc->group_ctx;
+    DSA                 *dsa = NULL;
+
+    if (!grp) {
+        printf("DSA domain parameters missing for group\n");
+        return NULL;
+    }
+    dsa = FIPS_dsa_new();
+    if (!dsa) {
+        printf("Failed to allocate DSA strcut\n");
+        return NULL;
+    }
+    dsa->p = BN_dup(grp->p);
+    dsa->q = BN_dup(grp->q);
+    dsa->g = BN_dup(grp->g);
+    if (!dsa->p || !dsa->q || !dsa->g) {
+        printf("Failed to copy DSA domain parameters\n");
+        FIPS_dsa_free(dsa);
+        return NULL;
+    }
+    return dsa;
+}
+
 static ACVP_RESULT app_dsa_handler(ACVP_TEST_CASE *test_case)
 {
     int                 L, N, n, r;
@@ -3183,18 +3877,8 @@ static ACVP_RESULT app_dsa_handler(ACVP_TEST_CASE *test_case)
     switch (tc->mode)
     {
     case ACVP_DSA_MODE_KEYGEN:
-        dsa = FIPS_dsa_new();
+        dsa = app_dsa_group_params(tc);
         if (!dsa) {
-            printf("Failed to allocate DSA strcut\n");
-            return ACVP_CRYPTO_MODULE_FAIL;
-        }
-        L = tc->l;
-        N = tc->n;
-
-        if (dsa_builtin_paramgen2(dsa, L, N, NULL, NULL, 0, -1,
-                        NULL, NULL, NULL, NULL) <= 0) {
-            printf("Parameter Generation error\n");
-            FIPS_dsa_free(dsa);
             return ACVP_CRYPTO_MODULE_FAIL;
         }
         tc->p = (unsigned char *)BN_bn2hex(dsa->p);
@@ -3400,18 +4084,8 @@ static ACVP_RESULT app_dsa_handler(ACVP_TEST_CASE *test_case)
             break;
         }
 
-        dsa = FIPS_dsa_new();
+        dsa = app_dsa_group_params(tc);
         if (!dsa) {
-            printf("Failed to allocate DSA strcut\n");
-            return ACVP_CRYPTO_MODULE_FAIL;
-        }
-        L = tc->l;
-        N = tc->n;
-
-        if (dsa_builtin_paramgen2(dsa, L, N, md, NULL, 0, -1,
-                        NULL, NULL, NULL, NULL) <= 0) {
-            printf("Parameter Generation error\n");
-            FIPS_dsa_free(dsa);
             return ACVP_CRYPTO_MODULE_FAIL;
         }
         tc->p = (unsigned char *)BN_bn2hex(dsa->p);
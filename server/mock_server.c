@@ -0,0 +1,757 @@
+/*****************************************************************************
+* Copyright (c) 2016, Cisco Systems, Inc.
+* All rights reserved.
+
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+* USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+/*
+ * This module is not part of libacvp.  It's a small stand-in for the
+ * ACVP server that speaks the endpoints used in acvp_transport.c, so
+ * the whole client can be exercised and measured locally:
+ *
+ *   POST validation/acvp/login
+ *   POST validation/acvp/register
+ *   GET  validation/acvp/vectors?vsId=
+ *   POST validation/acvp/vectors?vsId=
+ *   GET  validation/acvp/vectors/answers?vsId=
+ *   GET  validation/acvp/results?vsId=
+ *
+ * Vector sets for the SHA algorithms are generated, with the expected
+ * digests computed by OpenSSL so the uploaded responses can be checked.
+ * Any other algorithm is served from canned vector sets, for which the
+ * server checks that every test case was answered.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include "parson.h"
+
+#define MOCK_DEFAULT_PORT       8443
+#define MOCK_DEFAULT_TESTS      16
+#define MOCK_ACV_VERSION        "0.4"
+#define MOCK_PATH_MAX           1024
+#define MOCK_HDR_MAX            8192
+#define MOCK_BODY_MAX           1024*1024*16
+#define MOCK_HASH_MSG_MAX       256
+
+/*
+ * A vector set handed out during registration
+ */
+typedef struct mock_vs_t {
+    int vs_id;
+    JSON_Value *vectors;    /* vector set as sent to the client */
+    JSON_Value *answers;    /* expected testResults, NULL for canned vector sets */
+    int retries;            /* retry responses still to be sent for this vector set */
+    const char *disposition;
+    struct mock_vs_t *next;
+} MOCK_VS;
+
+/*
+ * A canned vector set loaded from the vector directory
+ */
+typedef struct mock_canned_t {
+    char *name;
+    JSON_Value *val;
+    struct mock_canned_t *next;
+} MOCK_CANNED;
+
+typedef struct mock_request_t {
+    char method[8];
+    char path[MOCK_PATH_MAX];
+    char *body;
+} MOCK_REQUEST;
+
+static struct {
+    int port;
+    int tests;
+    int retry_cnt;
+    int retry_period;
+    int latency;
+    MOCK_CANNED *canned;
+
+    pthread_mutex_t lock;
+    int next_vs_id;
+    MOCK_VS *vs_list;
+    int passed;
+    int failed;
+} mock;
+
+static const struct {
+    const char *name;
+    const EVP_MD *(*md) (void);
+} mock_hash_tbl[] = {
+    {"SHA-1",   EVP_sha1},
+    {"SHA-224", EVP_sha224},
+    {"SHA-256", EVP_sha256},
+    {"SHA-384", EVP_sha384},
+    {"SHA-512", EVP_sha512},
+};
+#define MOCK_HASH_CNT (sizeof(mock_hash_tbl) / sizeof(mock_hash_tbl[0]))
+
+static void print_usage (void) {
+    printf("\nacvp_mock_server is a local stand-in for the ACVP server.\n");
+    printf("usage: acvp_mock_server -cert <file> -key <file> [options]\n");
+    printf("      -port <port>             (default %d)\n", MOCK_DEFAULT_PORT);
+    printf("      -vectors <dir>           canned vector sets, one per *.json file\n");
+    printf("      -tests <count>           test cases per generated vector set (default %d)\n",
+           MOCK_DEFAULT_TESTS);
+    printf("      -retry <count> <seconds> retry responses sent before each vector set\n");
+    printf("      -latency <ms>            delay added to every response\n");
+    printf("\n");
+    printf("The cert and key are PEM encoded, the client needs the cert as its\n");
+    printf("CA file (ACV_CA_FILE) to verify the server.\n");
+}
+
+static void mock_bin_to_hex (const unsigned char *in, int len, char *out) {
+    static const char hex[] = "0123456789ABCDEF";
+    int i;
+
+    for (i = 0; i < len; i++) {
+        out[i * 2] = hex[in[i] >> 4];
+        out[i * 2 + 1] = hex[in[i] & 0xf];
+    }
+    out[len * 2] = 0;
+}
+
+/*
+ * Wraps a response object with the acvVersion header the client
+ * expects in front of every response.
+ */
+static char *mock_wrap (JSON_Value *val) {
+    JSON_Value *arr_val = json_value_init_array();
+    JSON_Value *ver_val = json_value_init_object();
+    char *body;
+
+    json_object_set_string(json_value_get_object(ver_val), "acvVersion", MOCK_ACV_VERSION);
+    json_array_append_value(json_value_get_array(arr_val), ver_val);
+    json_array_append_value(json_value_get_array(arr_val), val);
+    body = json_serialize_to_string(arr_val);
+    json_value_free(arr_val);
+
+    return body;
+}
+
+/*
+ * Returns the object following the acvVersion header
+ */
+static JSON_Object *mock_get_obj (JSON_Value *val) {
+    return json_array_get_object(json_value_get_array(val), 1);
+}
+
+static MOCK_VS *mock_find_vs (int vs_id) {
+    MOCK_VS *vs;
+
+    for (vs = mock.vs_list; vs; vs = vs->next) {
+        if (vs->vs_id == vs_id) {
+            return vs;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Adds a vector set to the session, the caller holds the lock
+ */
+static int mock_add_vs (JSON_Object *vs_obj, JSON_Value *vectors, JSON_Value *answers) {
+    MOCK_VS *vs;
+
+    vs = calloc(1, sizeof(MOCK_VS));
+    if (!vs) {
+        json_value_free(vectors);
+        json_value_free(answers);
+        return -1;
+    }
+    vs->vs_id = mock.next_vs_id++;
+    vs->vectors = vectors;
+    vs->answers = answers;
+    vs->retries = mock.retry_cnt;
+    json_object_set_number(mock_get_obj(vectors), "vsId", vs->vs_id);
+
+    vs->next = mock.vs_list;
+    mock.vs_list = vs;
+    json_object_set_number(vs_obj, "vsId", vs->vs_id);
+    return vs->vs_id;
+}
+
+/*
+ * Generates a SHA vector set with messages of increasing length.
+ * The expected digests are kept so the response can be verified.
+ */
+static void mock_gen_hash (const char *alg, const EVP_MD *md, JSON_Array *vs_arr) {
+    JSON_Value *vectors, *answers, *group_val, *test_val, *ans_val, *vs_val;
+    JSON_Object *obj, *group_obj;
+    JSON_Array *tests;
+    unsigned char msg[MOCK_HASH_MSG_MAX];
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    char hex[MOCK_HASH_MSG_MAX * 2 + 1];
+    unsigned int digest_len;
+    int i, msg_len;
+
+    vectors = json_value_init_array();
+    json_array_append_value(json_value_get_array(vectors), json_value_init_object());
+    json_object_set_string(json_array_get_object(json_value_get_array(vectors), 0),
+                           "acvVersion", MOCK_ACV_VERSION);
+    json_array_append_value(json_value_get_array(vectors), json_value_init_object());
+    obj = mock_get_obj(vectors);
+    json_object_set_string(obj, "algorithm", alg);
+    json_object_set_value(obj, "testGroups", json_value_init_array());
+
+    group_val = json_value_init_object();
+    group_obj = json_value_get_object(group_val);
+    json_object_set_number(group_obj, "tgId", 1);
+    json_object_set_string(group_obj, "testType", "AFT");
+    json_object_set_value(group_obj, "tests", json_value_init_array());
+    tests = json_object_get_array(group_obj, "tests");
+    json_array_append_value(json_object_get_array(obj, "testGroups"), group_val);
+
+    answers = json_value_init_array();
+    for (i = 0; i < mock.tests; i++) {
+        msg_len = i % MOCK_HASH_MSG_MAX;
+        RAND_bytes(msg, MOCK_HASH_MSG_MAX);
+        EVP_Digest(msg, msg_len, digest, &digest_len, md, NULL);
+
+        test_val = json_value_init_object();
+        json_object_set_number(json_value_get_object(test_val), "tcId", i + 1);
+        mock_bin_to_hex(msg, msg_len, hex);
+        json_object_set_string(json_value_get_object(test_val), "msg", hex);
+        json_object_set_number(json_value_get_object(test_val), "len", msg_len * 8);
+        json_array_append_value(tests, test_val);
+
+        ans_val = json_value_init_object();
+        json_object_set_number(json_value_get_object(ans_val), "tcId", i + 1);
+        mock_bin_to_hex(digest, digest_len, hex);
+        json_object_set_string(json_value_get_object(ans_val), "md", hex);
+        json_array_append_value(json_value_get_array(answers), ans_val);
+    }
+
+    vs_val = json_value_init_object();
+    if (mock_add_vs(json_value_get_object(vs_val), vectors, answers) < 0) {
+        json_value_free(vs_val);
+        return;
+    }
+    json_array_append_value(vs_arr, vs_val);
+}
+
+/*
+ * Hands out a copy of every canned vector set matching the
+ * algorithm and mode of a registered capability.
+ */
+static int mock_add_canned (const char *alg, const char *mode, JSON_Array *vs_arr) {
+    MOCK_CANNED *canned;
+    JSON_Object *obj;
+    JSON_Value *vs_val;
+    const char *c_mode;
+    int cnt = 0;
+
+    for (canned = mock.canned; canned; canned = canned->next) {
+        obj = mock_get_obj(canned->val);
+        if (strcmp(json_object_get_string(obj, "algorithm"), alg)) {
+            continue;
+        }
+        c_mode = json_object_get_string(obj, "mode");
+        if (c_mode && (!mode || strcmp(c_mode, mode))) {
+            continue;
+        }
+        vs_val = json_value_init_object();
+        if (mock_add_vs(json_value_get_object(vs_val), json_value_deep_copy(canned->val), NULL) < 0) {
+            json_value_free(vs_val);
+            break;
+        }
+        json_array_append_value(vs_arr, vs_val);
+        cnt++;
+    }
+    return cnt;
+}
+
+static int mock_login (MOCK_REQUEST *req, char **rsp) {
+    JSON_Value *val = json_value_init_object();
+
+    json_object_set_string(json_value_get_object(val), "accessToken", "mock-login-token");
+    *rsp = mock_wrap(val);
+    return 200;
+}
+
+/*
+ * Registration assigns a vector set to each capability the server
+ * can test, generated for the SHA algorithms and canned otherwise.
+ */
+static int mock_register (MOCK_REQUEST *req, char **rsp) {
+    JSON_Value *reg_val, *val, *cap_rsp;
+    JSON_Object *obj;
+    JSON_Array *caps, *vs_arr;
+    const char *alg, *mode;
+    int i, j, cnt;
+
+    reg_val = json_parse_string(req->body);
+    caps = json_object_get_array(json_object_get_object(mock_get_obj(reg_val), "capabilityExchange"),
+                                 "algorithms");
+    if (!caps) {
+        json_value_free(reg_val);
+        return 400;
+    }
+
+    val = json_value_init_object();
+    obj = json_value_get_object(val);
+    json_object_set_string(obj, "accessToken", "mock-session-token");
+    cap_rsp = json_value_init_object();
+    json_object_set_value(json_value_get_object(cap_rsp), "vectorSets", json_value_init_array());
+    vs_arr = json_object_get_array(json_value_get_object(cap_rsp), "vectorSets");
+    json_object_set_value(obj, "capabilityResponse", cap_rsp);
+
+    pthread_mutex_lock(&mock.lock);
+    for (i = 0; i < (int) json_array_get_count(caps); i++) {
+        alg = json_object_get_string(json_array_get_object(caps, i), "algorithm");
+        mode = json_object_get_string(json_array_get_object(caps, i), "mode");
+        if (!alg) {
+            continue;
+        }
+        cnt = mock_add_canned(alg, mode, vs_arr);
+        for (j = 0; !cnt && j < (int) MOCK_HASH_CNT; j++) {
+            if (!strcmp(alg, mock_hash_tbl[j].name)) {
+                mock_gen_hash(alg, mock_hash_tbl[j].md(), vs_arr);
+                cnt = 1;
+            }
+        }
+        if (!cnt) {
+            printf("No vector set available for %s%s%s\n", alg, mode ? " " : "", mode ? mode : "");
+        }
+    }
+    pthread_mutex_unlock(&mock.lock);
+
+    printf("Registered %d vector sets\n", (int) json_array_get_count(vs_arr));
+    json_value_free(reg_val);
+    *rsp = mock_wrap(val);
+    return 200;
+}
+
+static int mock_get_vectors (int vs_id, char **rsp) {
+    MOCK_VS *vs;
+    JSON_Value *val;
+
+    pthread_mutex_lock(&mock.lock);
+    vs = mock_find_vs(vs_id);
+    if (!vs) {
+        pthread_mutex_unlock(&mock.lock);
+        return 404;
+    }
+    if (vs->retries) {
+        vs->retries--;
+        val = json_value_init_object();
+        json_object_set_number(json_value_get_object(val), "vsId", vs_id);
+        json_object_set_number(json_value_get_object(val), "retry", mock.retry_period);
+        *rsp = mock_wrap(val);
+    } else {
+        *rsp = json_serialize_to_string(vs->vectors);
+    }
+    pthread_mutex_unlock(&mock.lock);
+    return 200;
+}
+
+/*
+ * Finds the result for a test case in the uploaded response
+ */
+static JSON_Object *mock_find_result (JSON_Array *results, int tc_id) {
+    int i;
+
+    for (i = 0; i < (int) json_array_get_count(results); i++) {
+        if ((int) json_object_get_number(json_array_get_object(results, i), "tcId") == tc_id) {
+            return json_array_get_object(results, i);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Checks an uploaded vector set response.  The digests of generated
+ * vector sets are compared, for canned vector sets every test case
+ * must have a result.
+ */
+static int mock_post_responses (int vs_id, MOCK_REQUEST *req, char **rsp) {
+    MOCK_VS *vs;
+    JSON_Value *val;
+    JSON_Array *results, *groups, *tests;
+    JSON_Object *exp, *res;
+    const char *md;
+    int i, j, tc_cnt = 0, pass_cnt = 0;
+
+    val = json_parse_string(req->body);
+    results = json_object_get_array(mock_get_obj(val), "testResults");
+    if (!results) {
+        json_value_free(val);
+        return 400;
+    }
+
+    pthread_mutex_lock(&mock.lock);
+    vs = mock_find_vs(vs_id);
+    if (!vs) {
+        pthread_mutex_unlock(&mock.lock);
+        json_value_free(val);
+        return 404;
+    }
+    if (vs->answers) {
+        for (i = 0; i < (int) json_array_get_count(json_value_get_array(vs->answers)); i++) {
+            exp = json_array_get_object(json_value_get_array(vs->answers), i);
+            res = mock_find_result(results, json_object_get_number(exp, "tcId"));
+            md = res ? json_object_get_string(res, "md") : NULL;
+            tc_cnt++;
+            if (md && !strcasecmp(md, json_object_get_string(exp, "md"))) {
+                pass_cnt++;
+            }
+        }
+    } else {
+        groups = json_object_get_array(mock_get_obj(vs->vectors), "testGroups");
+        for (i = 0; i < (int) json_array_get_count(groups); i++) {
+            tests = json_object_get_array(json_array_get_object(groups, i), "tests");
+            for (j = 0; j < (int) json_array_get_count(tests); j++) {
+                tc_cnt++;
+                if (mock_find_result(results, json_object_get_number(json_array_get_object(tests, j), "tcId"))) {
+                    pass_cnt++;
+                }
+            }
+        }
+    }
+    vs->disposition = pass_cnt == tc_cnt ? "passed" : "failed";
+    if (pass_cnt == tc_cnt) {
+        mock.passed++;
+    } else {
+        mock.failed++;
+    }
+    printf("vsId %d (%s): %d of %d test cases %s, %d passed / %d failed vector sets\n",
+           vs_id, json_object_get_string(mock_get_obj(vs->vectors), "algorithm"), pass_cnt, tc_cnt,
+           vs->answers ? "correct" : "answered", mock.passed, mock.failed);
+    pthread_mutex_unlock(&mock.lock);
+
+    json_value_free(val);
+    *rsp = mock_wrap(json_value_init_object());
+    return 200;
+}
+
+static int mock_get_answers (int vs_id, char **rsp) {
+    MOCK_VS *vs;
+    JSON_Value *val;
+
+    pthread_mutex_lock(&mock.lock);
+    vs = mock_find_vs(vs_id);
+    if (!vs) {
+        pthread_mutex_unlock(&mock.lock);
+        return 404;
+    }
+    val = json_value_init_object();
+    json_object_set_number(json_value_get_object(val), "vsId", vs_id);
+    json_object_set_value(json_value_get_object(val), "testResults",
+                          vs->answers ? json_value_deep_copy(vs->answers) : json_value_init_array());
+    pthread_mutex_unlock(&mock.lock);
+
+    *rsp = mock_wrap(val);
+    return 200;
+}
+
+static int mock_get_results (int vs_id, char **rsp) {
+    MOCK_VS *vs;
+    JSON_Value *val;
+
+    pthread_mutex_lock(&mock.lock);
+    vs = mock_find_vs(vs_id);
+    if (!vs) {
+        pthread_mutex_unlock(&mock.lock);
+        return 404;
+    }
+    val = json_value_init_object();
+    json_object_set_number(json_value_get_object(val), "vsId", vs_id);
+    json_object_set_string(json_value_get_object(val), "disposition",
+                           vs->disposition ? vs->disposition : "incomplete");
+    pthread_mutex_unlock(&mock.lock);
+
+    *rsp = mock_wrap(val);
+    return 200;
+}
+
+/*
+ * Routes a request to the endpoint handler.  Any path segment the
+ * client was configured with in front of validation/acvp is ignored.
+ */
+static int mock_dispatch (MOCK_REQUEST *req, char **rsp) {
+    char *ep;
+    int post = !strcmp(req->method, "POST");
+
+    ep = strstr(req->path, "validation/acvp/");
+    if (!ep) {
+        return 404;
+    }
+    ep += strlen("validation/acvp/");
+
+    if (post && !strcmp(ep, "login")) {
+        return mock_login(req, rsp);
+    }
+    if (post && !strcmp(ep, "register")) {
+        return mock_register(req, rsp);
+    }
+    if (!post && !strncmp(ep, "vectors/answers?vsId=", 21)) {
+        return mock_get_answers(atoi(ep + 21), rsp);
+    }
+    if (!strncmp(ep, "vectors?vsId=", 13)) {
+        return post ? mock_post_responses(atoi(ep + 13), req, rsp) : mock_get_vectors(atoi(ep + 13), rsp);
+    }
+    if (!post && !strncmp(ep, "results?vsId=", 13)) {
+        return mock_get_results(atoi(ep + 13), rsp);
+    }
+    return 404;
+}
+
+/*
+ * Reads one HTTP request from the connection.  Returns 0 when a
+ * request was read, non-zero when the client closed the connection.
+ */
+static int mock_read_request (SSL *ssl, MOCK_REQUEST *req) {
+    char *buf, *hdr_end, *cl;
+    int len = 0, max = MOCK_HDR_MAX, rv, hdr_len, body_len = 0;
+
+    buf = calloc(1, max + 1);
+    if (!buf) {
+        return -1;
+    }
+    while (!(hdr_end = strstr(buf, "\r\n\r\n"))) {
+        if (len == MOCK_HDR_MAX) {
+            free(buf);
+            return -1;
+        }
+        rv = SSL_read(ssl, buf + len, MOCK_HDR_MAX - len);
+        if (rv <= 0) {
+            free(buf);
+            return -1;
+        }
+        len += rv;
+        buf[len] = 0;
+    }
+    hdr_len = hdr_end + 4 - buf;
+
+    if (sscanf(buf, "%7s %1023s", req->method, req->path) != 2) {
+        free(buf);
+        return -1;
+    }
+    cl = strcasestr(buf, "Content-Length:");
+    if (cl && cl < hdr_end) {
+        body_len = atoi(cl + 15);
+    }
+    if (body_len < 0 || body_len > MOCK_BODY_MAX) {
+        free(buf);
+        return -1;
+    }
+
+    req->body = calloc(1, body_len + 1);
+    if (!req->body) {
+        free(buf);
+        return -1;
+    }
+    len -= hdr_len;
+    memcpy(req->body, buf + hdr_len, len > body_len ? body_len : len);
+    free(buf);
+    while (len < body_len) {
+        rv = SSL_read(ssl, req->body + len, body_len - len);
+        if (rv <= 0) {
+            free(req->body);
+            req->body = NULL;
+            return -1;
+        }
+        len += rv;
+    }
+    return 0;
+}
+
+static void mock_send_response (SSL *ssl, int status, const char *body) {
+    char hdr[256];
+    int len = body ? strlen(body) : 0;
+
+    snprintf(hdr, sizeof(hdr), "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+             "Content-Length: %d\r\n\r\n", status, status == 200 ? "OK" : "Error", len);
+    SSL_write(ssl, hdr, strlen(hdr));
+    if (len) {
+        SSL_write(ssl, body, len);
+    }
+}
+
+/*
+ * Each client connection is served on its own thread, so the server
+ * keeps up with clients processing vector sets in parallel.
+ */
+static void *mock_conn_main (void *arg) {
+    SSL *ssl = arg;
+    MOCK_REQUEST req;
+    char *rsp;
+    int status;
+
+    if (SSL_accept(ssl) > 0) {
+        memset(&req, 0, sizeof(req));
+        while (!mock_read_request(ssl, &req)) {
+            rsp = NULL;
+            status = mock_dispatch(&req, &rsp);
+            if (mock.latency) {
+                usleep(mock.latency * 1000);
+            }
+            printf("%s %s %d\n", req.method, req.path, status);
+            mock_send_response(ssl, status, rsp);
+            if (rsp) {
+                json_free_serialized_string(rsp);
+            }
+            free(req.body);
+            memset(&req, 0, sizeof(req));
+        }
+    }
+    close(SSL_get_fd(ssl));
+    SSL_free(ssl);
+    return NULL;
+}
+
+static int mock_load_canned (const char *dir) {
+    struct dirent **names = NULL;
+    MOCK_CANNED *canned;
+    char path[MOCK_PATH_MAX];
+    JSON_Value *val;
+    JSON_Object *obj;
+    int i, cnt, len;
+
+    cnt = scandir(dir, &names, NULL, alphasort);
+    if (cnt < 0) {
+        printf("Unable to read vector directory %s\n", dir);
+        return 1;
+    }
+    for (i = 0; i < cnt; i++) {
+        len = strlen(names[i]->d_name);
+        if (len > 5 && !strcmp(names[i]->d_name + len - 5, ".json")) {
+            snprintf(path, MOCK_PATH_MAX, "%s/%s", dir, names[i]->d_name);
+            val = json_parse_file_with_comments(path);
+            obj = mock_get_obj(val);
+            if (!obj || !json_object_get_string(obj, "algorithm")) {
+                printf("Skipping %s, not a vector set\n", path);
+                json_value_free(val);
+            } else {
+                canned = calloc(1, sizeof(MOCK_CANNED));
+                if (!canned) {
+                    return 1;
+                }
+                canned->name = strdup(names[i]->d_name);
+                canned->val = val;
+                canned->next = mock.canned;
+                mock.canned = canned;
+            }
+        }
+        free(names[i]);
+    }
+    free(names);
+    return 0;
+}
+
+int main (int argc, char **argv) {
+    char *cert_file = NULL, *key_file = NULL;
+    struct sockaddr_in addr;
+    SSL_CTX *ssl_ctx;
+    SSL *ssl;
+    pthread_t thread;
+    int i, sock, fd, on = 1;
+
+    mock.port = MOCK_DEFAULT_PORT;
+    mock.tests = MOCK_DEFAULT_TESTS;
+    mock.next_vs_id = 1;
+    pthread_mutex_init(&mock.lock, NULL);
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-cert") && i + 1 < argc) {
+            cert_file = argv[++i];
+        } else if (!strcmp(argv[i], "-key") && i + 1 < argc) {
+            key_file = argv[++i];
+        } else if (!strcmp(argv[i], "-port") && i + 1 < argc) {
+            mock.port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-vectors") && i + 1 < argc) {
+            if (mock_load_canned(argv[++i])) {
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-tests") && i + 1 < argc) {
+            mock.tests = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-retry") && i + 2 < argc) {
+            mock.retry_cnt = atoi(argv[++i]);
+            mock.retry_period = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-latency") && i + 1 < argc) {
+            mock.latency = atoi(argv[++i]);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (!cert_file || !key_file || mock.tests < 1) {
+        print_usage();
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    SSL_library_init();
+    SSL_load_error_strings();
+    ssl_ctx = SSL_CTX_new(SSLv23_server_method());
+    if (!ssl_ctx ||
+        SSL_CTX_use_certificate_chain_file(ssl_ctx, cert_file) != 1 ||
+        SSL_CTX_use_PrivateKey_file(ssl_ctx, key_file, SSL_FILETYPE_PEM) != 1) {
+        printf("Unable to load the server cert/key\n");
+        ERR_print_errors_fp(stdout);
+        return 1;
+    }
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(mock.port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) || listen(sock, 64)) {
+        perror("Unable to listen");
+        return 1;
+    }
+    printf("ACVP mock server listening on port %d\n", mock.port);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    while (1) {
+        fd = accept(sock, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        ssl = SSL_new(ssl_ctx);
+        SSL_set_fd(ssl, fd);
+        if (pthread_create(&thread, NULL, mock_conn_main, ssl)) {
+            close(fd);
+            SSL_free(ssl);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    return 0;
+}
@@ -28,6 +28,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #include "acvp.h"
 #include "acvp_lcl.h"
@@ -47,6 +49,8 @@ static ACVP_RESULT acvp_process_vector_set (ACVP_CTX *ctx, JSON_Object *obj);
 
 static ACVP_RESULT acvp_dispatch_vector_set (ACVP_CTX *ctx, JSON_Object *obj);
 
+static ACVP_RESULT acvp_process_offline_vectors (ACVP_CTX *ctx);
+
 static ACVP_RESULT acvp_append_sym_cipher_caps_entry (
         ACVP_CTX *ctx,
         ACVP_SYM_CIPHER_CAP *cap,
@@ -112,7 +116,7 @@ static void acvp_cap_free_nl (ACVP_NAME_LIST *list);
 
 static void acvp_cap_free_hash_pairs (ACVP_RSA_HASH_PAIR_LIST *list);
 
-static ACVP_RESULT acvp_get_result_vsid (ACVP_CTX *ctx, int vs_id);
+static ACVP_RESULT acvp_get_result_vsid (ACVP_CTX *ctx, ACVP_VS_LIST *vs_entry);
 
 static ACVP_RESULT acvp_add_prereq_val (ACVP_CIPHER cipher,
                                         ACVP_CAPS_LIST *caps_list,
@@ -665,10 +669,28 @@ ACVP_RESULT acvp_free_test_session (ACVP_CTX *ctx) {
         if (ctx->cacerts_file) { free(ctx->cacerts_file); }
         if (ctx->tls_cert) { free(ctx->tls_cert); }
         if (ctx->tls_key) { free(ctx->tls_key); }
+        if (ctx->json_filename) { free(ctx->json_filename); }
+        if (ctx->offline_vectors) { free(ctx->offline_vectors); }
+        if (ctx->offline_resp_dir) { free(ctx->offline_resp_dir); }
+        if (ctx->record_fp) { fclose(ctx->record_fp); }
+        if (ctx->record_buf) { free(ctx->record_buf); }
+        if (ctx->replay_val) { json_value_free(ctx->replay_val); }
+        if (ctx->vs_cache_dir) { free(ctx->vs_cache_dir); }
+        if (ctx->reg_cache_dir) { free(ctx->reg_cache_dir); }
+        acvp_payload_dump_stop(ctx);
+        acvp_log_ring_stop(ctx);
+        acvp_metrics_free(ctx);
+        if (ctx->reg_cache_key) { free(ctx->reg_cache_key); }
+        if (ctx->checkpoint_file) { free(ctx->checkpoint_file); }
+        if (ctx->checkpoint_reg) { free(ctx->checkpoint_reg); }
+        if (ctx->manifest_file) { free(ctx->manifest_file); }
+        if (ctx->manifest_val) { json_value_free(ctx->manifest_val); }
+        if (ctx->manifest_new) { json_value_free(ctx->manifest_new); }
         if (ctx->vs_list) {
             vs_entry = ctx->vs_list;
             while (vs_entry) {
                 vs_e2 = vs_entry->next;
+                if (vs_entry->response) { json_free_serialized_string(vs_entry->response); }
                 free(vs_entry);
                 vs_entry = vs_e2;
             }
@@ -1175,6 +1197,11 @@ ACVP_RESULT acvp_validate_hash_parm_value (ACVP_HASH_PARM parm, int value) {
     case ACVP_HASH_IN_EMPTY:
         retval = is_valid_tf_param(value);
         break;
+    case ACVP_HASH_LARGE_DATA:
+        if (value == 1 || value == 2 || value == 4 || value == 8) {
+            retval = ACVP_SUCCESS;
+        }
+        break;
     default:
         break;
     }
@@ -1225,6 +1252,9 @@ ACVP_RESULT acvp_enable_hash_cap_parm (
         case ACVP_HASH_IN_EMPTY:
             hash_cap->in_empty = value;
             break;
+        case ACVP_HASH_LARGE_DATA:
+            hash_cap->large_data |= value;
+            break;
         default:
             return ACVP_INVALID_ARG;
             break;
@@ -1237,6 +1267,42 @@ ACVP_RESULT acvp_enable_hash_cap_parm (
     return ACVP_SUCCESS;
 }
 
+/*
+ * Add the optional HASH(SHA) streaming callbacks
+ */
+ACVP_RESULT acvp_enable_hash_stream_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*init_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*update_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*final_cb) (ACVP_TEST_CASE *test_case)) {
+    ACVP_CAPS_LIST *cap;
+    ACVP_HASH_CAP *hash_cap;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!init_cb || !update_cb || !final_cb) {
+        return ACVP_INVALID_ARG;
+    }
+
+    cap = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap) {
+        return ACVP_NO_CAP;
+    }
+
+    hash_cap = cap->cap.hash_cap;
+    if (!hash_cap) {
+        return ACVP_NO_CAP;
+    }
+
+    hash_cap->stream.init = init_cb;
+    hash_cap->stream.update = update_cb;
+    hash_cap->stream.final = final_cb;
+
+    return ACVP_SUCCESS;
+}
+
 ACVP_RESULT acvp_validate_hmac_parm_value (ACVP_CIPHER cipher,
                                            ACVP_HMAC_PARM parm,
                                            int value) {
@@ -1369,6 +1435,37 @@ ACVP_RESULT acvp_enable_hmac_cap_parm (
     return ACVP_SUCCESS;
 }
 
+/*
+ * Add the optional HMAC streaming callbacks
+ */
+ACVP_RESULT acvp_enable_hmac_stream_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*init_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*update_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*final_cb) (ACVP_TEST_CASE *test_case)) {
+    ACVP_CAPS_LIST *cap;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!init_cb || !update_cb || !final_cb) {
+        return ACVP_INVALID_ARG;
+    }
+
+    cap = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap || !cap->cap.hmac_cap) {
+        ACVP_LOG_ERR("Cap entry not found, use acvp_enable_hmac_cap() first.");
+        return ACVP_NO_CAP;
+    }
+
+    cap->cap.hmac_cap->stream.init = init_cb;
+    cap->cap.hmac_cap->stream.update = update_cb;
+    cap->cap.hmac_cap->stream.final = final_cb;
+
+    return ACVP_SUCCESS;
+}
+
 ACVP_RESULT acvp_validate_cmac_parm_value (ACVP_CMAC_PARM parm, int value) {
     ACVP_RESULT retval = ACVP_INVALID_ARG;
 
@@ -1506,6 +1603,37 @@ ACVP_RESULT acvp_enable_cmac_cap_parm (
     return ACVP_SUCCESS;
 }
 
+/*
+ * Add the optional CMAC streaming callbacks
+ */
+ACVP_RESULT acvp_enable_cmac_stream_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*init_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*update_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*final_cb) (ACVP_TEST_CASE *test_case)) {
+    ACVP_CAPS_LIST *cap;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!init_cb || !update_cb || !final_cb) {
+        return ACVP_INVALID_ARG;
+    }
+
+    cap = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap || !cap->cap.cmac_cap) {
+        ACVP_LOG_ERR("Cap entry not found, use acvp_enable_cmac_cap() first.");
+        return ACVP_NO_CAP;
+    }
+
+    cap->cap.cmac_cap->stream.init = init_cb;
+    cap->cap.cmac_cap->stream.update = update_cb;
+    cap->cap.cmac_cap->stream.final = final_cb;
+
+    return ACVP_SUCCESS;
+}
+
 
 ACVP_RESULT acvp_validate_drbg_parm_value (ACVP_DRBG_PARM parm, int value) {
     ACVP_RESULT retval = ACVP_INVALID_ARG;
@@ -3232,6 +3360,35 @@ ACVP_RESULT acvp_enable_drbg_cap (
     return result;
 }
 
+/*
+ * Add the optional DRBG group setup/teardown callbacks
+ */
+ACVP_RESULT acvp_enable_drbg_group_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*begin_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*end_cb) (ACVP_TEST_CASE *test_case)) {
+    ACVP_CAPS_LIST *cap;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!begin_cb || !end_cb) {
+        return ACVP_INVALID_ARG;
+    }
+
+    cap = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap || !cap->cap.drbg_cap) {
+        ACVP_LOG_ERR("Cap entry not found, use acvp_enable_drbg_cap() first.");
+        return ACVP_NO_CAP;
+    }
+
+    cap->cap.drbg_cap->group.begin = begin_cb;
+    cap->cap.drbg_cap->group.end = end_cb;
+
+    return ACVP_SUCCESS;
+}
+
 ACVP_RESULT acvp_enable_rsa_keygen_cap (
         ACVP_CTX *ctx,
         ACVP_CIPHER cipher,
@@ -3302,6 +3459,56 @@ ACVP_RESULT acvp_enable_ecdsa_cap (
     return result;
 }
 
+/*
+ * Add the optional ECDSA group setup/teardown callbacks
+ */
+ACVP_RESULT acvp_enable_ecdsa_group_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*begin_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*end_cb) (ACVP_TEST_CASE *test_case)) {
+    ACVP_CAPS_LIST *cap_list;
+    ACVP_ECDSA_CAP *cap;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!begin_cb || !end_cb) {
+        return ACVP_INVALID_ARG;
+    }
+
+    cap_list = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap_list) {
+        ACVP_LOG_ERR("Cap entry not found, use acvp_enable_ecdsa_cap() first.");
+        return ACVP_NO_CAP;
+    }
+
+    switch(cipher) {
+    case ACVP_ECDSA_KEYGEN:
+        cap = cap_list->cap.ecdsa_keygen_cap;
+        break;
+    case ACVP_ECDSA_KEYVER:
+        cap = cap_list->cap.ecdsa_keyver_cap;
+        break;
+    case ACVP_ECDSA_SIGGEN:
+        cap = cap_list->cap.ecdsa_siggen_cap;
+        break;
+    case ACVP_ECDSA_SIGVER:
+        cap = cap_list->cap.ecdsa_sigver_cap;
+        break;
+    default:
+        return ACVP_INVALID_ARG;
+    }
+    if (!cap) {
+        return ACVP_NO_CAP;
+    }
+
+    cap->group.begin = begin_cb;
+    cap->group.end = end_cb;
+
+    return ACVP_SUCCESS;
+}
+
 static ACVP_RESULT acvp_enable_rsa_sig_cap_internal (
         ACVP_CTX *ctx,
         ACVP_CIPHER cipher,
@@ -3374,6 +3581,30 @@ ACVP_RESULT acvp_set_json_filename (ACVP_CTX *ctx, const char *json_filename) {
     return ACVP_SUCCESS;
 }
 
+/*
+ * Allows application to run the test session offline, reading
+ * the vector sets from local files and writing the responses
+ * to a directory instead of using the server.
+ */
+ACVP_RESULT acvp_set_offline_vectors (ACVP_CTX *ctx, const char *vector_path, const char *resp_dir) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!vector_path || !resp_dir) {
+        ACVP_LOG_ERR("Must provide the vector set path and response directory");
+        return ACVP_INVALID_ARG;
+    }
+    if (ctx->offline_vectors) { free(ctx->offline_vectors); }
+    if (ctx->offline_resp_dir) { free(ctx->offline_resp_dir); }
+    ctx->offline_vectors = strdup(vector_path);
+    ctx->offline_resp_dir = strdup(resp_dir);
+    if (!ctx->offline_vectors || !ctx->offline_resp_dir) {
+        return ACVP_MALLOC_FAIL;
+    }
+
+    return ACVP_SUCCESS;
+}
+
 /*
  * Allows application to specify the vendor attributes for
  * the test session.
@@ -3558,10 +3789,27 @@ static ACVP_RESULT acvp_lookup_prereqVals (JSON_Object *cap_obj, ACVP_CAPS_LIST
 }
 
 static ACVP_RESULT acvp_build_hash_register_cap (JSON_Object *cap_obj, ACVP_CAPS_LIST *cap_entry) {
+    JSON_Array *temp_arr = NULL;
+    int size;
+
     json_object_set_string(cap_obj, "algorithm", acvp_lookup_cipher_name(cap_entry->cipher));
     json_object_set_boolean(cap_obj, "inBit", cap_entry->cap.hash_cap->in_bit);
     json_object_set_boolean(cap_obj, "inEmpty", cap_entry->cap.hash_cap->in_empty);
 
+    /*
+     * Large data tests are only offered when the messages
+     * can be streamed to the crypto module
+     */
+    if (cap_entry->cap.hash_cap->large_data && cap_entry->cap.hash_cap->stream.update) {
+        json_object_set_value(cap_obj, "performLargeDataTest", json_value_init_array());
+        temp_arr = json_object_get_array(cap_obj, "performLargeDataTest");
+        for (size = 1; size <= 8; size <<= 1) {
+            if (cap_entry->cap.hash_cap->large_data & size) {
+                json_array_append_number(temp_arr, size);
+            }
+        }
+    }
+
     return ACVP_SUCCESS;
 }
 
@@ -5727,12 +5975,181 @@ static ACVP_RESULT acvp_build_kas_ffc_register_cap (ACVP_CTX *ctx, JSON_Object *
  * will be sent to the ACVP server to advertised the crypto
  * capabilities of the module under test.
  */
-static ACVP_RESULT acvp_build_register (ACVP_CTX *ctx, char **reg) {
-    ACVP_CAPS_LIST *cap_entry;
-
-    JSON_Value *reg_arry_val = NULL;
-    JSON_Value *ver_val = NULL;
-    JSON_Object *ver_obj = NULL;
+/*
+ * Builds the registration JSON of a single capability into cap_obj,
+ * based on the cipher type
+ */
+static ACVP_RESULT acvp_build_cap (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap_entry, JSON_Object *cap_obj) {
+    switch (cap_entry->cipher) {
+    case ACVP_AES_GCM:
+    case ACVP_AES_CCM:
+    case ACVP_AES_ECB:
+    case ACVP_AES_CFB1:
+    case ACVP_AES_CFB8:
+    case ACVP_AES_CFB128:
+    case ACVP_AES_CTR:
+    case ACVP_AES_OFB:
+    case ACVP_AES_CBC:
+    case ACVP_AES_KW:
+    case ACVP_AES_KWP:
+    case ACVP_AES_XTS:
+    case ACVP_TDES_ECB:
+    case ACVP_TDES_CBC:
+    case ACVP_TDES_CTR:
+    case ACVP_TDES_OFB:
+    case ACVP_TDES_CFB64:
+    case ACVP_TDES_CFB8:
+    case ACVP_TDES_CFB1:
+    case ACVP_TDES_KW:
+        acvp_build_sym_cipher_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_SHA1:
+    case ACVP_SHA224:
+    case ACVP_SHA256:
+    case ACVP_SHA384:
+    case ACVP_SHA512:
+        acvp_build_hash_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_HASHDRBG:
+    case ACVP_HMACDRBG:
+    case ACVP_CTRDRBG:
+        acvp_build_drbg_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_HMAC_SHA1:
+    case ACVP_HMAC_SHA2_224:
+    case ACVP_HMAC_SHA2_256:
+    case ACVP_HMAC_SHA2_384:
+    case ACVP_HMAC_SHA2_512:
+        acvp_build_hmac_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_CMAC_AES:
+    case ACVP_CMAC_TDES:
+        acvp_build_cmac_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_DSA_KEYGEN:
+        acvp_build_dsa_register_cap(cap_obj, cap_entry, ACVP_DSA_MODE_KEYGEN);
+        break;
+    case ACVP_DSA_PQGVER:
+        acvp_build_dsa_register_cap(cap_obj, cap_entry, ACVP_DSA_MODE_PQGVER);
+        break;
+    case ACVP_DSA_PQGGEN:
+        acvp_build_dsa_register_cap(cap_obj, cap_entry, ACVP_DSA_MODE_PQGGEN);
+        break;
+    case ACVP_DSA_SIGGEN:
+        acvp_build_dsa_register_cap(cap_obj, cap_entry, ACVP_DSA_MODE_SIGGEN);
+        break;
+    case ACVP_DSA_SIGVER:
+        acvp_build_dsa_register_cap(cap_obj, cap_entry, ACVP_DSA_MODE_SIGVER);
+        break;
+    case ACVP_RSA_KEYGEN:
+        acvp_build_rsa_keygen_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_RSA_SIGGEN:
+        acvp_build_rsa_sig_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_RSA_SIGVER:
+        acvp_build_rsa_sig_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_ECDSA_KEYGEN:
+    case ACVP_ECDSA_KEYVER:
+    case ACVP_ECDSA_SIGGEN:
+    case ACVP_ECDSA_SIGVER:
+        acvp_build_ecdsa_register_cap(cap_entry->cipher, cap_obj, cap_entry);
+        break;
+    case ACVP_KDF135_TLS:
+        acvp_build_kdf135_tls_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_KDF135_SNMP:
+        acvp_build_kdf135_snmp_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_KDF135_SSH:
+        acvp_build_kdf135_ssh_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_KDF135_SRTP:
+        acvp_build_kdf135_srtp_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_KDF135_IKEV2:
+        acvp_build_kdf135_ikev2_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_KDF135_IKEV1:
+        acvp_build_kdf135_ikev1_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_KDF135_X963:
+        acvp_build_kdf135_x963_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_KDF135_TPM:
+        acvp_build_kdf135_tpm_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_KDF108:
+        acvp_build_kdf108_register_cap(cap_obj, cap_entry);
+        break;
+    case ACVP_KAS_ECC_CDH:
+        acvp_build_kas_ecc_register_cap(ctx, cap_obj, cap_entry, ACVP_KAS_ECC_MODE_CDH);
+        break;
+    case ACVP_KAS_ECC_COMP:
+        acvp_build_kas_ecc_register_cap(ctx, cap_obj, cap_entry, ACVP_KAS_ECC_MODE_COMPONENT);
+        break;
+    case ACVP_KAS_ECC_NOCOMP:
+        acvp_build_kas_ecc_register_cap(ctx, cap_obj, cap_entry, ACVP_KAS_ECC_MODE_NOCOMP);
+        break;
+    case ACVP_KAS_FFC_COMP:
+        acvp_build_kas_ffc_register_cap(ctx, cap_obj, cap_entry, ACVP_KAS_FFC_MODE_COMPONENT);
+        break;
+    case ACVP_KAS_FFC_NOCOMP:
+        acvp_build_kas_ffc_register_cap(ctx, cap_obj, cap_entry, ACVP_KAS_FFC_MODE_NOCOMP);
+        break;
+    default:
+        ACVP_LOG_ERR("Cap entry not found, %d.", cap_entry->cipher);
+        return ACVP_NO_CAP;
+    }
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Fingerprints the registration JSON of all the enabled capabilities,
+ * the same way acvp_manifest_check() fingerprints each of them.  The
+ * registration cache is keyed by the result, so any change to the
+ * capabilities gives a new cache entry.
+ */
+ACVP_RESULT acvp_caps_fingerprint (ACVP_CTX *ctx, unsigned long long *fingerprint) {
+    ACVP_CAPS_LIST *cap_entry;
+    JSON_Value *cap_val;
+    char key[2 * 17];
+    unsigned long long hash = 0;
+    ACVP_RESULT rv;
+
+    for (cap_entry = ctx->caps_list; cap_entry; cap_entry = cap_entry->next) {
+        cap_val = json_value_init_object();
+        rv = acvp_build_cap(ctx, cap_entry, json_value_get_object(cap_val));
+        if (rv != ACVP_SUCCESS) {
+            json_value_free(cap_val);
+            return rv;
+        }
+        snprintf(key, sizeof(key), "%016llx%016llx", hash, acvp_cap_fingerprint(cap_val));
+        json_value_free(cap_val);
+        hash = acvp_fnv_hash(key, strlen(key));
+    }
+    *fingerprint = hash;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Identifies this build of libacvp for the registration cache.  The
+ * registration builders live in this file, so a change to any of
+ * them gives a new identity.
+ */
+const char *acvp_build_id (void) {
+    return ACVP_VERSION " " __DATE__ " " __TIME__;
+}
+
+static ACVP_RESULT acvp_build_register (ACVP_CTX *ctx, char **reg) {
+    ACVP_CAPS_LIST *cap_entry;
+    ACVP_RESULT rv;
+
+    JSON_Value *reg_arry_val = NULL;
+    JSON_Value *ver_val = NULL;
+    JSON_Object *ver_obj = NULL;
 
     JSON_Array *reg_arry = NULL;
 
@@ -5858,6 +6275,11 @@ static ACVP_RESULT acvp_build_register (ACVP_CTX *ctx, char **reg) {
     /*
      * Start the capabilities advertisement
      */
+    ctx->manifest_changed = 0;
+    if (ctx->manifest_new) {
+        json_value_free(ctx->manifest_new);
+        ctx->manifest_new = json_value_init_object();
+    }
     caps_val = json_value_init_object();
     caps_obj = json_value_get_object(caps_val);
     json_object_set_value(caps_obj, "algorithms", json_value_init_array());
@@ -5879,137 +6301,27 @@ static ACVP_RESULT acvp_build_register (ACVP_CTX *ctx, char **reg) {
             cap_val = json_value_init_object();
             cap_obj = json_value_get_object(cap_val);
 
-            /*
-             * Build up the capability JSON based on the cipher type
-             */
-            switch (cap_entry->cipher) {
-            case ACVP_AES_GCM:
-            case ACVP_AES_CCM:
-            case ACVP_AES_ECB:
-            case ACVP_AES_CFB1:
-            case ACVP_AES_CFB8:
-            case ACVP_AES_CFB128:
-            case ACVP_AES_CTR:
-            case ACVP_AES_OFB:
-            case ACVP_AES_CBC:
-            case ACVP_AES_KW:
-            case ACVP_AES_KWP:
-            case ACVP_AES_XTS:
-            case ACVP_TDES_ECB:
-            case ACVP_TDES_CBC:
-            case ACVP_TDES_CTR:
-            case ACVP_TDES_OFB:
-            case ACVP_TDES_CFB64:
-            case ACVP_TDES_CFB8:
-            case ACVP_TDES_CFB1:
-            case ACVP_TDES_KW:
-                acvp_build_sym_cipher_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_SHA1:
-            case ACVP_SHA224:
-            case ACVP_SHA256:
-            case ACVP_SHA384:
-            case ACVP_SHA512:
-                acvp_build_hash_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_HASHDRBG:
-            case ACVP_HMACDRBG:
-            case ACVP_CTRDRBG:
-                acvp_build_drbg_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_HMAC_SHA1:
-            case ACVP_HMAC_SHA2_224:
-            case ACVP_HMAC_SHA2_256:
-            case ACVP_HMAC_SHA2_384:
-            case ACVP_HMAC_SHA2_512:
-                acvp_build_hmac_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_CMAC_AES:
-            case ACVP_CMAC_TDES:
-                acvp_build_cmac_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_DSA_KEYGEN:
-                acvp_build_dsa_register_cap(cap_obj, cap_entry, ACVP_DSA_MODE_KEYGEN);
-                break;
-            case ACVP_DSA_PQGVER:
-                acvp_build_dsa_register_cap(cap_obj, cap_entry, ACVP_DSA_MODE_PQGVER);
-                break;
-            case ACVP_DSA_PQGGEN:
-                acvp_build_dsa_register_cap(cap_obj, cap_entry, ACVP_DSA_MODE_PQGGEN);
-                break;
-            case ACVP_DSA_SIGGEN:
-                acvp_build_dsa_register_cap(cap_obj, cap_entry, ACVP_DSA_MODE_SIGGEN);
-                break;
-            case ACVP_DSA_SIGVER:
-                acvp_build_dsa_register_cap(cap_obj, cap_entry, ACVP_DSA_MODE_SIGVER);
-                break;
-            case ACVP_RSA_KEYGEN:
-                acvp_build_rsa_keygen_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_RSA_SIGGEN:
-                acvp_build_rsa_sig_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_RSA_SIGVER:
-                acvp_build_rsa_sig_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_ECDSA_KEYGEN:
-            case ACVP_ECDSA_KEYVER:
-            case ACVP_ECDSA_SIGGEN:
-            case ACVP_ECDSA_SIGVER:
-                acvp_build_ecdsa_register_cap(cap_entry->cipher, cap_obj, cap_entry);
-                break;
-            case ACVP_KDF135_TLS:
-                acvp_build_kdf135_tls_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_KDF135_SNMP:
-                acvp_build_kdf135_snmp_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_KDF135_SSH:
-                acvp_build_kdf135_ssh_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_KDF135_SRTP:
-                acvp_build_kdf135_srtp_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_KDF135_IKEV2:
-                acvp_build_kdf135_ikev2_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_KDF135_IKEV1:
-                acvp_build_kdf135_ikev1_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_KDF135_X963:
-                acvp_build_kdf135_x963_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_KDF135_TPM:
-                acvp_build_kdf135_tpm_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_KDF108:
-                acvp_build_kdf108_register_cap(cap_obj, cap_entry);
-                break;
-            case ACVP_KAS_ECC_CDH:
-                acvp_build_kas_ecc_register_cap(ctx, cap_obj, cap_entry, ACVP_KAS_ECC_MODE_CDH);
-                break;
-            case ACVP_KAS_ECC_COMP:
-                acvp_build_kas_ecc_register_cap(ctx, cap_obj, cap_entry, ACVP_KAS_ECC_MODE_COMPONENT);
-                break;
-            case ACVP_KAS_ECC_NOCOMP:
-                acvp_build_kas_ecc_register_cap(ctx, cap_obj, cap_entry, ACVP_KAS_ECC_MODE_NOCOMP);
-                break;
-            case ACVP_KAS_FFC_COMP:
-                acvp_build_kas_ffc_register_cap(ctx, cap_obj, cap_entry, ACVP_KAS_FFC_MODE_COMPONENT);
-                break;
-            case ACVP_KAS_FFC_NOCOMP:
-                acvp_build_kas_ffc_register_cap(ctx, cap_obj, cap_entry, ACVP_KAS_FFC_MODE_NOCOMP);
-                break;
-            default:
-                ACVP_LOG_ERR("Cap entry not found, %d.", cap_entry->cipher);
-                return ACVP_NO_CAP;
+            rv = acvp_build_cap(ctx, cap_entry, cap_obj);
+            if (rv != ACVP_SUCCESS) {
+                json_value_free(cap_val);
+                json_value_free(caps_val);
+                json_value_free(val);
+                json_value_free(reg_arry_val);
+                json_value_free(dep_val);
+                return rv;
             }
 
             /*
              * Now that we've built up the JSON for this capability,
              * add it to the array of capabilities on the register message.
+             * Capabilities unchanged since the manifest was saved are
+             * left out.
              */
-            json_array_append_value(caps_arr, cap_val);
+            if (ctx->manifest_file && acvp_manifest_check(ctx, cap_obj, cap_val)) {
+                json_value_free(cap_val);
+            } else {
+                json_array_append_value(caps_arr, cap_val);
+            }
 
             /* Advance to next cap entry */
             cap_entry = cap_entry->next;
@@ -6033,6 +6345,308 @@ void acvp_mark_as_sample (ACVP_CTX *ctx) {
     ctx->is_sample = 1;
 }
 
+/*
+ * This function is used by the application to control
+ * whether the "msg" value of each SHA MCT iteration is
+ * included in the vector set response.
+ */
+ACVP_RESULT acvp_set_hash_mct_msg_output (ACVP_CTX *ctx, int enable) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    ctx->hash_mct_no_msg = enable ? 0 : 1;
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function is used by the application to have the big
+ * numbers of the asymmetric test cases passed as binary.
+ */
+ACVP_RESULT acvp_set_binary_bignums (ACVP_CTX *ctx, int enable) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    ctx->bn_binary = enable ? 1 : 0;
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function is used by the application to set how many
+ * threads the long running asymmetric handlers may use to
+ * run the test cases of a test group in parallel.
+ */
+ACVP_RESULT acvp_set_worker_threads (ACVP_CTX *ctx, int count) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (count < 0) {
+        return ACVP_INVALID_ARG;
+    }
+    ctx->worker_threads = count;
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function is used by the application to record the
+ * HTTP exchanges with the server into a session archive.
+ */
+ACVP_RESULT acvp_set_transport_record (ACVP_CTX *ctx, const char *archive) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!archive) {
+        ACVP_LOG_ERR("Must provide value for the session archive");
+        return ACVP_INVALID_ARG;
+    }
+    if (ctx->record_fp) {
+        fclose(ctx->record_fp);
+    }
+    ctx->record_fp = fopen(archive, "w");
+    if (!ctx->record_fp) {
+        ACVP_LOG_ERR("Unable to create session archive %s", archive);
+        return ACVP_INVALID_ARG;
+    }
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function is used by the application to serve the
+ * HTTP exchanges from a recorded session archive.
+ */
+ACVP_RESULT acvp_set_transport_replay (ACVP_CTX *ctx, const char *archive, int latency_ms) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!archive || latency_ms < 0) {
+        ACVP_LOG_ERR("Must provide the session archive and a valid latency");
+        return ACVP_INVALID_ARG;
+    }
+    ctx->replay_latency = latency_ms;
+
+    return acvp_load_replay_archive(ctx, archive);
+}
+
+/*
+ * This function is used by the application to cache the
+ * downloaded vector sets on disk for later sessions.
+ */
+ACVP_RESULT acvp_set_vector_cache (ACVP_CTX *ctx, const char *cache_dir) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!cache_dir) {
+        ACVP_LOG_ERR("Must provide value for the cache directory");
+        return ACVP_INVALID_ARG;
+    }
+    if (ctx->vs_cache_dir) { free(ctx->vs_cache_dir); }
+    ctx->vs_cache_dir = strdup(cache_dir);
+    if (!ctx->vs_cache_dir) {
+        return ACVP_MALLOC_FAIL;
+    }
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function is used by the application to cache the
+ * registration message on disk for later sessions.
+ */
+ACVP_RESULT acvp_set_registration_cache (ACVP_CTX *ctx, const char *cache_dir, const char *cap_key) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!cache_dir) {
+        ACVP_LOG_ERR("Must provide value for the cache directory");
+        return ACVP_INVALID_ARG;
+    }
+    if (ctx->reg_cache_dir) { free(ctx->reg_cache_dir); }
+    if (ctx->reg_cache_key) { free(ctx->reg_cache_key); }
+    ctx->reg_cache_key = NULL;
+    ctx->reg_cache_dir = strdup(cache_dir);
+    if (!ctx->reg_cache_dir) {
+        return ACVP_MALLOC_FAIL;
+    }
+    if (cap_key) {
+        ctx->reg_cache_key = strdup(cap_key);
+        if (!ctx->reg_cache_key) {
+            return ACVP_MALLOC_FAIL;
+        }
+    }
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function is used by the application to have the
+ * full request and response bodies written to a file.
+ */
+ACVP_RESULT acvp_set_payload_dump (ACVP_CTX *ctx, const char *filename) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!filename) {
+        ACVP_LOG_ERR("Must provide value for the payload dump file");
+        return ACVP_INVALID_ARG;
+    }
+
+    return acvp_payload_dump_start(ctx, filename);
+}
+
+/*
+ * This function is used by the application to receive the
+ * log messages and session events from a logging thread.
+ */
+ACVP_RESULT acvp_set_event_logger (ACVP_CTX *ctx, ACVP_RESULT (*event_cb) (ACVP_LOG_EVENT *event), int ring_size) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!event_cb || ring_size <= 0) {
+        ACVP_LOG_ERR("Must provide an event callback and a ring size");
+        return ACVP_INVALID_ARG;
+    }
+
+    return acvp_log_ring_start(ctx, event_cb, ring_size);
+}
+
+/*
+ * This function is used by the application to record the
+ * timing and throughput metrics of every vector set.
+ */
+ACVP_RESULT acvp_set_metrics (ACVP_CTX *ctx, int enable) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!enable) {
+        acvp_metrics_free(ctx);
+        return ACVP_SUCCESS;
+    }
+
+    return acvp_metrics_start(ctx);
+}
+
+/*
+ * This function is used by the application to query the
+ * metrics recorded for the vector sets.
+ */
+ACVP_RESULT acvp_get_metrics (ACVP_CTX *ctx, const ACVP_VS_METRICS **metrics) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!metrics) {
+        ACVP_LOG_ERR("Must provide a pointer for the metrics");
+        return ACVP_INVALID_ARG;
+    }
+    *metrics = acvp_metrics_list(ctx);
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function is used by the application to save the
+ * metrics recorded for the vector sets as JSON.
+ */
+ACVP_RESULT acvp_export_metrics (ACVP_CTX *ctx, const char *filename) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!filename) {
+        ACVP_LOG_ERR("Must provide value for the metrics file");
+        return ACVP_INVALID_ARG;
+    }
+
+    return acvp_metrics_export(ctx, filename);
+}
+
+/*
+ * This function is used by the application to have the
+ * progress of the session saved in a checkpoint file.
+ */
+ACVP_RESULT acvp_set_checkpoint_file (ACVP_CTX *ctx, const char *filename) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!filename) {
+        ACVP_LOG_ERR("Must provide value for the checkpoint file");
+        return ACVP_INVALID_ARG;
+    }
+    if (ctx->checkpoint_file) { free(ctx->checkpoint_file); }
+    ctx->checkpoint_file = strdup(filename);
+    if (!ctx->checkpoint_file) {
+        return ACVP_MALLOC_FAIL;
+    }
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * This function is used by the application in place of
+ * acvp_register() to continue a checkpointed session.
+ */
+ACVP_RESULT acvp_resume_session (ACVP_CTX *ctx, const char *filename) {
+    ACVP_RESULT rv;
+
+    rv = acvp_set_checkpoint_file(ctx, filename);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
+
+    return acvp_checkpoint_load(ctx, filename);
+}
+
+/*
+ * This function is used by the application to register only
+ * the capabilities that changed since the last passing run.
+ */
+ACVP_RESULT acvp_set_capability_manifest (ACVP_CTX *ctx, const char *manifest) {
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!manifest) {
+        ACVP_LOG_ERR("Must provide value for the capability manifest");
+        return ACVP_INVALID_ARG;
+    }
+    if (ctx->manifest_file) { free(ctx->manifest_file); }
+    ctx->manifest_file = strdup(manifest);
+    if (!ctx->manifest_file) {
+        return ACVP_MALLOC_FAIL;
+    }
+
+    return acvp_manifest_load(ctx, manifest);
+}
+
+/*
+ * This function is used by the application to save the
+ * capability fingerprints once the session passed.
+ */
+ACVP_RESULT acvp_save_capability_manifest (ACVP_CTX *ctx) {
+    ACVP_VS_LIST *vs_entry;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!ctx->manifest_file) {
+        ACVP_LOG_ERR("No capability manifest, use acvp_set_capability_manifest() first.");
+        return ACVP_INVALID_ARG;
+    }
+
+    /*
+     * Only a passing run may update the manifest, otherwise a failed
+     * capability would be skipped by the following runs
+     */
+    for (vs_entry = ctx->vs_list; vs_entry; vs_entry = vs_entry->next) {
+        if (vs_entry->disposition != ACVP_DISP_PASSED) {
+            ACVP_LOG_ERR("vsId: %d did not pass, the capability manifest is not saved", vs_entry->vs_id);
+            return ACVP_TEST_FAIL;
+        }
+    }
+
+    return acvp_manifest_save(ctx);
+}
+
 /*
  * This function builds the JSON login message that
  * will be sent to the ACVP server to perform the
@@ -6088,9 +6702,10 @@ static ACVP_RESULT acvp_build_login (ACVP_CTX *ctx, char **login, int refresh) {
  */
 ACVP_RESULT acvp_register (ACVP_CTX *ctx) {
     ACVP_RESULT rv;
-    char *reg;
+    char *reg = NULL;
     char *login;
     JSON_Value *tmp_json_from_file;
+    int use_cache, cached = 0;
 
     if (!ctx) {
         return ACVP_NO_CTX;
@@ -6106,21 +6721,17 @@ ACVP_RESULT acvp_register (ACVP_CTX *ctx) {
             return rv;
         }
 
-        if (ctx->debug >= ACVP_LOG_LVL_STATUS) {
-            printf("\nPOST %s\n", login);
-        } else {
-            ACVP_LOG_INFO("POST %s", login);
-        }
+        acvp_log_payload(ctx, ACVP_LOG_LVL_STATUS, "POST", login);
 
         /*
          * Send the login to the ACVP server and get the response,
          */
         rv = acvp_send_login(ctx, login);
         if (rv == ACVP_SUCCESS) {
-            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf);
+            acvp_log_payload(ctx, ACVP_LOG_LVL_STATUS, "200 OK", ctx->reg_buf);
             rv = acvp_parse_login(ctx);
         } else {
-            ACVP_LOG_STATUS("Login Response Failed %s", ctx->reg_buf);
+            acvp_log_payload(ctx, ACVP_LOG_LVL_STATUS, "Login Response Failed", ctx->reg_buf);
         }
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_STATUS("Login Send Failed");
@@ -6128,7 +6739,17 @@ ACVP_RESULT acvp_register (ACVP_CTX *ctx) {
         }
     }
 
-    if (ctx->use_json != 1) {
+    /*
+     * A cached registration is sent as it is, skipping both the
+     * capabilities and the JSON registration file.
+     */
+    use_cache = ctx->reg_cache_dir && !ctx->manifest_file;
+    if (use_cache) {
+        reg = acvp_reg_cache_load(ctx);
+    }
+    if (reg) {
+        cached = 1;
+    } else if (ctx->use_json != 1) {
         /*
          * Construct the registration message based on the capabilities
          * the user has enabled.
@@ -6138,17 +6759,21 @@ ACVP_RESULT acvp_register (ACVP_CTX *ctx) {
             ACVP_LOG_ERR("Unable to build register message");
             return rv;
         }
+        if (ctx->manifest_file && !ctx->manifest_changed) {
+            ACVP_LOG_STATUS("No capabilities changed since the manifest was saved, nothing to register");
+            json_free_serialized_string(reg);
+            return ACVP_SUCCESS;
+        }
     } else {
         tmp_json_from_file = json_parse_file(ctx->json_filename);
         reg = json_serialize_to_string_pretty(tmp_json_from_file);
         json_value_free(tmp_json_from_file);
     }
-
-    if (ctx->debug >= ACVP_LOG_LVL_STATUS) {
-        printf("\nPOST %s\n", reg);
-    } else {
-        ACVP_LOG_INFO("POST %s", reg);
+    if (use_cache && !cached) {
+        acvp_reg_cache_store(ctx, reg);
     }
+
+    acvp_log_payload(ctx, ACVP_LOG_LVL_STATUS, "POST", reg);
     /*
      * Send the capabilities to the ACVP server and get the response,
      * which should be a list of VS identifiers that will need
@@ -6156,11 +6781,20 @@ ACVP_RESULT acvp_register (ACVP_CTX *ctx) {
      */
     rv = acvp_send_register(ctx, reg);
     if (rv == ACVP_SUCCESS) {
-        ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf);
+        acvp_log_payload(ctx, ACVP_LOG_LVL_STATUS, "200 OK", ctx->reg_buf);
         rv = acvp_parse_register(ctx);
     }
+    if (rv == ACVP_SUCCESS && ctx->checkpoint_file) {
+        if (ctx->checkpoint_reg) { free(ctx->checkpoint_reg); }
+        ctx->checkpoint_reg = strdup(ctx->reg_buf);
+        acvp_checkpoint_save(ctx);
+    }
 
-    json_free_serialized_string(reg);
+    if (cached) {
+        free(reg);
+    } else {
+        json_free_serialized_string(reg);
+    }
 
     return (rv);
 }
@@ -6657,13 +7291,21 @@ static ACVP_RESULT acvp_parse_register (ACVP_CTX *ctx) {
  * it should be run on a separate thread if needed.
  */
 ACVP_RESULT acvp_process_tests (ACVP_CTX *ctx) {
-    ACVP_RESULT rv;
+    ACVP_RESULT rv = ACVP_SUCCESS;
     ACVP_VS_LIST *vs_entry;
 
     if (!ctx) {
         return ACVP_NO_CTX;
     }
 
+    /*
+     * In offline mode the vector sets come from local files
+     * and the responses are saved rather than submitted.
+     */
+    if (ctx->offline_vectors) {
+        return acvp_process_offline_vectors(ctx);
+    }
+
     /*
      * Iterate through the VS identifiers the server sent to us
      * in the regisration response.  Process each vector set and
@@ -6671,7 +7313,11 @@ ACVP_RESULT acvp_process_tests (ACVP_CTX *ctx) {
      */
     vs_entry = ctx->vs_list;
     while (vs_entry) {
-        rv = acvp_process_vsid(ctx, vs_entry->vs_id);
+        if (vs_entry->state >= ACVP_VS_UPLOADED) {
+            ACVP_LOG_STATUS("vsId: %d was already uploaded", vs_entry->vs_id);
+        } else {
+            rv = acvp_process_vsid(ctx, vs_entry->vs_id);
+        }
         vs_entry = vs_entry->next;
     }
 
@@ -6685,6 +7331,10 @@ ACVP_RESULT acvp_process_tests (ACVP_CTX *ctx) {
  */
 ACVP_RESULT acvp_retry_handler (ACVP_CTX *ctx, unsigned int retry_period) {
     ACVP_LOG_STATUS("200 OK KAT values not ready, server requests we wait and try again...");
+    if (ctx->replay_val) {
+        /* the replay latency stands in for the server */
+        return ACVP_KAT_DOWNLOAD_RETRY;
+    }
     if (retry_period <= 0 || retry_period > ACVP_RETRY_TIME_MAX) {
         retry_period = ACVP_RETRY_TIME_MAX;
         ACVP_LOG_WARN("retry_period not found, using max retry period!");
@@ -6697,10 +7347,12 @@ ACVP_RESULT acvp_retry_handler (ACVP_CTX *ctx, unsigned int retry_period) {
 
 /*
  * This routine will iterate through all the vector sets, requesting
- * the test result from the server for each set.
+ * the test result from the server for each set.  The first error is
+ * returned, the disposition of each vector set is recorded in the
+ * vector set list.
  */
 ACVP_RESULT acvp_check_test_results (ACVP_CTX *ctx) {
-    ACVP_RESULT rv;
+    ACVP_RESULT rv = ACVP_SUCCESS, vs_rv;
     ACVP_VS_LIST *vs_entry;
 
     if (!ctx) {
@@ -6714,9 +7366,25 @@ ACVP_RESULT acvp_check_test_results (ACVP_CTX *ctx) {
      */
     vs_entry = ctx->vs_list;
     while (vs_entry) {
-        rv = acvp_get_result_vsid(ctx, vs_entry->vs_id);
-        if (ctx->is_sample) {
-            rv = acvp_retrieve_sample_answers(ctx, vs_entry->vs_id);
+        if (vs_entry->state == ACVP_VS_VERIFIED) {
+            vs_entry->disposition = ACVP_DISP_PASSED;
+            vs_entry = vs_entry->next;
+            continue;
+        }
+        /*
+         * Only a passing vector set is checkpointed as verified, the
+         * results of a failed or incomplete one are fetched again by
+         * a resumed session
+         */
+        vs_rv = acvp_get_result_vsid(ctx, vs_entry);
+        if (vs_rv == ACVP_SUCCESS && vs_entry->disposition == ACVP_DISP_PASSED) {
+            acvp_checkpoint_vs(ctx, vs_entry->vs_id, ACVP_VS_VERIFIED);
+        }
+        if (ctx->is_sample && vs_rv == ACVP_SUCCESS) {
+            vs_rv = acvp_retrieve_sample_answers(ctx, vs_entry->vs_id);
+        }
+        if (vs_rv != ACVP_SUCCESS && rv == ACVP_SUCCESS) {
+            rv = vs_rv;
         }
         vs_entry = vs_entry->next;
     }
@@ -6742,21 +7410,17 @@ ACVP_RESULT acvp_refresh (ACVP_CTX *ctx)
             return rv;
         }
 
-        if (ctx->debug >= ACVP_LOG_LVL_STATUS) {
-            printf("\nPOST %s\n", login);
-        } else {
-            ACVP_LOG_INFO("POST %s", login);
-        }
+        acvp_log_payload(ctx, ACVP_LOG_LVL_STATUS, "POST", login);
 
         /*
          * Send the login to the ACVP server and get the response,
          */
         rv = acvp_send_login(ctx, login);
         if (rv == ACVP_SUCCESS) {
-            ACVP_LOG_STATUS("200 OK %s", ctx->reg_buf);
+            acvp_log_payload(ctx, ACVP_LOG_LVL_STATUS, "200 OK", ctx->reg_buf);
             rv = acvp_parse_login(ctx);
         } else {
-            ACVP_LOG_STATUS("Login Response Failed %s", ctx->reg_buf);
+            acvp_log_payload(ctx, ACVP_LOG_LVL_STATUS, "Login Response Failed", ctx->reg_buf);
         }
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_STATUS("Login Send Failed");
@@ -6785,23 +7449,40 @@ static ACVP_RESULT acvp_process_vsid (ACVP_CTX *ctx, int vs_id) {
     JSON_Object *obj = NULL;
     char *json_buf;
     int retry = 1;
+    int cached;
+    ACVP_METRICS_TIMER timer;
+
+    acvp_metrics_vs(ctx, vs_id);
+
+    /*
+     * A resumed session uploads the response computed
+     * before it was interrupted
+     */
+    if (acvp_checkpoint_restore_response(ctx, vs_id) == ACVP_SUCCESS) {
+        ACVP_LOG_STATUS("Using the checkpointed response for vsId: %d", vs_id);
+        retry = 0;
+    }
 
     //TODO: do we want to limit the number of retries?
     while (retry) {
         /*
-         * Get the KAT vector set
+         * Get the KAT vector set, from the cache when possible
          */
-        rv = acvp_retrieve_vector_set(ctx, vs_id);
-        if (rv != ACVP_SUCCESS) {
-            return (rv);
+        acvp_metrics_timer_start(ctx, &timer);
+        cached = ctx->vs_cache_dir && acvp_vs_cache_load(ctx, vs_id) == ACVP_SUCCESS;
+        if (!cached) {
+            rv = acvp_retrieve_vector_set(ctx, vs_id);
+            if (rv != ACVP_SUCCESS) {
+                return (rv);
+            }
         }
+        acvp_metrics_timer_stop(ctx, ACVP_PHASE_DOWNLOAD, &timer);
         json_buf = ctx->kat_buf;
-        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-            printf("\n200 OK %s\n", ctx->kat_buf);
-        } else {
-            ACVP_LOG_STATUS("200 OK %s\n", ctx->kat_buf);
-        }
+        acvp_log_payload(ctx, ACVP_LOG_LVL_STATUS, "200 OK", ctx->kat_buf);
+        acvp_metrics_bytes(ctx, strlen(json_buf), 0);
+        acvp_metrics_timer_start(ctx, &timer);
         val = json_parse_string_with_comments(json_buf);
+        acvp_metrics_timer_stop(ctx, ACVP_PHASE_PARSE, &timer);
         if (!val) {
             ACVP_LOG_ERR("JSON parse error");
             return ACVP_JSON_ERR;
@@ -6816,10 +7497,23 @@ static ACVP_RESULT acvp_process_vsid (ACVP_CTX *ctx, int vs_id) {
         if (retry_period) {
             rv = acvp_retry_handler(ctx, retry_period);
         } else {
+            acvp_log_event(ctx, ACVP_EVENT_VS_START, ACVP_LOG_LVL_STATUS, 0, NULL, 2,
+                           "algorithm", json_object_get_string(obj, "algorithm"),
+                           "cached", cached ? "yes" : "no");
+            if (ctx->vs_cache_dir && !cached) {
+                acvp_vs_cache_store(ctx, vs_id);
+            }
+            acvp_checkpoint_vs(ctx, vs_id, ACVP_VS_DOWNLOADED);
+            acvp_metrics_count_tests(ctx, obj);
             /*
              * Process the KAT vectors
              */
+            acvp_metrics_timer_start(ctx, &timer);
             rv = acvp_process_vector_set(ctx, obj);
+            acvp_metrics_timer_stop(ctx, ACVP_PHASE_PROCESS, &timer);
+            if (rv == ACVP_SUCCESS) {
+                acvp_checkpoint_vs(ctx, vs_id, ACVP_VS_COMPUTED);
+            }
         }
         json_value_free(val);
 
@@ -6844,10 +7538,174 @@ static ACVP_RESULT acvp_process_vsid (ACVP_CTX *ctx, int vs_id) {
     if (rv != ACVP_SUCCESS) {
         return (rv);
     }
+    acvp_checkpoint_vs(ctx, vs_id, ACVP_VS_UPLOADED);
+    acvp_log_event(ctx, ACVP_EVENT_VS_DONE, ACVP_LOG_LVL_STATUS, 0, NULL, 0);
 
     return ACVP_SUCCESS;
 }
 
+/*
+ * This function processes a single vector set that was read
+ * from a local file.  The vector set is held in the same form
+ * the server returns it in.  The vector set response is written
+ * to the offline response directory as vsid_<vsId>.json.
+ */
+static ACVP_RESULT acvp_process_offline_vs (ACVP_CTX *ctx, JSON_Value *val) {
+    ACVP_RESULT rv;
+    JSON_Object *obj = NULL;
+    char resp_file[ACVP_OFFLINE_PATH_MAX];
+    int vs_id;
+    JSON_Status status;
+    ACVP_METRICS_TIMER timer;
+
+    obj = acvp_get_obj_from_rsp(val);
+    if (!obj) {
+        ACVP_LOG_ERR("JSON parse error: vector set missing acvVersion");
+        return ACVP_MALFORMED_JSON;
+    }
+    vs_id = json_object_get_number(obj, "vsId");
+
+    /*
+     * A retry response means the vector set was saved before
+     * the server had generated it, there is nothing to process.
+     */
+    if (json_object_get_number(obj, "retry")) {
+        ACVP_LOG_ERR("Vector set vsId: %d was saved before the KAT values were ready", vs_id);
+        return ACVP_MALFORMED_JSON;
+    }
+
+    ctx->vs_id = vs_id;
+    acvp_metrics_vs(ctx, vs_id);
+    acvp_metrics_count_tests(ctx, obj);
+    acvp_metrics_timer_start(ctx, &timer);
+    rv = acvp_process_vector_set(ctx, obj);
+    acvp_metrics_timer_stop(ctx, ACVP_PHASE_PROCESS, &timer);
+    if (rv != ACVP_SUCCESS) {
+        if (ctx->kat_resp) {
+            json_value_free(ctx->kat_resp);
+            ctx->kat_resp = NULL;
+        }
+        return rv;
+    }
+
+    snprintf(resp_file, ACVP_OFFLINE_PATH_MAX, "%s/" ACVP_OFFLINE_RESP_PREFIX "%d.json", ctx->offline_resp_dir, vs_id);
+    acvp_metrics_timer_start(ctx, &timer);
+    status = json_serialize_to_file_pretty(ctx->kat_resp, resp_file);
+    acvp_metrics_timer_stop(ctx, ACVP_PHASE_SERIALIZE, &timer);
+    if (status != JSONSuccess) {
+        ACVP_LOG_ERR("Unable to write vector set response to %s", resp_file);
+        rv = ACVP_INVALID_ARG;
+    } else {
+        ACVP_LOG_STATUS("Saved vector set response vsId: %d to %s", vs_id, resp_file);
+    }
+    json_value_free(ctx->kat_resp);
+    ctx->kat_resp = NULL;
+
+    return rv;
+}
+
+/*
+ * This function processes every vector set held in a local file.
+ * The file holds either a single vector set, or a bundle which is
+ * a JSON array of vector sets.  All the vector sets are processed
+ * even if one fails, the first failure is returned.
+ */
+static ACVP_RESULT acvp_process_offline_file (ACVP_CTX *ctx, const char *filename) {
+    ACVP_RESULT rv = ACVP_SUCCESS, vs_rv;
+    JSON_Value *val;
+    JSON_Array *arr;
+    JSON_Value *vs_val;
+    int i, vs_cnt;
+
+    ACVP_LOG_STATUS("Reading vector sets from %s", filename);
+    val = json_parse_file_with_comments(filename);
+    if (!val) {
+        ACVP_LOG_ERR("JSON parse error in %s", filename);
+        return ACVP_JSON_ERR;
+    }
+    arr = json_value_get_array(val);
+    if (!arr) {
+        ACVP_LOG_ERR("JSON parse error: %s does not hold a vector set", filename);
+        json_value_free(val);
+        return ACVP_MALFORMED_JSON;
+    }
+
+    if (json_array_get_string(arr, 0) == NULL &&
+        json_object_get_string(json_array_get_object(arr, 0), "acvVersion")) {
+        rv = acvp_process_offline_vs(ctx, val);
+    } else {
+        vs_cnt = json_array_get_count(arr);
+        for (i = 0; i < vs_cnt; i++) {
+            vs_val = json_array_get_value(arr, i);
+            vs_rv = acvp_process_offline_vs(ctx, vs_val);
+            if (vs_rv != ACVP_SUCCESS && rv == ACVP_SUCCESS) {
+                rv = vs_rv;
+            }
+        }
+    }
+
+    json_value_free(val);
+    return rv;
+}
+
+/*
+ * Only the *.json files in the offline vector directory are
+ * processed.  The vsid_<vsId>.json responses are skipped, so the
+ * responses of an earlier run left in the same directory are not
+ * taken for vector sets.
+ */
+static int acvp_offline_file_filter (const struct dirent *entry) {
+    size_t len = strnlen(entry->d_name, sizeof(entry->d_name));
+
+    if (!strncmp(entry->d_name, ACVP_OFFLINE_RESP_PREFIX, strlen(ACVP_OFFLINE_RESP_PREFIX))) {
+        return 0;
+    }
+    return (len > 5 && !strncmp(entry->d_name + len - 5, ".json", 5));
+}
+
+/*
+ * This function replaces the download/process/submit flow of
+ * acvp_process_vsid() when running offline.  The vector sets are
+ * read from the directory or bundle file given to
+ * acvp_set_offline_vectors(), so that the tests can run on
+ * hardware that has no access to the server.
+ */
+static ACVP_RESULT acvp_process_offline_vectors (ACVP_CTX *ctx) {
+    ACVP_RESULT rv = ACVP_SUCCESS, file_rv;
+    struct stat st;
+    struct dirent **names = NULL;
+    char filename[ACVP_OFFLINE_PATH_MAX];
+    int i, cnt;
+
+    if (stat(ctx->offline_vectors, &st)) {
+        ACVP_LOG_ERR("Unable to access offline vector sets %s", ctx->offline_vectors);
+        return ACVP_INVALID_ARG;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return acvp_process_offline_file(ctx, ctx->offline_vectors);
+    }
+
+    cnt = scandir(ctx->offline_vectors, &names, acvp_offline_file_filter, alphasort);
+    if (cnt < 0) {
+        ACVP_LOG_ERR("Unable to read offline vector set directory %s", ctx->offline_vectors);
+        return ACVP_INVALID_ARG;
+    }
+    if (!cnt) {
+        ACVP_LOG_WARN("No vector sets found in %s", ctx->offline_vectors);
+    }
+    for (i = 0; i < cnt; i++) {
+        snprintf(filename, ACVP_OFFLINE_PATH_MAX, "%s/%s", ctx->offline_vectors, names[i]->d_name);
+        file_rv = acvp_process_offline_file(ctx, filename);
+        if (file_rv != ACVP_SUCCESS && rv == ACVP_SUCCESS) {
+            rv = file_rv;
+        }
+        free(names[i]);
+    }
+    free(names);
+
+    return rv;
+}
+
 /*
  * This function is used to invoke the appropriate handler function
  * for a given ACV operation.  The operation is specified in the
@@ -6922,14 +7780,22 @@ static ACVP_RESULT acvp_process_vector_set (ACVP_CTX *ctx, JSON_Object *obj) {
 
 
 /*
- * This function will get the test results for a single KAT vector set.
+ * This function will get the test results for a single KAT vector set
+ * and record its disposition in the vector set list entry.
  */
-static ACVP_RESULT acvp_get_result_vsid (ACVP_CTX *ctx, int vs_id) {
+static ACVP_RESULT acvp_get_result_vsid (ACVP_CTX *ctx, ACVP_VS_LIST *vs_entry) {
     ACVP_RESULT rv;
     JSON_Value *val;
     JSON_Object *obj = NULL;
+    JSON_Array *tests;
+    JSON_Object *test;
+    const char *disposition, *result;
     char *json_buf;
+    int vs_id = vs_entry->vs_id;
     int retry = 1;
+    int i;
+
+    vs_entry->disposition = ACVP_DISP_UNKNOWN;
 
     while (retry) {
         /*
@@ -6941,11 +7807,7 @@ static ACVP_RESULT acvp_get_result_vsid (ACVP_CTX *ctx, int vs_id) {
         }
         json_buf = ctx->kat_buf;
 
-        if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-            printf("\n%s\n", ctx->kat_buf);
-        } else {
-            ACVP_LOG_ERR("%s", ctx->kat_buf);
-        }
+        acvp_log_payload(ctx, ACVP_LOG_LVL_ERR, "Results", ctx->kat_buf);
         val = json_parse_string_with_comments(json_buf);
         if (!val) {
             ACVP_LOG_ERR("JSON parse error");
@@ -6963,9 +7825,31 @@ static ACVP_RESULT acvp_get_result_vsid (ACVP_CTX *ctx, int vs_id) {
         } else {
             /*
              * Parse the JSON response from the server, if the vector set failed,
-             * then pull out the reason code and log it.
+             * then log the test cases that failed.
              */
-            //TODO
+            disposition = json_object_get_string(obj, "disposition");
+            if (!disposition) {
+                ACVP_LOG_ERR("Server JSON missing 'disposition' for vsId: %d", vs_id);
+                rv = ACVP_MALFORMED_JSON;
+            } else if (!strncmp(disposition, "passed", 6)) {
+                vs_entry->disposition = ACVP_DISP_PASSED;
+                ACVP_LOG_STATUS("vsId: %d passed", vs_id);
+            } else if (!strncmp(disposition, "failed", 6)) {
+                vs_entry->disposition = ACVP_DISP_FAILED;
+                ACVP_LOG_ERR("vsId: %d failed", vs_id);
+                tests = json_object_get_array(obj, "tests");
+                for (i = 0; i < (int) json_array_get_count(tests); i++) {
+                    test = json_array_get_object(tests, i);
+                    result = json_object_get_string(test, "result");
+                    if (result && strncmp(result, "passed", 6)) {
+                        ACVP_LOG_ERR("vsId: %d tcId: %d %s", vs_id,
+                                     (int) json_object_get_number(test, "tcId"), result);
+                    }
+                }
+            } else {
+                vs_entry->disposition = ACVP_DISP_INCOMPLETE;
+                ACVP_LOG_WARN("vsId: %d is %s", vs_id, disposition);
+            }
         }
         json_value_free(val);
 
@@ -7567,6 +8451,37 @@ ACVP_RESULT acvp_enable_kdf135_ssh_cap (
     return (acvp_append_kdf135_ssh_caps_entry(ctx, cap, crypto_handler));
 }
 
+/*
+ * Add the optional kdf135 batch callback
+ */
+ACVP_RESULT acvp_enable_kdf135_batch_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*batch_cb) (ACVP_TEST_BATCH *batch)) {
+    ACVP_CAPS_LIST *cap;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!batch_cb) {
+        return ACVP_INVALID_ARG;
+    }
+    if (cipher < ACVP_KDF135_TLS || cipher > ACVP_KDF135_TPM) {
+        ACVP_LOG_ERR("Batch callbacks are only supported for the kdf135 ciphers");
+        return ACVP_INVALID_ARG;
+    }
+
+    cap = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap) {
+        ACVP_LOG_ERR("Cap entry not found, use acvp_enable_kdf135_*_cap() first.");
+        return ACVP_NO_CAP;
+    }
+
+    cap->batch_handler = batch_cb;
+
+    return ACVP_SUCCESS;
+}
+
 static ACVP_RESULT acvp_validate_kdf135_ssh_param_value (ACVP_KDF135_SSH_METHOD method, ACVP_KDF135_SSH_CAP_PARM param) {
     ACVP_RESULT retval = ACVP_INVALID_ARG;
 
@@ -8212,6 +9127,41 @@ ACVP_RESULT acvp_enable_dsa_cap_parm (ACVP_CTX *ctx,
 
     return (result);
 }
+
+/*
+ * Add the optional DSA group setup/teardown callbacks
+ */
+ACVP_RESULT acvp_enable_dsa_group_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*begin_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*end_cb) (ACVP_TEST_CASE *test_case)) {
+    ACVP_CAPS_LIST *cap;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!begin_cb || !end_cb) {
+        return ACVP_INVALID_ARG;
+    }
+
+    /* Only keyGen and sigGen groups share domain parameters */
+    if (cipher != ACVP_DSA_KEYGEN && cipher != ACVP_DSA_SIGGEN) {
+        return ACVP_INVALID_ARG;
+    }
+
+    cap = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap || !cap->cap.dsa_cap) {
+        ACVP_LOG_ERR("Cap entry not found, use acvp_enable_dsa_cap() first.");
+        return ACVP_NO_CAP;
+    }
+
+    cap->cap.dsa_cap->group.begin = begin_cb;
+    cap->cap.dsa_cap->group.end = end_cb;
+
+    return ACVP_SUCCESS;
+}
+
 /* increment counter (64-bit int) by 1 */
 void ctr64_inc(unsigned char *counter)
 {
@@ -8617,6 +9567,40 @@ ACVP_RESULT acvp_enable_kas_ecc_cap_scheme (ACVP_CTX *ctx,
     return ACVP_SUCCESS;
 }
 
+/*
+ * Add the optional KAS-ECC group setup/teardown callbacks
+ */
+ACVP_RESULT acvp_enable_kas_ecc_group_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*begin_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*end_cb) (ACVP_TEST_CASE *test_case)) {
+    ACVP_CAPS_LIST *cap;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!begin_cb || !end_cb) {
+        return ACVP_INVALID_ARG;
+    }
+
+    /* Only the CDH and component modes are tested */
+    if (cipher != ACVP_KAS_ECC_CDH && cipher != ACVP_KAS_ECC_COMP) {
+        return ACVP_INVALID_ARG;
+    }
+
+    cap = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap || !cap->cap.kas_ecc_cap) {
+        ACVP_LOG_ERR("Cap entry not found, use acvp_enable_kas_ecc_cap() first.");
+        return ACVP_NO_CAP;
+    }
+
+    cap->cap.kas_ecc_cap->group.begin = begin_cb;
+    cap->cap.kas_ecc_cap->group.end = end_cb;
+
+    return ACVP_SUCCESS;
+}
+
 /*
  * Append a KAS-FFC pre req val to the capabilities
  */
@@ -8949,3 +9933,37 @@ ACVP_RESULT acvp_enable_kas_ffc_cap_scheme (ACVP_CTX *ctx,
     }
     return ACVP_SUCCESS;
 }
+
+/*
+ * Add the optional KAS-FFC group setup/teardown callbacks
+ */
+ACVP_RESULT acvp_enable_kas_ffc_group_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*begin_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*end_cb) (ACVP_TEST_CASE *test_case)) {
+    ACVP_CAPS_LIST *cap;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!begin_cb || !end_cb) {
+        return ACVP_INVALID_ARG;
+    }
+
+    /* Only the component mode is tested */
+    if (cipher != ACVP_KAS_FFC_COMP) {
+        return ACVP_INVALID_ARG;
+    }
+
+    cap = acvp_locate_cap_entry(ctx, cipher);
+    if (!cap || !cap->cap.kas_ffc_cap) {
+        ACVP_LOG_ERR("Cap entry not found, use acvp_enable_kas_ffc_cap() first.");
+        return ACVP_NO_CAP;
+    }
+
+    cap->cap.kas_ffc_cap->group.begin = begin_cb;
+    cap->cap.kas_ffc_cap->group.end = end_cb;
+
+    return ACVP_SUCCESS;
+}
@@ -58,6 +58,69 @@ typedef enum acvp_log_lvl {
     ACVP_LOG_LVL_VERBOSE,
 } ACVP_LOG_LVL;
 
+/*
+ * Events delivered to the callback set with acvp_set_event_logger()
+ */
+typedef enum acvp_log_event_type {
+    ACVP_EVENT_MSG = 0,     /* a log message, the text is in msg */
+    ACVP_EVENT_HTTP,        /* an HTTP exchange with the server */
+    ACVP_EVENT_VS_START,    /* processing of a vector set started */
+    ACVP_EVENT_VS_DONE,     /* a vector set was processed and uploaded */
+    ACVP_EVENT_TC_FAIL,     /* the crypto module failed a test case */
+    ACVP_EVENT_DROPPED,     /* events were dropped, the ring was full */
+} ACVP_LOG_EVENT_TYPE;
+
+#define ACVP_LOG_MSG_MAX 1024
+#define ACVP_LOG_FIELD_MAX 8
+#define ACVP_LOG_KEY_MAX 32
+#define ACVP_LOG_VALUE_MAX 128
+
+typedef struct acvp_log_field_t {
+    char key[ACVP_LOG_KEY_MAX];
+    char value[ACVP_LOG_VALUE_MAX];
+} ACVP_LOG_FIELD;
+
+typedef struct acvp_log_event_t {
+    ACVP_LOG_EVENT_TYPE type;
+    ACVP_LOG_LVL level;
+    int vs_id;              /* vector set the event is about, 0 for none */
+    int tc_id;              /* test case the event is about, 0 for none */
+    long long timestamp;    /* microseconds since the epoch */
+    char msg[ACVP_LOG_MSG_MAX];
+    int field_cnt;
+    ACVP_LOG_FIELD fields[ACVP_LOG_FIELD_MAX];
+} ACVP_LOG_EVENT;
+
+/*
+ * Phases of a vector set that acvp_set_metrics() times
+ */
+typedef enum acvp_metrics_phase {
+    ACVP_PHASE_DOWNLOAD = 0,    /* retrieving the vector set, or loading it from the cache */
+    ACVP_PHASE_PARSE,           /* parsing the vector set JSON */
+    ACVP_PHASE_PROCESS,         /* running the test cases and building the response */
+    ACVP_PHASE_SERIALIZE,       /* serializing the response */
+    ACVP_PHASE_UPLOAD,          /* submitting the response */
+    ACVP_PHASE_MAX
+} ACVP_METRICS_PHASE;
+
+#define ACVP_METRICS_HIST_MAX 24
+
+typedef struct acvp_vs_metrics_t {
+    int vs_id;
+    double wall[ACVP_PHASE_MAX];    /* seconds */
+    double cpu[ACVP_PHASE_MAX];     /* seconds of process CPU time */
+    long long bytes_received;
+    long long bytes_sent;
+    int test_groups;
+    int test_cases;
+    int callbacks;                  /* crypto handler calls */
+    double callback_time;           /* seconds spent in the crypto handler */
+    double callback_max;            /* seconds of the slowest call */
+    int callback_hist[ACVP_METRICS_HIST_MAX];   /* bucket i counts the calls under 2^i microseconds,
+                                                   the last bucket the slower ones */
+    struct acvp_vs_metrics_t *next;
+} ACVP_VS_METRICS;
+
 /*! @struct ACVP_CTX
  *  @brief This opaque structure is used to maintain the state of a test session
  *         with an ACVP server.  A single instance of this context
@@ -235,7 +298,6 @@ typedef enum acvp_kdf135_srtp_param {
     ACVP_SRTP_PARAM_MAX
 } ACVP_KDF135_SRTP_PARAM;
 
-#define ACVP_KDF108_KEYOUT_MAX 512
 #define ACVP_KDF108_FIXED_DATA_MAX 512
 
 /*! @struct ACVP_KDF108_MODE */
@@ -346,7 +408,8 @@ typedef enum acvp_kdf135_snmp_param {
 #define ACVP_STR_SHA2_512_256   "SHA2-512/256"
 typedef enum acvp_hash_param {
     ACVP_HASH_IN_BIT = 0,
-    ACVP_HASH_IN_EMPTY
+    ACVP_HASH_IN_EMPTY,
+    ACVP_HASH_LARGE_DATA
 } ACVP_HASH_PARM;
 
 /*
@@ -527,7 +590,8 @@ typedef enum acvp_sym_cipher_testtype {
 typedef enum acvp_hash_testtype {
     ACVP_HASH_TEST_TYPE_NONE = 0,
     ACVP_HASH_TEST_TYPE_AFT,
-    ACVP_HASH_TEST_TYPE_MCT
+    ACVP_HASH_TEST_TYPE_MCT,
+    ACVP_HASH_TEST_TYPE_LDT
 } ACVP_HASH_TESTTYPE;
 
 /*! @struct ACVP_HMAC_PARM */
@@ -597,7 +661,9 @@ typedef struct acvp_sym_cipher_tc_t {
     unsigned int iv_len;
     unsigned int ct_len;
     unsigned int tag_len;
-    unsigned int mct_index;  /* used to identify init vs. update */
+    unsigned int mct_index;  /* used to identify init vs. update, for MCT the
+                                key only changes when this is 0 so the key
+                                schedule may be reused for the other values */
 } ACVP_SYM_CIPHER_TC;
 
 /*!
@@ -624,12 +690,16 @@ typedef struct acvp_hash_tc_t {
     unsigned int tc_id;    /* Test case id */
     ACVP_HASH_TESTTYPE test_type; /* KAT or MCT */
     unsigned char *msg;
-    unsigned char *m1;
-    unsigned char *m2;
+    unsigned char *m1; /* MCT messages, these and md are rotated between */
+    unsigned char *m2; /* iterations so the pointers must not be cached  */
     unsigned char *m3;
     unsigned int msg_len;
     unsigned char *md; /* The resulting digest calculated for the test case */
     unsigned int md_len;
+    unsigned long long full_len; /* Length in bytes of the entire message when
+                                    it is streamed, msg/msg_len is the chunk */
+    void *stream_ctx;   /* --- User supplied --- state of a streamed digest,
+                           kept from init_cb until final_cb */
 } ACVP_HASH_TC;
 
 /*!
@@ -774,16 +844,25 @@ typedef struct acvp_kdf108_tc_t {
     ACVP_KDF108_MODE mode;
     ACVP_KDF108_MAC_MODE_VAL mac_mode;
     ACVP_KDF108_FIXED_DATA_ORDER_VAL counter_location;
-    unsigned char *key_in;
-    unsigned char *key_out;
-    unsigned char *fixed_data;
-    int key_in_len;             /**< Length of key_in (in bytes) */
-    int key_out_len;            /**< Length of key_out (in bytes) */
+    unsigned char *key_in;      /**< key_in_len bytes */
+    unsigned char *key_out;     /**< key_out_len bytes, --- User supplied --- */
+    unsigned char *fixed_data;  /**< ACVP_KDF108_FIXED_DATA_MAX bytes,
+                                     --- User supplied --- */
+    int key_in_len;             /**< Length of key_in (in bytes), from the
+                                     group's MAC mode */
+    int key_out_len;            /**< Length of key_out (in bytes), from the
+                                     group's keyOutLength.  The buffers are
+                                     sized for each test group, there is no
+                                     fixed limit. */
     int fixed_data_len;         /**< Length of fixed_data (in bytes).
                                      --- User supplied ---
                                      Must be <= ACVP_KDF108_FIXED_DATA_MAX */
     int counter_len;
     int deferred;
+    int break_location;         /**< Position of the counter within the
+                                     fixed_data (in bits), only used for
+                                     ACVP_KDF108_FIXED_DATA_ORDER_MIDDLE.
+                                     --- User supplied --- */
 } ACVP_KDF108_TC;
 
 /*!
@@ -791,6 +870,9 @@ typedef struct acvp_kdf108_tc_t {
  * @brief This struct holds data that represents a single test
  * case for kdf135 SRTP testing.  This data is
  * passed between libacvp and the crypto module.
+ * The crypto module derives all six SRTP and SRTCP keys of the
+ * master key in the same call, so the AES key schedule of the
+ * master key only needs to be set up once per test case.
  */
 typedef struct acvp_kdf135_srtp_tc_t {
     ACVP_CIPHER cipher;
@@ -859,6 +941,10 @@ typedef struct acvp_hmac_tc_t {
     unsigned int mac_len;
     unsigned int key_len;
     unsigned char *key;
+    unsigned long long full_len; /* Length in bytes of the entire message when
+                                    it is streamed, msg/msg_len is the chunk */
+    void *stream_ctx;   /* --- User supplied --- state of a streamed mac,
+                           kept from init_cb until final_cb */
 } ACVP_HMAC_TC;
 
 /*!
@@ -882,8 +968,28 @@ typedef struct acvp_cmac_tc_t {
     /* for CMAC-TDES */
     unsigned char *key2;
     unsigned char *key3;
+    unsigned long long full_len; /* Length in bytes of the entire message when
+                                    it is streamed, msg/msg_len is the chunk */
+    void *stream_ctx;   /* --- User supplied --- state of a streamed mac,
+                           kept from init_cb until final_cb */
 } ACVP_CMAC_TC;
 
+#define ACVP_BN_MAX 512 /* bytes, enough for a 4096 bit value */
+/*!
+ * @struct ACVP_BN
+ * @brief This struct holds a big number as a big-endian byte
+ * buffer.  The asymmetric test cases carry these in their "bn"
+ * member in place of the hex string fields when
+ * acvp_set_binary_bignums() is enabled.  val always points to a
+ * buffer of ACVP_BN_MAX bytes owned by libacvp.  For an input
+ * len is the number of bytes in val, for an output the crypto
+ * module writes the value to val and sets len.
+ */
+typedef struct acvp_bn_t {
+    unsigned char *val;
+    int len;
+} ACVP_BN;
+
 /*!
  * @struct ACVP_RSA_KEYGEN_TC
  * @brief This struct holds data that represents a single
@@ -931,6 +1037,14 @@ typedef struct acvp_rsa_keygen_tc_t {
     int bitlen2;
     int bitlen3;
     int bitlen4;
+
+    struct {
+        ACVP_BN e;
+        ACVP_BN p;
+        ACVP_BN q;
+        ACVP_BN n;
+        ACVP_BN d;
+    } bn;    /* Used in place of e/p/q/n/d when binary big numbers are enabled */
 } ACVP_RSA_KEYGEN_TC;
 
 /*!
@@ -957,7 +1071,15 @@ typedef struct acvp_ecdsa_tc_t {
     
     char *ver_disposition;
     unsigned char *message;
-
+    void *group_ctx; /* owned by the crypto module, set by the group callbacks */
+
+    struct {
+        ACVP_BN d;
+        ACVP_BN qx;
+        ACVP_BN qy;
+        ACVP_BN r;
+        ACVP_BN s;
+    } bn;    /* Used in place of d/qx/qy/r/s when binary big numbers are enabled */
 } ACVP_ECDSA_TC;
 
 /*!
@@ -1031,6 +1153,7 @@ typedef enum acvp_dsa_gen_parm {
  */
 /*! @struct ACVP_DSA_TC */
 typedef struct acvp_dsa_tc_t {
+    unsigned int tc_id;    /* Test case id */
     ACVP_CIPHER cipher;
     ACVP_DSA_MODE mode; // "pqgGen", "pqgVer", etc.
     int l;
@@ -1055,6 +1178,17 @@ typedef struct acvp_dsa_tc_t {
     unsigned char *s;
     unsigned char *seed;
     unsigned char *msg;
+    void *group_ctx; /* owned by the crypto module, set by the group callbacks */
+
+    struct {
+        ACVP_BN p;
+        ACVP_BN q;
+        ACVP_BN g;
+        ACVP_BN x;
+        ACVP_BN y;
+        ACVP_BN r;
+        ACVP_BN s;
+    } bn;    /* Used in place of p/q/g/x/y/r/s when binary big numbers are enabled */
 } ACVP_DSA_TC;
 
 #define ACVP_KAS_ECC_MAX_STR 4096
@@ -1146,6 +1280,15 @@ typedef struct acvp_kas_ecc_tc_t {
     int dlen;
     int zlen;
     int chashlen;
+    void *group_ctx; /* owned by the crypto module, set by the group callbacks */
+
+    struct {
+        ACVP_BN psx;
+        ACVP_BN psy;
+        ACVP_BN pix;
+        ACVP_BN piy;
+        ACVP_BN d;
+    } bn;    /* Used in place of psx/psy/pix/piy/d when binary big numbers are enabled */
 } ACVP_KAS_ECC_TC;
 
 #define ACVP_KAS_FFC_MAX_STR 4096
@@ -1232,6 +1375,17 @@ typedef struct acvp_kas_ffc_tc_t {
     int chashlen;
     int piutlen;
     int zlen;
+    void *group_ctx; /* owned by the crypto module, set by the group callbacks */
+
+    struct {
+        ACVP_BN p;
+        ACVP_BN q;
+        ACVP_BN g;
+        ACVP_BN eps;
+        ACVP_BN epri;
+        ACVP_BN epui;
+        ACVP_BN piut;
+    } bn;    /* Used in place of p/q/g/eps/epri/epui/piut when binary big numbers are enabled */
 } ACVP_KAS_FFC_TC;
 
 /*!
@@ -1261,6 +1415,7 @@ typedef struct acvp_drbg_tc_t {
     unsigned int entropy_len;
     unsigned int nonce_len;
     unsigned int drb_len;
+    void *group_ctx; /* owned by the crypto module, set by the group callbacks */
 } ACVP_DRBG_TC;
 
 /*!
@@ -1298,6 +1453,20 @@ typedef struct acvp_test_case_t {
     } tc;
 } ACVP_TEST_CASE;
 
+/*!
+ * @struct ACVP_TEST_BATCH
+ * @brief This struct holds all the test cases of one test group
+ * for the algorithms that can be processed in a batch.  The test
+ * cases in 'tcs' are ready to be processed when the batch is
+ * passed to the crypto module, and the module fills in the
+ * results of each of them the same way the crypto_handler would.
+ */
+typedef struct acvp_test_batch_t {
+    ACVP_CIPHER cipher;
+    int count;              /* Number of test cases in tcs */
+    ACVP_TEST_CASE *tcs;
+} ACVP_TEST_BATCH;
+
 enum acvp_result {
     ACVP_SUCCESS = 0,
     ACVP_MALLOC_FAIL, /**< Error allocating memory */
@@ -1318,6 +1487,7 @@ enum acvp_result {
     ACVP_DUP_CIPHER,
     ACVP_TOTP_DECODE_FAIL,
     ACVP_TOTP_MISSING_SEED,
+    ACVP_TEST_FAIL, /**< One or more vector sets did not pass */
     ACVP_RESULT_MAX,
 };
 
@@ -1468,6 +1638,40 @@ ACVP_RESULT acvp_enable_hash_cap_parm (
         ACVP_HASH_PARM param,
         int value);
 
+/*! @brief acvp_enable_hash_stream_cb() allows an application to have
+       hash messages fed to the crypto module in chunks.
+
+    Messages larger than ACVP_HASH_MSG_MAX, and all large data (LDT)
+    test cases, can't be handed to the crypto module in one buffer.
+    When these callbacks are registered libacvp decodes the message
+    from the vector set a chunk at a time and invokes init_cb once,
+    update_cb for each chunk and final_cb once at the end.  The
+    ACVP_HASH_TC full_len field holds the total message length, and
+    msg/msg_len describe the current chunk during update_cb.  The
+    final_cb must fill in md and md_len.  The digest state belongs in
+    the stream_ctx field of the test case, which libacvp leaves alone
+    between the callbacks, rather than in a static variable.  Use
+    ACVP_HASH_LARGE_DATA with acvp_enable_hash_cap_parm() to advertise
+    large data support.
+
+    The ACVP_CIPHER value passed to this function should already have
+    been setup by invoking acvp_enable_hash_cap().
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_CIPHER enum value identifying the crypto capability.
+    @param init_cb Invoked at the start of a streamed test case.
+    @param update_cb Invoked for each chunk of the message.
+    @param final_cb Invoked after the last chunk to produce the digest.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_enable_hash_stream_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*init_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*update_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*final_cb) (ACVP_TEST_CASE *test_case));
+
 /*! @brief acvp_enable_drbg_cap() allows an application to specify a
        hash capability to be tested by the ACVP server.
 
@@ -1573,6 +1777,35 @@ ACVP_RESULT acvp_enable_drbg_length_cap (
         int step,
         int max);
 
+/*! @brief acvp_enable_drbg_group_cb() allows an application to set up
+       DRBG state once per DRBG test group.
+
+    All the test cases in a DRBG test group share the mode, the
+    derivation function and prediction resistance settings, and
+    the entropy, nonce, personalization string, additional input
+    and returned bits lengths.  libacvp sizes the test case buffers
+    once per group from these lengths.  begin_cb is invoked before
+    the first test case of each group with the settings and lengths
+    set on the test case, and may store an opaque handle in
+    group_ctx, such as a DRBG context allocated for the mode that
+    each test case only needs to re-instantiate.  libacvp hands the
+    same group_ctx to every test case in the group.  end_cb is
+    invoked after the last test case, or after a failure, and must
+    release anything held in group_ctx.
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_CIPHER enum value identifying the crypto capability.
+    @param begin_cb Invoked before the first test case of each group.
+    @param end_cb Invoked after the last test case of each group.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_enable_drbg_group_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*begin_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*end_cb) (ACVP_TEST_CASE *test_case));
+
 /*! @brief acvp_enable_dsa_cap()
 
   This function should be used to enable DSA capabilities. Specific modes
@@ -1619,6 +1852,31 @@ ACVP_RESULT acvp_enable_dsa_cap_parm (ACVP_CTX *ctx,
                                       ACVP_DSA_PARM param,
                                       int value);
 
+/*! @brief acvp_enable_dsa_group_cb() allows an application to set up
+       state once per test group for DSA keyGen and sigGen.
+
+    The ACVP server shares l, n and the hash algorithm across all the
+    test cases in a keyGen or sigGen test group, so the domain
+    parameters only need to be generated once per group.  begin_cb is
+    invoked before the first test case of each group with l, n and sha
+    set on the test case, and may store the group state in group_ctx.
+    group_ctx is left untouched for every test case in the group.
+    end_cb is invoked after the last test case, or after a failure,
+    and must release anything held in group_ctx.
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_CIPHER enum value identifying the crypto capability.
+    @param begin_cb Invoked before the first test case of each group.
+    @param end_cb Invoked after the last test case of each group.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_enable_dsa_group_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*begin_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*end_cb) (ACVP_TEST_CASE *test_case));
+
 /*! @brief acvp_enable_kas_ecc_cap()
 
   This function should be used to enable KAS-ECC capabilities. Specific modes
@@ -1698,6 +1956,32 @@ ACVP_RESULT acvp_enable_kas_ecc_cap_scheme (ACVP_CTX *ctx,
                                             int option,
                                             int value);
 
+/*! @brief acvp_enable_kas_ecc_group_cb() allows an application to set up
+       a key agreement context once per KAS-ECC test group.
+
+    All the test cases in a KAS-ECC test group share the curve, and
+    the hash algorithm for the component mode.  begin_cb is invoked
+    before the first test case of each group with curve and md set
+    on the test case, and may store an opaque handle in group_ctx,
+    such as the validated curve group used to check and import the
+    server's public points.  libacvp hands the same group_ctx to
+    every test case in the group.  end_cb is invoked after the last
+    test case, or after a failure, and must release anything held
+    in group_ctx.
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_KAS_ECC_CDH or ACVP_KAS_ECC_COMP.
+    @param begin_cb Invoked before the first test case of each group.
+    @param end_cb Invoked after the last test case of each group.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_enable_kas_ecc_group_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*begin_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*end_cb) (ACVP_TEST_CASE *test_case));
+
 /*! @brief acvp_enable_kas_ffc_cap()
 
   This function should be used to enable KAS-FFC capabilities. Specific modes
@@ -1797,6 +2081,34 @@ ACVP_RESULT acvp_enable_kas_ffc_cap_scheme (ACVP_CTX *ctx,
                                             ACVP_KAS_FFC_PARAM param,
                                             int value);
 
+/*! @brief acvp_enable_kas_ffc_group_cb() allows an application to set up
+       a key agreement context once per KAS-FFC test group.
+
+    All the test cases in a KAS-FFC test group share the hash
+    algorithm and the p, q and g domain parameters.  libacvp decodes
+    the domain parameters once per group and leaves them set on the
+    test case for the whole group.  begin_cb is invoked before the
+    first test case of each group with md and p, q, g (or bn.p,
+    bn.q, bn.g when binary big numbers are enabled) set, and may
+    store an opaque handle in group_ctx, such as a validated DH
+    object holding the domain parameters.  libacvp hands the same
+    group_ctx to every test case in the group.  end_cb is invoked
+    after the last test case, or after a failure, and must release
+    anything held in group_ctx.
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_KAS_FFC_COMP.
+    @param begin_cb Invoked before the first test case of each group.
+    @param end_cb Invoked after the last test case of each group.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_enable_kas_ffc_group_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*begin_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*end_cb) (ACVP_TEST_CASE *test_case));
+
 /*! @brief acvp_enable_rsa_*_cap()
 
   This function should be used to enable RSA capabilities. Specific modes
@@ -1899,6 +2211,33 @@ ACVP_RESULT acvp_enable_ecdsa_cap_parm (
         char *value
 );
 
+/*! @brief acvp_enable_ecdsa_group_cb() allows an application to set up
+       a curve context once per ECDSA test group.
+
+    All the test cases in an ECDSA test group share the curve, and
+    the hash algorithm for sigGen and sigVer.  begin_cb is invoked
+    before the first test case of each group with curve, hash_alg
+    and secret_gen_mode set on the test case, and may store an
+    opaque handle in group_ctx, such as the resolved curve with its
+    precomputation tables or, for sigGen, the key pair used to sign
+    every message in the group.  libacvp hands the same group_ctx to
+    every test case in the group.  end_cb is invoked after the last
+    test case, or after a failure, and must release anything held
+    in group_ctx.
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_CIPHER enum value identifying the crypto capability.
+    @param begin_cb Invoked before the first test case of each group.
+    @param end_cb Invoked after the last test case of each group.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_enable_ecdsa_group_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*begin_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*end_cb) (ACVP_TEST_CASE *test_case));
+
 /*! @brief acvp_enable_rsa_bignum_parm() allows an application to specify
        BIGNUM operational parameters to be used for a given RSA alg during a
        test session with the ACVP server.
@@ -1999,6 +2338,32 @@ ACVP_RESULT acvp_enable_hmac_cap_parm (
         ACVP_HMAC_PARM parm,
         int value);
 
+/*! @brief acvp_enable_hmac_stream_cb() allows an application to have
+       HMAC messages fed to the crypto module in chunks.
+
+    When these callbacks are registered, messages larger than
+    ACVP_HMAC_MSG_MAX are decoded from the vector set a chunk at a
+    time.  init_cb is invoked once with the key and full_len set,
+    update_cb for each chunk described by msg/msg_len, and final_cb
+    once at the end to fill in mac and mac_len.  The mac state belongs
+    in the stream_ctx field of the test case rather than in a static
+    variable.
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_CIPHER enum value identifying the crypto capability.
+    @param init_cb Invoked at the start of a streamed test case.
+    @param update_cb Invoked for each chunk of the message.
+    @param final_cb Invoked after the last chunk to produce the mac.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_enable_hmac_stream_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*init_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*update_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*final_cb) (ACVP_TEST_CASE *test_case));
+
 /*! @brief acvp_enable_cmac_cap() allows an application to specify an
        CMAC capability to be tested by the ACVP server.
 
@@ -2044,6 +2409,32 @@ ACVP_RESULT acvp_enable_cmac_cap_parm (
         ACVP_CMAC_PARM parm,
         int value);
 
+/*! @brief acvp_enable_cmac_stream_cb() allows an application to have
+       CMAC messages fed to the crypto module in chunks.
+
+    When these callbacks are registered, messages larger than
+    ACVP_CMAC_MSG_MAX are decoded from the vector set a chunk at a
+    time.  init_cb is invoked once with the keys and full_len set,
+    update_cb for each chunk described by msg/msg_len, and final_cb
+    once at the end to fill in mac and mac_len, or ver_disposition
+    for the verify direction.  The mac state belongs in the stream_ctx
+    field of the test case rather than in a static variable.
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_CIPHER enum value identifying the crypto capability.
+    @param init_cb Invoked at the start of a streamed test case.
+    @param update_cb Invoked for each chunk of the message.
+    @param final_cb Invoked after the last chunk to produce the result.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_enable_cmac_stream_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*init_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*update_cb) (ACVP_TEST_CASE *test_case),
+        ACVP_RESULT (*final_cb) (ACVP_TEST_CASE *test_case));
+
 /*! @brief acvp_enable_kdf135_*_cap() allows an application to specify a
        kdf cipher capability to be tested by the ACVP server.
 
@@ -2091,6 +2482,33 @@ ACVP_RESULT acvp_enable_kdf135_tpm_cap (
         ACVP_CTX *ctx,
         ACVP_RESULT (*crypto_handler) (ACVP_TEST_CASE *test_case));
 
+/*! @brief acvp_enable_kdf135_batch_cb() allows an application to process
+       all the test cases of a kdf135 test group in a single call.
+
+    libacvp parses every test case of a kdf135 test group before any of
+    them is handed to the crypto module.  When a batch callback is set
+    it is invoked once per test group with all of those test cases,
+    which allows a crypto module with a vectorized HMAC or SHA
+    implementation to derive the keys of the whole group in one pass.
+    The crypto_handler given to acvp_enable_kdf135_*_cap() is not used
+    for a capability that has a batch callback.
+
+    Each SRTP test case carries its own KDR and AES key length, so for
+    ACVP_KDF135_SRTP the batch holds the test cases of all the test
+    groups of the vector set, covering every KDR value in one call.
+
+    @param ctx Address of pointer to a previously allocated ACVP_CTX.
+    @param cipher ACVP_CIPHER enum value identifying the kdf135 capability.
+    @param batch_cb Address of function implemented by application that
+       is invoked with all the test cases of each test group.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_enable_kdf135_batch_cb (
+        ACVP_CTX *ctx,
+        ACVP_CIPHER cipher,
+        ACVP_RESULT (*batch_cb) (ACVP_TEST_BATCH *batch));
+
 ACVP_RESULT acvp_enable_kdf108_cap (
         ACVP_CTX *ctx,
         ACVP_RESULT (*crypto_handler) (ACVP_TEST_CASE *test_case));
@@ -2429,6 +2847,308 @@ ACVP_RESULT acvp_set_certkey (ACVP_CTX *ctx, char *cert_file, char *key_file);
  */
 void acvp_mark_as_sample (ACVP_CTX *ctx);
 
+/*! @brief acvp_set_hash_mct_msg_output() controls whether the
+    "msg" value is reported for each SHA Monte Carlo iteration.
+
+    By default libacvp hex encodes the three seed messages of each
+    outer MCT iteration and includes them in the response.  The
+    server does not require this value, so applications may turn
+    it off to avoid the extra encoding work.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param enable 1 to include the "msg" value (default), 0 to omit it.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_hash_mct_msg_output (ACVP_CTX *ctx, int enable);
+
+/*! @brief acvp_set_binary_bignums() selects how big numbers are
+    passed between libacvp and the crypto module.
+
+    By default the big numbers of the RSA keyGen, DSA, ECDSA,
+    KAS-ECC and KAS-FFC test cases are hex strings, which the crypto module
+    typically converts to and from its own big number type on every
+    call.  When enabled, libacvp decodes the inputs once into the
+    "bn" member of the test case as big-endian byte buffers, and
+    hex encodes the outputs the crypto module writes there straight
+    into the JSON response.  The matching hex string fields are not
+    allocated or read in this mode.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param enable 1 to use the binary "bn" fields, 0 for hex strings
+        (default).
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_binary_bignums (ACVP_CTX *ctx, int enable);
+
+/*! @brief acvp_set_worker_threads() sets the number of threads used
+    to run test cases in parallel.
+
+    Only the test cases of RSA keyGen and of DSA pqgGen and pqgVer,
+    which are independent of each other and slow to compute, are
+    dispatched through the worker pool.  Every other algorithm keeps
+    calling its crypto handler serially from the thread that called
+    acvp_process_tests.  When count is greater than one, libacvp
+    invokes the crypto handler of these three algorithms for the test
+    cases of a test group from up to count threads at once, so
+    their handlers must be safe to call concurrently.  Results are
+    still reported in the order the server sent them.  Progress is
+    reported through the test_progress_cb at the ACVP_LOG_LVL_STATUS
+    level.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param count Number of threads, 0 or 1 runs the test cases serially
+        (default).
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_worker_threads (ACVP_CTX *ctx, int count);
+
+/*! @brief acvp_set_transport_record() captures the HTTP traffic of the
+    test session into a session archive.
+
+    Every request sent to the ACVP server (login, registration, vector
+    set downloads, response uploads and results) is appended to the
+    archive together with the HTTP status and body the server returned.
+    The archive holds one JSON object per line and is replayed with
+    acvp_set_transport_replay().  The login password (TOTP) and the
+    access tokens returned by the server are written as "<redacted>",
+    a replayed session uses that value as its access token.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param archive Name of the session archive, any existing file
+        is replaced.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_transport_record (ACVP_CTX *ctx, const char *archive);
+
+/*! @brief acvp_set_transport_replay() serves the HTTP traffic of the
+    test session from a session archive instead of the ACVP server.
+
+    Each request is answered with the first exchange in the archive
+    not yet used that has the same method and URL path, the server
+    name and port are ignored.  The bodies sent by the client are not
+    compared, so a session recorded once can be replayed against a
+    changed crypto module or libacvp build with identical inputs.
+    The retry period requested by replayed responses is not waited
+    for, latency_ms is used to model the server instead.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param archive Name of a session archive written by
+        acvp_set_transport_record().
+    @param latency_ms Milliseconds added to every replayed exchange,
+        0 for none.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_transport_replay (ACVP_CTX *ctx, const char *archive, int latency_ms);
+
+/*! @brief acvp_set_vector_cache() enables an on-disk cache of the
+    downloaded vector sets.
+
+    The content of a vector set never changes on the server, so when
+    a session is rerun (e.g. after a JWT timeout or a crypto module
+    failure) the vector sets found in the cache are processed without
+    downloading them again.  Entries are keyed by the server name,
+    port and vsId, and carry a hash of their content so a damaged
+    entry is downloaded again.  Retry responses are never cached.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param cache_dir Existing directory the vector sets are cached in.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_vector_cache (ACVP_CTX *ctx, const char *cache_dir);
+
+/*! @brief acvp_set_registration_cache() enables an on-disk cache of
+    the registration message.
+
+    With the cache, the registration message is saved once and later
+    sessions send the saved bytes as they are, so a JSON registration
+    file is not parsed and serialized again.  The entry is keyed by a
+    hash of the libacvp build, the vendor and module info, cap_key and
+    the fingerprint of the registration JSON of every enabled
+    capability, the same fingerprint acvp_set_capability_manifest()
+    uses.  Any change to a capability parameter therefore selects a
+    new entry.  For a JSON registration file the file name, size and
+    modification time are used instead of the capabilities.  The cache
+    is not used together with acvp_set_capability_manifest().
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param cache_dir Existing directory the registration is cached in.
+    @param cap_key Optional string added to the key, may be NULL.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_registration_cache (ACVP_CTX *ctx, const char *cache_dir, const char *cap_key);
+
+/*! @brief acvp_set_payload_dump() writes the full body of every request
+    and response to a file.
+
+    The messages passed to the logging callback only hold the first
+    512 bytes of a request or response body.  When the whole bodies
+    are needed, e.g. to debug a failing vector set, they can be dumped
+    to a file independent of the log level.  The file is written by a
+    separate thread, so the test session does not wait for the disk.
+    It is closed by acvp_free_test_session().  The login password
+    (TOTP) and the access tokens are written as "<redacted>", the same
+    as in the session archive of acvp_set_transport_record().
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param filename Name of the dump file, it is overwritten.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_payload_dump (ACVP_CTX *ctx, const char *filename);
+
+/*! @brief acvp_set_event_logger() delivers log messages and session
+    events to the application as structured events.
+
+    Each event carries its type, level, vsId, tcId, a timestamp and up
+    to ACVP_LOG_FIELD_MAX key/value fields, e.g. the method, path and
+    status of an HTTP exchange.  Events are put in a ring buffer and
+    delivered to event_cb from a separate thread, so a slow logger
+    never holds up the test session.  When the ring is full new events
+    are dropped and an ACVP_EVENT_DROPPED event reports the number of
+    dropped events once there is room again.  While the event logger
+    is set, log messages are delivered to event_cb as ACVP_EVENT_MSG
+    events and the test_progress_cb is no longer called.  The level
+    given to acvp_create_test_session() still applies.  Pending events
+    are delivered by acvp_free_test_session().
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param event_cb Function called from the logging thread for
+        every event.
+    @param ring_size Number of events the ring buffer holds.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_event_logger (ACVP_CTX *ctx, ACVP_RESULT (*event_cb) (ACVP_LOG_EVENT *event), int ring_size);
+
+/*! @brief acvp_set_metrics() enables the per vector set metrics.
+
+    For every vector set the session records the wall and CPU time of
+    each phase, the bytes received and sent, the number of test groups
+    and test cases, and the latency of the crypto handler calls as a
+    histogram.  The metrics are kept until acvp_free_test_session().
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param enable 1 to record metrics, 0 to stop recording and discard
+        the metrics recorded so far.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_metrics (ACVP_CTX *ctx, int enable);
+
+/*! @brief acvp_get_metrics() returns the metrics recorded for the
+    vector sets, e.g. after acvp_process_tests().
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param metrics Set to the list of vector set metrics, in the order
+        the vector sets were processed, or NULL if there are none.  The
+        list belongs to the context.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_get_metrics (ACVP_CTX *ctx, const ACVP_VS_METRICS **metrics);
+
+/*! @brief acvp_export_metrics() writes the metrics recorded for the
+    vector sets to a file as JSON.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param filename Name of the file, it is overwritten.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_export_metrics (ACVP_CTX *ctx, const char *filename);
+
+/*! @brief acvp_set_checkpoint_file() enables the session checkpoint.
+
+    The checkpoint records the registration response, the access token
+    and the progress of every vector set (downloaded, computed, uploaded,
+    verified as passed), along with the computed responses that have not been
+    uploaded yet.  It is rewritten after registration and each time a
+    vector set makes progress, so a session that is killed can be
+    continued with acvp_resume_session().
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param filename Name of the checkpoint file.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_checkpoint_file (ACVP_CTX *ctx, const char *filename);
+
+/*! @brief acvp_resume_session() continues a test session from its
+    checkpoint, it is called instead of acvp_register().
+
+    The access token and vector set list are restored from the
+    checkpoint.  acvp_process_tests() then only processes the vector
+    sets that were not uploaded, a computed response is uploaded
+    without processing the vector set again, and
+    acvp_check_test_results() skips the vector sets that already passed.
+    The session keeps updating the same checkpoint file.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session, with the same server and
+        capabilities as the checkpointed session.
+    @param filename Name of the checkpoint file.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_resume_session (ACVP_CTX *ctx, const char *filename);
+
+/*! @brief acvp_set_capability_manifest() registers only the
+    capabilities that changed since the last passing run.
+
+    While building the registration, the JSON fragment of each enabled
+    capability is fingerprinted and compared with the manifest.  The
+    capabilities with the same fingerprint are left out of the
+    registration, so only the vector sets of new or changed
+    capabilities are processed.  When nothing changed acvp_register()
+    returns ACVP_SUCCESS without contacting the server and there are
+    no vector sets to process.  A missing manifest file registers
+    every capability.  This has no effect when registering from a
+    JSON file set with acvp_set_json_filename().
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+    @param manifest Name of the manifest file.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_capability_manifest (ACVP_CTX *ctx, const char *manifest);
+
+/*! @brief acvp_save_capability_manifest() saves the fingerprints of all
+    the capabilities enabled in this session to the manifest.
+
+    The application calls this once acvp_check_test_results() shows
+    that all vector sets passed.  Later runs then skip those
+    capabilities until they change.  Nothing is saved, and
+    ACVP_TEST_FAIL is returned, unless the results of every vector set
+    of the session were retrieved and passed.
+
+    @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+
+    @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_save_capability_manifest (ACVP_CTX *ctx);
+
 /*! @brief acvp_register() registers the DUT with the ACVP server.
 
     This function is used to regitser the DUT with the server.
@@ -2488,6 +3208,33 @@ ACVP_RESULT acvp_set_vendor_info (ACVP_CTX *ctx,
  */
 ACVP_RESULT acvp_set_json_filename (ACVP_CTX *ctx, const char *json_filename);
 
+/*! @brief acvp_set_offline_vectors() puts the test session in offline
+ *  mode.  acvp_process_tests() will then read the vector sets from
+ *  local files instead of downloading them from the server, and write
+ *  each vector set response to a file for a later upload.  No network
+ *  traffic occurs in offline mode, so acvp_register() and
+ *  acvp_check_test_results() are not used.
+ *
+ *  The vector sets are stored exactly as the server returns them, i.e.
+ *  a JSON array holding the acvVersion object followed by the vector
+ *  set.  vector_path is either a directory, in which case every *.json
+ *  file in it is processed in name order, or a single bundle file.  A
+ *  bundle may hold one vector set or a JSON array of vector sets.
+ *  Files named vsid_*.json are taken for responses and skipped, so
+ *  vector set files must not use that name.
+ *
+ *  The response for each vector set is written to resp_dir as
+ *  vsid_<vsId>.json, holding the same body that would have been
+ *  submitted to the server.
+ *
+ * @param ctx Pointer to ACVP_CTX that was previously created by
+        calling acvp_create_test_session.
+ * @param vector_path Directory or bundle file holding the vector sets
+ * @param resp_dir Existing directory the responses are written to
+ * @return ACVP_RESULT
+ */
+ACVP_RESULT acvp_set_offline_vectors (ACVP_CTX *ctx, const char *vector_path, const char *resp_dir);
+
 
 /*! @brief acvp_set_module_info() specifies the crypto module attributes
     for the test session.
@@ -2510,9 +3257,13 @@ ACVP_RESULT acvp_set_module_info (ACVP_CTX *ctx,
 /*! @brief acvp_check_test_results() allows the application to fetch vector
         set results from the server during a test session.
 
+   The results of every vector set are fetched, the failed test cases
+   are logged.  A vector set that failed is not an error, see
+   acvp_save_capability_manifest().
+
    @param ctx Address of pointer to a previously allocated ACVP_CTX.
 
-   @return ACVP_RESULT
+   @return ACVP_RESULT, the first error fetching the results
  */
 ACVP_RESULT acvp_check_test_results (ACVP_CTX *ctx);
 
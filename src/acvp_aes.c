@@ -56,6 +56,8 @@ static ACVP_RESULT acvp_aes_init_tc (ACVP_CTX *ctx,
                                      ACVP_CIPHER alg_id,
                                      ACVP_SYM_CIPH_DIR dir);
 
+static ACVP_RESULT acvp_aes_alloc_tc (ACVP_SYM_CIPHER_TC *stc);
+
 static ACVP_RESULT acvp_aes_release_tc (ACVP_SYM_CIPHER_TC *stc);
 
 
@@ -288,7 +290,7 @@ static ACVP_RESULT acvp_aes_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
 
             stc->mct_index = j;    /* indicates init vs. update */
             /* Process the current AES encrypt test vector... */
-            rv = (cap->crypto_handler)(tc);
+            rv = acvp_call_crypto_handler(ctx, cap, tc);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("crypto module failed the operation");
                 free(tmp);
@@ -478,7 +480,7 @@ ACVP_RESULT acvp_aes_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
 
     ACVP_SYM_CIPH_DIR dir;
     ACVP_CIPHER alg_id;
-    char *test_type, *json_result;
+    char *test_type;
 
     if (!alg_str) {
         ACVP_LOG_ERR("unable to parse 'algorithm' from JSON");
@@ -525,6 +527,16 @@ ACVP_RESULT acvp_aes_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     json_object_set_value(r_vs, "testResults", json_value_init_array());
     r_tarr = json_object_get_array(r_vs, "testResults");
 
+    /*
+     * Allocate the test case buffers once, they are
+     * re-used for every test case in the vector set.
+     */
+    rv = acvp_aes_alloc_tc(&stc);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Unable to malloc in acvp_aes_kat_handler");
+        return rv;
+    }
+
     groups = json_object_get_array(obj, "testGroups");
     g_cnt = json_array_get_count(groups);
     for (i = 0; i < g_cnt; i++) {
@@ -543,10 +555,12 @@ ACVP_RESULT acvp_aes_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 dir = ACVP_DIR_DECRYPT;
             } else {
                 ACVP_LOG_ERR("unsupported direction requested from server (%s)", dir_str);
+                acvp_aes_release_tc(&stc);
                 return (ACVP_UNSUPPORTED_OP);
             }
         } else {
             ACVP_LOG_ERR("unsupported direction requested from server (%s)", dir_str);
+            acvp_aes_release_tc(&stc);
             return (ACVP_UNSUPPORTED_OP);
         }
 
@@ -554,6 +568,7 @@ ACVP_RESULT acvp_aes_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             (alg_id == ACVP_AES_KWP)) {
             kwcipher = (unsigned char *) json_object_get_string(groupobj, "kwCipher");
             if (kwcipher == NULL) {
+                acvp_aes_release_tc(&stc);
                 return (ACVP_UNSUPPORTED_OP);
             }
         }
@@ -650,8 +665,6 @@ ACVP_RESULT acvp_aes_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Setup the test case data that will be passed down to
              * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
              */
             acvp_aes_init_tc(ctx, &stc, tc_id, test_type, key, pt, ct, iv, tag, aad,
                              kwcipher, keylen, ivlen, ptlen, aadlen, taglen, alg_id, dir);
@@ -663,16 +676,18 @@ ACVP_RESULT acvp_aes_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 rv = acvp_aes_mct_tc(ctx, cap, &tc, &stc, res_tarr);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("crypto module failed the MCT operation");
+                    acvp_aes_release_tc(&stc);
                     return ACVP_CRYPTO_MODULE_FAIL;
                 }
 
             } else {
 
                 /* Process the current AES KAT test vector... */
-                rv = (cap->crypto_handler)(&tc);
+                rv = acvp_call_crypto_handler(ctx, cap, &tc);
                 if (rv != ACVP_SUCCESS) {
                     if ((rv != ACVP_CRYPTO_TAG_FAIL) && (rv != ACVP_CRYPTO_WRAP_FAIL)) {
                         ACVP_LOG_ERR("ERROR: crypto module failed the operation");
+                        acvp_aes_release_tc(&stc);
                         return ACVP_CRYPTO_MODULE_FAIL;
                     }
                 }
@@ -683,28 +698,22 @@ ACVP_RESULT acvp_aes_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 rv = acvp_aes_output_tc(ctx, &stc, r_tobj, rv);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("JSON output failure in AES module");
+                    acvp_aes_release_tc(&stc);
                     return rv;
                 }
             }
 
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_aes_release_tc(&stc);
-
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
     }
-    json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
+    /*
+     * Release all the memory associated with the test cases
+     */
+    acvp_aes_release_tc(&stc);
+
+    json_array_append_value(reg_arry, r_vs_val);
 
     return ACVP_SUCCESS;
 }
@@ -840,6 +849,60 @@ static ACVP_RESULT acvp_aes_output_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *stc,
 }
 
 
+/*
+ * This function allocates the buffers for an AES test case.
+ * It is called once per vector set, the buffers are then
+ * re-used for each test case and released by acvp_aes_release_tc().
+ */
+static ACVP_RESULT acvp_aes_alloc_tc (ACVP_SYM_CIPHER_TC *stc) {
+    memset(stc, 0x0, sizeof(ACVP_SYM_CIPHER_TC));
+
+    stc->key = calloc(1, ACVP_SYM_KEY_MAX);
+    if (!stc->key) { goto err; }
+    stc->pt = calloc(1, ACVP_SYM_PT_MAX);
+    if (!stc->pt) { goto err; }
+    stc->ct = calloc(1, ACVP_SYM_CT_MAX);
+    if (!stc->ct) { goto err; }
+    stc->tag = calloc(1, ACVP_SYM_TAG_MAX);
+    if (!stc->tag) { goto err; }
+    stc->iv = calloc(1, ACVP_SYM_IV_MAX);
+    if (!stc->iv) { goto err; }
+    stc->aad = calloc(1, ACVP_SYM_AAD_MAX);
+    if (!stc->aad) { goto err; }
+
+    return ACVP_SUCCESS;
+
+    err:
+    acvp_aes_release_tc(stc);
+    return ACVP_MALLOC_FAIL;
+}
+
+/*
+ * This function clears the data left over from the previous
+ * test case while keeping the buffers allocated by
+ * acvp_aes_alloc_tc().  Only the used portion of the large
+ * buffers is zeroed.
+ */
+static void acvp_aes_reset_tc (ACVP_SYM_CIPHER_TC *stc) {
+    unsigned char *key = stc->key, *pt = stc->pt, *ct = stc->ct;
+    unsigned char *tag = stc->tag, *iv = stc->iv, *aad = stc->aad;
+
+    memset(key, 0x0, ACVP_SYM_KEY_MAX);
+    memset(tag, 0x0, ACVP_SYM_TAG_MAX);
+    memset(iv, 0x0, ACVP_SYM_IV_MAX);
+    acvp_clear_tc_buf(pt, stc->pt_len, ACVP_SYM_PT_MAX);
+    acvp_clear_tc_buf(ct, stc->ct_len, ACVP_SYM_CT_MAX);
+    acvp_clear_tc_buf(aad, stc->aad_len, ACVP_SYM_AAD_MAX);
+
+    memset(stc, 0x0, sizeof(ACVP_SYM_CIPHER_TC));
+    stc->key = key;
+    stc->pt = pt;
+    stc->ct = ct;
+    stc->tag = tag;
+    stc->iv = iv;
+    stc->aad = aad;
+}
+
 /*
  * This function is used to fill-in the data for an AES
  * test case.  The JSON parsing logic invokes this after the
@@ -871,20 +934,7 @@ static ACVP_RESULT acvp_aes_init_tc (ACVP_CTX *ctx,
 
     //FIXME:  check lengths do not exceed MAX values below
 
-    memset(stc, 0x0, sizeof(ACVP_SYM_CIPHER_TC));
-
-    stc->key = calloc(1, ACVP_SYM_KEY_MAX);
-    if (!stc->key) { return ACVP_MALLOC_FAIL; }
-    stc->pt = calloc(1, ACVP_SYM_PT_MAX);
-    if (!stc->pt) { return ACVP_MALLOC_FAIL; }
-    stc->ct = calloc(1, ACVP_SYM_CT_MAX);
-    if (!stc->ct) { return ACVP_MALLOC_FAIL; }
-    stc->tag = calloc(1, ACVP_SYM_TAG_MAX);
-    if (!stc->tag) { return ACVP_MALLOC_FAIL; }
-    stc->iv = calloc(1, ACVP_SYM_IV_MAX);
-    if (!stc->iv) { return ACVP_MALLOC_FAIL; }
-    stc->aad = calloc(1, ACVP_SYM_AAD_MAX);
-    if (!stc->aad) { return ACVP_MALLOC_FAIL; }
+    acvp_aes_reset_tc(stc);
 
     /* Assume KAT if not MCT */
     if (test_type && !strcmp(test_type, "MCT")) {
@@ -995,7 +1045,7 @@ static ACVP_RESULT acvp_aes_init_tc (ACVP_CTX *ctx,
 
 /*
  * This function simply releases the data associated with
- * a test case.
+ * the test cases of a vector set.
  */
 static ACVP_RESULT acvp_aes_release_tc (ACVP_SYM_CIPHER_TC *stc) {
     free(stc->key);
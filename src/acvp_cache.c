@@ -0,0 +1,404 @@
+/*****************************************************************************
+* Copyright (c) 2016, Cisco Systems, Inc.
+* All rights reserved.
+
+* Redistribution and use in source and binary forms, with or without modification, 
+* are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice, 
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation 
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+* USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <sys/stat.h>
+
+#include "acvp.h"
+#include "acvp_lcl.h"
+
+#define ACVP_VS_CACHE_MAGIC "ACVP-VS-CACHE"
+#define ACVP_REG_CACHE_MAGIC "ACVP-REG-CACHE"
+
+/*
+ * 64 bit FNV-1a hash of a buffer.  This is used to detect damaged
+ * cache entries and changed capabilities, it is not a security
+ * mechanism.
+ */
+unsigned long long acvp_fnv_hash (const char *buf, int len) {
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char) buf[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/*
+ * Builds the name of the cache entry for a vector set.  The server
+ * name and port are part of the name, since the vsId is only unique
+ * within a single server.
+ */
+static void acvp_vs_cache_name (ACVP_CTX *ctx, int vs_id, char *name, int name_max) {
+    char server[256];
+    int i;
+
+    snprintf(server, sizeof(server), "%s", ctx->server_name ? ctx->server_name : "");
+    for (i = 0; server[i]; i++) {
+        if (!isalnum((unsigned char) server[i]) && server[i] != '.' && server[i] != '-') {
+            server[i] = '_';
+        }
+    }
+    snprintf(name, name_max, "%s/%s_%d_%d.vs", ctx->vs_cache_dir, server, ctx->server_port, vs_id);
+}
+
+/*
+ * Loads a vector set from the cache into the kat_buf, just as if
+ * it had been downloaded by acvp_retrieve_vector_set().  Returns
+ * ACVP_SUCCESS on a hit, anything else means the vector set
+ * needs to be downloaded.
+ */
+ACVP_RESULT acvp_vs_cache_load (ACVP_CTX *ctx, int vs_id) {
+    char name[ACVP_OFFLINE_PATH_MAX];
+    char magic[32];
+    unsigned long long hash;
+    int len;
+    FILE *fp;
+
+    acvp_vs_cache_name(ctx, vs_id, name, sizeof(name));
+    fp = fopen(name, "rb");
+    if (!fp) {
+        return ACVP_INVALID_ARG;
+    }
+    if (fscanf(fp, "%31s %llx %d", magic, &hash, &len) != 3 || fgetc(fp) != '\n' ||
+        strcmp(magic, ACVP_VS_CACHE_MAGIC) || len <= 0 || len >= ACVP_KAT_BUF_MAX) {
+        ACVP_LOG_WARN("Ignoring malformed vector set cache entry %s", name);
+        fclose(fp);
+        return ACVP_MALFORMED_JSON;
+    }
+
+    if (!ctx->kat_buf) {
+        ctx->kat_buf = calloc(1, ACVP_KAT_BUF_MAX);
+        if (!ctx->kat_buf) {
+            fclose(fp);
+            return ACVP_MALLOC_FAIL;
+        }
+    }
+    if (fread(ctx->kat_buf, 1, len, fp) != (size_t) len ||
+        acvp_fnv_hash(ctx->kat_buf, len) != hash) {
+        ACVP_LOG_WARN("Ignoring damaged vector set cache entry %s", name);
+        memset(ctx->kat_buf, 0x0, ACVP_KAT_BUF_MAX);
+        fclose(fp);
+        return ACVP_MALFORMED_JSON;
+    }
+    ctx->kat_buf[len] = 0;
+    fclose(fp);
+
+    ACVP_LOG_STATUS("Using cached vector set vsId: %d from %s", vs_id, name);
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Saves the vector set held in the kat_buf to the cache.  The
+ * entry is written to a temporary file first and then renamed,
+ * so an interrupted session never leaves a partial entry behind.
+ * A failure to cache is logged, it does not fail the session.
+ */
+void acvp_vs_cache_store (ACVP_CTX *ctx, int vs_id) {
+    char name[ACVP_OFFLINE_PATH_MAX];
+    char tmp_name[ACVP_OFFLINE_PATH_MAX + 4];
+    int len;
+    FILE *fp;
+
+    if (!ctx->kat_buf) {
+        return;
+    }
+    len = strnlen(ctx->kat_buf, ACVP_KAT_BUF_MAX);
+
+    acvp_vs_cache_name(ctx, vs_id, name, sizeof(name));
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", name);
+    fp = fopen(tmp_name, "wb");
+    if (!fp) {
+        ACVP_LOG_WARN("Unable to create vector set cache entry %s", name);
+        return;
+    }
+    fprintf(fp, "%s %llx %d\n", ACVP_VS_CACHE_MAGIC, acvp_fnv_hash(ctx->kat_buf, len), len);
+    if (fwrite(ctx->kat_buf, 1, len, fp) != (size_t) len) {
+        ACVP_LOG_WARN("Unable to write vector set cache entry %s", name);
+        fclose(fp);
+        remove(tmp_name);
+        return;
+    }
+    fclose(fp);
+    if (rename(tmp_name, name)) {
+        ACVP_LOG_WARN("Unable to save vector set cache entry %s", name);
+        remove(tmp_name);
+        return;
+    }
+    ACVP_LOG_INFO("Cached vector set vsId: %d in %s", vs_id, name);
+}
+
+#define ACVP_STR_OR_EMPTY(s) ((s) ? (s) : "")
+
+/*
+ * Builds the name of the cache entry for the registration.  The
+ * name holds a hash of everything that changes the registration
+ * message: the build of libacvp, the vendor and module info, the
+ * fingerprint of the registration JSON of every enabled capability,
+ * and the optional key given by the application.  For a registration
+ * read from a JSON file, the file name, size and modification time
+ * are used instead of the capabilities.
+ */
+static ACVP_RESULT acvp_reg_cache_name (ACVP_CTX *ctx, char *name, int name_max) {
+    char key[ACVP_OFFLINE_PATH_MAX * 4];
+    unsigned long long caps = 0;
+    struct stat st;
+    ACVP_RESULT rv;
+    int len;
+
+    memset(&st, 0x0, sizeof(st));
+    if (ctx->use_json == 1) {
+        stat(ctx->json_filename, &st);
+    } else {
+        rv = acvp_caps_fingerprint(ctx, &caps);
+        if (rv != ACVP_SUCCESS) {
+            return rv;
+        }
+    }
+    len = snprintf(key, sizeof(key), "%s\n%s\n%d\n%s\n%lld\n%lld\n%016llx\n%s\n%s\n%s\n%s\n%s\n%s\n%s\n%s",
+                   acvp_build_id(), ACVP_STR_OR_EMPTY(ctx->reg_cache_key), ctx->is_sample,
+                   ctx->use_json == 1 ? ctx->json_filename : "",
+                   (long long) st.st_size, (long long) st.st_mtime, caps,
+                   ACVP_STR_OR_EMPTY(ctx->vendor_name), ACVP_STR_OR_EMPTY(ctx->vendor_url),
+                   ACVP_STR_OR_EMPTY(ctx->contact_name), ACVP_STR_OR_EMPTY(ctx->contact_email),
+                   ACVP_STR_OR_EMPTY(ctx->module_name), ACVP_STR_OR_EMPTY(ctx->module_type),
+                   ACVP_STR_OR_EMPTY(ctx->module_version), ACVP_STR_OR_EMPTY(ctx->module_desc));
+    if (len >= (int) sizeof(key)) {
+        len = sizeof(key) - 1;
+    }
+    snprintf(name, name_max, "%s/reg_%016llx.reg", ctx->reg_cache_dir,
+             acvp_fnv_hash(key, len));
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Loads the registration message from the cache.  The message is
+ * returned exactly as it was built, ready to be sent, so neither the
+ * capabilities nor a JSON registration file need to be processed.
+ * Returns NULL on a miss, the caller frees the message.
+ */
+char *acvp_reg_cache_load (ACVP_CTX *ctx) {
+    char name[ACVP_OFFLINE_PATH_MAX];
+    char magic[32];
+    unsigned long long hash;
+    char *reg;
+    int len;
+    FILE *fp;
+
+    if (acvp_reg_cache_name(ctx, name, sizeof(name)) != ACVP_SUCCESS) {
+        return NULL;
+    }
+    fp = fopen(name, "rb");
+    if (!fp) {
+        return NULL;
+    }
+    if (fscanf(fp, "%31s %llx %d", magic, &hash, &len) != 3 || fgetc(fp) != '\n' ||
+        strcmp(magic, ACVP_REG_CACHE_MAGIC) || len <= 0) {
+        ACVP_LOG_WARN("Ignoring malformed registration cache entry %s", name);
+        fclose(fp);
+        return NULL;
+    }
+
+    reg = calloc(1, len + 1);
+    if (!reg) {
+        fclose(fp);
+        return NULL;
+    }
+    if (fread(reg, 1, len, fp) != (size_t) len || acvp_fnv_hash(reg, len) != hash) {
+        ACVP_LOG_WARN("Ignoring damaged registration cache entry %s", name);
+        free(reg);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+
+    ACVP_LOG_STATUS("Using cached registration from %s", name);
+    return reg;
+}
+
+/*
+ * Saves the registration message to the cache, using the same
+ * temporary file and rename as the vector set cache.  A failure to
+ * cache is logged, it does not fail the session.
+ */
+void acvp_reg_cache_store (ACVP_CTX *ctx, const char *reg) {
+    char name[ACVP_OFFLINE_PATH_MAX];
+    char tmp_name[ACVP_OFFLINE_PATH_MAX + 4];
+    int len;
+    FILE *fp;
+
+    if (!reg) {
+        return;
+    }
+    len = strlen(reg);
+
+    if (acvp_reg_cache_name(ctx, name, sizeof(name)) != ACVP_SUCCESS) {
+        return;
+    }
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", name);
+    fp = fopen(tmp_name, "wb");
+    if (!fp) {
+        ACVP_LOG_WARN("Unable to create registration cache entry %s", name);
+        return;
+    }
+    fprintf(fp, "%s %llx %d\n", ACVP_REG_CACHE_MAGIC, acvp_fnv_hash(reg, len), len);
+    if (fwrite(reg, 1, len, fp) != (size_t) len) {
+        ACVP_LOG_WARN("Unable to write registration cache entry %s", name);
+        fclose(fp);
+        remove(tmp_name);
+        return;
+    }
+    fclose(fp);
+    if (rename(tmp_name, name)) {
+        ACVP_LOG_WARN("Unable to save registration cache entry %s", name);
+        remove(tmp_name);
+        return;
+    }
+    ACVP_LOG_INFO("Cached registration in %s", name);
+}
+
+/*
+ * Loads the capability manifest saved by a previous run.  A missing
+ * manifest is not an error, every capability is then registered.
+ */
+ACVP_RESULT acvp_manifest_load (ACVP_CTX *ctx, const char *filename) {
+    FILE *fp;
+
+    if (ctx->manifest_val) {
+        json_value_free(ctx->manifest_val);
+        ctx->manifest_val = NULL;
+    }
+    if (ctx->manifest_new) {
+        json_value_free(ctx->manifest_new);
+    }
+    ctx->manifest_new = json_value_init_object();
+
+    fp = fopen(filename, "r");
+    if (!fp) {
+        ACVP_LOG_STATUS("No capability manifest %s, registering every capability", filename);
+        return ACVP_SUCCESS;
+    }
+    fclose(fp);
+
+    ctx->manifest_val = json_parse_file(filename);
+    if (!json_object_get_object(json_value_get_object(ctx->manifest_val), "capabilities")) {
+        ACVP_LOG_ERR("Malformed capability manifest %s", filename);
+        if (ctx->manifest_val) {
+            json_value_free(ctx->manifest_val);
+            ctx->manifest_val = NULL;
+        }
+        return ACVP_MALFORMED_JSON;
+    }
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Fingerprints the registration JSON of a single capability
+ */
+unsigned long long acvp_cap_fingerprint (JSON_Value *cap_val) {
+    unsigned long long hash;
+    char *frag;
+
+    frag = json_serialize_to_string(cap_val);
+    if (!frag) {
+        return 0;
+    }
+    hash = acvp_fnv_hash(frag, strlen(frag));
+    json_free_serialized_string(frag);
+    return hash;
+}
+
+/*
+ * Fingerprints the registration fragment of a capability and records
+ * it for the next manifest.  The fragment is keyed by its algorithm
+ * and mode.  Returns 1 when the manifest holds the same fingerprint,
+ * i.e. the capability is unchanged since the last passing run.
+ */
+int acvp_manifest_check (ACVP_CTX *ctx, JSON_Object *cap_obj, JSON_Value *cap_val) {
+    JSON_Object *new_caps, *old_caps;
+    const char *alg, *mode, *old_hash;
+    char key[128], hash[17];
+    unsigned long long fingerprint;
+    int i;
+
+    alg = json_object_get_string(cap_obj, "algorithm");
+    mode = json_object_get_string(cap_obj, "mode");
+    new_caps = json_value_get_object(ctx->manifest_new);
+    snprintf(key, sizeof(key), "%s%s%s", alg ? alg : "", mode ? "/" : "", mode ? mode : "");
+    for (i = 2; json_object_get_value(new_caps, key); i++) {
+        snprintf(key, sizeof(key), "%s%s%s#%d", alg ? alg : "", mode ? "/" : "", mode ? mode : "", i);
+    }
+
+    fingerprint = acvp_cap_fingerprint(cap_val);
+    if (!fingerprint) {
+        ctx->manifest_changed++;
+        return 0;
+    }
+    snprintf(hash, sizeof(hash), "%016llx", fingerprint);
+    json_object_set_string(new_caps, key, hash);
+
+    old_caps = json_object_get_object(json_value_get_object(ctx->manifest_val), "capabilities");
+    old_hash = json_object_get_string(old_caps, key);
+    if (old_hash && !strcmp(old_hash, hash)) {
+        ACVP_LOG_STATUS("Capability %s unchanged, not registered", key);
+        return 1;
+    }
+    ACVP_LOG_STATUS("Capability %s %s, registered", key, old_hash ? "changed" : "is new");
+    ctx->manifest_changed++;
+    return 0;
+}
+
+/*
+ * Saves the fingerprints of the capabilities built for the last
+ * registration as the new manifest.
+ */
+ACVP_RESULT acvp_manifest_save (ACVP_CTX *ctx) {
+    JSON_Value *val;
+    char tmp_name[ACVP_OFFLINE_PATH_MAX + 4];
+    ACVP_RESULT rv = ACVP_SUCCESS;
+
+    if (!ctx->manifest_new || !json_object_get_count(json_value_get_object(ctx->manifest_new))) {
+        ACVP_LOG_ERR("No capabilities have been fingerprinted, call acvp_register() first");
+        return ACVP_NO_CAP;
+    }
+
+    val = json_value_init_object();
+    json_object_set_value(json_value_get_object(val), "capabilities", json_value_deep_copy(ctx->manifest_new));
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", ctx->manifest_file);
+    if (json_serialize_to_file_pretty(val, tmp_name) != JSONSuccess ||
+        rename(tmp_name, ctx->manifest_file)) {
+        ACVP_LOG_ERR("Unable to write capability manifest %s", ctx->manifest_file);
+        remove(tmp_name);
+        rv = ACVP_INVALID_ARG;
+    }
+    json_value_free(val);
+
+    return rv;
+}
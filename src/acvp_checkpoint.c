@@ -0,0 +1,238 @@
+/*****************************************************************************
+* Copyright (c) 2016, Cisco Systems, Inc.
+* All rights reserved.
+
+* Redistribution and use in source and binary forms, with or without modification, 
+* are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice, 
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation 
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+* USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "acvp.h"
+#include "acvp_lcl.h"
+#include "parson.h"
+
+/*
+ * The names the vector set states are stored with in the checkpoint,
+ * indexed by ACVP_VS_STATE
+ */
+static const char *acvp_vs_state_names[] = {
+    "registered",
+    "downloaded",
+    "computed",
+    "uploaded",
+    "verified"
+};
+#define ACVP_VS_STATE_CNT (int) (sizeof(acvp_vs_state_names) / sizeof(acvp_vs_state_names[0]))
+
+/*
+ * Writes the session checkpoint.  The checkpoint is written to a
+ * temporary file which then replaces the previous one, so a crash
+ * while saving leaves the last good checkpoint in place.
+ */
+ACVP_RESULT acvp_checkpoint_save (ACVP_CTX *ctx) {
+    JSON_Value *val;
+    JSON_Object *obj;
+    JSON_Value *vs_val;
+    JSON_Object *vs_obj;
+    JSON_Array *vs_arr;
+    ACVP_VS_LIST *vs_entry;
+    char tmp_name[ACVP_OFFLINE_PATH_MAX];
+    ACVP_RESULT rv = ACVP_SUCCESS;
+
+    val = json_value_init_object();
+    obj = json_value_get_object(val);
+    json_object_set_string(obj, "server", ctx->server_name ? ctx->server_name : "");
+    json_object_set_number(obj, "port", ctx->server_port);
+    json_object_set_string(obj, "accessToken", ctx->jwt_token ? ctx->jwt_token : "");
+    if (ctx->checkpoint_reg) {
+        json_object_set_string(obj, "registration", ctx->checkpoint_reg);
+    }
+
+    json_object_set_value(obj, "vectorSets", json_value_init_array());
+    vs_arr = json_object_get_array(obj, "vectorSets");
+    for (vs_entry = ctx->vs_list; vs_entry; vs_entry = vs_entry->next) {
+        vs_val = json_value_init_object();
+        vs_obj = json_value_get_object(vs_val);
+        json_object_set_number(vs_obj, "vsId", vs_entry->vs_id);
+        json_object_set_string(vs_obj, "state", acvp_vs_state_names[vs_entry->state]);
+        if (vs_entry->response) {
+            json_object_set_string(vs_obj, "response", vs_entry->response);
+        }
+        json_array_append_value(vs_arr, vs_val);
+    }
+
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", ctx->checkpoint_file);
+    if (json_serialize_to_file(val, tmp_name) != JSONSuccess ||
+        rename(tmp_name, ctx->checkpoint_file)) {
+        ACVP_LOG_ERR("Unable to write session checkpoint %s", ctx->checkpoint_file);
+        remove(tmp_name);
+        rv = ACVP_INVALID_ARG;
+    }
+    json_value_free(val);
+
+    return rv;
+}
+
+static ACVP_VS_LIST *acvp_checkpoint_find_vs (ACVP_CTX *ctx, int vs_id) {
+    ACVP_VS_LIST *vs_entry;
+
+    for (vs_entry = ctx->vs_list; vs_entry; vs_entry = vs_entry->next) {
+        if (vs_entry->vs_id == vs_id) {
+            return vs_entry;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Records the progress of a vector set and saves the checkpoint.
+ * Once a vector set is computed, its response is kept in the
+ * checkpoint until it has been uploaded, so a resumed session
+ * only needs to upload it.
+ */
+void acvp_checkpoint_vs (ACVP_CTX *ctx, int vs_id, ACVP_VS_STATE state) {
+    ACVP_VS_LIST *vs_entry;
+
+    if (!ctx->checkpoint_file) {
+        return;
+    }
+    vs_entry = acvp_checkpoint_find_vs(ctx, vs_id);
+    if (!vs_entry) {
+        return;
+    }
+
+    vs_entry->state = state;
+    if (state == ACVP_VS_COMPUTED && ctx->kat_resp) {
+        if (vs_entry->response) {
+            json_free_serialized_string(vs_entry->response);
+        }
+        vs_entry->response = json_serialize_to_string(ctx->kat_resp);
+    } else if (state >= ACVP_VS_UPLOADED && vs_entry->response) {
+        json_free_serialized_string(vs_entry->response);
+        vs_entry->response = NULL;
+    }
+
+    acvp_checkpoint_save(ctx);
+}
+
+/*
+ * Sets up the kat_resp from the response saved in the checkpoint,
+ * ready to be uploaded.  Returns ACVP_SUCCESS when the vector set
+ * had a saved response.
+ */
+ACVP_RESULT acvp_checkpoint_restore_response (ACVP_CTX *ctx, int vs_id) {
+    ACVP_VS_LIST *vs_entry;
+
+    vs_entry = acvp_checkpoint_find_vs(ctx, vs_id);
+    if (!vs_entry || !vs_entry->response) {
+        return ACVP_NO_CAP;
+    }
+    if (ctx->kat_resp) {
+        json_value_free(ctx->kat_resp);
+    }
+    ctx->kat_resp = json_parse_string(vs_entry->response);
+    if (!ctx->kat_resp) {
+        ACVP_LOG_ERR("Checkpointed response for vsId: %d is malformed", vs_id);
+        return ACVP_JSON_ERR;
+    }
+    ctx->vs_id = vs_id;
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Restores the access token and the vector set list of a session
+ * from its checkpoint.
+ */
+ACVP_RESULT acvp_checkpoint_load (ACVP_CTX *ctx, const char *filename) {
+    JSON_Value *val;
+    JSON_Object *obj;
+    JSON_Object *vs_obj;
+    JSON_Array *vs_arr;
+    ACVP_VS_LIST *vs_entry, **tail;
+    const char *server, *jwt, *reg, *state, *response;
+    int i, j, vs_cnt;
+
+    val = json_parse_file(filename);
+    obj = json_value_get_object(val);
+    jwt = json_object_get_string(obj, "accessToken");
+    vs_arr = json_object_get_array(obj, "vectorSets");
+    if (!jwt || !vs_arr) {
+        ACVP_LOG_ERR("Unable to read session checkpoint %s", filename);
+        if (val) {
+            json_value_free(val);
+        }
+        return ACVP_MALFORMED_JSON;
+    }
+
+    server = json_object_get_string(obj, "server");
+    if (ctx->server_name && server && (strcmp(server, ctx->server_name) ||
+        (int) json_object_get_number(obj, "port") != ctx->server_port)) {
+        ACVP_LOG_WARN("Session checkpoint was taken with server %s:%d", server,
+                      (int) json_object_get_number(obj, "port"));
+    }
+
+    if (ctx->jwt_token) { free(ctx->jwt_token); }
+    ctx->jwt_token = strdup(jwt);
+    if (ctx->checkpoint_reg) { free(ctx->checkpoint_reg); }
+    reg = json_object_get_string(obj, "registration");
+    ctx->checkpoint_reg = reg ? strdup(reg) : NULL;
+
+    while (ctx->vs_list) {
+        vs_entry = ctx->vs_list->next;
+        if (ctx->vs_list->response) { json_free_serialized_string(ctx->vs_list->response); }
+        free(ctx->vs_list);
+        ctx->vs_list = vs_entry;
+    }
+
+    tail = &ctx->vs_list;
+    vs_cnt = json_array_get_count(vs_arr);
+    for (i = 0; i < vs_cnt; i++) {
+        vs_obj = json_array_get_object(vs_arr, i);
+        vs_entry = calloc(1, sizeof(ACVP_VS_LIST));
+        if (!vs_entry) {
+            json_value_free(val);
+            return ACVP_MALLOC_FAIL;
+        }
+        vs_entry->vs_id = json_object_get_number(vs_obj, "vsId");
+        state = json_object_get_string(vs_obj, "state");
+        for (j = 0; state && j < ACVP_VS_STATE_CNT; j++) {
+            if (!strcmp(state, acvp_vs_state_names[j])) {
+                vs_entry->state = j;
+            }
+        }
+        response = json_object_get_string(vs_obj, "response");
+        if (response && vs_entry->state == ACVP_VS_COMPUTED) {
+            vs_entry->response = strdup(response);
+        } else if (vs_entry->state == ACVP_VS_COMPUTED) {
+            /* the response was lost, the vector set is processed again */
+            vs_entry->state = ACVP_VS_DOWNLOADED;
+        }
+        *tail = vs_entry;
+        tail = &vs_entry->next;
+        ACVP_LOG_STATUS("Resumed vs_id=%d (%s)", vs_entry->vs_id, acvp_vs_state_names[vs_entry->state]);
+    }
+    json_value_free(val);
+
+    return ACVP_SUCCESS;
+}
@@ -32,6 +32,58 @@
 #include "acvp_lcl.h"
 #include "parson.h"
 
+static ACVP_RESULT acvp_cmac_release_tc (ACVP_CMAC_TC *stc);
+
+/*
+ * This function allocates the buffers for a CMAC test case.
+ * It is called once per vector set, the buffers are then
+ * re-used for each test case and released by acvp_cmac_release_tc().
+ */
+static ACVP_RESULT acvp_cmac_alloc_tc (ACVP_CMAC_TC *stc) {
+    memset(stc, 0x0, sizeof(ACVP_CMAC_TC));
+
+    stc->msg = calloc(1, ACVP_CMAC_MSG_MAX);
+    if (!stc->msg) { goto err; }
+    stc->mac = calloc(ACVP_CMAC_MAC_MAX, sizeof(char));
+    if (!stc->mac) { goto err; }
+    stc->key = calloc(1, ACVP_CMAC_KEY_MAX);
+    if (!stc->key) { goto err; }
+    stc->key2 = calloc(1, ACVP_CMAC_KEY_MAX);
+    if (!stc->key2) { goto err; }
+    stc->key3 = calloc(1, ACVP_CMAC_KEY_MAX);
+    if (!stc->key3) { goto err; }
+
+    return ACVP_SUCCESS;
+
+    err:
+    acvp_cmac_release_tc(stc);
+    return ACVP_MALLOC_FAIL;
+}
+
+/*
+ * This function clears the data left over from the previous
+ * test case while keeping the buffers allocated by
+ * acvp_cmac_alloc_tc().  Only the used portion of the
+ * message buffer is zeroed.
+ */
+static void acvp_cmac_reset_tc (ACVP_CMAC_TC *stc) {
+    unsigned char *msg = stc->msg, *mac = stc->mac;
+    unsigned char *key = stc->key, *key2 = stc->key2, *key3 = stc->key3;
+
+    acvp_clear_tc_buf(msg, stc->msg_len, ACVP_CMAC_MSG_MAX);
+    memset(mac, 0x0, ACVP_CMAC_MAC_MAX);
+    memset(key, 0x0, ACVP_CMAC_KEY_MAX);
+    memset(key2, 0x0, ACVP_CMAC_KEY_MAX);
+    memset(key3, 0x0, ACVP_CMAC_KEY_MAX);
+
+    memset(stc, 0x0, sizeof(ACVP_CMAC_TC));
+    stc->msg = msg;
+    stc->mac = mac;
+    stc->key = key;
+    stc->key2 = key2;
+    stc->key3 = key3;
+}
+
 static ACVP_RESULT acvp_cmac_init_tc (ACVP_CTX *ctx,
                                       ACVP_CMAC_TC *stc,
                                       unsigned int tc_id,
@@ -44,6 +96,7 @@ static ACVP_RESULT acvp_cmac_init_tc (ACVP_CTX *ctx,
                                       int direction_verify,
                                       unsigned char *mac,
                                       unsigned int mac_len,
+                                      int stream,
                                       ACVP_CIPHER alg_id) {
     ACVP_RESULT rv;
 
@@ -65,25 +118,18 @@ static ACVP_RESULT acvp_cmac_init_tc (ACVP_CTX *ctx,
         }
     }
     
-    memset(stc, 0x0, sizeof(ACVP_CMAC_TC));
-
-    stc->msg = calloc(1, ACVP_CMAC_MSG_MAX);
-    if (!stc->msg) { return ACVP_MALLOC_FAIL; }
-    
-    stc->mac = calloc(ACVP_CMAC_MAC_MAX, sizeof(char));
-    if (!stc->mac) { return ACVP_MALLOC_FAIL; }
-    stc->key = calloc(1, ACVP_CMAC_KEY_MAX);
-    if (!stc->key) { return ACVP_MALLOC_FAIL; }
-    
-    stc->key2 = calloc(1, ACVP_CMAC_KEY_MAX);
-    if (!stc->key2) { return ACVP_MALLOC_FAIL; }
-    stc->key3 = calloc(1, ACVP_CMAC_KEY_MAX);
-    if (!stc->key3) { return ACVP_MALLOC_FAIL; }
+    acvp_cmac_reset_tc(stc);
 
-    rv = acvp_hexstr_to_bin((const unsigned char *) msg, stc->msg, ACVP_CMAC_MSG_MAX);
-    if (rv != ACVP_SUCCESS) {
-        ACVP_LOG_ERR("Hex converstion failure (msg)");
-        return rv;
+    /*
+     * A streamed message is decoded a chunk at a time
+     * by acvp_cmac_stream_tc()
+     */
+    if (!stream) {
+        rv = acvp_hexstr_to_bin((const unsigned char *) msg, stc->msg, ACVP_CMAC_MSG_MAX);
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Hex converstion failure (msg)");
+            return rv;
+        }
     }
     
     if (alg_id == ACVP_CMAC_AES) {
@@ -120,12 +166,37 @@ static ACVP_RESULT acvp_cmac_init_tc (ACVP_CTX *ctx,
     }
 
     stc->tc_id = tc_id;
-    stc->msg_len = msg_len;
+    stc->msg_len = stream ? 0 : msg_len;
     stc->cipher = alg_id;
     
     return ACVP_SUCCESS;
 }
 
+/*
+ * This is the handler for CMAC test cases whose message is too
+ * large to be handed to the crypto module in a single buffer.
+ * The message is fed to the crypto module in ACVP_CMAC_MSG_MAX
+ * sized chunks using the stream callbacks.
+ */
+static ACVP_RESULT acvp_cmac_stream_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
+                                        ACVP_TEST_CASE *tc, ACVP_CMAC_TC *stc,
+                                        unsigned char *msg,
+                                        unsigned long long msg_len) {
+    ACVP_RESULT rv;
+
+    ACVP_LOG_INFO("    Streaming %llu byte message", msg_len);
+
+    stc->full_len = msg_len;
+    rv = acvp_stream_hex_msg(ctx, &cap->cap.cmac_cap->stream, tc, msg,
+                             msg_len, msg_len, stc->msg,
+                             ACVP_CMAC_MSG_MAX, &stc->msg_len);
+
+    /* Make sure the next test case clears all the chunk data */
+    stc->msg_len = msg_len > ACVP_CMAC_MSG_MAX ? ACVP_CMAC_MSG_MAX : msg_len;
+
+    return rv;
+}
+
 /*
  * After the test case has been processed by the DUT, the results
  * need to be JSON formated to be included in the vector set results
@@ -159,7 +230,7 @@ static ACVP_RESULT acvp_cmac_output_tc (ACVP_CTX *ctx, ACVP_CMAC_TC *stc, JSON_O
 
 /*
  * This function simply releases the data associated with
- * a test case.
+ * the test cases of a vector set.
  */
 static ACVP_RESULT acvp_cmac_release_tc (ACVP_CMAC_TC *stc) {
     free(stc->msg);
@@ -175,6 +246,7 @@ static ACVP_RESULT acvp_cmac_release_tc (ACVP_CMAC_TC *stc) {
 ACVP_RESULT acvp_cmac_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     unsigned int tc_id, msglen, keyLen, keyingOption, maclen, verify = 0;
     unsigned char *msg = NULL, *key1 = NULL, *key2 = NULL, *key3 = NULL, *mac = NULL;
+    int stream;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Value *testval;
@@ -200,7 +272,7 @@ ACVP_RESULT acvp_cmac_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_CIPHER alg_id;
-    char *json_result, *direction = NULL;
+    char *direction = NULL;
 
     if (!alg_str) {
         ACVP_LOG_ERR("ERROR: unable to parse 'algorithm' from JSON");
@@ -251,6 +323,16 @@ ACVP_RESULT acvp_cmac_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     json_object_set_value(r_vs, "testResults", json_value_init_array());
     r_tarr = json_object_get_array(r_vs, "testResults");
 
+    /*
+     * Allocate the test case buffers once, they are
+     * re-used for every test case in the vector set.
+     */
+    rv = acvp_cmac_alloc_tc(&stc);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("ERROR: Unable to malloc in acvp_cmac_kat_handler");
+        return rv;
+    }
+
     groups = json_object_get_array(obj, "testGroups");
     g_cnt = json_array_get_count(groups);
     for (i = 0; i < g_cnt; i++) {
@@ -322,16 +404,32 @@ ACVP_RESULT acvp_cmac_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Setup the test case data that will be passed down to
              * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
              */
+            /*
+             * Messages that won't fit in the test case buffer
+             * are streamed to the crypto module
+             */
+            stream = 0;
+            if (msg && strlen((char *) msg) > ACVP_CMAC_MSG_MAX * 2) {
+                if (!cap->cap.cmac_cap->stream.update) {
+                    ACVP_LOG_ERR("ERROR: message too large, no CMAC stream callbacks registered");
+                    acvp_cmac_release_tc(&stc);
+                    return ACVP_UNSUPPORTED_OP;
+                }
+                stream = 1;
+            }
             acvp_cmac_init_tc(ctx, &stc, tc_id, msg, msglen, keyLen, key1, key2, key3,
-                              verify, mac, maclen, alg_id);
+                              verify, mac, maclen, stream, alg_id);
 
             /* Process the current test vector... */
-            rv = (cap->crypto_handler)(&tc);
+            if (stream) {
+                rv = acvp_cmac_stream_tc(ctx, cap, &tc, &stc, msg, strlen((char *) msg) / 2);
+            } else {
+                rv = acvp_call_crypto_handler(ctx, cap, &tc);
+            }
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("ERROR: crypto module failed the operation");
+                acvp_cmac_release_tc(&stc);
                 return ACVP_CRYPTO_MODULE_FAIL;
             }
 
@@ -341,27 +439,21 @@ ACVP_RESULT acvp_cmac_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             rv = acvp_cmac_output_tc(ctx, &stc, r_tobj);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("ERROR: JSON output failure in hash module");
+                acvp_cmac_release_tc(&stc);
                 return rv;
             }
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_cmac_release_tc(&stc);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
     }
 
-    json_array_append_value(reg_arry, r_vs_val);
+    /*
+     * Release all the memory associated with the test cases
+     */
+    acvp_cmac_release_tc(&stc);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
+    json_array_append_value(reg_arry, r_vs_val);
 
     return ACVP_SUCCESS;
 }
@@ -51,12 +51,22 @@ static ACVP_RESULT acvp_des_init_tc (ACVP_CTX *ctx,
                                      ACVP_CIPHER alg_id,
                                      ACVP_SYM_CIPH_DIR dir);
 
+static ACVP_RESULT acvp_des_alloc_tc (ACVP_SYM_CIPHER_TC *stc);
+
 static ACVP_RESULT acvp_des_release_tc (ACVP_SYM_CIPHER_TC *stc);
 
 
+/*
+ * The MCT only ever looks back one inner iteration, plus at the
+ * first block of the outer iteration, so rather than keeping every
+ * block we keep a two entry ring indexed by the parity of the
+ * inner iteration.
+ */
 static unsigned char old_iv[8];
-static unsigned char ptext[10001][8];
-static unsigned char ctext[10001][8];
+static unsigned char ptext[2][8];
+static unsigned char ctext[2][8];
+static unsigned char ptext_first[8];
+static unsigned char ctext_first[8];
 
 static void shiftin (unsigned char *dst, unsigned char *src, int nbits) {
     int n;
@@ -81,10 +91,16 @@ static void shiftin (unsigned char *dst, unsigned char *src, int nbits) {
 static ACVP_RESULT acvp_des_mct_iterate_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *stc,
                                             int i, JSON_Object *r_tobj) {
     int j = stc->mct_index;
+    unsigned char *ct_cur = ctext[j & 1], *ct_prev = ctext[(j + 1) & 1];
+    unsigned char *pt_cur = ptext[j & 1], *pt_prev = ptext[(j + 1) & 1];
     int n;
 
-    memcpy(ctext[j], stc->ct, stc->ct_len);
-    memcpy(ptext[j], stc->pt, stc->pt_len);
+    memcpy(ct_cur, stc->ct, stc->ct_len);
+    memcpy(pt_cur, stc->pt, stc->pt_len);
+    if (j == 0) {
+        memcpy(ctext_first, stc->ct, stc->ct_len);
+        memcpy(ptext_first, stc->pt, stc->pt_len);
+    }
 
     switch (stc->cipher) {
     case ACVP_TDES_CBC:
@@ -93,19 +109,19 @@ static ACVP_RESULT acvp_des_mct_iterate_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *s
                 memcpy(stc->pt, old_iv, 8);
             } else {
                 for (n = 0; n < 8; ++n) {
-                    stc->pt[n] = ctext[j - 1][n];
+                    stc->pt[n] = ct_prev[n];
                 }
             }
             for (n = 0; n < 8; ++n) {
-                stc->iv[n] = ctext[j][n];
+                stc->iv[n] = ct_cur[n];
             }
         } else {
             for (n = 0; n < 8; ++n) {
-                stc->ct[n] = ptext[j][n];
+                stc->ct[n] = pt_cur[n];
             }
             if (j != 0) {
                 for (n = 0; n < 8; ++n) {
-                    stc->iv[n] = ptext[j - 1][n];
+                    stc->iv[n] = pt_prev[n];
                 }
             }
         }
@@ -116,11 +132,11 @@ static ACVP_RESULT acvp_des_mct_iterate_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *s
                 memcpy(stc->pt, old_iv, 8);
             } else {
                 for (n = 0; n < 8; ++n) {
-                    stc->pt[n] = ctext[j - 1][n];
+                    stc->pt[n] = ct_prev[n];
                 }
             }
             for (n = 0; n < 8; ++n) {
-                stc->iv[n] = ctext[j][n];
+                stc->iv[n] = ct_cur[n];
             }
         } else {
 
@@ -191,72 +207,39 @@ static ACVP_RESULT acvp_des_mct_iterate_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *s
  * After the test case has been processed by the DUT, the results
  * need to be JSON formated to be included in the vector set results
  * file that will be uploaded to the server.  This routine handles
- * the JSON processing for a single test case for MCT.
+ * the JSON processing for a single test case for MCT.  The caller
+ * provides a scratch buffer of ACVP_SYM_CT_MAX bytes.
  */
 static ACVP_RESULT acvp_des_output_mct_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *stc,
-                                           JSON_Object *r_tobj) {
+                                           JSON_Object *r_tobj, char *tmp) {
     ACVP_RESULT rv;
-    char *tmp = NULL;
-    char *tmp1 = NULL;
-    char *tmp2 = NULL;
-    char *tmp3 = NULL;
-
-    tmp = calloc(1, ACVP_SYM_CT_MAX);
-    if (!tmp) {
-        ACVP_LOG_ERR("Unable to malloc in acvp_des_output_mct_tc");
-        return ACVP_MALLOC_FAIL;
-    }
-    tmp1 = calloc(1, ACVP_SYM_CT_MAX);
-    if (!tmp1) {
-        ACVP_LOG_ERR("Unable to malloc in acvp_des_output_mct_tc");
-        free(tmp);
-        return ACVP_MALLOC_FAIL;
-    }
-    tmp2 = calloc(1, ACVP_SYM_CT_MAX);
-    if (!tmp2) {
-        ACVP_LOG_ERR("Unable to malloc in acvp_des_output_mct_tc");
-        free(tmp);
-        free(tmp1);
-        return ACVP_MALLOC_FAIL;
-    }
-    tmp3 = calloc(1, ACVP_SYM_CT_MAX);
-    if (!tmp3) {
-        ACVP_LOG_ERR("Unable to malloc in acvp_des_output_mct_tc");
-        free(tmp);
-        free(tmp1);
-        free(tmp2);
-        return ACVP_MALLOC_FAIL;
-    }
 
     memset(tmp, 0x0, ACVP_SYM_CT_MAX);
-    memset(tmp1, 0x0, ACVP_SYM_CT_MAX);
-    memset(tmp2, 0x0, ACVP_SYM_CT_MAX);
-    memset(tmp3, 0x0, ACVP_SYM_CT_MAX);
-    rv = acvp_bin_to_hexstr(stc->key, stc->key_len / 24, (unsigned char *) tmp1);
+    rv = acvp_bin_to_hexstr(stc->key, stc->key_len / 24, (unsigned char *) tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (key)");
-        goto err;
+        return rv;
     }
-    rv = acvp_bin_to_hexstr(stc->key + 8, stc->key_len / 24, (unsigned char *) tmp2);
+    json_object_set_string(r_tobj, "key1", tmp);
+    rv = acvp_bin_to_hexstr(stc->key + 8, stc->key_len / 24, (unsigned char *) tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (key)");
-        goto err;
+        return rv;
     }
-    rv = acvp_bin_to_hexstr(stc->key + 16, stc->key_len / 24, (unsigned char *) tmp3);
+    json_object_set_string(r_tobj, "key2", tmp);
+    rv = acvp_bin_to_hexstr(stc->key + 16, stc->key_len / 24, (unsigned char *) tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (key)");
-        goto err;
+        return rv;
     }
-    json_object_set_string(r_tobj, "key1", tmp1);
-    json_object_set_string(r_tobj, "key2", tmp2);
-    json_object_set_string(r_tobj, "key3", tmp3);
+    json_object_set_string(r_tobj, "key3", tmp);
 
     if (stc->cipher != ACVP_TDES_ECB) {
         memset(tmp, 0x0, ACVP_SYM_CT_MAX);
         rv = acvp_bin_to_hexstr(stc->iv, stc->iv_len, (unsigned char *) tmp);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("hex conversion failure (iv)");
-            goto err;
+            return rv;
         }
         json_object_set_string(r_tobj, "iv", tmp);
     }
@@ -268,7 +251,7 @@ static ACVP_RESULT acvp_des_output_mct_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *st
             rv = acvp_bin_to_hexstr(stc->pt, 1, (unsigned char *) tmp);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("hex conversion failure (pt)");
-                goto err;
+                return rv;
             }
             json_object_set_string(r_tobj, "pt", tmp);
             json_object_set_number(r_tobj, "ptLen", 1);
@@ -277,7 +260,7 @@ static ACVP_RESULT acvp_des_output_mct_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *st
             rv = acvp_bin_to_hexstr(stc->pt, stc->pt_len, (unsigned char *) tmp);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("hex conversion failure (pt)");
-                goto err;
+                return rv;
             }
             json_object_set_string(r_tobj, "pt", tmp);
         }
@@ -288,7 +271,7 @@ static ACVP_RESULT acvp_des_output_mct_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *st
             rv = acvp_bin_to_hexstr(stc->ct, 1, (unsigned char *) tmp);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("hex conversion failure (ct)");
-                goto err;
+                return rv;
             }
             json_object_set_string(r_tobj, "ct", tmp);
             json_object_set_number(r_tobj, "ctLen", 1);
@@ -297,25 +280,13 @@ static ACVP_RESULT acvp_des_output_mct_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *st
             rv = acvp_bin_to_hexstr(stc->ct, stc->ct_len, (unsigned char *) tmp);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("hex conversion failure (ct)");
-                goto err;
+                return rv;
             }
             json_object_set_string(r_tobj, "ct", tmp);
         }
     }
 
-    free(tmp);
-    free(tmp1);
-    free(tmp2);
-    free(tmp3);
-
     return ACVP_SUCCESS;
-
-    err:
-    free(tmp);
-    free(tmp1);
-    free(tmp2);
-    free(tmp3);
-    return rv;
 }
 
 static const unsigned char odd_parity[256] = {
@@ -354,7 +325,7 @@ void acvp_des_set_odd_parity (unsigned char *key) {
 static ACVP_RESULT acvp_des_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
                                     ACVP_TEST_CASE *tc, ACVP_SYM_CIPHER_TC *stc,
                                     JSON_Array *res_array) {
-    int i, j, n, bit_len;
+    int i, j, n, bit_len, shift_start;
     ACVP_RESULT rv;
     JSON_Value *r_tval = NULL; /* Response testval */
     JSON_Object *r_tobj = NULL; /* Response testobj */
@@ -386,6 +357,12 @@ static ACVP_RESULT acvp_des_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
         return (ACVP_UNSUPPORTED_OP);
     }
 
+    /*
+     * The next key is built from the last 192 bits of output, so
+     * there's no need to shift every block of the inner loop in.
+     */
+    shift_start = ACVP_DES_MCT_INNER - ((3 * 64) / bit_len);
+
 
     for (i = 0; i < ACVP_DES_MCT_OUTER; ++i) {
 
@@ -398,10 +375,11 @@ static ACVP_RESULT acvp_des_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
         /*
          * Output the test case request values using JSON
          */
-        rv = acvp_des_output_mct_tc(ctx, stc, r_tobj);
+        rv = acvp_des_output_mct_tc(ctx, stc, r_tobj, tmp);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("JSON output failure in DES module");
             free(tmp);
+            json_value_free(r_tval);
             return rv;
         }
 
@@ -410,9 +388,14 @@ static ACVP_RESULT acvp_des_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
             if (j == 0) {
                 memcpy(old_iv, stc->iv, stc->iv_len);
             }
+            /*
+             * The key only changes between outer iterations, so the
+             * crypto module only needs to set up its key schedule
+             * when mct_index is 0 and may reuse it otherwise.
+             */
             stc->mct_index = j;    /* indicates init vs. update */
             /* Process the current DES encrypt test vector... */
-            rv = (cap->crypto_handler)(tc);
+            rv = acvp_call_crypto_handler(ctx, cap, tc);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("crypto module failed the operation");
                 free(tmp);
@@ -422,10 +405,12 @@ static ACVP_RESULT acvp_des_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
             /*
              * Adjust the parameters for next iteration if needed.
              */
-            if (stc->direction == ACVP_DIR_ENCRYPT) {
-                shiftin(nk, stc->ct, bit_len);
-            } else {
-                shiftin(nk, stc->pt, bit_len);
+            if (j >= shift_start) {
+                if (stc->direction == ACVP_DIR_ENCRYPT) {
+                    shiftin(nk, stc->ct, bit_len);
+                } else {
+                    shiftin(nk, stc->pt, bit_len);
+                }
             }
             rv = acvp_des_mct_iterate_tc(ctx, stc, i, r_tobj);
             if (rv != ACVP_SUCCESS) {
@@ -458,11 +443,11 @@ static ACVP_RESULT acvp_des_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
         if (stc->cipher == ACVP_TDES_OFB) {
             if (stc->direction == ACVP_DIR_ENCRYPT) {
                 for (n = 0; n < 8; ++n) {
-                    stc->pt[n] = ptext[0][n] ^ stc->iv_ret[n];
+                    stc->pt[n] = ptext_first[n] ^ stc->iv_ret[n];
                 }
             } else {
                 for (n = 0; n < 8; ++n) {
-                    stc->ct[n] = ctext[0][n] ^ stc->iv_ret[n];
+                    stc->ct[n] = ctext_first[n] ^ stc->iv_ret[n];
                 }
             }
         }
@@ -557,7 +542,7 @@ ACVP_RESULT acvp_des_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_SYM_CIPH_DIR dir;
     ACVP_CIPHER alg_id;
-    char *test_type, *json_result;
+    char *test_type;
 
     if (!alg_str) {
         ACVP_LOG_ERR("unable to parse 'algorithm' from JSON");
@@ -608,6 +593,16 @@ ACVP_RESULT acvp_des_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     json_object_set_value(r_vs, "testResults", json_value_init_array());
     r_tarr = json_object_get_array(r_vs, "testResults");
 
+    /*
+     * Allocate the test case buffers once, they are
+     * re-used for every test case in the vector set.
+     */
+    rv = acvp_des_alloc_tc(&stc);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Unable to malloc in acvp_des_kat_handler");
+        return rv;
+    }
+
     groups = json_object_get_array(obj, "testGroups");
     g_cnt = json_array_get_count(groups);
     for (i = 0; i < g_cnt; i++) {
@@ -626,10 +621,12 @@ ACVP_RESULT acvp_des_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 dir = ACVP_DIR_DECRYPT;
             } else {
                 ACVP_LOG_ERR("unsupported direction requested from server (%s)", dir_str);
+                acvp_des_release_tc(&stc);
                 return (ACVP_UNSUPPORTED_OP);
             }
         } else {
             ACVP_LOG_ERR("unsupported direction requested from server (%s)", dir_str);
+            acvp_des_release_tc(&stc);
             return (ACVP_UNSUPPORTED_OP);
         }
         keylen = (unsigned int) json_object_get_number(groupobj, "keyLen");
@@ -665,6 +662,7 @@ ACVP_RESULT acvp_des_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 key = calloc(1, ACVP_SYM_KEY_MAX);
                 if (!key) {
                     ACVP_LOG_ERR("Unable to malloc");
+                    acvp_des_release_tc(&stc);
                     return ACVP_MALLOC_FAIL;
                 }
                 memset(key, 0x0, ACVP_SYM_KEY_MAX);
@@ -680,6 +678,7 @@ ACVP_RESULT acvp_des_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 iv = (unsigned char *) json_object_get_string(testobj, "iv");
                 if (!pt) {
                     free(key);
+                    acvp_des_release_tc(&stc);
                     return (ACVP_MALFORMED_JSON);
                 }
 
@@ -698,6 +697,7 @@ ACVP_RESULT acvp_des_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 iv = (unsigned char *) json_object_get_string(testobj, "iv");
                 if (!ct) {
                     free(key);
+                    acvp_des_release_tc(&stc);
                     return (ACVP_MALFORMED_JSON);
                 }
 
@@ -730,8 +730,6 @@ ACVP_RESULT acvp_des_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Setup the test case data that will be passed down to
              * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
              */
             acvp_des_init_tc(ctx, &stc, tc_id, test_type, key, pt, ct, iv,
                              keylen, ivlen, ptlen, alg_id, dir);
@@ -744,17 +742,19 @@ ACVP_RESULT acvp_des_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("crypto module failed the DES MCT operation");
                     free(key);
+                    acvp_des_release_tc(&stc);
                     return ACVP_CRYPTO_MODULE_FAIL;
                 }
             } else {
 
                 /* Process the current DES encrypt test vector... */
-                rv = (cap->crypto_handler)(&tc);
+                rv = acvp_call_crypto_handler(ctx, cap, &tc);
 
                 if (rv != ACVP_SUCCESS) {
                     if (rv != ACVP_CRYPTO_WRAP_FAIL) {
                         ACVP_LOG_ERR("ERROR: crypto module failed the operation");
                         free(key);
+                        acvp_des_release_tc(&stc);
                         return ACVP_CRYPTO_MODULE_FAIL;
                     }
                 }
@@ -766,15 +766,11 @@ ACVP_RESULT acvp_des_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("JSON output failure in 3DES module");
                     free(key);
+                    acvp_des_release_tc(&stc);
                     return rv;
                 }
             }
 
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_des_release_tc(&stc);
-
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
 
@@ -782,15 +778,12 @@ ACVP_RESULT acvp_des_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
         }
     }
 
-    json_array_append_value(reg_arry, r_vs_val);
+    /*
+     * Release all the memory associated with the test cases
+     */
+    acvp_des_release_tc(&stc);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
+    json_array_append_value(reg_arry, r_vs_val);
 
     return ACVP_SUCCESS;
 }
@@ -896,6 +889,61 @@ static ACVP_RESULT acvp_des_output_tc (ACVP_CTX *ctx, ACVP_SYM_CIPHER_TC *stc,
 }
 
 
+/*
+ * This function allocates the buffers for a 3DES test case.
+ * It is called once per vector set, the buffers are then
+ * re-used for each test case and released by acvp_des_release_tc().
+ */
+static ACVP_RESULT acvp_des_alloc_tc (ACVP_SYM_CIPHER_TC *stc) {
+    memset(stc, 0x0, sizeof(ACVP_SYM_CIPHER_TC));
+
+    stc->key = calloc(1, ACVP_SYM_KEY_MAX);
+    if (!stc->key) { goto err; }
+    stc->pt = calloc(1, ACVP_SYM_PT_MAX);
+    if (!stc->pt) { goto err; }
+    stc->ct = calloc(1, ACVP_SYM_CT_MAX);
+    if (!stc->ct) { goto err; }
+    stc->iv = calloc(1, ACVP_SYM_IV_MAX);
+    if (!stc->iv) { goto err; }
+    stc->iv_ret = calloc(1, ACVP_SYM_IV_MAX);
+    if (!stc->iv_ret) { goto err; }
+    stc->iv_ret_after = calloc(1, ACVP_SYM_IV_MAX);
+    if (!stc->iv_ret_after) { goto err; }
+
+    return ACVP_SUCCESS;
+
+    err:
+    acvp_des_release_tc(stc);
+    return ACVP_MALLOC_FAIL;
+}
+
+/*
+ * This function clears the data left over from the previous
+ * test case while keeping the buffers allocated by
+ * acvp_des_alloc_tc().  Only the used portion of the
+ * pt/ct buffers is zeroed.
+ */
+static void acvp_des_reset_tc (ACVP_SYM_CIPHER_TC *stc) {
+    unsigned char *key = stc->key, *pt = stc->pt, *ct = stc->ct;
+    unsigned char *iv = stc->iv, *iv_ret = stc->iv_ret;
+    unsigned char *iv_ret_after = stc->iv_ret_after;
+
+    memset(key, 0x0, ACVP_SYM_KEY_MAX);
+    memset(iv, 0x0, ACVP_SYM_IV_MAX);
+    memset(iv_ret, 0x0, ACVP_SYM_IV_MAX);
+    memset(iv_ret_after, 0x0, ACVP_SYM_IV_MAX);
+    acvp_clear_tc_buf(pt, stc->pt_len, ACVP_SYM_PT_MAX);
+    acvp_clear_tc_buf(ct, stc->ct_len, ACVP_SYM_CT_MAX);
+
+    memset(stc, 0x0, sizeof(ACVP_SYM_CIPHER_TC));
+    stc->key = key;
+    stc->pt = pt;
+    stc->ct = ct;
+    stc->iv = iv;
+    stc->iv_ret = iv_ret;
+    stc->iv_ret_after = iv_ret_after;
+}
+
 /*
  * This function is used to fill-in the data for a 3DES
  * test case.  The JSON parsing logic invokes this after the
@@ -922,20 +970,7 @@ static ACVP_RESULT acvp_des_init_tc (ACVP_CTX *ctx,
 
     //FIXME:  check lengths do not exceed MAX values below
 
-    memset(stc, 0x0, sizeof(ACVP_SYM_CIPHER_TC));
-
-    stc->key = calloc(1, ACVP_SYM_KEY_MAX);
-    if (!stc->key) { return ACVP_MALLOC_FAIL; }
-    stc->pt = calloc(1, ACVP_SYM_PT_MAX);
-    if (!stc->pt) { return ACVP_MALLOC_FAIL; }
-    stc->ct = calloc(1, ACVP_SYM_CT_MAX);
-    if (!stc->ct) { return ACVP_MALLOC_FAIL; }
-    stc->iv = calloc(1, ACVP_SYM_IV_MAX);
-    if (!stc->iv) { return ACVP_MALLOC_FAIL; }
-    stc->iv_ret = calloc(1, ACVP_SYM_IV_MAX);
-    if (!stc->iv_ret) { return ACVP_MALLOC_FAIL; }
-    stc->iv_ret_after = calloc(1, ACVP_SYM_IV_MAX);
-    if (!stc->iv_ret_after) { return ACVP_MALLOC_FAIL; }
+    acvp_des_reset_tc(stc);
 
     /* Assume KAT if not MCT */
     if (test_type && !strcmp(test_type, "MCT")) {
@@ -1017,7 +1052,7 @@ static ACVP_RESULT acvp_des_init_tc (ACVP_CTX *ctx,
 
 /*
  * This function simply releases the data associated with
- * a test case.
+ * the test cases of a vector set.
  */
 static ACVP_RESULT acvp_des_release_tc (ACVP_SYM_CIPHER_TC *stc) {
     free(stc->key);
@@ -32,10 +32,28 @@
 #include "acvp_lcl.h"
 #include "parson.h"
 
+/*
+ * The DRBG lengths in the vector set are in bits
+ */
+#define ACVP_DRBG_BYTES(bits) (((bits) + 7) / 8)
+
 /*
  * Forward prototypes for local functions
  */
-static ACVP_RESULT acvp_drbg_output_tc (ACVP_CTX *ctx, ACVP_DRBG_TC *stc, JSON_Object *tc_rsp);
+static ACVP_RESULT acvp_drbg_output_tc (ACVP_CTX *ctx, ACVP_DRBG_TC *stc, JSON_Object *tc_rsp,
+                                        char *drb_hex);
+
+static ACVP_RESULT acvp_drbg_init_group (ACVP_CTX *ctx,
+                                         ACVP_DRBG_TC *stc,
+                                         unsigned int der_func_enabled,
+                                         unsigned int pred_resist_enabled,
+                                         unsigned int additional_input_len,
+                                         unsigned int perso_string_len,
+                                         unsigned int entropy_len,
+                                         unsigned int nonce_len,
+                                         unsigned int drb_len,
+                                         ACVP_DRBG_MODE mode_id,
+                                         ACVP_CIPHER alg_id);
 
 static ACVP_RESULT acvp_drbg_init_tc (ACVP_CTX *ctx,
                                       ACVP_DRBG_TC *stc,
@@ -46,19 +64,15 @@ static ACVP_RESULT acvp_drbg_init_tc (ACVP_CTX *ctx,
                                       unsigned char *entropy_input_pr_1,
                                       unsigned char *perso_string,
                                       unsigned char *entropy,
-                                      unsigned char *nonce,
-                                      unsigned int der_func_enabled,
-                                      unsigned int pred_resist_enabled,
-                                      unsigned int additional_input_len,
-                                      unsigned int perso_string_len,
-                                      unsigned int entropy_len,
-                                      unsigned int nonce_len,
-                                      unsigned int drb_len,
-                                      ACVP_DRBG_MODE mode_id,
-                                      ACVP_CIPHER alg_id);
+                                      unsigned char *nonce);
 
 static ACVP_RESULT acvp_drbg_release_tc (ACVP_DRBG_TC *stc);
 
+static ACVP_RESULT acvp_drbg_group_begin (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc);
+
+static ACVP_RESULT acvp_drbg_group_end (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
+                                        void *group_ctx, ACVP_RESULT rv);
+
 //handle array values
 ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     unsigned int tc_id;
@@ -78,6 +92,8 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     unsigned int pred_resist_enabled;
     
     char *json_result;
+    char *drb_hex = NULL;
+    void *group_ctx = NULL;
 
     JSON_Value *reg_arry_val = NULL;
     JSON_Object *reg_obj = NULL;
@@ -100,7 +116,7 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_CAPS_LIST *cap;
     ACVP_DRBG_TC stc;
     ACVP_TEST_CASE tc;
-    ACVP_RESULT rv;
+    ACVP_RESULT rv = ACVP_SUCCESS;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_CIPHER alg_id;
     ACVP_DRBG_MODE mode_id;
@@ -116,6 +132,7 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
      * Get a reference to the abstracted test case
      */
     tc.tc.drbg = &stc;
+    memset(&stc, 0x0, sizeof(ACVP_DRBG_TC));
 
     /*
      * Get the crypto module handler for this DRBG algorithm
@@ -132,12 +149,23 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
         return (ACVP_UNSUPPORTED_OP);
     }
     
+    /*
+     * The hex encoded returnedBits of every test case in the
+     * vector set are built in this buffer.
+     */
+    drb_hex = calloc(1, (2 * ACVP_DRB_MAX) + 1);
+    if (!drb_hex) {
+        ACVP_LOG_ERR("Unable to malloc in acvp_drbg_kat_handler");
+        return ACVP_MALLOC_FAIL;
+    }
+
     /*
      * Create ACVP array for response
      */
     rv = acvp_create_array(&reg_obj, &reg_arry_val, &reg_arry);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Failed to create JSON response struct. ");
+        free(drb_hex);
         return (rv);
     }
 
@@ -165,9 +193,11 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
         groupval = json_array_get_value(groups, i);
         groupobj = json_value_get_object(groupval);
 
-        json_result = json_serialize_to_string_pretty(groupval);
-        ACVP_LOG_INFO("json groupval count: %d\n %s\n", i, json_result);
-        json_free_serialized_string(json_result);
+        if (ACVP_LOG_ON(ctx, ACVP_LOG_LVL_INFO)) {
+            json_result = json_serialize_to_string_pretty(groupval);
+            ACVP_LOG_INFO("json groupval count: %d\n %s\n", i, json_result);
+            json_free_serialized_string(json_result);
+        }
     
         /*
          * Get DRBG Mode index
@@ -175,12 +205,14 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
         char *mode_str = (char *) json_object_get_string(groupobj, "mode");
         if (!mode_str) {
             ACVP_LOG_ERR("unable to parse DRBG 'mode' from JSON");
-            return (ACVP_MALFORMED_JSON);
+            rv = ACVP_MALFORMED_JSON;
+            goto end;
         }
         mode_id = acvp_lookup_drbg_mode_index(mode_str);
         if (mode_id == ACVP_DRBG_MODE_END) {
             ACVP_LOG_ERR("unsupported DRBG mode (%s)", mode_str);
-            return (ACVP_UNSUPPORTED_OP);
+            rv = ACVP_UNSUPPORTED_OP;
+            goto end;
         }
     
         /*
@@ -196,7 +228,8 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
 
         if (!der_func_enabled || !pred_resist_enabled) {
             ACVP_LOG_ERR("ACVP server requesting unsupported PR or DF capability");
-            return (ACVP_UNSUPPORTED_OP);
+            rv = ACVP_UNSUPPORTED_OP;
+            goto end;
         }
 
         if (pred_resist_enabled) {
@@ -216,6 +249,30 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
         ACVP_LOG_INFO("    returnedBitsLen: %d", drb_len);
         //TODO: Sanity check alg/mode mismatch
 
+        /*
+         * Size the test case buffers for this group, they are
+         * re-used by every test case in the group.
+         */
+        rv = acvp_drbg_init_group(ctx, &stc, der_func_enabled,
+                                  pred_resist_enabled,
+                                  additional_input_len,
+                                  perso_string_len,
+                                  entropy_len,
+                                  nonce_len,
+                                  drb_len,
+                                  mode_id,
+                                  alg_id);
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
+
+        rv = acvp_drbg_group_begin(ctx, cap, &tc);
+        if (rv != ACVP_SUCCESS) {
+            acvp_drbg_release_tc(&stc);
+            goto end;
+        }
+        group_ctx = stc.group_ctx;
+
         /*
          * Handle test array
          */
@@ -227,9 +284,11 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             testval = json_array_get_value(tests, j);
             testobj = json_value_get_object(testval);
 
-            json_result = json_serialize_to_string_pretty(testval);
-            ACVP_LOG_INFO("json testval count: %d\n %s\n", i, json_result);
-            json_free_serialized_string(json_result);
+            if (ACVP_LOG_ON(ctx, ACVP_LOG_LVL_INFO)) {
+                json_result = json_serialize_to_string_pretty(testval);
+                ACVP_LOG_INFO("json testval count: %d\n %s\n", i, json_result);
+                json_free_serialized_string(json_result);
+            }
 
             tc_id = (unsigned int) json_object_get_number(testobj, "tcId");
 
@@ -262,6 +321,8 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Get 2nd element from the array
              */
+            additional_input_1 = NULL;
+            entropy_input_pr_1 = NULL;
             if (pr_input_cnt == 2) {
                 pr_i = pr_i + 1;
                 pr_input_val = json_array_get_value(pred_resist_input, pr_i);
@@ -281,93 +342,159 @@ ACVP_RESULT acvp_drbg_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Setup the test case data that will be passed down to
              * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
              */
-            acvp_drbg_init_tc(ctx, &stc, tc_id, additional_input,
-                              entropy_input_pr,
-                              additional_input_1,
-                              entropy_input_pr_1,
-                              perso_string,
-                              entropy,
-                              nonce,
-                              der_func_enabled,
-                              pred_resist_enabled,
-                              additional_input_len,
-                              perso_string_len,
-                              entropy_len,
-                              nonce_len,
-                              drb_len,
-                              mode_id,
-                              alg_id);
+            rv = acvp_drbg_init_tc(ctx, &stc, tc_id, additional_input,
+                                   entropy_input_pr,
+                                   additional_input_1,
+                                   entropy_input_pr_1,
+                                   perso_string,
+                                   entropy,
+                                   nonce);
+            stc.group_ctx = group_ctx;
+            if (rv != ACVP_SUCCESS) {
+                ACVP_LOG_ERR("Failed to initialize DRBG test case");
+                json_value_free(r_tval);
+                break;
+            }
 
             /* Process the current test vector... */
-            rv = (cap->crypto_handler)(&tc);
+            rv = acvp_call_crypto_handler(ctx, cap, &tc);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("crypto module failed the operation");
-                return ACVP_CRYPTO_MODULE_FAIL;
+                rv = ACVP_CRYPTO_MODULE_FAIL;
+                json_value_free(r_tval);
+                break;
             }
 
             /*
              * Output the test case results using JSON
              */
-            rv = acvp_drbg_output_tc(ctx, &stc, r_tobj);
+            rv = acvp_drbg_output_tc(ctx, &stc, r_tobj, drb_hex);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("JSON output failure in DRBG module");
-                return rv;
+                json_value_free(r_tval);
+                break;
             }
 
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_drbg_release_tc(&stc);
-
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
 
         }
-    }
-    json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        /*
+         * Release all the memory associated with the group
+         */
+        rv = acvp_drbg_group_end(ctx, cap, &tc, group_ctx, rv);
+        acvp_drbg_release_tc(&stc);
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
     }
-    json_free_serialized_string(json_result);
 
-    return ACVP_SUCCESS;
+    end:
+    free(drb_hex);
+    json_array_append_value(reg_arry, r_vs_val);
+
+    return rv;
 }
 
 /*
  * After the test case has been processed by the DUT, the results
  * need to be JSON formated to be included in the vector set results
  * file that will be uploaded to the server.  This routine handles
- * the JSON processing for a single test case.
+ * the JSON processing for a single test case.  drb_hex is the
+ * vector set's buffer for the hex encoded returnedBits.
  */
-static ACVP_RESULT acvp_drbg_output_tc (ACVP_CTX *ctx, ACVP_DRBG_TC *stc, JSON_Object *tc_rsp) {
+static ACVP_RESULT acvp_drbg_output_tc (ACVP_CTX *ctx, ACVP_DRBG_TC *stc, JSON_Object *tc_rsp,
+                                        char *drb_hex) {
     ACVP_RESULT rv;
-    char *tmp = NULL;
-
-    tmp = calloc(1, 2 * ACVP_DRB_MAX);
-    if (!tmp) {
-        ACVP_LOG_ERR("Unable to malloc in acvp_drbg_output_tc");
-        return ACVP_MALLOC_FAIL;
-    }
 
-    rv = acvp_bin_to_hexstr(stc->drb, stc->drb_len/8, (unsigned char *) tmp);
+    rv = acvp_bin_to_hexstr(stc->drb, stc->drb_len/8, (unsigned char *) drb_hex);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (returnedBits)");
         return rv;
     }
-    json_object_set_string(tc_rsp, "returnedBits", tmp);
+    json_object_set_string(tc_rsp, "returnedBits", drb_hex);
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Set up the test case for a group.  The settings and lengths are
+ * the same for every test case in the group, so the buffers are
+ * sized from the group lengths and carved from a single allocation
+ * that all the test cases of the group re-use.
+ */
+static ACVP_RESULT acvp_drbg_init_group (ACVP_CTX *ctx,
+                                         ACVP_DRBG_TC *stc,
+                                         unsigned int der_func_enabled,
+                                         unsigned int pred_resist_enabled,
+                                         unsigned int additional_input_len,
+                                         unsigned int perso_string_len,
+                                         unsigned int entropy_len,
+                                         unsigned int nonce_len,
+                                         unsigned int drb_len,
+                                         ACVP_DRBG_MODE mode_id,
+                                         ACVP_CIPHER alg_id) {
+    unsigned int addl_bytes = ACVP_DRBG_BYTES(additional_input_len);
+    unsigned int perso_bytes = ACVP_DRBG_BYTES(perso_string_len);
+    unsigned int entropy_bytes = ACVP_DRBG_BYTES(entropy_len);
+    unsigned int nonce_bytes = ACVP_DRBG_BYTES(nonce_len);
+    unsigned int drb_bytes = ACVP_DRBG_BYTES(drb_len);
+    unsigned char *buf;
+
+    memset(stc, 0x0, sizeof(ACVP_DRBG_TC));
+
+    if (addl_bytes > ACVP_DRBG_ADDI_IN_MAX ||
+        perso_bytes > ACVP_DRBG_PER_SO_MAX ||
+        entropy_bytes > ACVP_DRBG_ENTPY_IN_MAX ||
+        nonce_bytes > ACVP_DRBG_NONCE_MAX ||
+        drb_bytes > ACVP_DRB_MAX) {
+        ACVP_LOG_ERR("DRBG group lengths exceed the supported maximum");
+        return ACVP_INVALID_ARG;
+    }
+
+    /*
+     * drb comes first, releasing it releases all the buffers
+     */
+    buf = calloc(1, drb_bytes + (2 * addl_bytes) + (3 * entropy_bytes) +
+                 nonce_bytes + perso_bytes + 1);
+    if (!buf) { return ACVP_MALLOC_FAIL; }
+
+    stc->drb = buf;
+    buf += drb_bytes;
+    stc->additional_input = buf;
+    buf += addl_bytes;
+    stc->additional_input_1 = buf;
+    buf += addl_bytes;
+    stc->entropy = buf;
+    buf += entropy_bytes;
+    stc->entropy_input_pr = buf;
+    buf += entropy_bytes;
+    stc->entropy_input_pr_1 = buf;
+    buf += entropy_bytes;
+    stc->nonce = buf;
+    buf += nonce_bytes;
+    stc->perso_string = buf;
 
-    free(tmp);
+    stc->additional_input_len = additional_input_len;
+    stc->pred_resist_enabled = pred_resist_enabled;
+    stc->perso_string_len = perso_string_len;
+    stc->der_func_enabled = der_func_enabled;
+    stc->entropy_len = entropy_len;
+    stc->nonce_len = nonce_len;
+    stc->drb_len = drb_len;
+    stc->mode = mode_id;
+    stc->cipher = alg_id;
 
     return ACVP_SUCCESS;
 }
 
+/*
+ * Decode the values of a single test case into the group's
+ * buffers.  Each buffer is cleared first, the lengths were
+ * set by acvp_drbg_init_group().
+ */
 static ACVP_RESULT acvp_drbg_init_tc (ACVP_CTX *ctx,
                                       ACVP_DRBG_TC *stc,
                                       unsigned int tc_id,
@@ -377,42 +504,25 @@ static ACVP_RESULT acvp_drbg_init_tc (ACVP_CTX *ctx,
                                       unsigned char *entropy_input_pr_1,
                                       unsigned char *perso_string,
                                       unsigned char *entropy,
-                                      unsigned char *nonce,
-                                      unsigned int der_func_enabled,
-                                      unsigned int pred_resist_enabled,
-                                      unsigned int additional_input_len,
-                                      unsigned int perso_string_len,
-                                      unsigned int entropy_len,
-                                      unsigned int nonce_len,
-                                      unsigned int drb_len,
-                                      ACVP_DRBG_MODE mode_id,
-                                      ACVP_CIPHER alg_id) {
+                                      unsigned char *nonce) {
+    unsigned int addl_bytes = ACVP_DRBG_BYTES(stc->additional_input_len);
+    unsigned int perso_bytes = ACVP_DRBG_BYTES(stc->perso_string_len);
+    unsigned int entropy_bytes = ACVP_DRBG_BYTES(stc->entropy_len);
+    unsigned int nonce_bytes = ACVP_DRBG_BYTES(stc->nonce_len);
     ACVP_RESULT rv;
-    memset(stc, 0x0, sizeof(ACVP_DRBG_TC));
-
-    //TODO Verify that these MAX values are correct.
-
-    stc->drb = calloc(1, ACVP_DRB_MAX);
-    if (!stc->drb) { return ACVP_MALLOC_FAIL; }
-    stc->additional_input = calloc(1, ACVP_DRBG_ADDI_IN_MAX);
-    if (!stc->additional_input) { return ACVP_MALLOC_FAIL; }
-    stc->additional_input_1 = calloc(1, ACVP_DRBG_ADDI_IN_MAX);
-    if (!stc->additional_input_1) { return ACVP_MALLOC_FAIL; }
-    stc->entropy = calloc(1, ACVP_DRBG_ENTPY_IN_MAX);
-    if (!stc->entropy) { return ACVP_MALLOC_FAIL; }
-    stc->entropy_input_pr = calloc(1, ACVP_DRBG_ENTPY_IN_MAX);
-    if (!stc->entropy_input_pr) { return ACVP_MALLOC_FAIL; }
-    stc->entropy_input_pr_1 = calloc(1, ACVP_DRBG_ENTPY_IN_MAX);
-    if (!stc->entropy_input_pr_1) { return ACVP_MALLOC_FAIL; }
-    stc->nonce = calloc(1, ACVP_DRBG_NONCE_MAX);
-    if (!stc->nonce) { return ACVP_MALLOC_FAIL; }
-    stc->perso_string = calloc(1, ACVP_DRBG_PER_SO_MAX);
-    if (!stc->perso_string) { return ACVP_MALLOC_FAIL; }
 
+    memset(stc->drb, 0x0, ACVP_DRBG_BYTES(stc->drb_len));
+    memset(stc->additional_input, 0x0, addl_bytes);
+    memset(stc->additional_input_1, 0x0, addl_bytes);
+    memset(stc->entropy, 0x0, entropy_bytes);
+    memset(stc->entropy_input_pr, 0x0, entropy_bytes);
+    memset(stc->entropy_input_pr_1, 0x0, entropy_bytes);
+    memset(stc->nonce, 0x0, nonce_bytes);
+    memset(stc->perso_string, 0x0, perso_bytes);
 
     if (additional_input) {
         rv = acvp_hexstr_to_bin((const unsigned char *) additional_input,
-                                stc->additional_input, ACVP_DRBG_ADDI_IN_MAX);
+                                stc->additional_input, addl_bytes);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (additional_input)");
             return rv;
@@ -421,7 +531,7 @@ static ACVP_RESULT acvp_drbg_init_tc (ACVP_CTX *ctx,
 
     if (entropy_input_pr) {
         rv = acvp_hexstr_to_bin((const unsigned char *) entropy_input_pr,
-                                stc->entropy_input_pr, ACVP_DRBG_ENTPY_IN_MAX);
+                                stc->entropy_input_pr, entropy_bytes);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (entropy_input_pr)");
             return rv;
@@ -430,7 +540,7 @@ static ACVP_RESULT acvp_drbg_init_tc (ACVP_CTX *ctx,
 
     if (additional_input_1) {
         rv = acvp_hexstr_to_bin((const unsigned char *) additional_input_1,
-                                stc->additional_input_1, ACVP_DRBG_ADDI_IN_MAX);
+                                stc->additional_input_1, addl_bytes);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (2nd additional_input)");
             return rv;
@@ -439,7 +549,7 @@ static ACVP_RESULT acvp_drbg_init_tc (ACVP_CTX *ctx,
 
     if (entropy_input_pr_1) {
         rv = acvp_hexstr_to_bin((const unsigned char *) entropy_input_pr_1,
-                                stc->entropy_input_pr_1, ACVP_DRBG_ENTPY_IN_MAX);
+                                stc->entropy_input_pr_1, entropy_bytes);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (2nd entropy_input_pr)");
             return rv;
@@ -448,7 +558,7 @@ static ACVP_RESULT acvp_drbg_init_tc (ACVP_CTX *ctx,
 
     if (entropy) {
         rv = acvp_hexstr_to_bin((const unsigned char *) entropy,
-                                stc->entropy, ACVP_DRBG_ENTPY_IN_MAX);
+                                stc->entropy, entropy_bytes);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (entropy)");
             return rv;
@@ -457,7 +567,7 @@ static ACVP_RESULT acvp_drbg_init_tc (ACVP_CTX *ctx,
 
     if (perso_string) {
         rv = acvp_hexstr_to_bin((const unsigned char *) perso_string,
-                                stc->perso_string, ACVP_DRBG_PER_SO_MAX);
+                                stc->perso_string, perso_bytes);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (perso_string)");
             return rv;
@@ -466,41 +576,71 @@ static ACVP_RESULT acvp_drbg_init_tc (ACVP_CTX *ctx,
 
     if (nonce) {
         rv = acvp_hexstr_to_bin((const unsigned char *) nonce,
-                                stc->nonce, ACVP_DRBG_NONCE_MAX);
+                                stc->nonce, nonce_bytes);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("Hex conversion failure (nonce)");
             return rv;
         }
     }
 
-    stc->additional_input_len = additional_input_len;
-    stc->pred_resist_enabled = pred_resist_enabled;
-    stc->perso_string_len = perso_string_len;
-    stc->der_func_enabled = der_func_enabled;
-    stc->entropy_len = entropy_len;
-    stc->nonce_len = nonce_len;
-    stc->drb_len = drb_len;
     stc->tc_id = tc_id;
-    stc->mode = mode_id;
-    stc->cipher = alg_id;
 
     return ACVP_SUCCESS;
 }
 
 /*
  * This function simply releases the data associated with
- * a test case.
+ * a test group.
  */
 static ACVP_RESULT acvp_drbg_release_tc (ACVP_DRBG_TC *stc) {
     free(stc->drb);
-    free(stc->additional_input);
-    free(stc->additional_input_1);
-    free(stc->entropy);
-    free(stc->entropy_input_pr);
-    free(stc->entropy_input_pr_1);
-    free(stc->nonce);
-    free(stc->perso_string);
 
     memset(stc, 0x0, sizeof(ACVP_DRBG_TC));
     return ACVP_SUCCESS;
 }
+
+/*
+ * Invoke the optional group setup callback before the first test
+ * case of a group.  The test case carries the group settings and
+ * lengths, the module keeps whatever it builds from them in
+ * group_ctx.
+ */
+static ACVP_RESULT acvp_drbg_group_begin (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc) {
+    ACVP_DRBG_TC *stc = tc->tc.drbg;
+    ACVP_DRBG_CAP *drbg_cap = cap->cap.drbg_cap;
+
+    stc->group_ctx = NULL;
+    if (!drbg_cap || !drbg_cap->group.begin) {
+        return ACVP_SUCCESS;
+    }
+
+    if ((drbg_cap->group.begin)(tc) != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("ERROR: crypto module failed the group setup");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Invoke the optional group teardown callback, also when a test
+ * case in the group failed.
+ */
+static ACVP_RESULT acvp_drbg_group_end (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
+                                        void *group_ctx, ACVP_RESULT rv) {
+    ACVP_DRBG_TC *stc = tc->tc.drbg;
+    ACVP_DRBG_CAP *drbg_cap = cap->cap.drbg_cap;
+
+    if (!drbg_cap || !drbg_cap->group.end) {
+        return rv;
+    }
+
+    stc->group_ctx = group_ctx;
+    if ((drbg_cap->group.end)(tc) != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("ERROR: crypto module failed the group teardown");
+        if (rv == ACVP_SUCCESS) {
+            rv = ACVP_CRYPTO_MODULE_FAIL;
+        }
+    }
+    stc->group_ctx = NULL;
+    return rv;
+}
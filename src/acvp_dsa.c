@@ -83,6 +83,9 @@ static ACVP_RESULT acvp_dsa_keygen_init_tc (ACVP_CTX *ctx,
         return ACVP_INVALID_ARG;
     }
 
+    if (ctx->bn_binary) {
+        return acvp_bn_alloc((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
+    }
     return ACVP_SUCCESS;
 }
 static ACVP_RESULT acvp_dsa_siggen_init_tc (ACVP_CTX *ctx,
@@ -122,6 +125,9 @@ static ACVP_RESULT acvp_dsa_siggen_init_tc (ACVP_CTX *ctx,
         ACVP_LOG_ERR("Hex conversion failure (msg)");
         return rv;
     }
+    if (ctx->bn_binary) {
+        return acvp_bn_alloc((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
+    }
     return ACVP_SUCCESS;
 }
 
@@ -161,6 +167,28 @@ static ACVP_RESULT acvp_dsa_sigver_init_tc (ACVP_CTX *ctx,
     stc->msg = calloc(1, ACVP_DSA_MAX_STRING);
     if (!stc->msg) { return ACVP_MALLOC_FAIL; }
 
+    stc->msglen = strlen((const char *)msg)/2;
+    rv = acvp_hexstr_to_bin((const unsigned char *) msg, stc->msg, ACVP_DSA_MAX_STRING);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (msg)");
+        return rv;
+    }
+
+    if (ctx->bn_binary) {
+        rv = acvp_bn_alloc((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
+        if (rv != ACVP_SUCCESS) { return rv; }
+        if (acvp_hexstr_to_bn((char *)p, &stc->bn.p) != ACVP_SUCCESS ||
+            acvp_hexstr_to_bn((char *)q, &stc->bn.q) != ACVP_SUCCESS ||
+            acvp_hexstr_to_bn((char *)g, &stc->bn.g) != ACVP_SUCCESS ||
+            acvp_hexstr_to_bn((char *)r, &stc->bn.r) != ACVP_SUCCESS ||
+            acvp_hexstr_to_bn((char *)s, &stc->bn.s) != ACVP_SUCCESS ||
+            acvp_hexstr_to_bn((char *)y, &stc->bn.y) != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Hex conversion failure (pqg/r/s/y)");
+            return ACVP_INVALID_ARG;
+        }
+        return ACVP_SUCCESS;
+    }
+
     stc->p = calloc(1, ACVP_DSA_MAX_STRING);
     if (!stc->p) { return ACVP_MALLOC_FAIL; }
     stc->q = calloc(1, ACVP_DSA_MAX_STRING);
@@ -174,12 +202,6 @@ static ACVP_RESULT acvp_dsa_sigver_init_tc (ACVP_CTX *ctx,
     stc->y = calloc(1, ACVP_DSA_MAX_STRING);
     if (!stc->y) { return ACVP_MALLOC_FAIL; }
 
-    stc->msglen = strlen((const char *)msg)/2;
-    rv = acvp_hexstr_to_bin((const unsigned char *) msg, stc->msg, ACVP_DSA_MAX_STRING);
-    if (rv != ACVP_SUCCESS) {
-        ACVP_LOG_ERR("Hex conversion failure (msg)");
-        return rv;
-    }
     memcpy(stc->p, p, strlen((const char *)p));
     memcpy(stc->q, q, strlen((const char *)q));
     memcpy(stc->g, g, strlen((const char *)g));
@@ -206,6 +228,7 @@ static ACVP_RESULT acvp_dsa_pqgver_init_tc (ACVP_CTX *ctx,
                                      unsigned int pqg) {
     ACVP_RESULT rv;
 
+    stc->tc_id = tc_id;
     stc->l = l;
     stc->n = n;
     stc->c = c;
@@ -226,19 +249,24 @@ static ACVP_RESULT acvp_dsa_pqgver_init_tc (ACVP_CTX *ctx,
     stc->seed = calloc(1, ACVP_DSA_MAX_STRING);
     if (!stc->seed) { return ACVP_MALLOC_FAIL; }
 
-    stc->p = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->p) { return ACVP_MALLOC_FAIL; }
-    stc->q = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->q) { return ACVP_MALLOC_FAIL; }
-    stc->g = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->g) { return ACVP_MALLOC_FAIL; }
+    if (ctx->bn_binary) {
+        rv = acvp_bn_alloc((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
+        if (rv != ACVP_SUCCESS) { return rv; }
+    } else {
+        stc->p = calloc(1, ACVP_DSA_MAX_STRING);
+        if (!stc->p) { return ACVP_MALLOC_FAIL; }
+        stc->q = calloc(1, ACVP_DSA_MAX_STRING);
+        if (!stc->q) { return ACVP_MALLOC_FAIL; }
+        stc->g = calloc(1, ACVP_DSA_MAX_STRING);
+        if (!stc->g) { return ACVP_MALLOC_FAIL; }
 
-    stc->r = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->r) { return ACVP_MALLOC_FAIL; }
-    stc->s = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->s) { return ACVP_MALLOC_FAIL; }
-    stc->y = calloc(1, ACVP_DSA_MAX_STRING);
-    if (!stc->y) { return ACVP_MALLOC_FAIL; }
+        stc->r = calloc(1, ACVP_DSA_MAX_STRING);
+        if (!stc->r) { return ACVP_MALLOC_FAIL; }
+        stc->s = calloc(1, ACVP_DSA_MAX_STRING);
+        if (!stc->s) { return ACVP_MALLOC_FAIL; }
+        stc->y = calloc(1, ACVP_DSA_MAX_STRING);
+        if (!stc->y) { return ACVP_MALLOC_FAIL; }
+    }
 
     stc->index = -1;
     if (index) {
@@ -252,6 +280,15 @@ static ACVP_RESULT acvp_dsa_pqgver_init_tc (ACVP_CTX *ctx,
             return rv;
         }
     }
+    if (ctx->bn_binary) {
+        if (acvp_hexstr_to_bn((char *)p, &stc->bn.p) != ACVP_SUCCESS ||
+            acvp_hexstr_to_bn((char *)q, &stc->bn.q) != ACVP_SUCCESS ||
+            (g && acvp_hexstr_to_bn((char *)g, &stc->bn.g) != ACVP_SUCCESS)) {
+            ACVP_LOG_ERR("Hex conversion failure (pqg)");
+            return ACVP_INVALID_ARG;
+        }
+        return ACVP_SUCCESS;
+    }
     memcpy(stc->p, p, strlen((const char *)p));
     memcpy(stc->q, q, strlen((const char *)q));
     if (g) {
@@ -274,6 +311,7 @@ static ACVP_RESULT acvp_dsa_pqggen_init_tc (ACVP_CTX *ctx,
                                      unsigned char *seed) {
     ACVP_RESULT rv;
 
+    stc->tc_id = tc_id;
     stc->l = l;
     stc->n = n;
 
@@ -289,12 +327,17 @@ static ACVP_RESULT acvp_dsa_pqggen_init_tc (ACVP_CTX *ctx,
         return rv;
     }
 
-    stc->p = calloc(1, ACVP_DSA_PQG_MAX);
-    if (!stc->p) { return ACVP_MALLOC_FAIL; }
-    stc->q = calloc(1, ACVP_DSA_PQG_MAX);
-    if (!stc->q) { return ACVP_MALLOC_FAIL; }
-    stc->g = calloc(1, ACVP_DSA_PQG_MAX);
-    if (!stc->g) { return ACVP_MALLOC_FAIL; }
+    if (ctx->bn_binary) {
+        rv = acvp_bn_alloc((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
+        if (rv != ACVP_SUCCESS) { return rv; }
+    } else {
+        stc->p = calloc(1, ACVP_DSA_PQG_MAX);
+        if (!stc->p) { return ACVP_MALLOC_FAIL; }
+        stc->q = calloc(1, ACVP_DSA_PQG_MAX);
+        if (!stc->q) { return ACVP_MALLOC_FAIL; }
+        stc->g = calloc(1, ACVP_DSA_PQG_MAX);
+        if (!stc->g) { return ACVP_MALLOC_FAIL; }
+    }
     stc->seed = calloc(1, ACVP_DSA_SEED_MAX);
     if (!stc->seed) { return ACVP_MALLOC_FAIL; }
 
@@ -308,6 +351,14 @@ static ACVP_RESULT acvp_dsa_pqggen_init_tc (ACVP_CTX *ctx,
             ACVP_LOG_ERR("Hex conversion failure (seed)");
             return rv;
         }
+        if (ctx->bn_binary) {
+            if (acvp_hexstr_to_bn((char *)p, &stc->bn.p) != ACVP_SUCCESS ||
+                acvp_hexstr_to_bn((char *)q, &stc->bn.q) != ACVP_SUCCESS) {
+                ACVP_LOG_ERR("Hex conversion failure (pq)");
+                return ACVP_INVALID_ARG;
+            }
+            break;
+        }
         memcpy(stc->p, p, strlen((const char *)p));
         memcpy(stc->q, q, strlen((const char *)q));
         break;
@@ -323,6 +374,19 @@ static ACVP_RESULT acvp_dsa_pqggen_init_tc (ACVP_CTX *ctx,
     return ACVP_SUCCESS;
 }
 
+/*
+ * Add a big number to the test case response, either the hex
+ * string set by the crypto module or its binary "bn" value.
+ */
+static ACVP_RESULT acvp_dsa_output_value (ACVP_CTX *ctx, JSON_Object *r_tobj, const char *name,
+                                          unsigned char *hex, ACVP_BN *bn) {
+    if (ctx->bn_binary) {
+        return acvp_bn_to_json(r_tobj, name, bn);
+    }
+    json_object_set_string(r_tobj, name, (char *) hex);
+    return ACVP_SUCCESS;
+}
+
 /*
  * After the test case has been processed by the DUT, the results
  * need to be JSON formated to be included in the vector set results
@@ -338,7 +402,9 @@ static ACVP_RESULT acvp_dsa_output_tc (ACVP_CTX *ctx, ACVP_DSA_TC *stc, JSON_Obj
         switch (stc->gen_pq) {
         case ACVP_DSA_CANONICAL:
         case ACVP_DSA_UNVERIFIABLE:
-            json_object_set_string(r_tobj, "g", (char *) stc->g);
+            if (acvp_dsa_output_value(ctx, r_tobj, "g", stc->g, &stc->bn.g) != ACVP_SUCCESS) {
+                goto bn_err;
+            }
             break;
         case ACVP_DSA_PROBABLE:
         case ACVP_DSA_PROVABLE:
@@ -348,8 +414,10 @@ static ACVP_RESULT acvp_dsa_output_tc (ACVP_CTX *ctx, ACVP_DSA_TC *stc, JSON_Obj
                 return ACVP_MALLOC_FAIL;
             }
 
-            json_object_set_string(r_tobj, "p", (char *) stc->p);
-            json_object_set_string(r_tobj, "q", (char *) stc->q);
+            if (acvp_dsa_output_value(ctx, r_tobj, "p", stc->p, &stc->bn.p) != ACVP_SUCCESS ||
+                acvp_dsa_output_value(ctx, r_tobj, "q", stc->q, &stc->bn.q) != ACVP_SUCCESS) {
+                goto bn_err;
+            }
 
             memset(tmp, 0x0, ACVP_DSA_SEED_MAX);
             rv = acvp_bin_to_hexstr(stc->seed, stc->seedlen, (unsigned char *) tmp);
@@ -367,22 +435,26 @@ static ACVP_RESULT acvp_dsa_output_tc (ACVP_CTX *ctx, ACVP_DSA_TC *stc, JSON_Obj
         }
         break;
     case ACVP_DSA_MODE_SIGGEN:
-        json_object_set_string(r_tobj, "p", (char *) stc->p);
-        json_object_set_string(r_tobj, "q", (char *) stc->q);
-        json_object_set_string(r_tobj, "g", (char *) stc->g);
-        json_object_set_string(r_tobj, "y", (char *) stc->y);
-        json_object_set_string(r_tobj, "r", (char *) stc->r);
-        json_object_set_string(r_tobj, "s", (char *) stc->s);
+        if (acvp_dsa_output_value(ctx, r_tobj, "p", stc->p, &stc->bn.p) != ACVP_SUCCESS ||
+            acvp_dsa_output_value(ctx, r_tobj, "q", stc->q, &stc->bn.q) != ACVP_SUCCESS ||
+            acvp_dsa_output_value(ctx, r_tobj, "g", stc->g, &stc->bn.g) != ACVP_SUCCESS ||
+            acvp_dsa_output_value(ctx, r_tobj, "y", stc->y, &stc->bn.y) != ACVP_SUCCESS ||
+            acvp_dsa_output_value(ctx, r_tobj, "r", stc->r, &stc->bn.r) != ACVP_SUCCESS ||
+            acvp_dsa_output_value(ctx, r_tobj, "s", stc->s, &stc->bn.s) != ACVP_SUCCESS) {
+            goto bn_err;
+        }
         break;
     case ACVP_DSA_MODE_SIGVER:
         json_object_set_string(r_tobj, "result", stc->result > 0 ? "passed" : "failed");
         break;
     case ACVP_DSA_MODE_KEYGEN:
-        json_object_set_string(r_tobj, "p", (char *) stc->p);
-        json_object_set_string(r_tobj, "q", (char *) stc->q);
-        json_object_set_string(r_tobj, "g", (char *) stc->g);
-        json_object_set_string(r_tobj, "y", (char *) stc->y);
-        json_object_set_string(r_tobj, "x", (char *) stc->x);
+        if (acvp_dsa_output_value(ctx, r_tobj, "p", stc->p, &stc->bn.p) != ACVP_SUCCESS ||
+            acvp_dsa_output_value(ctx, r_tobj, "q", stc->q, &stc->bn.q) != ACVP_SUCCESS ||
+            acvp_dsa_output_value(ctx, r_tobj, "g", stc->g, &stc->bn.g) != ACVP_SUCCESS ||
+            acvp_dsa_output_value(ctx, r_tobj, "y", stc->y, &stc->bn.y) != ACVP_SUCCESS ||
+            acvp_dsa_output_value(ctx, r_tobj, "x", stc->x, &stc->bn.x) != ACVP_SUCCESS) {
+            goto bn_err;
+        }
         break;
     case ACVP_DSA_MODE_PQGVER:
         json_object_set_string(r_tobj, "result", stc->result > 0 ? "passed" : "failed");
@@ -393,6 +465,11 @@ static ACVP_RESULT acvp_dsa_output_tc (ACVP_CTX *ctx, ACVP_DSA_TC *stc, JSON_Obj
 
     free(tmp);
     return ACVP_SUCCESS;
+
+bn_err:
+    ACVP_LOG_ERR("hex conversion failure in DSA module");
+    free(tmp);
+    return ACVP_DATA_TOO_LARGE;
 }
 
 /*
@@ -410,9 +487,136 @@ static ACVP_RESULT acvp_dsa_release_tc (ACVP_DSA_TC *stc) {
     free(stc->s);
     free(stc->seed);
     free(stc->msg);
+    acvp_bn_free((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
+
+    /*
+     * Tests in a group share the test case, clear the pointers so
+     * an early exit from the next test can't free them twice.
+     */
+    stc->p = stc->q = stc->g = NULL;
+    stc->x = stc->y = NULL;
+    stc->r = stc->s = NULL;
+    stc->seed = stc->msg = NULL;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * pqgGen and pqgVer test cases are long, independent prime
+ * searches.  Give each test case in the group its own copy of
+ * the test case so they can be run by the worker threads.
+ */
+static ACVP_RESULT acvp_dsa_alloc_tcs (ACVP_CTX *ctx, ACVP_DSA_TC *stc, int t_cnt,
+                                       ACVP_DSA_TC **stcs, ACVP_TEST_CASE **tcs) {
+    int j;
+
+    *stcs = calloc(t_cnt, sizeof(ACVP_DSA_TC));
+    *tcs = calloc(t_cnt, sizeof(ACVP_TEST_CASE));
+    if (!*stcs || !*tcs) {
+        ACVP_LOG_ERR("Unable to malloc DSA test cases");
+        free(*stcs);
+        free(*tcs);
+        *stcs = NULL;
+        *tcs = NULL;
+        return ACVP_MALLOC_FAIL;
+    }
+    for (j = 0; j < t_cnt; j++) {
+        (*stcs)[j].cipher = stc->cipher;
+        (*stcs)[j].mode = stc->mode;
+        (*tcs)[j].tc.dsa = &(*stcs)[j];
+    }
     return ACVP_SUCCESS;
 }
 
+static void acvp_dsa_release_tcs (ACVP_DSA_TC *stcs, ACVP_TEST_CASE *tcs, int t_cnt) {
+    int j;
+
+    if (stcs) {
+        for (j = 0; j < t_cnt; j++) {
+            acvp_dsa_release_tc(&stcs[j]);
+        }
+    }
+    free(stcs);
+    free(tcs);
+}
+
+/*
+ * Run the crypto module over the test cases of a group and
+ * output the results in the order the server sent them.
+ */
+static ACVP_RESULT acvp_dsa_run_tcs (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_DSA_TC *stcs,
+                                     ACVP_TEST_CASE *tcs, int t_cnt, JSON_Array *r_tarr) {
+    JSON_Value *r_tval = NULL; /* Response testval */
+    JSON_Object *r_tobj = NULL; /* Response testobj */
+    ACVP_RESULT rv;
+    int j;
+
+    rv = acvp_run_crypto_handlers(ctx, cap, tcs, t_cnt);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
+
+    for (j = 0; j < t_cnt; j++) {
+        /*
+         * Create a new test case in the response
+         */
+        r_tval = json_value_init_object();
+        r_tobj = json_value_get_object(r_tval);
+        json_object_set_number(r_tobj, "tcId", stcs[j].tc_id);
+
+        /*
+         * Output the test case results using JSON
+         */
+        rv = acvp_dsa_output_tc(ctx, &stcs[j], r_tobj);
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("JSON output failure in DSA module");
+            json_value_free(r_tval);
+            return rv;
+        }
+        json_array_append_value(r_tarr, r_tval);
+    }
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Invoke the optional group setup callback before the first test case
+ * in a test group.  The group parameters are already set on the test
+ * case so the crypto module can build state to share across the group
+ * (e.g. domain parameters) and stash it in group_ctx.
+ */
+static ACVP_RESULT acvp_dsa_group_begin (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc) {
+    ACVP_DSA_CAP *dsa_cap = cap->cap.dsa_cap;
+
+    tc->tc.dsa->group_ctx = NULL;
+    if (!dsa_cap || !dsa_cap->group.begin) {
+        return ACVP_SUCCESS;
+    }
+    if ((dsa_cap->group.begin)(tc) != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("crypto module failed the group setup");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Invoke the optional group teardown callback once the test group is
+ * done, including when a test case failed part way through the group.
+ */
+static ACVP_RESULT acvp_dsa_group_end (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
+                                       ACVP_RESULT rv) {
+    ACVP_DSA_CAP *dsa_cap = cap->cap.dsa_cap;
+
+    if (dsa_cap && dsa_cap->group.end) {
+        if ((dsa_cap->group.end)(tc) != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("crypto module failed the group teardown");
+            if (rv == ACVP_SUCCESS) {
+                rv = ACVP_CRYPTO_MODULE_FAIL;
+            }
+        }
+    }
+    tc->tc.dsa->group_ctx = NULL;
+    return rv;
+}
+
 ACVP_RESULT acvp_dsa_keygen_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS_LIST *cap,
                                      JSON_Array *r_tarr, JSON_Object *groupobj)
 {
@@ -438,6 +642,13 @@ ACVP_RESULT acvp_dsa_keygen_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
     t_cnt = json_array_get_count(tests);
 
     stc = tc.tc.dsa;
+    stc->l = l;
+    stc->n = n;
+
+    rv = acvp_dsa_group_begin(ctx, cap, &tc);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
 
     for (j = 0; j < t_cnt; j++) {
         ACVP_LOG_INFO("Found new DSA KeyGen test vector...");
@@ -455,13 +666,19 @@ ACVP_RESULT acvp_dsa_keygen_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
          * TODO: this does mallocs, we can probably do the mallocs once for
          *       the entire vector set to be more efficient
          */
-        acvp_dsa_keygen_init_tc(ctx, stc, tc_id, stc->cipher, num, index, l, n);
+        rv = acvp_dsa_keygen_init_tc(ctx, stc, tc_id, stc->cipher, num, index, l, n);
+        if (rv != ACVP_SUCCESS) {
+            acvp_dsa_release_tc(stc);
+            break;
+        }
 
         /* Process the current DSA test vector... */
-        rv = (cap->crypto_handler)(&tc);
+        rv = acvp_call_crypto_handler(ctx, cap, &tc);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("crypto module failed the operation");
-            return ACVP_CRYPTO_MODULE_FAIL;
+            acvp_dsa_release_tc(stc);
+            rv = ACVP_CRYPTO_MODULE_FAIL;
+            break;
         }
 
         mval = json_value_init_object();
@@ -473,13 +690,19 @@ ACVP_RESULT acvp_dsa_keygen_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
         rv = acvp_dsa_output_tc(ctx, stc, mobj);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("JSON output failure in DSA module");
-            return rv;
+            json_value_free(mval);
+            acvp_dsa_release_tc(stc);
+            break;
         }
 
         /* Append the test response value to array */
         json_array_append_value(r_tarr, mval);
         acvp_dsa_release_tc(stc);
     }
+    rv = acvp_dsa_group_end(ctx, cap, &tc, rv);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
     /* Append the test response value to array */
     json_array_append_value(r_tarr, r_tval);
     return rv;
@@ -492,15 +715,12 @@ ACVP_RESULT acvp_dsa_pqggen_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
     JSON_Array *tests;
     JSON_Value *testval;
     JSON_Object *testobj = NULL;
-    JSON_Value *r_tval = NULL; /* Response testval */
-    JSON_Object *r_tobj = NULL; /* Response testobj */
     int j, t_cnt, tc_id;
     ACVP_RESULT rv = ACVP_SUCCESS;
-    JSON_Value *mval;
-    JSON_Object *mobj = NULL;
     unsigned gpq = 0, n, l;
     unsigned char *p = NULL, *q = NULL, *seed = NULL;
-    ACVP_DSA_TC *stc;
+    ACVP_DSA_TC *stc, *stcs = NULL;
+    ACVP_TEST_CASE *tcs = NULL;
 
     gen_pq = (unsigned char *) json_object_get_string(groupobj, "pqMode");
     gen_g = (unsigned char *) json_object_get_string(groupobj, "gMode");
@@ -520,9 +740,17 @@ ACVP_RESULT acvp_dsa_pqggen_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
 
     tests = json_object_get_array(groupobj, "tests");
     t_cnt = json_array_get_count(tests);
+    if (!t_cnt) {
+        return ACVP_SUCCESS;
+    }
 
     stc = tc.tc.dsa;
 
+    rv = acvp_dsa_alloc_tcs(ctx, stc, t_cnt, &stcs, &tcs);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
+
     for (j = 0; j < t_cnt; j++) {
         ACVP_LOG_INFO("Found new DSA PQGGen test vector...");
         testval = json_array_get_value(tests, j);
@@ -567,83 +795,22 @@ ACVP_RESULT acvp_dsa_pqggen_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
             }
         }
 
-
         /*
          * Setup the test case data that will be passed down to
          * the crypto module.
-         * TODO: this does mallocs, we can probably do the mallocs once for
-         *       the entire vector set to be more efficient
          */
-
-        switch (gpq) {
-        case ACVP_DSA_PROBABLE:
-        case ACVP_DSA_PROVABLE:
-            /*
-             * Create a new test case in the response
-             */
-            r_tval = json_value_init_object();
-            r_tobj = json_value_get_object(r_tval);
-            json_object_set_number(r_tobj, "tcId", tc_id);
-
-            acvp_dsa_pqggen_init_tc(ctx, stc, tc_id, stc->cipher, gpq, index, l, n, sha, p, q, seed);
-
-            /* Process the current DSA test vector... */
-            rv = (cap->crypto_handler)(&tc);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("crypto module failed the operation");
-                return ACVP_CRYPTO_MODULE_FAIL;
-            }
-
-            mval = json_value_init_object();
-            mobj = json_value_get_object(mval);
-            /*
-             * Output the test case results using JSON
-             */
-            rv = acvp_dsa_output_tc(ctx, stc, r_tobj);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("JSON output failure in DSA module");
-                return rv;
-            }
-
-            stc->seedlen = 0;
-            stc->counter = 0;
-            stc->seed = 0;
-            break;
-
-        case ACVP_DSA_CANONICAL:
-        case ACVP_DSA_UNVERIFIABLE:
-            /*
-             * Create a new test case in the response
-             */
-            r_tval = json_value_init_object();
-            r_tobj = json_value_get_object(r_tval);
-            json_object_set_number(r_tobj, "tcId", tc_id);
-
-            /* Process the current DSA test vector... */
-            acvp_dsa_pqggen_init_tc(ctx, stc, tc_id, stc->cipher, gpq, index, l, n, sha, p, q, seed);
-            rv = (cap->crypto_handler)(&tc);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("crypto module failed the operation");
-                return ACVP_CRYPTO_MODULE_FAIL;
-            }
-
-            /*
-             * Output the test case results using JSON
-             */
-            rv = acvp_dsa_output_tc(ctx, stc, r_tobj);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("JSON output failure in DSA module");
-                return rv;
-            }
-            break;
-        default:
-            ACVP_LOG_ERR("Invalid DSA PQGGen mode");
-            rv = ACVP_INVALID_ARG;
-            break;
+        rv = acvp_dsa_pqggen_init_tc(ctx, &stcs[j], tc_id, stc->cipher, gpq, index, l, n, sha, p, q, seed);
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Invalid DSA PQGGen test case %d", tc_id);
+            goto end;
         }
-        json_array_append_value(r_tarr, r_tval);
-        acvp_dsa_release_tc(stc);
     }
+
+    /* Process the DSA test vectors and output the results... */
+    rv = acvp_dsa_run_tcs(ctx, cap, stcs, tcs, t_cnt, r_tarr);
+
+end:
+    acvp_dsa_release_tcs(stcs, tcs, t_cnt);
     return rv;
 }
 
@@ -673,6 +840,18 @@ ACVP_RESULT acvp_dsa_siggen_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
     t_cnt = json_array_get_count(tests);
 
     stc = tc.tc.dsa;
+    stc->l = l;
+    stc->n = n;
+    rv = acvp_dsa_set_sha(stc, sha);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Bad SHA value");
+        return rv;
+    }
+
+    rv = acvp_dsa_group_begin(ctx, cap, &tc);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
 
     for (j = 0; j < t_cnt; j++) {
         ACVP_LOG_INFO("Found new DSA SigGen test vector...");
@@ -691,13 +870,19 @@ ACVP_RESULT acvp_dsa_siggen_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
          * TODO: this does mallocs, we can probably do the mallocs once for
          *       the entire vector set to be more efficient
          */
-        acvp_dsa_siggen_init_tc(ctx, stc, tc_id, stc->cipher, num, index, l, n, sha, msg);
+        rv = acvp_dsa_siggen_init_tc(ctx, stc, tc_id, stc->cipher, num, index, l, n, sha, msg);
+        if (rv != ACVP_SUCCESS) {
+            acvp_dsa_release_tc(stc);
+            break;
+        }
 
         /* Process the current DSA test vector... */
-        rv = (cap->crypto_handler)(&tc);
+        rv = acvp_call_crypto_handler(ctx, cap, &tc);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("crypto module failed the operation");
-            return ACVP_CRYPTO_MODULE_FAIL;
+            acvp_dsa_release_tc(stc);
+            rv = ACVP_CRYPTO_MODULE_FAIL;
+            break;
         }
 
         mval = json_value_init_object();
@@ -709,12 +894,18 @@ ACVP_RESULT acvp_dsa_siggen_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
         rv = acvp_dsa_output_tc(ctx, stc, mobj);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("JSON output failure in DSA module");
-            return rv;
+            json_value_free(mval);
+            acvp_dsa_release_tc(stc);
+            break;
         }
         acvp_dsa_release_tc(stc);
         /* Append the test response value to array */
         json_array_append_value(r_tarr, mval);
     }
+    rv = acvp_dsa_group_end(ctx, cap, &tc, rv);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
     /* Append the test response value to array */
     json_array_append_value(r_tarr, r_tval);
     return rv;
@@ -727,14 +918,12 @@ ACVP_RESULT acvp_dsa_pqgver_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
     JSON_Array *tests;
     JSON_Value *testval;
     JSON_Object *testobj = NULL;
-    JSON_Value *r_tval = NULL; /* Response testval */
     int j, t_cnt, tc_id, l, n, c, gpq;
     ACVP_RESULT rv = ACVP_SUCCESS;
-    JSON_Value *mval;
-    JSON_Object *mobj = NULL;
     unsigned int num = 0;
     unsigned char *p = NULL, *q = NULL;
-    ACVP_DSA_TC *stc;
+    ACVP_DSA_TC *stc, *stcs = NULL;
+    ACVP_TEST_CASE *tcs = NULL;
 
     l = json_object_get_number(groupobj, "l");
     n = json_object_get_number(groupobj, "n");
@@ -750,9 +939,17 @@ ACVP_RESULT acvp_dsa_pqgver_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
 
     tests = json_object_get_array(groupobj, "tests");
     t_cnt = json_array_get_count(tests);
+    if (!t_cnt) {
+        return ACVP_SUCCESS;
+    }
 
     stc = tc.tc.dsa;
 
+    rv = acvp_dsa_alloc_tcs(ctx, stc, t_cnt, &stcs, &tcs);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
+
     for (j = 0; j < t_cnt; j++) {
         ACVP_LOG_INFO("Found new DSA PQGVer test vector...");
         testval = json_array_get_value(tests, j);
@@ -792,37 +989,20 @@ ACVP_RESULT acvp_dsa_pqgver_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
         /*
          * Setup the test case data that will be passed down to
          * the crypto module.
-         * TODO: this does mallocs, we can probably do the mallocs once for
-         *       the entire vector set to be more efficient
          */
-        acvp_dsa_pqgver_init_tc(ctx, stc, tc_id, stc->cipher, num, 
-                                l, n, c, index, sha, p, q, g, seed, gpq);
-
-        /* Process the current DSA test vector... */
-        rv = (cap->crypto_handler)(&tc);
+        rv = acvp_dsa_pqgver_init_tc(ctx, &stcs[j], tc_id, stc->cipher, num,
+                                     l, n, c, index, sha, p, q, g, seed, gpq);
         if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("crypto module failed the operation");
-            return ACVP_CRYPTO_MODULE_FAIL;
+            ACVP_LOG_ERR("Invalid DSA PQGVer test case %d", tc_id);
+            goto end;
         }
+    }
 
-        mval = json_value_init_object();
-        mobj = json_value_get_object(mval);
-        json_object_set_number(mobj, "tcId", tc_id);
-        /*
-         * Output the test case results using JSON
-         */
-        rv = acvp_dsa_output_tc(ctx, stc, mobj);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("JSON output failure in DSA module");
-            return rv;
-        }
-        acvp_dsa_release_tc(stc);
+    /* Process the DSA test vectors and output the results... */
+    rv = acvp_dsa_run_tcs(ctx, cap, stcs, tcs, t_cnt, r_tarr);
 
-        /* Append the test response value to array */
-        json_array_append_value(r_tarr, mval);
-    }
-    /* Append the test response value to array */
-    json_array_append_value(r_tarr, r_tval);
+end:
+    acvp_dsa_release_tcs(stcs, tcs, t_cnt);
     return rv;
 }
 
@@ -885,11 +1065,15 @@ ACVP_RESULT acvp_dsa_sigver_handler (ACVP_CTX *ctx, ACVP_TEST_CASE tc, ACVP_CAPS
          * TODO: this does mallocs, we can probably do the mallocs once for
          *       the entire vector set to be more efficient
          */
-        acvp_dsa_sigver_init_tc(ctx, stc, tc_id, stc->cipher, num, index, 
-                                l, n, sha, p, q, g, r, s, y, msg);
+        rv = acvp_dsa_sigver_init_tc(ctx, stc, tc_id, stc->cipher, num, index,
+                                     l, n, sha, p, q, g, r, s, y, msg);
+        if (rv != ACVP_SUCCESS) {
+            acvp_dsa_release_tc(stc);
+            return rv;
+        }
 
         /* Process the current DSA test vector... */
-        rv = (cap->crypto_handler)(&tc);
+        rv = acvp_call_crypto_handler(ctx, cap, &tc);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("crypto module failed the operation");
             return ACVP_CRYPTO_MODULE_FAIL;
@@ -934,7 +1118,6 @@ ACVP_RESULT acvp_dsa_pqgver_kat_handler (ACVP_CTX *ctx, JSON_Object *obj)
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_CIPHER alg_id;
-    char *json_result;
     unsigned char *type;
     unsigned int g_cnt, i;
 
@@ -1005,18 +1188,6 @@ ACVP_RESULT acvp_dsa_pqgver_kat_handler (ACVP_CTX *ctx, JSON_Object *obj)
     }
     memset(&stc, 0x0, sizeof(ACVP_DSA_TC));
     json_array_append_value(reg_arry, r_vs_val);
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (!json_result) {
-        ACVP_LOG_ERR("JSON unable to be serialized");
-        return ACVP_JSON_ERR;
-    }
-
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
 
     return ACVP_SUCCESS;
 }
@@ -1037,7 +1208,6 @@ ACVP_RESULT acvp_dsa_pqggen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_CIPHER alg_id;
-    char *json_result;
     unsigned char *type;
     unsigned int g_cnt, i;
 
@@ -1109,13 +1279,6 @@ ACVP_RESULT acvp_dsa_pqggen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
 
     memset(&stc, 0x0, sizeof(ACVP_DSA_TC));
     json_array_append_value(reg_arry, r_vs_val);
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
 
     return ACVP_SUCCESS;
 }
@@ -1137,7 +1300,6 @@ ACVP_RESULT acvp_dsa_siggen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj)
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_CIPHER alg_id;
-    char *json_result;
     unsigned char *type;
     unsigned int g_cnt, i;
 
@@ -1209,15 +1371,6 @@ ACVP_RESULT acvp_dsa_siggen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj)
 
     memset(&stc, 0x0, sizeof(ACVP_DSA_TC));
     json_array_append_value(reg_arry, r_vs_val);
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-
-/* TODO: we should check the return code */
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
 
     return ACVP_SUCCESS;
 }
@@ -1239,7 +1392,6 @@ ACVP_RESULT acvp_dsa_keygen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj)
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_CIPHER alg_id;
-    char *json_result;
     unsigned char *type;
     unsigned int g_cnt, i;
 
@@ -1311,15 +1463,6 @@ ACVP_RESULT acvp_dsa_keygen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj)
 
     memset(&stc, 0x0, sizeof(ACVP_DSA_TC));
     json_array_append_value(reg_arry, r_vs_val);
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-
-/* TODO: we should check the return code */
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
 
     return ACVP_SUCCESS;
 }
@@ -1341,7 +1484,6 @@ ACVP_RESULT acvp_dsa_sigver_kat_handler (ACVP_CTX *ctx, JSON_Object *obj)
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_CIPHER alg_id;
-    char *json_result;
     unsigned char *type;
     unsigned int g_cnt, i;
 
@@ -1413,18 +1555,6 @@ ACVP_RESULT acvp_dsa_sigver_kat_handler (ACVP_CTX *ctx, JSON_Object *obj)
 
     memset(&stc, 0x0, sizeof(ACVP_DSA_TC));
     json_array_append_value(reg_arry, r_vs_val);
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (!json_result) {
-        ACVP_LOG_ERR("JSON unable to be serialized");
-        return ACVP_JSON_ERR;
-    }
-
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
 
     return ACVP_SUCCESS;
 }
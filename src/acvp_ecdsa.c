@@ -41,7 +41,39 @@ static ACVP_RESULT acvp_ecdsa_kat_handler_internal (ACVP_CTX *ctx, JSON_Object *
  * file that will be uploaded to the server.  This routine handles
  * the JSON processing for a single test case.
  */
+static ACVP_RESULT acvp_ecdsa_output_bn_tc (ACVP_CTX *ctx, ACVP_CIPHER cipher, ACVP_ECDSA_TC *stc, JSON_Object *tc_rsp) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+
+    if (cipher == ACVP_ECDSA_KEYGEN || cipher == ACVP_ECDSA_SIGGEN) {
+        rv = acvp_bn_to_json(tc_rsp, "qy", &stc->bn.qy);
+        if (rv == ACVP_SUCCESS) {
+            rv = acvp_bn_to_json(tc_rsp, "qx", &stc->bn.qx);
+        }
+    }
+    if (rv == ACVP_SUCCESS && cipher == ACVP_ECDSA_KEYGEN) {
+        rv = acvp_bn_to_json(tc_rsp, "d", &stc->bn.d);
+    }
+    if (rv == ACVP_SUCCESS && cipher == ACVP_ECDSA_SIGGEN) {
+        rv = acvp_bn_to_json(tc_rsp, "r", &stc->bn.r);
+        if (rv == ACVP_SUCCESS) {
+            rv = acvp_bn_to_json(tc_rsp, "s", &stc->bn.s);
+        }
+    }
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("hex conversion failure in ECDSA module");
+        return rv;
+    }
+    if (cipher == ACVP_ECDSA_KEYVER || cipher == ACVP_ECDSA_SIGVER) {
+        json_object_set_string(tc_rsp, "result", stc->ver_disposition);
+    }
+
+    return ACVP_SUCCESS;
+}
+
 static ACVP_RESULT acvp_ecdsa_output_tc (ACVP_CTX *ctx, ACVP_CIPHER cipher, ACVP_ECDSA_TC *stc, JSON_Object *tc_rsp) {
+    if (ctx->bn_binary) {
+        return acvp_ecdsa_output_bn_tc(ctx, cipher, stc, tc_rsp);
+    }
     if (cipher == ACVP_ECDSA_KEYGEN) {
         json_object_set_string(tc_rsp, "qy", (const char *) stc->qy);
         json_object_set_string(tc_rsp, "qx", (const char *) stc->qx);
@@ -77,6 +109,7 @@ static ACVP_RESULT acvp_ecdsa_release_tc (ACVP_ECDSA_TC *stc) {
     if (stc->s) { free(stc->s); }
     if (stc->message) { free(stc->message); }
     if (stc->ver_disposition) { free(stc->ver_disposition); }
+    acvp_bn_free((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
     
     return ACVP_SUCCESS;
 }
@@ -115,7 +148,23 @@ static ACVP_RESULT acvp_ecdsa_init_tc (ACVP_CTX *ctx,
         strncpy(stc->hash_alg, hash_alg, strnlen(hash_alg, 8));
     }
     
-    if (cipher == ACVP_ECDSA_KEYVER || cipher == ACVP_ECDSA_SIGVER) {
+    if (ctx->bn_binary) {
+        if (acvp_bn_alloc((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn)) != ACVP_SUCCESS) { goto err; }
+        if (cipher == ACVP_ECDSA_KEYVER || cipher == ACVP_ECDSA_SIGVER) {
+            if (acvp_hexstr_to_bn(qx, &stc->bn.qx) != ACVP_SUCCESS ||
+                acvp_hexstr_to_bn(qy, &stc->bn.qy) != ACVP_SUCCESS) {
+                goto hex_err;
+            }
+            stc->ver_disposition = calloc(5, sizeof(char));
+            if (!stc->ver_disposition) { goto err; }
+        }
+        if (cipher == ACVP_ECDSA_SIGVER) {
+            if (acvp_hexstr_to_bn(r, &stc->bn.r) != ACVP_SUCCESS ||
+                acvp_hexstr_to_bn(s, &stc->bn.s) != ACVP_SUCCESS) {
+                goto hex_err;
+            }
+        }
+    } else if (cipher == ACVP_ECDSA_KEYVER || cipher == ACVP_ECDSA_SIGVER) {
         stc->qx = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
         if (!stc->qx) { goto err; }
         strncpy((char *)stc->qx, qx, strnlen(qx, ACVP_RSA_EXP_LEN_MAX));
@@ -125,7 +174,7 @@ static ACVP_RESULT acvp_ecdsa_init_tc (ACVP_CTX *ctx,
         stc->ver_disposition = calloc(5, sizeof(char));
         if (!stc->ver_disposition) { goto err; }
     }
-    if (cipher == ACVP_ECDSA_SIGVER) {
+    if (!ctx->bn_binary && cipher == ACVP_ECDSA_SIGVER) {
         stc->r = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
         if (!stc->r) { goto err; }
         stc->s = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
@@ -141,6 +190,11 @@ static ACVP_RESULT acvp_ecdsa_init_tc (ACVP_CTX *ctx,
     
     return ACVP_SUCCESS;
     
+    hex_err:
+    /* the caller releases the test case */
+    ACVP_LOG_ERR("Hex conversion failure in ECDSA test case");
+    return ACVP_INVALID_ARG;
+
     err:
     ACVP_LOG_ERR("Failed to allocate buffer in ECDSA test case");
     if (stc->curve) free(stc->curve);
@@ -154,6 +208,63 @@ static ACVP_RESULT acvp_ecdsa_init_tc (ACVP_CTX *ctx,
     return ACVP_MALLOC_FAIL;
 }
 
+/*
+ * Invoke the optional group setup callback before the first test
+ * case of a group.  The test case only carries the group values,
+ * the module keeps whatever it builds from them in group_ctx.
+ */
+static ACVP_RESULT acvp_ecdsa_group_begin (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
+                                           char *curve, char *secret_gen_mode, char *hash_alg) {
+    ACVP_ECDSA_TC *stc = tc->tc.ecdsa;
+    ACVP_ECDSA_CAP *ecdsa_cap = cap->cap.ecdsa_keygen_cap; /* same for all ECDSA modes */
+    ACVP_RESULT rv;
+
+    memset(stc, 0x0, sizeof(ACVP_ECDSA_TC));
+    if (!ecdsa_cap || !ecdsa_cap->group.begin) {
+        return ACVP_SUCCESS;
+    }
+
+    stc->cipher = cap->cipher;
+    stc->curve = curve;
+    stc->secret_gen_mode = secret_gen_mode;
+    stc->hash_alg = hash_alg;
+    rv = (ecdsa_cap->group.begin)(tc);
+    stc->curve = NULL;
+    stc->secret_gen_mode = NULL;
+    stc->hash_alg = NULL;
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("ERROR: crypto module failed the group setup");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Invoke the optional group teardown callback, also when a test
+ * case in the group failed.
+ */
+static ACVP_RESULT acvp_ecdsa_group_end (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
+                                         void *group_ctx, ACVP_RESULT rv) {
+    ACVP_ECDSA_TC *stc = tc->tc.ecdsa;
+    ACVP_ECDSA_CAP *ecdsa_cap = cap->cap.ecdsa_keygen_cap;
+
+    if (!ecdsa_cap || !ecdsa_cap->group.end) {
+        return rv;
+    }
+
+    memset(stc, 0x0, sizeof(ACVP_ECDSA_TC));
+    stc->cipher = cap->cipher;
+    stc->group_ctx = group_ctx;
+    if ((ecdsa_cap->group.end)(tc) != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("ERROR: crypto module failed the group teardown");
+        if (rv == ACVP_SUCCESS) {
+            rv = ACVP_CRYPTO_MODULE_FAIL;
+        }
+    }
+    stc->group_ctx = NULL;
+    return rv;
+}
+
 ACVP_RESULT acvp_ecdsa_keygen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     return acvp_ecdsa_kat_handler_internal(ctx, obj, ACVP_ECDSA_KEYGEN);
 }
@@ -196,9 +307,9 @@ static ACVP_RESULT acvp_ecdsa_kat_handler_internal (ACVP_CTX *ctx, JSON_Object *
     ACVP_ECDSA_TC stc;
     ACVP_TEST_CASE tc;
     ACVP_RESULT rv;
+    void *group_ctx = NULL;
     
     ACVP_CIPHER alg_id;
-    char *json_result = NULL;
     char *hash_alg = NULL, *curve = NULL, *secret_gen_mode = NULL;
     char *alg_str, *mode_str, *qx, *qy, *r, *s, *message;
     
@@ -268,6 +379,12 @@ static ACVP_RESULT acvp_ecdsa_kat_handler_internal (ACVP_CTX *ctx, JSON_Object *
         ACVP_LOG_INFO("              hashAlg: %s", hash_alg);
     
     
+        rv = acvp_ecdsa_group_begin(ctx, cap, &tc, curve, secret_gen_mode, hash_alg);
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
+        group_ctx = stc.group_ctx;
+
         tests = json_object_get_array(groupobj, "tests");
         t_cnt = json_array_get_count(tests);
         
@@ -301,10 +418,11 @@ static ACVP_RESULT acvp_ecdsa_kat_handler_internal (ACVP_CTX *ctx, JSON_Object *
             json_object_set_number(r_tobj, "tcId", tc_id);
             
             rv = acvp_ecdsa_init_tc(ctx, alg_id, &stc, tc_id, curve, secret_gen_mode, hash_alg, qx, qy, message, r, s);
+            stc.group_ctx = group_ctx;
             
             /* Process the current test vector... */
             if (rv == ACVP_SUCCESS) {
-                rv = (cap->crypto_handler)(&tc);
+                rv = acvp_call_crypto_handler(ctx, cap, &tc);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("ERROR: crypto module failed the operation");
                     rv = ACVP_CRYPTO_MODULE_FAIL;
@@ -333,21 +451,19 @@ static ACVP_RESULT acvp_ecdsa_kat_handler_internal (ACVP_CTX *ctx, JSON_Object *
             key_err:
             acvp_ecdsa_release_tc(&stc);
             if (rv != ACVP_SUCCESS) {
-                goto end;
+                break;
             }
         }
+
+        rv = acvp_ecdsa_group_end(ctx, cap, &tc, group_ctx, rv);
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
     }
     
     end:
     json_array_append_value(reg_arry, r_vs_val);
     
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
     return rv;
 }
 
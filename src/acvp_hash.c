@@ -43,8 +43,11 @@ static ACVP_RESULT acvp_hash_init_tc (ACVP_CTX *ctx,
                                       char *test_type,
                                       unsigned int msg_len,
                                       unsigned char *msg,
+                                      int stream,
                                       ACVP_CIPHER alg_id);
 
+static ACVP_RESULT acvp_hash_alloc_tc (ACVP_HASH_TC *stc);
+
 static ACVP_RESULT acvp_hash_release_tc (ACVP_HASH_TC *stc);
 
 
@@ -53,13 +56,21 @@ static ACVP_RESULT acvp_hash_release_tc (ACVP_HASH_TC *stc);
  * information may need to be modified.  This function
  * performs the iteration depdedent upon the hash type
  * and direction.
+ *
+ * The three message buffers and the digest buffer form
+ * a fixed ring, so rather than copying the digests we
+ * rotate the pointers: m1 <- m2 <- m3 <- md, and the old
+ * m1 buffer becomes the output buffer for the next digest.
  */
 static ACVP_RESULT acvp_hash_mct_iterate_tc (ACVP_CTX *ctx, ACVP_HASH_TC *stc, int i,
                                              JSON_Object *r_tobj) {
+    unsigned char *tmp = stc->m1;
+
     /* feed hash into the next message for MCT */
-    memcpy(stc->m1, stc->m2, stc->md_len);
-    memcpy(stc->m2, stc->m3, stc->md_len);
-    memcpy(stc->m3, stc->md, stc->md_len);
+    stc->m1 = stc->m2;
+    stc->m2 = stc->m3;
+    stc->m3 = stc->md;
+    stc->md = tmp;
 
     return ACVP_SUCCESS;
 }
@@ -68,26 +79,20 @@ static ACVP_RESULT acvp_hash_mct_iterate_tc (ACVP_CTX *ctx, ACVP_HASH_TC *stc, i
  * After the test case has been processed by the DUT, the results
  * need to be JSON formated to be included in the vector set results
  * file that will be uploaded to the server.  This routine handles
- * the JSON processing for a single test case for MCT.
+ * the JSON processing for a single test case for MCT.  The last
+ * digest of the inner loop has been rotated into m3.
  */
-static ACVP_RESULT acvp_hash_output_mct_tc (ACVP_CTX *ctx, ACVP_HASH_TC *stc, JSON_Object *r_tobj) {
+static ACVP_RESULT acvp_hash_output_mct_tc (ACVP_CTX *ctx, ACVP_HASH_TC *stc,
+                                            JSON_Object *r_tobj, char *tmp) {
     ACVP_RESULT rv;
-    char *tmp;
 
-    tmp = calloc(1, ACVP_HASH_MSG_MAX);
-    if (!tmp) {
-        ACVP_LOG_ERR("Unable to malloc in acvp_hash_output_tc");
-        return ACVP_MALLOC_FAIL;
-    }
-    rv = acvp_bin_to_hexstr(stc->md, stc->md_len, (unsigned char *) tmp);
+    rv = acvp_bin_to_hexstr(stc->m3, stc->md_len, (unsigned char *) tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (md)");
         return rv;
     }
     json_object_set_string(r_tobj, "md", tmp);
 
-    free(tmp);
-
     return ACVP_SUCCESS;
 }
 
@@ -105,9 +110,11 @@ static ACVP_RESULT acvp_hash_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
     JSON_Value *r_tval = NULL; /* Response testval */
     JSON_Object *r_tobj = NULL; /* Response testobj */
     char *tmp = NULL;
-    unsigned char *msg = NULL;
 
-    tmp = calloc(1, ACVP_HASH_MSG_MAX);
+    /*
+     * Large enough to hold the hex encoding of m1|m2|m3
+     */
+    tmp = calloc(1, (ACVP_HASH_MD_MAX * 3 * 2) + 1);
     if (!tmp) {
         ACVP_LOG_ERR("Unable to malloc in acvp_hash_mct_tc");
         return ACVP_MALLOC_FAIL;
@@ -125,32 +132,32 @@ static ACVP_RESULT acvp_hash_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
         r_tval = json_value_init_object();
         r_tobj = json_value_get_object(r_tval);
 
-        msg = calloc(1, ACVP_HASH_MSG_MAX);
-        if (!msg) {
-            ACVP_LOG_ERR("Unable to malloc in acvp_hash_output_tc");
-            free(tmp);
-            return ACVP_MALLOC_FAIL;
+        if (!ctx->hash_mct_no_msg) {
+            /*
+             * Encode m1|m2|m3 straight into the output string,
+             * no need to concatenate the binary values first.
+             */
+            acvp_bin_to_hexstr(stc->m1, stc->msg_len, (unsigned char *) tmp);
+            acvp_bin_to_hexstr(stc->m2, stc->msg_len,
+                               (unsigned char *) tmp + (stc->msg_len * 2));
+            rv = acvp_bin_to_hexstr(stc->m3, stc->msg_len,
+                                    (unsigned char *) tmp + (stc->msg_len * 4));
+            if (rv != ACVP_SUCCESS) {
+                ACVP_LOG_ERR("hex conversion failure (msg)");
+                json_value_free(r_tval);
+                free(tmp);
+                return rv;
+            }
+            json_object_set_string(r_tobj, "msg", tmp);
         }
 
-        memcpy(msg, stc->m1, stc->msg_len);
-        memcpy(msg + stc->msg_len, stc->m2, stc->msg_len);
-        memcpy(msg + (stc->msg_len * 2), stc->m3, stc->msg_len);
-
-        rv = acvp_bin_to_hexstr(msg, stc->msg_len * 3, (unsigned char *) tmp);
-        if (rv != ACVP_SUCCESS) {
-            ACVP_LOG_ERR("hex conversion failure (msg)");
-            free(msg);
-            free(tmp);
-            return rv;
-        }
-        json_object_set_string(r_tobj, "msg", tmp);
         for (j = 0; j < ACVP_HASH_MCT_INNER; ++j) {
 
             /* Process the current SHA test vector... */
-            rv = (cap->crypto_handler)(tc);
+            rv = acvp_call_crypto_handler(ctx, cap, tc);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("crypto module failed the operation");
-                free(msg);
+                json_value_free(r_tval);
                 free(tmp);
                 return ACVP_CRYPTO_MODULE_FAIL;
             }
@@ -161,7 +168,7 @@ static ACVP_RESULT acvp_hash_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
             rv = acvp_hash_mct_iterate_tc(ctx, stc, i, r_tobj);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("Failed the MCT iteration changes");
-                free(msg);
+                json_value_free(r_tval);
                 free(tmp);
                 return rv;
             }
@@ -169,10 +176,10 @@ static ACVP_RESULT acvp_hash_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
         /*
          * Output the test case request values using JSON
          */
-        rv = acvp_hash_output_mct_tc(ctx, stc, r_tobj);
+        rv = acvp_hash_output_mct_tc(ctx, stc, r_tobj, tmp);
         if (rv != ACVP_SUCCESS) {
             ACVP_LOG_ERR("JSON output failure in HASH module");
-            free(msg);
+            json_value_free(r_tval);
             free(tmp);
             return rv;
         }
@@ -180,19 +187,51 @@ static ACVP_RESULT acvp_hash_mct_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
         /* Append the test response value to array */
         json_array_append_value(res_array, r_tval);
 
+        /*
+         * The next outer iteration is seeded with the last digest
+         */
         memcpy(stc->m1, stc->m3, stc->msg_len);
         memcpy(stc->m2, stc->m3, stc->msg_len);
-
-        free(msg);
     }
 
     free(tmp);
     return ACVP_SUCCESS;
 }
 
+/*
+ * This is the handler for hash test cases whose message is too
+ * large to be handed to the crypto module in a single buffer,
+ * including the large data tests.  The message is built by
+ * repeating 'content' until it is 'full_len' bytes long and is
+ * fed to the crypto module in ACVP_HASH_MSG_MAX sized chunks.
+ */
+static ACVP_RESULT acvp_hash_stream_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
+                                        ACVP_TEST_CASE *tc, ACVP_HASH_TC *stc,
+                                        unsigned char *content,
+                                        unsigned long long content_len,
+                                        unsigned long long full_len) {
+    ACVP_RESULT rv;
+
+    ACVP_LOG_INFO("    Streaming %llu byte message", full_len);
+
+    stc->full_len = full_len;
+    rv = acvp_stream_hex_msg(ctx, &cap->cap.hash_cap->stream, tc, content,
+                             content_len, full_len, stc->msg,
+                             ACVP_HASH_MSG_MAX, &stc->msg_len);
+
+    /* Make sure the next test case clears all the chunk data */
+    stc->msg_len = full_len > ACVP_HASH_MSG_MAX ? ACVP_HASH_MSG_MAX : full_len;
+
+    return rv;
+}
+
 ACVP_RESULT acvp_hash_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     unsigned int tc_id, msglen;
     unsigned char *msg = NULL;
+    unsigned long long content_len = 0, full_len = 0;
+    int stream;
+    JSON_Object *large_msg = NULL;
+    const char *expansion = NULL;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Value *testval;
@@ -220,7 +259,6 @@ ACVP_RESULT acvp_hash_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_CIPHER alg_id;
-    char *json_result;
 
     if (!alg_str) {
         ACVP_LOG_ERR("unable to parse 'algorithm' from JSON");
@@ -271,6 +309,16 @@ ACVP_RESULT acvp_hash_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     json_object_set_value(r_vs, "testResults", json_value_init_array());
     r_tarr = json_object_get_array(r_vs, "testResults");
 
+    /*
+     * Allocate the test case buffers once, they are
+     * re-used for every test case in the vector set.
+     */
+    rv = acvp_hash_alloc_tc(&stc);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Unable to malloc in acvp_hash_kat_handler");
+        return rv;
+    }
+
     groups = json_object_get_array(obj, "testGroups");
     g_cnt = json_array_get_count(groups);
     for (i = 0; i < g_cnt; i++) {
@@ -292,10 +340,51 @@ ACVP_RESULT acvp_hash_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             msg = (unsigned char *) json_object_get_string(testobj, "msg");
             msglen = (unsigned int) json_object_get_number(testobj, "len");
 
+            /*
+             * Large data tests and messages that won't fit in the
+             * test case buffer are streamed to the crypto module
+             */
+            stream = 0;
+            if (test_type && !strcmp(test_type, "LDT")) {
+                large_msg = json_object_get_object(testobj, "largeMsg");
+                if (!large_msg) {
+                    ACVP_LOG_ERR("unable to parse 'largeMsg' from JSON");
+                    acvp_hash_release_tc(&stc);
+                    return ACVP_MALFORMED_JSON;
+                }
+                expansion = json_object_get_string(large_msg, "expansionTechnique");
+                if (!expansion || strcmp(expansion, "repeating")) {
+                    ACVP_LOG_ERR("unsupported large data expansion (%s)", expansion);
+                    acvp_hash_release_tc(&stc);
+                    return ACVP_UNSUPPORTED_OP;
+                }
+                msg = (unsigned char *) json_object_get_string(large_msg, "content");
+                content_len = (unsigned long long)
+                        json_object_get_number(large_msg, "contentLength") / 8;
+                full_len = (unsigned long long)
+                        json_object_get_number(large_msg, "fullLength") / 8;
+                stream = 1;
+            } else if (msg && strlen((char *) msg) > ACVP_HASH_MSG_MAX * 2) {
+                content_len = full_len = msglen / 8;
+                stream = 1;
+            }
+            if (!msg) {
+                ACVP_LOG_ERR("unable to parse 'msg' from JSON");
+                acvp_hash_release_tc(&stc);
+                return ACVP_MALFORMED_JSON;
+            }
+            if (stream && !cap->cap.hash_cap->stream.update) {
+                ACVP_LOG_ERR("message too large, no hash stream callbacks registered");
+                acvp_hash_release_tc(&stc);
+                return ACVP_UNSUPPORTED_OP;
+            }
+
             ACVP_LOG_INFO("        Test case: %d", j);
             ACVP_LOG_INFO("             tcId: %d", tc_id);
             ACVP_LOG_INFO("              len: %d", msglen);
-            ACVP_LOG_INFO("              msg: %s", msg);
+            if (!stream) {
+                ACVP_LOG_INFO("              msg: %s", msg);
+            }
             ACVP_LOG_INFO("         testtype: %s", test_type);
 
             /*
@@ -309,10 +398,8 @@ ACVP_RESULT acvp_hash_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Setup the test case data that will be passed down to
              * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
              */
-            acvp_hash_init_tc(ctx, &stc, tc_id, test_type, msglen, msg, alg_id);
+            acvp_hash_init_tc(ctx, &stc, tc_id, test_type, msglen, msg, stream, alg_id);
 
             /* If Monte Carlo start that here */
             if (stc.test_type == ACVP_HASH_TEST_TYPE_MCT) {
@@ -322,14 +409,21 @@ ACVP_RESULT acvp_hash_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("crypto module failed the HASH MCT operation");
                     json_value_free(r_tval);
+                    acvp_hash_release_tc(&stc);
                     return ACVP_CRYPTO_MODULE_FAIL;
                 }
             } else {
                 /* Process the current test vector... */
-                rv = (cap->crypto_handler)(&tc);
+                if (stream) {
+                    rv = acvp_hash_stream_tc(ctx, cap, &tc, &stc, msg,
+                                             content_len, full_len);
+                } else {
+                    rv = acvp_call_crypto_handler(ctx, cap, &tc);
+                }
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("crypto module failed the operation");
                     json_value_free(r_tval);
+                    acvp_hash_release_tc(&stc);
                     return ACVP_CRYPTO_MODULE_FAIL;
                 }
 
@@ -340,28 +434,22 @@ ACVP_RESULT acvp_hash_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("JSON output failure in hash module");
                     json_value_free(r_tval);
+                    acvp_hash_release_tc(&stc);
                     return rv;
                 }
             }
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_hash_release_tc(&stc);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
     }
 
-    json_array_append_value(reg_arry, r_vs_val);
+    /*
+     * Release all the memory associated with the test cases
+     */
+    acvp_hash_release_tc(&stc);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
+    json_array_append_value(reg_arry, r_vs_val);
 
     return ACVP_SUCCESS;
 }
@@ -394,27 +482,67 @@ static ACVP_RESULT acvp_hash_output_tc (ACVP_CTX *ctx, ACVP_HASH_TC *stc, JSON_O
     return ACVP_SUCCESS;
 }
 
+/*
+ * This function allocates the buffers for a hash test case.
+ * It is called once per vector set, the buffers are then
+ * re-used for each test case and released by acvp_hash_release_tc().
+ */
+static ACVP_RESULT acvp_hash_alloc_tc (ACVP_HASH_TC *stc) {
+    memset(stc, 0x0, sizeof(ACVP_HASH_TC));
+
+    stc->msg = calloc(1, ACVP_HASH_MSG_MAX);
+    if (!stc->msg) { goto err; }
+    stc->md = calloc(1, ACVP_HASH_MD_MAX);
+    if (!stc->md) { goto err; }
+    stc->m1 = calloc(1, ACVP_HASH_MD_MAX);
+    if (!stc->m1) { goto err; }
+    stc->m2 = calloc(1, ACVP_HASH_MD_MAX);
+    if (!stc->m2) { goto err; }
+    stc->m3 = calloc(1, ACVP_HASH_MD_MAX);
+    if (!stc->m3) { goto err; }
+
+    return ACVP_SUCCESS;
+
+    err:
+    acvp_hash_release_tc(stc);
+    return ACVP_MALLOC_FAIL;
+}
+
+/*
+ * This function clears the data left over from the previous
+ * test case while keeping the buffers allocated by
+ * acvp_hash_alloc_tc().  Only the used portion of the
+ * message buffer is zeroed.
+ */
+static void acvp_hash_reset_tc (ACVP_HASH_TC *stc) {
+    unsigned char *msg = stc->msg, *md = stc->md;
+    unsigned char *m1 = stc->m1, *m2 = stc->m2, *m3 = stc->m3;
+
+    acvp_clear_tc_buf(msg, stc->msg_len, ACVP_HASH_MSG_MAX);
+    memset(md, 0x0, ACVP_HASH_MD_MAX);
+    memset(m1, 0x0, ACVP_HASH_MD_MAX);
+    memset(m2, 0x0, ACVP_HASH_MD_MAX);
+    memset(m3, 0x0, ACVP_HASH_MD_MAX);
+
+    memset(stc, 0x0, sizeof(ACVP_HASH_TC));
+    stc->msg = msg;
+    stc->md = md;
+    stc->m1 = m1;
+    stc->m2 = m2;
+    stc->m3 = m3;
+}
+
 static ACVP_RESULT acvp_hash_init_tc (ACVP_CTX *ctx,
                                       ACVP_HASH_TC *stc,
                                       unsigned int tc_id,
                                       char *test_type,
                                       unsigned int msg_len,
                                       unsigned char *msg,
+                                      int stream,
                                       ACVP_CIPHER alg_id) {
     ACVP_RESULT rv;
 
-    memset(stc, 0x0, sizeof(ACVP_HASH_TC));
-
-    stc->msg = calloc(1, ACVP_HASH_MSG_MAX);
-    if (!stc->msg) { return ACVP_MALLOC_FAIL; }
-    stc->md = calloc(1, ACVP_HASH_MD_MAX);
-    if (!stc->md) { return ACVP_MALLOC_FAIL; }
-    stc->m1 = calloc(1, ACVP_HASH_MD_MAX);
-    if (!stc->m1) { return ACVP_MALLOC_FAIL; }
-    stc->m2 = calloc(1, ACVP_HASH_MD_MAX);
-    if (!stc->m2) { return ACVP_MALLOC_FAIL; }
-    stc->m3 = calloc(1, ACVP_HASH_MD_MAX);
-    if (!stc->m3) { return ACVP_MALLOC_FAIL; }
+    acvp_hash_reset_tc(stc);
 
     /* Assume KAT if not MCT */
     if (test_type && !strcmp(test_type, "MCT")) {
@@ -422,26 +550,37 @@ static ACVP_RESULT acvp_hash_init_tc (ACVP_CTX *ctx,
         msg_len = (strlen((char *) msg) / 2) * 8;
     } else if (test_type && !strcmp(test_type, "AFT")) {
         stc->test_type = ACVP_HASH_TEST_TYPE_AFT;
+    } else if (test_type && !strcmp(test_type, "LDT")) {
+        stc->test_type = ACVP_HASH_TEST_TYPE_LDT;
     } else {
         return ACVP_UNSUPPORTED_OP;
     }
 
+    stc->tc_id = tc_id;
+    stc->cipher = alg_id;
+
+    /*
+     * A streamed message is decoded a chunk at a time
+     * by acvp_hash_stream_tc()
+     */
+    if (stream) {
+        return ACVP_SUCCESS;
+    }
+
     rv = acvp_hexstr_to_bin((const unsigned char *) msg, stc->msg, ACVP_HASH_MSG_MAX);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("Hex converstion failure (msg)");
         return rv;
     }
 
-    stc->tc_id = tc_id;
     stc->msg_len = msg_len / 8;
-    stc->cipher = alg_id;
 
     return ACVP_SUCCESS;
 }
 
 /*
  * This function simply releases the data associated with
- * a test case.
+ * the test cases of a vector set.
  */
 static ACVP_RESULT acvp_hash_release_tc (ACVP_HASH_TC *stc) {
     free(stc->msg);
@@ -32,6 +32,49 @@
 #include "acvp_lcl.h"
 #include "parson.h"
 
+static ACVP_RESULT acvp_hmac_release_tc (ACVP_HMAC_TC *stc);
+
+/*
+ * This function allocates the buffers for an HMAC test case.
+ * It is called once per vector set, the buffers are then
+ * re-used for each test case and released by acvp_hmac_release_tc().
+ */
+static ACVP_RESULT acvp_hmac_alloc_tc (ACVP_HMAC_TC *stc) {
+    memset(stc, 0x0, sizeof(ACVP_HMAC_TC));
+
+    stc->msg = calloc(1, ACVP_HMAC_MSG_MAX);
+    if (!stc->msg) { goto err; }
+    stc->mac = calloc(1, ACVP_HMAC_MAC_MAX);
+    if (!stc->mac) { goto err; }
+    stc->key = calloc(1, ACVP_HMAC_KEY_MAX);
+    if (!stc->key) { goto err; }
+
+    return ACVP_SUCCESS;
+
+    err:
+    acvp_hmac_release_tc(stc);
+    return ACVP_MALLOC_FAIL;
+}
+
+/*
+ * This function clears the data left over from the previous
+ * test case while keeping the buffers allocated by
+ * acvp_hmac_alloc_tc().  Only the used portion of the
+ * key buffer is zeroed.
+ */
+static void acvp_hmac_reset_tc (ACVP_HMAC_TC *stc) {
+    unsigned char *msg = stc->msg, *mac = stc->mac, *key = stc->key;
+
+    memset(msg, 0x0, ACVP_HMAC_MSG_MAX);
+    memset(mac, 0x0, ACVP_HMAC_MAC_MAX);
+    acvp_clear_tc_buf(key, stc->key_len, ACVP_HMAC_KEY_MAX);
+
+    memset(stc, 0x0, sizeof(ACVP_HMAC_TC));
+    stc->msg = msg;
+    stc->mac = mac;
+    stc->key = key;
+}
+
 static ACVP_RESULT acvp_hmac_init_tc (ACVP_CTX *ctx,
                                       ACVP_HMAC_TC *stc,
                                       unsigned int tc_id,
@@ -40,22 +83,22 @@ static ACVP_RESULT acvp_hmac_init_tc (ACVP_CTX *ctx,
                                       unsigned int mac_len,
                                       unsigned int key_len,
                                       unsigned char *key,
+                                      int stream,
                                       ACVP_CIPHER alg_id) {
     ACVP_RESULT rv;
 
-    memset(stc, 0x0, sizeof(ACVP_HMAC_TC));
-
-    stc->msg = calloc(1, ACVP_HMAC_MSG_MAX);
-    if (!stc->msg) { return ACVP_MALLOC_FAIL; }
-    stc->mac = calloc(1, ACVP_HMAC_MAC_MAX);
-    if (!stc->mac) { return ACVP_MALLOC_FAIL; }
-    stc->key = calloc(1, ACVP_HMAC_KEY_MAX);
-    if (!stc->key) { return ACVP_MALLOC_FAIL; }
+    acvp_hmac_reset_tc(stc);
 
-    rv = acvp_hexstr_to_bin((const unsigned char *) msg, stc->msg, ACVP_HMAC_MSG_MAX);
-    if (rv != ACVP_SUCCESS) {
-        ACVP_LOG_ERR("Hex converstion failure (msg)");
-        return rv;
+    /*
+     * A streamed message is decoded a chunk at a time
+     * by acvp_hmac_stream_tc()
+     */
+    if (!stream) {
+        rv = acvp_hexstr_to_bin((const unsigned char *) msg, stc->msg, ACVP_HMAC_MSG_MAX);
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Hex converstion failure (msg)");
+            return rv;
+        }
     }
     rv = acvp_hexstr_to_bin((const unsigned char *) key, stc->key, ACVP_HMAC_KEY_MAX);
     if (rv != ACVP_SUCCESS) {
@@ -65,13 +108,38 @@ static ACVP_RESULT acvp_hmac_init_tc (ACVP_CTX *ctx,
 
     stc->tc_id = tc_id;
     stc->mac_len = mac_len / 8;
-    stc->msg_len = msg_len / 8;
+    stc->msg_len = stream ? 0 : msg_len / 8;
     stc->key_len = key_len / 8;
     stc->cipher = alg_id;
 
     return ACVP_SUCCESS;
 }
 
+/*
+ * This is the handler for HMAC test cases whose message is too
+ * large to be handed to the crypto module in a single buffer.
+ * The message is fed to the crypto module in ACVP_HMAC_MSG_MAX
+ * sized chunks using the stream callbacks.
+ */
+static ACVP_RESULT acvp_hmac_stream_tc (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap,
+                                        ACVP_TEST_CASE *tc, ACVP_HMAC_TC *stc,
+                                        unsigned char *msg,
+                                        unsigned long long msg_len) {
+    ACVP_RESULT rv;
+
+    ACVP_LOG_INFO("    Streaming %llu byte message", msg_len);
+
+    stc->full_len = msg_len;
+    rv = acvp_stream_hex_msg(ctx, &cap->cap.hmac_cap->stream, tc, msg,
+                             msg_len, msg_len, stc->msg,
+                             ACVP_HMAC_MSG_MAX, &stc->msg_len);
+
+    /* Make sure the next test case clears all the chunk data */
+    stc->msg_len = msg_len > ACVP_HMAC_MSG_MAX ? ACVP_HMAC_MSG_MAX : msg_len;
+
+    return rv;
+}
+
 /*
  * After the test case has been processed by the DUT, the results
  * need to be JSON formated to be included in the vector set results
@@ -102,7 +170,7 @@ static ACVP_RESULT acvp_hmac_output_tc (ACVP_CTX *ctx, ACVP_HMAC_TC *stc, JSON_O
 
 /*
  * This function simply releases the data associated with
- * a test case.
+ * the test cases of a vector set.
  */
 static ACVP_RESULT acvp_hmac_release_tc (ACVP_HMAC_TC *stc) {
     free(stc->msg);
@@ -116,6 +184,7 @@ static ACVP_RESULT acvp_hmac_release_tc (ACVP_HMAC_TC *stc) {
 ACVP_RESULT acvp_hmac_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     unsigned int tc_id, msglen, keylen, maclen;
     unsigned char *msg = NULL, *key = NULL;
+    int stream;
     JSON_Value *groupval;
     JSON_Object *groupobj = NULL;
     JSON_Value *testval;
@@ -141,7 +210,6 @@ ACVP_RESULT acvp_hmac_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     ACVP_CIPHER alg_id;
-    char *json_result;
 
     if (!alg_str) {
         ACVP_LOG_ERR("ERROR: unable to parse 'algorithm' from JSON");
@@ -192,6 +260,16 @@ ACVP_RESULT acvp_hmac_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     json_object_set_value(r_vs, "testResults", json_value_init_array());
     r_tarr = json_object_get_array(r_vs, "testResults");
 
+    /*
+     * Allocate the test case buffers once, they are
+     * re-used for every test case in the vector set.
+     */
+    rv = acvp_hmac_alloc_tc(&stc);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("ERROR: Unable to malloc in acvp_hmac_kat_handler");
+        return rv;
+    }
+
     groups = json_object_get_array(obj, "testGroups");
     g_cnt = json_array_get_count(groups);
     for (i = 0; i < g_cnt; i++) {
@@ -235,18 +313,35 @@ ACVP_RESULT acvp_hmac_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             /*
              * Setup the test case data that will be passed down to
              * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
              */
             if (msglen == 0) {
                 msglen = strnlen((const char *) msg, ACVP_HMAC_MSG_MAX) / 2;
             }
-            acvp_hmac_init_tc(ctx, &stc, tc_id, msglen, msg, maclen, keylen, key, alg_id);
+
+            /*
+             * Messages that won't fit in the test case buffer
+             * are streamed to the crypto module
+             */
+            stream = 0;
+            if (msg && strlen((char *) msg) > ACVP_HMAC_MSG_MAX * 2) {
+                if (!cap->cap.hmac_cap->stream.update) {
+                    ACVP_LOG_ERR("ERROR: message too large, no HMAC stream callbacks registered");
+                    acvp_hmac_release_tc(&stc);
+                    return ACVP_UNSUPPORTED_OP;
+                }
+                stream = 1;
+            }
+            acvp_hmac_init_tc(ctx, &stc, tc_id, msglen, msg, maclen, keylen, key, stream, alg_id);
 
             /* Process the current test vector... */
-            rv = (cap->crypto_handler)(&tc);
+            if (stream) {
+                rv = acvp_hmac_stream_tc(ctx, cap, &tc, &stc, msg, strlen((char *) msg) / 2);
+            } else {
+                rv = acvp_call_crypto_handler(ctx, cap, &tc);
+            }
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("ERROR: crypto module failed the operation");
+                acvp_hmac_release_tc(&stc);
                 return ACVP_CRYPTO_MODULE_FAIL;
             }
 
@@ -256,27 +351,21 @@ ACVP_RESULT acvp_hmac_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             rv = acvp_hmac_output_tc(ctx, &stc, r_tobj);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("ERROR: JSON output failure in hash module");
+                acvp_hmac_release_tc(&stc);
                 return rv;
             }
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_hmac_release_tc(&stc);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
     }
 
-    json_array_append_value(reg_arry, r_vs_val);
+    /*
+     * Release all the memory associated with the test cases
+     */
+    acvp_hmac_release_tc(&stc);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
+    json_array_append_value(reg_arry, r_vs_val);
 
     return ACVP_SUCCESS;
 }
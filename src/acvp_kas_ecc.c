@@ -49,9 +49,17 @@ static ACVP_RESULT acvp_kas_ecc_output_cdh_tc (ACVP_CTX *ctx, ACVP_KAS_ECC_TC *s
         return ACVP_MALLOC_FAIL;
     }
 
-    json_object_set_string(tc_rsp, "publicIutX", stc->pix);
-
-    json_object_set_string(tc_rsp, "publicIutY", stc->piy);
+    if (ctx->bn_binary) {
+        if (acvp_bn_to_json(tc_rsp, "publicIutX", &stc->bn.pix) != ACVP_SUCCESS ||
+            acvp_bn_to_json(tc_rsp, "publicIutY", &stc->bn.piy) != ACVP_SUCCESS) {
+            free(tmp);
+            ACVP_LOG_ERR("hex conversion failure (pix/piy)");
+            return ACVP_DATA_TOO_LARGE;
+        }
+    } else {
+        json_object_set_string(tc_rsp, "publicIutX", stc->pix);
+        json_object_set_string(tc_rsp, "publicIutY", stc->piy);
+    }
 
     memset(tmp, 0x0, ACVP_KAS_ECC_MAX_STR);
     rv = acvp_bin_to_hexstr((const unsigned char *)stc->z, stc->zlen, (unsigned char *) tmp);
@@ -100,9 +108,19 @@ static ACVP_RESULT acvp_kas_ecc_output_comp_tc (ACVP_CTX *ctx, ACVP_KAS_ECC_TC *
         return ACVP_SUCCESS;
     }
 
-    json_object_set_string(tc_rsp, "ephemeralPrivateIut", stc->d);
-    json_object_set_string(tc_rsp, "ephemeralPublicIutX", stc->pix);
-    json_object_set_string(tc_rsp, "ephemeralPublicIutY", stc->piy);
+    if (ctx->bn_binary) {
+        if (acvp_bn_to_json(tc_rsp, "ephemeralPrivateIut", &stc->bn.d) != ACVP_SUCCESS ||
+            acvp_bn_to_json(tc_rsp, "ephemeralPublicIutX", &stc->bn.pix) != ACVP_SUCCESS ||
+            acvp_bn_to_json(tc_rsp, "ephemeralPublicIutY", &stc->bn.piy) != ACVP_SUCCESS) {
+            free(tmp);
+            ACVP_LOG_ERR("hex conversion failure (d/pix/piy)");
+            return ACVP_DATA_TOO_LARGE;
+        }
+    } else {
+        json_object_set_string(tc_rsp, "ephemeralPrivateIut", stc->d);
+        json_object_set_string(tc_rsp, "ephemeralPublicIutX", stc->pix);
+        json_object_set_string(tc_rsp, "ephemeralPublicIutY", stc->piy);
+    }
 
     memset(tmp, 0x0, ACVP_KAS_ECC_MAX_STR);
     rv = acvp_bin_to_hexstr((const unsigned char *)stc->chash, stc->chashlen, 
@@ -117,6 +135,62 @@ static ACVP_RESULT acvp_kas_ecc_output_comp_tc (ACVP_CTX *ctx, ACVP_KAS_ECC_TC *
     return rv;
 }
 
+/*
+ * Map the curve name used in the vector set to its ACVP_ECDSA_CURVE
+ * value, 0 if the curve is unknown.
+ */
+static int acvp_kas_ecc_get_curve (const char *curve) {
+    if (!curve) {
+        return 0;
+    }
+    if (!strcmp(curve, "b-233"))
+        return ACVP_ECDSA_CURVE_B233;
+    if (!strcmp(curve, "b-283"))
+        return ACVP_ECDSA_CURVE_B283;
+    if (!strcmp(curve, "b-409"))
+        return ACVP_ECDSA_CURVE_B409;
+    if (!strcmp(curve, "b-571"))
+        return ACVP_ECDSA_CURVE_B571;
+    if (!strcmp(curve, "k-233"))
+        return ACVP_ECDSA_CURVE_K233;
+    if (!strcmp(curve, "k-283"))
+        return ACVP_ECDSA_CURVE_K283;
+    if (!strcmp(curve, "k-409"))
+        return ACVP_ECDSA_CURVE_K409;
+    if (!strcmp(curve, "k-571"))
+        return ACVP_ECDSA_CURVE_K571;
+    if (!strcmp(curve, "p-224"))
+        return ACVP_ECDSA_CURVE_P224;
+    if (!strcmp(curve, "p-256"))
+        return ACVP_ECDSA_CURVE_P256;
+    if (!strcmp(curve, "p-384"))
+        return ACVP_ECDSA_CURVE_P384;
+    if (!strcmp(curve, "p-521"))
+        return ACVP_ECDSA_CURVE_P521;
+
+    return 0;
+}
+
+/*
+ * Map the hash name used in the vector set to its ACVP_CIPHER
+ * value, 0 if the hash is unknown.
+ */
+static int acvp_kas_ecc_get_md (const char *hash) {
+    if (!hash) {
+        return 0;
+    }
+    if (!strcmp(hash, "SHA2-224"))
+        return ACVP_SHA224;
+    if (!strcmp(hash, "SHA2-256"))
+        return ACVP_SHA256;
+    if (!strcmp(hash, "SHA2-384"))
+        return ACVP_SHA384;
+    if (!strcmp(hash, "SHA2-512"))
+        return ACVP_SHA512;
+
+    return 0;
+}
+
 static ACVP_RESULT acvp_kas_ecc_init_cdh_tc (ACVP_CTX *ctx,
                                              ACVP_KAS_ECC_TC *stc,
                                              unsigned int tc_id,
@@ -127,47 +201,35 @@ static ACVP_RESULT acvp_kas_ecc_init_cdh_tc (ACVP_CTX *ctx,
 ) {
 
     stc->mode = mode;
+    stc->curve = acvp_kas_ecc_get_curve(curve);
+
+    stc->z = calloc(1, ACVP_KAS_ECC_MAX_STR);
+    if (!stc->z) { return ACVP_MALLOC_FAIL; }
+    stc->chash = calloc(1, ACVP_KAS_ECC_MAX_STR);
+    if (!stc->chash) { return ACVP_MALLOC_FAIL; }
+
+    if (ctx->bn_binary) {
+        if (acvp_bn_alloc((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn)) != ACVP_SUCCESS) {
+            return ACVP_MALLOC_FAIL;
+        }
+        if (acvp_hexstr_to_bn(psx, &stc->bn.psx) != ACVP_SUCCESS ||
+            acvp_hexstr_to_bn(psy, &stc->bn.psy) != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Hex conversion failure (psx/psy)");
+            return ACVP_INVALID_ARG;
+        }
+        return ACVP_SUCCESS;
+    }
 
     stc->psx = calloc(1, ACVP_KAS_ECC_MAX_STR);
     if (!stc->psx) { return ACVP_MALLOC_FAIL; }
     stc->psy = calloc(1, ACVP_KAS_ECC_MAX_STR);
     if (!stc->psy) { return ACVP_MALLOC_FAIL; }
-
-    stc->z = calloc(1, ACVP_KAS_ECC_MAX_STR);
-    if (!stc->z) { return ACVP_MALLOC_FAIL; }
     stc->d = calloc(1, ACVP_KAS_ECC_MAX_STR);
     if (!stc->d) { return ACVP_MALLOC_FAIL; }
-    stc->chash = calloc(1, ACVP_KAS_ECC_MAX_STR);
-    if (!stc->chash) { return ACVP_MALLOC_FAIL; }
 
     strncpy(stc->psx, psx, strnlen((char *)psx, ACVP_KAS_ECC_MAX_STR));
     strncpy(stc->psy, psy, strnlen((char *)psy, ACVP_KAS_ECC_MAX_STR));
 
-    if (!strcmp(curve, "b-233"))
-        stc->curve = ACVP_ECDSA_CURVE_B233;
-    if (!strcmp(curve, "b-283"))
-        stc->curve = ACVP_ECDSA_CURVE_B283;
-    if (!strcmp(curve, "b-409"))
-        stc->curve = ACVP_ECDSA_CURVE_B409;
-    if (!strcmp(curve, "b-571"))
-        stc->curve = ACVP_ECDSA_CURVE_B571;
-    if (!strcmp(curve, "k-233"))
-        stc->curve = ACVP_ECDSA_CURVE_K233;
-    if (!strcmp(curve, "k-283"))
-        stc->curve = ACVP_ECDSA_CURVE_K283;
-    if (!strcmp(curve, "k-409"))
-        stc->curve = ACVP_ECDSA_CURVE_K409;
-    if (!strcmp(curve, "k-571"))
-        stc->curve = ACVP_ECDSA_CURVE_K571;
-    if (!strcmp(curve, "p-224"))
-        stc->curve = ACVP_ECDSA_CURVE_P224;
-    if (!strcmp(curve, "p-256"))
-        stc->curve = ACVP_ECDSA_CURVE_P256;
-    if (!strcmp(curve, "p-384"))
-        stc->curve = ACVP_ECDSA_CURVE_P384;
-    if (!strcmp(curve, "p-521"))
-        stc->curve = ACVP_ECDSA_CURVE_P521;
-
     return ACVP_SUCCESS;
 }
 
@@ -186,17 +248,44 @@ static ACVP_RESULT acvp_kas_ecc_init_comp_tc (ACVP_CTX *ctx,
 ) {
 
     stc->mode = mode;
-
-    stc->psx = calloc(1, ACVP_KAS_ECC_MAX_STR);
-    if (!stc->psx) { return ACVP_MALLOC_FAIL; }
-    stc->psy = calloc(1, ACVP_KAS_ECC_MAX_STR);
-    if (!stc->psy) { return ACVP_MALLOC_FAIL; }
+    stc->md = acvp_kas_ecc_get_md(hash);
+    stc->curve = acvp_kas_ecc_get_curve(curve);
 
     stc->z = calloc(1, ACVP_KAS_ECC_MAX_STR);
     if (!stc->z) { return ACVP_MALLOC_FAIL; }
     stc->chash = calloc(1, ACVP_KAS_ECC_MAX_STR);
     if (!stc->chash) { return ACVP_MALLOC_FAIL; }
 
+    if (stc->test_type == ACVP_KAS_ECC_TT_VAL) {
+        strncpy(stc->z, z, strnlen((char *)z, ACVP_KAS_ECC_MAX_STR));
+        stc->zlen = strnlen((char *)z, ACVP_KAS_ECC_MAX_STR);
+    }
+
+    if (ctx->bn_binary) {
+        if (acvp_bn_alloc((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn)) != ACVP_SUCCESS) {
+            return ACVP_MALLOC_FAIL;
+        }
+        if (acvp_hexstr_to_bn(psx, &stc->bn.psx) != ACVP_SUCCESS ||
+            acvp_hexstr_to_bn(psy, &stc->bn.psy) != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Hex conversion failure (psx/psy)");
+            return ACVP_INVALID_ARG;
+        }
+        if (stc->test_type == ACVP_KAS_ECC_TT_VAL) {
+            if (acvp_hexstr_to_bn(pix, &stc->bn.pix) != ACVP_SUCCESS ||
+                acvp_hexstr_to_bn(piy, &stc->bn.piy) != ACVP_SUCCESS ||
+                acvp_hexstr_to_bn(d, &stc->bn.d) != ACVP_SUCCESS) {
+                ACVP_LOG_ERR("Hex conversion failure (pix/piy/d)");
+                return ACVP_INVALID_ARG;
+            }
+        }
+        return ACVP_SUCCESS;
+    }
+
+    stc->psx = calloc(1, ACVP_KAS_ECC_MAX_STR);
+    if (!stc->psx) { return ACVP_MALLOC_FAIL; }
+    stc->psy = calloc(1, ACVP_KAS_ECC_MAX_STR);
+    if (!stc->psy) { return ACVP_MALLOC_FAIL; }
+
     strncpy(stc->psx, psx, strnlen((char *)psx, ACVP_KAS_ECC_MAX_STR));
     strncpy(stc->psy, psy, strnlen((char *)psy, ACVP_KAS_ECC_MAX_STR));
     if (stc->test_type == ACVP_KAS_ECC_TT_VAL) {
@@ -210,43 +299,7 @@ static ACVP_RESULT acvp_kas_ecc_init_comp_tc (ACVP_CTX *ctx,
         strncpy(stc->pix, pix, strnlen((char *)pix, ACVP_KAS_ECC_MAX_STR));
         strncpy(stc->piy, piy, strnlen((char *)piy, ACVP_KAS_ECC_MAX_STR));
         strncpy(stc->d, d, strnlen((char *)d, ACVP_KAS_ECC_MAX_STR));
-        strncpy(stc->z, z, strnlen((char *)z, ACVP_KAS_ECC_MAX_STR));
-        stc->zlen = strnlen((char *)z, ACVP_KAS_ECC_MAX_STR);
     }
-    if (!strcmp(hash, "SHA2-224"))
-        stc->md = ACVP_SHA224;
-    if (!strcmp(hash, "SHA2-256"))
-        stc->md = ACVP_SHA256;
-    if (!strcmp(hash, "SHA2-384"))
-        stc->md = ACVP_SHA384;
-    if (!strcmp(hash, "SHA2-512"))
-        stc->md = ACVP_SHA512;
-
-    if (!strcmp(curve, "b-233"))
-        stc->curve = ACVP_ECDSA_CURVE_B233;
-    if (!strcmp(curve, "b-283"))
-        stc->curve = ACVP_ECDSA_CURVE_B283;
-    if (!strcmp(curve, "b-409"))
-        stc->curve = ACVP_ECDSA_CURVE_B409;
-    if (!strcmp(curve, "b-571"))
-        stc->curve = ACVP_ECDSA_CURVE_B571;
-    if (!strcmp(curve, "k-233"))
-        stc->curve = ACVP_ECDSA_CURVE_K233;
-    if (!strcmp(curve, "k-283"))
-        stc->curve = ACVP_ECDSA_CURVE_K283;
-    if (!strcmp(curve, "k-409"))
-        stc->curve = ACVP_ECDSA_CURVE_K409;
-    if (!strcmp(curve, "k-571"))
-        stc->curve = ACVP_ECDSA_CURVE_K571;
-    if (!strcmp(curve, "p-224"))
-        stc->curve = ACVP_ECDSA_CURVE_P224;
-    if (!strcmp(curve, "p-256"))
-        stc->curve = ACVP_ECDSA_CURVE_P256;
-    if (!strcmp(curve, "p-384"))
-        stc->curve = ACVP_ECDSA_CURVE_P384;
-    if (!strcmp(curve, "p-521"))
-        stc->curve = ACVP_ECDSA_CURVE_P521;
-
     return ACVP_SUCCESS;
 }
 
@@ -263,9 +316,66 @@ static ACVP_RESULT acvp_kas_ecc_release_tc (ACVP_KAS_ECC_TC *stc) {
     free(stc->piy);
     free(stc->d);
     free(stc->z);
+    acvp_bn_free((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
+
+    /*
+     * The test case is re-used for the next test, don't leave
+     * pointers behind that a failed test could free again.
+     */
+    stc->chash = stc->psx = stc->psy = NULL;
+    stc->pix = stc->piy = stc->d = stc->z = NULL;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Invoke the optional group setup callback before the first test
+ * case of a group.  The curve and hash are the same for every test
+ * case in the group, the module keeps whatever it builds from them
+ * in group_ctx.
+ */
+static ACVP_RESULT acvp_kas_ecc_group_begin (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
+                                             const char *curve, const char *hash) {
+    ACVP_KAS_ECC_TC *stc = tc->tc.kas_ecc;
+    ACVP_KAS_ECC_CAP *kas_ecc_cap = cap->cap.kas_ecc_cap;
+
+    stc->group_ctx = NULL;
+    if (!kas_ecc_cap || !kas_ecc_cap->group.begin) {
+        return ACVP_SUCCESS;
+    }
+
+    stc->curve = acvp_kas_ecc_get_curve(curve);
+    stc->md = acvp_kas_ecc_get_md(hash);
+    if ((kas_ecc_cap->group.begin)(tc) != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("ERROR: crypto module failed the group setup");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
     return ACVP_SUCCESS;
 }
 
+/*
+ * Invoke the optional group teardown callback, also when a test
+ * case in the group failed.
+ */
+static ACVP_RESULT acvp_kas_ecc_group_end (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
+                                           void *group_ctx, ACVP_RESULT rv) {
+    ACVP_KAS_ECC_TC *stc = tc->tc.kas_ecc;
+    ACVP_KAS_ECC_CAP *kas_ecc_cap = cap->cap.kas_ecc_cap;
+
+    if (!kas_ecc_cap || !kas_ecc_cap->group.end) {
+        return rv;
+    }
+
+    stc->group_ctx = group_ctx;
+    if ((kas_ecc_cap->group.end)(tc) != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("ERROR: crypto module failed the group teardown");
+        if (rv == ACVP_SUCCESS) {
+            rv = ACVP_CRYPTO_MODULE_FAIL;
+        }
+    }
+    stc->group_ctx = NULL;
+    return rv;
+}
+
 static ACVP_RESULT acvp_kas_ecc_cdh(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
                                     ACVP_KAS_ECC_TC *stc, JSON_Object *obj, int mode, 
                                     JSON_Array *r_tarr)
@@ -285,6 +395,7 @@ static ACVP_RESULT acvp_kas_ecc_cdh(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TES
     int j, t_cnt, tc_id;
     ACVP_RESULT rv;
     const char *test_type;
+    void *group_ctx = NULL;
 
     groups = json_object_get_array(obj, "testGroups");
     g_cnt = json_array_get_count(groups);
@@ -304,6 +415,11 @@ static ACVP_RESULT acvp_kas_ecc_cdh(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TES
         ACVP_LOG_INFO("    Test group: %d", i);
         ACVP_LOG_INFO("          curve: %s", curve);
 
+        rv = acvp_kas_ecc_group_begin(ctx, cap, tc, curve, NULL);
+        if (rv != ACVP_SUCCESS) {
+            return rv;
+        }
+        group_ctx = stc->group_ctx;
 
         tests = json_object_get_array(groupobj, "tests");
         t_cnt = json_array_get_count(tests);
@@ -334,13 +450,21 @@ static ACVP_RESULT acvp_kas_ecc_cdh(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TES
              * TODO: this does mallocs, we can probably do the mallocs once for
              *       the entire vector set to be more efficient
              */
-            acvp_kas_ecc_init_cdh_tc(ctx, stc, tc_id, curve,
-                                     psx, psy, mode);
+            rv = acvp_kas_ecc_init_cdh_tc(ctx, stc, tc_id, curve,
+                                          psx, psy, mode);
+            stc->group_ctx = group_ctx;
 
             /* Process the current KAT test vector... */
-            rv = (cap->crypto_handler)(tc);
-            if (rv != ACVP_SUCCESS) {
-                    return ACVP_CRYPTO_MODULE_FAIL;
+            if (rv == ACVP_SUCCESS) {
+                rv = acvp_call_crypto_handler(ctx, cap, tc);
+                if (rv != ACVP_SUCCESS) {
+                    ACVP_LOG_ERR("ERROR: crypto module failed the operation");
+                    rv = ACVP_CRYPTO_MODULE_FAIL;
+                    goto key_err;
+                }
+            } else {
+                ACVP_LOG_ERR("Failed to initialize KAS-ECC CDH test case");
+                goto key_err;
             }
 
             /*
@@ -349,16 +473,27 @@ static ACVP_RESULT acvp_kas_ecc_cdh(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TES
             rv = acvp_kas_ecc_output_cdh_tc(ctx, stc, r_tobj);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("JSON output failure in KAS-ECC module");
-                return rv;
+                goto key_err;
             }
 
+            /* Append the test response value to array */
+            json_array_append_value(r_tarr, r_tval);
+            r_tval = NULL;
+
             /*
              * Release all the memory associated with the test case
              */
+            key_err:
             acvp_kas_ecc_release_tc(stc);
+            if (rv != ACVP_SUCCESS) {
+                json_value_free(r_tval);
+                break;
+            }
+        }
 
-            /* Append the test response value to array */
-            json_array_append_value(r_tarr, r_tval);
+        rv = acvp_kas_ecc_group_end(ctx, cap, tc, group_ctx, rv);
+        if (rv != ACVP_SUCCESS) {
+            return rv;
         }
     }
     return ACVP_SUCCESS;
@@ -383,6 +518,7 @@ static ACVP_RESULT acvp_kas_ecc_comp(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TE
     int j, t_cnt, tc_id;
     ACVP_RESULT rv;
     const char *test_type;
+    void *group_ctx = NULL;
 
     groups = json_object_get_array(obj, "testGroups");
     g_cnt = json_array_get_count(groups);
@@ -406,6 +542,11 @@ static ACVP_RESULT acvp_kas_ecc_comp(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TE
         ACVP_LOG_INFO("          curve: %s", curve);
         ACVP_LOG_INFO("           hash: %s", hash);
 
+        rv = acvp_kas_ecc_group_begin(ctx, cap, tc, curve, hash);
+        if (rv != ACVP_SUCCESS) {
+            return rv;
+        }
+        group_ctx = stc->group_ctx;
 
         tests = json_object_get_array(groupobj, "tests");
         t_cnt = json_array_get_count(tests);
@@ -446,13 +587,21 @@ static ACVP_RESULT acvp_kas_ecc_comp(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TE
              * TODO: this does mallocs, we can probably do the mallocs once for
              *       the entire vector set to be more efficient
              */
-            acvp_kas_ecc_init_comp_tc(ctx, stc, tc_id, curve, hash,
-                                      psx, psy, d, pix, piy, z, mode);
+            rv = acvp_kas_ecc_init_comp_tc(ctx, stc, tc_id, curve, hash,
+                                           psx, psy, d, pix, piy, z, mode);
+            stc->group_ctx = group_ctx;
 
             /* Process the current KAT test vector... */
-            rv = (cap->crypto_handler)(tc);
-            if (rv != ACVP_SUCCESS) {
-                    return ACVP_CRYPTO_MODULE_FAIL;
+            if (rv == ACVP_SUCCESS) {
+                rv = acvp_call_crypto_handler(ctx, cap, tc);
+                if (rv != ACVP_SUCCESS) {
+                    ACVP_LOG_ERR("ERROR: crypto module failed the operation");
+                    rv = ACVP_CRYPTO_MODULE_FAIL;
+                    goto key_err;
+                }
+            } else {
+                ACVP_LOG_ERR("Failed to initialize KAS-ECC Component test case");
+                goto key_err;
             }
 
             /*
@@ -461,16 +610,27 @@ static ACVP_RESULT acvp_kas_ecc_comp(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TE
             rv = acvp_kas_ecc_output_comp_tc(ctx, stc, r_tobj);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("JSON output failure in KAS-ECC module");
-                return rv;
+                goto key_err;
             }
 
+            /* Append the test response value to array */
+            json_array_append_value(r_tarr, r_tval);
+            r_tval = NULL;
+
             /*
              * Release all the memory associated with the test case
              */
+            key_err:
             acvp_kas_ecc_release_tc(stc);
+            if (rv != ACVP_SUCCESS) {
+                json_value_free(r_tval);
+                break;
+            }
+        }
 
-            /* Append the test response value to array */
-            json_array_append_value(r_tarr, r_tval);
+        rv = acvp_kas_ecc_group_end(ctx, cap, tc, group_ctx, rv);
+        if (rv != ACVP_SUCCESS) {
+            return rv;
         }
     }
     return ACVP_SUCCESS;
@@ -490,7 +650,6 @@ ACVP_RESULT acvp_kas_ecc_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     int mode;
-    char *json_result;
     const char *alg_mode;
 
     if (!alg_str) {
@@ -573,14 +732,6 @@ ACVP_RESULT acvp_kas_ecc_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     }
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
-
-    return ACVP_SUCCESS;
+    return rv;
 }
 
@@ -67,7 +67,16 @@ static ACVP_RESULT acvp_kas_ffc_output_comp_tc (ACVP_CTX *ctx, ACVP_KAS_FFC_TC *
         return ACVP_SUCCESS;
     }
 
-    json_object_set_string(tc_rsp, "ephemeralPublicIut", stc->piut);
+    if (ctx->bn_binary) {
+        rv = acvp_bn_to_json(tc_rsp, "ephemeralPublicIut", &stc->bn.piut);
+        if (rv != ACVP_SUCCESS) {
+            free(tmp);
+            ACVP_LOG_ERR("hex conversion failure (piut)");
+            return rv;
+        }
+    } else {
+        json_object_set_string(tc_rsp, "ephemeralPublicIut", stc->piut);
+    }
 
     memset(tmp, 0x0, ACVP_KAS_FFC_MAX_STR);
     rv = acvp_bin_to_hexstr((const unsigned char *)stc->chash, stc->chashlen, 
@@ -87,10 +96,6 @@ static ACVP_RESULT acvp_kas_ffc_output_comp_tc (ACVP_CTX *ctx, ACVP_KAS_FFC_TC *
 static ACVP_RESULT acvp_kas_ffc_init_comp_tc (ACVP_CTX *ctx,
                                               ACVP_KAS_FFC_TC *stc,
                                               unsigned int tc_id,
-                                              const char *hash,
-                                              char *p,
-                                              char *q,
-                                              char *g,
                                               char *eps,
                                               char *epri,
                                               char *epui,
@@ -99,54 +104,56 @@ static ACVP_RESULT acvp_kas_ffc_init_comp_tc (ACVP_CTX *ctx,
 ) {
 
     stc->mode = mode;
-    if (!strcmp(hash, "SHA2-224"))
-        stc->md = ACVP_SHA224;
-    if (!strcmp(hash, "SHA2-256"))
-        stc->md = ACVP_SHA256;
-    if (!strcmp(hash, "SHA2-384"))
-        stc->md = ACVP_SHA384;
-    if (!strcmp(hash, "SHA2-512"))
-        stc->md = ACVP_SHA512;
-    if (!stc->md) {
-        return ACVP_UNSUPPORTED_OP;
+
+    stc->chash = calloc(1, ACVP_KAS_FFC_MAX_STR);
+    if (!stc->chash) { return ACVP_MALLOC_FAIL; }
+    stc->z = calloc(1, ACVP_KAS_FFC_MAX_STR);
+    if (!stc->z) { return ACVP_MALLOC_FAIL; }
+
+    if (stc->test_type == ACVP_KAS_FFC_TT_VAL) {
+        strncpy(stc->z, z, strnlen((char *)z, ACVP_KAS_FFC_MAX_STR));
+    }
+
+    /*
+     * The domain parameters were set up once for the whole
+     * group, only the per test case values are decoded here.
+     */
+    if (ctx->bn_binary) {
+        stc->bn.epri.len = stc->bn.epui.len = stc->bn.piut.len = 0;
+        if (acvp_hexstr_to_bn(eps, &stc->bn.eps) != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Hex conversion failure (eps)");
+            return ACVP_INVALID_ARG;
+        }
+        if (stc->test_type == ACVP_KAS_FFC_TT_VAL) {
+            if (acvp_hexstr_to_bn(epri, &stc->bn.epri) != ACVP_SUCCESS ||
+                acvp_hexstr_to_bn(epui, &stc->bn.epui) != ACVP_SUCCESS) {
+                ACVP_LOG_ERR("Hex conversion failure (epri/epui)");
+                return ACVP_INVALID_ARG;
+            }
+        }
+        return ACVP_SUCCESS;
     }
 
-    stc->p = calloc(1, ACVP_KAS_FFC_MAX_STR);
-    if (!stc->p) { return ACVP_MALLOC_FAIL; }
-    stc->q = calloc(1, ACVP_KAS_FFC_MAX_STR);
-    if (!stc->q) { return ACVP_MALLOC_FAIL; }
-    stc->g = calloc(1, ACVP_KAS_FFC_MAX_STR);
-    if (!stc->g) { return ACVP_MALLOC_FAIL; }
     stc->eps = calloc(1, ACVP_KAS_FFC_MAX_STR);
     if (!stc->eps) { return ACVP_MALLOC_FAIL; }
     stc->epri = calloc(1, ACVP_KAS_FFC_MAX_STR);
     if (!stc->epri) { return ACVP_MALLOC_FAIL; }
     stc->epui = calloc(1, ACVP_KAS_FFC_MAX_STR);
     if (!stc->epui) { return ACVP_MALLOC_FAIL; }
-    stc->chash = calloc(1, ACVP_KAS_FFC_MAX_STR);
-    if (!stc->chash) { return ACVP_MALLOC_FAIL; }
 
-    strncpy(stc->p, p, strnlen((char *)p, ACVP_KAS_FFC_MAX_STR));
-    strncpy(stc->q, q, strnlen((char *)q, ACVP_KAS_FFC_MAX_STR));
-    strncpy(stc->g, g, strnlen((char *)g, ACVP_KAS_FFC_MAX_STR));
     strncpy(stc->eps, eps, strnlen((char *)eps, ACVP_KAS_FFC_MAX_STR));
 
-    
-    stc->z = calloc(1, ACVP_KAS_FFC_MAX_STR);
-    if (!stc->z) { return ACVP_MALLOC_FAIL; }
- 
     if (stc->test_type == ACVP_KAS_FFC_TT_VAL) {
-        strncpy(stc->z, z, strnlen((char *)z, ACVP_KAS_FFC_MAX_STR));
         strncpy(stc->epri, epri, strnlen((char *)epri, ACVP_KAS_FFC_MAX_STR));
         strncpy(stc->epui, epui, strnlen((char *)epui, ACVP_KAS_FFC_MAX_STR));
-
     }
     return ACVP_SUCCESS;
 }
 
 /*
  * This function simply releases the data associated with
- * a test case.
+ * a test case.  The domain parameters belong to the group
+ * and are released by acvp_kas_ffc_release_group().
  */
 static ACVP_RESULT acvp_kas_ffc_release_tc (ACVP_KAS_FFC_TC *stc) {
 
@@ -156,12 +163,120 @@ static ACVP_RESULT acvp_kas_ffc_release_tc (ACVP_KAS_FFC_TC *stc) {
     free(stc->eps);
     free(stc->z);
     free(stc->chash);
+
+    /*
+     * The test case is re-used for the next test, don't leave
+     * pointers behind that a failed test could free again.
+     */
+    stc->piut = stc->epri = stc->epui = stc->eps = NULL;
+    stc->z = stc->chash = NULL;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Release the domain parameters of a test group.
+ */
+static void acvp_kas_ffc_release_group (ACVP_KAS_FFC_TC *stc) {
+
     free(stc->p);
     free(stc->q);
     free(stc->g);
+    acvp_bn_free((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
+    stc->p = stc->q = stc->g = NULL;
+}
+
+/*
+ * Set up the hash and domain parameters shared by all the test
+ * cases of a group, then invoke the optional group setup callback.
+ * p, q and g stay on the test case until acvp_kas_ffc_group_end(),
+ * so neither libacvp nor the module has to decode them again for
+ * every test case.  In binary mode the bn buffers for the per test
+ * case values are allocated here as well.
+ */
+static ACVP_RESULT acvp_kas_ffc_group_begin (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
+                                             const char *hash, char *p, char *q, char *g) {
+    ACVP_KAS_FFC_TC *stc = tc->tc.kas_ffc;
+    ACVP_KAS_FFC_CAP *kas_ffc_cap = cap->cap.kas_ffc_cap;
+
+    stc->group_ctx = NULL;
+    stc->md = 0;
+    if (hash) {
+        if (!strcmp(hash, "SHA2-224"))
+            stc->md = ACVP_SHA224;
+        if (!strcmp(hash, "SHA2-256"))
+            stc->md = ACVP_SHA256;
+        if (!strcmp(hash, "SHA2-384"))
+            stc->md = ACVP_SHA384;
+        if (!strcmp(hash, "SHA2-512"))
+            stc->md = ACVP_SHA512;
+    }
+    if (!stc->md) {
+        ACVP_LOG_ERR("Unsupported KAS-FFC hash algorithm");
+        return ACVP_UNSUPPORTED_OP;
+    }
+    if (!p || !q || !g) {
+        ACVP_LOG_ERR("Missing KAS-FFC domain parameters");
+        return ACVP_MALFORMED_JSON;
+    }
+
+    if (ctx->bn_binary) {
+        if (acvp_bn_alloc((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn)) != ACVP_SUCCESS) {
+            return ACVP_MALLOC_FAIL;
+        }
+        if (acvp_hexstr_to_bn(p, &stc->bn.p) != ACVP_SUCCESS ||
+            acvp_hexstr_to_bn(q, &stc->bn.q) != ACVP_SUCCESS ||
+            acvp_hexstr_to_bn(g, &stc->bn.g) != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("Hex conversion failure (pqg)");
+            acvp_kas_ffc_release_group(stc);
+            return ACVP_INVALID_ARG;
+        }
+    } else {
+        stc->p = calloc(1, ACVP_KAS_FFC_MAX_STR);
+        stc->q = calloc(1, ACVP_KAS_FFC_MAX_STR);
+        stc->g = calloc(1, ACVP_KAS_FFC_MAX_STR);
+        if (!stc->p || !stc->q || !stc->g) {
+            acvp_kas_ffc_release_group(stc);
+            return ACVP_MALLOC_FAIL;
+        }
+        strncpy(stc->p, p, strnlen((char *)p, ACVP_KAS_FFC_MAX_STR));
+        strncpy(stc->q, q, strnlen((char *)q, ACVP_KAS_FFC_MAX_STR));
+        strncpy(stc->g, g, strnlen((char *)g, ACVP_KAS_FFC_MAX_STR));
+    }
+
+    if (!kas_ffc_cap || !kas_ffc_cap->group.begin) {
+        return ACVP_SUCCESS;
+    }
+    if ((kas_ffc_cap->group.begin)(tc) != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("ERROR: crypto module failed the group setup");
+        acvp_kas_ffc_release_group(stc);
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
     return ACVP_SUCCESS;
 }
 
+/*
+ * Invoke the optional group teardown callback, also when a test
+ * case in the group failed, and release the domain parameters.
+ */
+static ACVP_RESULT acvp_kas_ffc_group_end (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
+                                           void *group_ctx, ACVP_RESULT rv) {
+    ACVP_KAS_FFC_TC *stc = tc->tc.kas_ffc;
+    ACVP_KAS_FFC_CAP *kas_ffc_cap = cap->cap.kas_ffc_cap;
+
+    if (kas_ffc_cap && kas_ffc_cap->group.end) {
+        stc->group_ctx = group_ctx;
+        if ((kas_ffc_cap->group.end)(tc) != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("ERROR: crypto module failed the group teardown");
+            if (rv == ACVP_SUCCESS) {
+                rv = ACVP_CRYPTO_MODULE_FAIL;
+            }
+        }
+        stc->group_ctx = NULL;
+    }
+    acvp_kas_ffc_release_group(stc);
+    return rv;
+}
+
 
 static ACVP_RESULT acvp_kas_ffc_comp(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc,
                                      ACVP_KAS_FFC_TC *stc, JSON_Object *obj, int mode, 
@@ -181,6 +296,7 @@ static ACVP_RESULT acvp_kas_ffc_comp(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TE
     int j, t_cnt, tc_id;
     ACVP_RESULT rv;
     const char *test_type;
+    void *group_ctx = NULL;
 
     groups = json_object_get_array(obj, "testGroups");
     g_cnt = json_array_get_count(groups);
@@ -208,6 +324,12 @@ static ACVP_RESULT acvp_kas_ffc_comp(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TE
         ACVP_LOG_INFO("              q: %s", q);
         ACVP_LOG_INFO("              g: %s", g);
 
+        rv = acvp_kas_ffc_group_begin(ctx, cap, tc, hash, p, q, g);
+        if (rv != ACVP_SUCCESS) {
+            return rv;
+        }
+        group_ctx = stc->group_ctx;
+
         tests = json_object_get_array(groupobj, "tests");
         t_cnt = json_array_get_count(tests);
 
@@ -239,19 +361,23 @@ static ACVP_RESULT acvp_kas_ffc_comp(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TE
             /*
              * Setup the test case data that will be passed down to
              * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
              */
-            rv = acvp_kas_ffc_init_comp_tc(ctx, stc, tc_id, hash,
-                                           p, q, g, eps, epri, epui, z, mode);
-            if (rv != ACVP_SUCCESS) {
-                return ACVP_CRYPTO_MODULE_FAIL;
-            }
+            rv = acvp_kas_ffc_init_comp_tc(ctx, stc, tc_id,
+                                           eps, epri, epui, z, mode);
+            stc->group_ctx = group_ctx;
 
             /* Process the current KAT test vector... */
-            rv = (cap->crypto_handler)(tc);
-            if (rv != ACVP_SUCCESS) {
-                return ACVP_CRYPTO_MODULE_FAIL;
+            if (rv == ACVP_SUCCESS) {
+                rv = acvp_call_crypto_handler(ctx, cap, tc);
+                if (rv != ACVP_SUCCESS) {
+                    ACVP_LOG_ERR("ERROR: crypto module failed the operation");
+                    rv = ACVP_CRYPTO_MODULE_FAIL;
+                    goto key_err;
+                }
+            } else {
+                ACVP_LOG_ERR("Failed to initialize KAS-FFC Component test case");
+                rv = ACVP_CRYPTO_MODULE_FAIL;
+                goto key_err;
             }
 
             /*
@@ -260,16 +386,27 @@ static ACVP_RESULT acvp_kas_ffc_comp(ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TE
             rv = acvp_kas_ffc_output_comp_tc(ctx, stc, r_tobj);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("JSON output failure in KAS-FFC module");
-                return rv;
+                goto key_err;
             }
 
+            /* Append the test response value to array */
+            json_array_append_value(r_tarr, r_tval);
+            r_tval = NULL;
+
             /*
              * Release all the memory associated with the test case
              */
+            key_err:
             acvp_kas_ffc_release_tc(stc);
+            if (rv != ACVP_SUCCESS) {
+                json_value_free(r_tval);
+                break;
+            }
+        }
 
-            /* Append the test response value to array */
-            json_array_append_value(r_tarr, r_tval);
+        rv = acvp_kas_ffc_group_end(ctx, cap, tc, group_ctx, rv);
+        if (rv != ACVP_SUCCESS) {
+            return rv;
         }
     }
 
@@ -289,7 +426,6 @@ ACVP_RESULT acvp_kas_ffc_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_RESULT rv;
     const char *alg_str = json_object_get_string(obj, "algorithm");
     int mode;
-    char *json_result;
     const char *alg_mode;
 
     if (!alg_str) {
@@ -359,15 +495,7 @@ ACVP_RESULT acvp_kas_ffc_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     }
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
-
-    return ACVP_SUCCESS;
+    return rv;
 }
 
 
@@ -31,17 +31,25 @@
 #include "acvp_lcl.h"
 #include "parson.h"
 
+/*
+ * Size of the hex buffer of a group, large enough for either
+ * the key_out or a full fixed_data buffer
+ */
+#define ACVP_KDF108_HEX_LEN(key_out_len) \
+    (((key_out_len) > ACVP_KDF108_FIXED_DATA_MAX ? (key_out_len) : ACVP_KDF108_FIXED_DATA_MAX) * 2 + 1)
+
 /*
  * After the test case has been processed by the DUT, the results
  * need to be JSON formated to be included in the vector set results
  * file that will be uploaded to the server.  This routine handles
- * the JSON processing for a single test case.
+ * the JSON processing for a single test case.  'hex' is the group's
+ * buffer for the hex encoded results, see ACVP_KDF108_HEX_LEN().
  */
 static ACVP_RESULT acvp_kdf108_output_tc (ACVP_CTX *ctx,
                                           ACVP_KDF108_TC *stc,
-                                          JSON_Object *tc_rsp) {
+                                          JSON_Object *tc_rsp,
+                                          char *hex) {
     ACVP_RESULT rv = 0;
-    char tmp[ACVP_KDF108_STRING_MAX + 1] = {0}; // Leave space for terminator
 
     /*
      * Sign check, only accept positive values
@@ -53,67 +61,62 @@ static ACVP_RESULT acvp_kdf108_output_tc (ACVP_CTX *ctx,
     }
 
     /*
-     * Length check
+     * Length check, key_out_len is set by libacvp
      */
-    if ((stc->key_out_len * 2) > ACVP_KDF108_STRING_MAX ||
-        (stc->fixed_data_len * 2) > ACVP_KDF108_STRING_MAX) {
-        ACVP_LOG_ERR("stc lengths > ACVP_KDF108_STRING_MAX(%u)", ACVP_KDF108_STRING_MAX);
+    if (stc->fixed_data_len > ACVP_KDF108_FIXED_DATA_MAX) {
+        ACVP_LOG_ERR("fixed_data_len > ACVP_KDF108_FIXED_DATA_MAX(%u)", ACVP_KDF108_FIXED_DATA_MAX);
         return ACVP_INVALID_ARG;
     }
 
-    rv = acvp_bin_to_hexstr(stc->key_out, stc->key_out_len, (unsigned char *) tmp);
+    rv = acvp_bin_to_hexstr(stc->key_out, stc->key_out_len, (unsigned char *) hex);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("acvp_bin_to_hexstr() failure");
         return rv;
     }
-    json_object_set_string(tc_rsp, "keyOut", tmp);
+    json_object_set_string(tc_rsp, "keyOut", hex);
 
-    // Clear the tmp array
-    memset(tmp, 0, ACVP_KDF108_STRING_MAX);
-
-    rv = acvp_bin_to_hexstr(stc->fixed_data, stc->fixed_data_len, (unsigned char *) tmp);
+    rv = acvp_bin_to_hexstr(stc->fixed_data, stc->fixed_data_len, (unsigned char *) hex);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("acvp_bin_to_hexstr() failure");
         return rv;
     }
-    json_object_set_string(tc_rsp, "fixedData", tmp);
+    json_object_set_string(tc_rsp, "fixedData", hex);
+
+    /*
+     * The counter splits the fixed data, report where
+     */
+    if (stc->counter_location == ACVP_KDF108_FIXED_DATA_ORDER_MIDDLE) {
+        if (stc->break_location <= 0 || stc->break_location >= stc->fixed_data_len * 8) {
+            ACVP_LOG_ERR("break_location (%d) is not within fixed_data", stc->break_location);
+            return ACVP_INVALID_ARG;
+        }
+        json_object_set_number(tc_rsp, "breakLocation", stc->break_location);
+    }
 
     return ACVP_SUCCESS;
 }
 
-static ACVP_RESULT acvp_kdf108_init_tc (ACVP_CTX *ctx,
-                                        ACVP_KDF108_TC *stc,
-                                        unsigned int tc_id,
-                                        ACVP_KDF108_MODE kdf_mode,
-                                        ACVP_KDF108_MAC_MODE_VAL mac_mode,
-                                        ACVP_KDF108_FIXED_DATA_ORDER_VAL counter_location,
-                                        char *key_in,
-                                        int key_in_len,
-                                        int key_out_len,
-                                        int counter_len,
-                                        int deferred
-) {
+/*
+ * All the test cases of a KDF108 test group share the modes
+ * and the key_in/key_out lengths.  A single buffer is allocated
+ * for the group, holding key_in, key_out and fixed_data.
+ */
+static ACVP_RESULT acvp_kdf108_init_group (ACVP_CTX *ctx,
+                                           ACVP_KDF108_TC *stc,
+                                           ACVP_KDF108_MODE kdf_mode,
+                                           ACVP_KDF108_MAC_MODE_VAL mac_mode,
+                                           ACVP_KDF108_FIXED_DATA_ORDER_VAL counter_location,
+                                           int key_in_len,
+                                           int key_out_len,
+                                           int counter_len) {
     memset(stc, 0x0, sizeof(ACVP_KDF108_TC));
 
-    // Allocate space for the key_in (binary)
-    stc->key_in = calloc(key_in_len, sizeof(unsigned char));
+    stc->key_in = calloc(key_in_len + key_out_len + ACVP_KDF108_FIXED_DATA_MAX,
+                         sizeof(unsigned char));
     if (!stc->key_in) { return ACVP_MALLOC_FAIL; }
+    stc->key_out = stc->key_in + key_in_len;
+    stc->fixed_data = stc->key_out + key_out_len;
 
-    // Convert key_in from hex string to binary
-    acvp_hexstr_to_bin(key_in, stc->key_in, key_in_len);
-
-    // Allocate space for the key_out
-    stc->key_out = calloc(key_out_len, sizeof(unsigned char));
-    if (!stc->key_out) { return ACVP_MALLOC_FAIL; }
-
-    /*
-     * Allocate space for the fixed_data.
-     * User supplies the data, set size limit.
-     */
-    stc->fixed_data = calloc(ACVP_KDF108_FIXED_DATA_MAX, sizeof(unsigned char));
-    if (!stc->key_out) { return ACVP_MALLOC_FAIL; }
-    
-    stc->tc_id = tc_id;
     stc->cipher = ACVP_KDF108;
     stc->mode = kdf_mode;
     stc->mac_mode = mac_mode;
@@ -121,20 +124,47 @@ static ACVP_RESULT acvp_kdf108_init_tc (ACVP_CTX *ctx,
     stc->key_in_len = key_in_len;
     stc->key_out_len = key_out_len;
     stc->counter_len = counter_len;
+
+    return ACVP_SUCCESS;
+}
+
+static ACVP_RESULT acvp_kdf108_init_tc (ACVP_CTX *ctx,
+                                        ACVP_KDF108_TC *stc,
+                                        unsigned int tc_id,
+                                        const char *key_in,
+                                        int deferred) {
+    ACVP_RESULT rv;
+
+    acvp_clear_tc_buf(stc->key_out, stc->key_out_len, stc->key_out_len);
+    acvp_clear_tc_buf(stc->fixed_data, ACVP_KDF108_FIXED_DATA_MAX, ACVP_KDF108_FIXED_DATA_MAX);
+    stc->fixed_data_len = 0;
+    stc->break_location = 0;
+
+    if (!key_in) {
+        ACVP_LOG_ERR("Missing keyIn - initalize KDF108 test case");
+        return ACVP_MALFORMED_JSON;
+    }
+
+    // Convert key_in from hex string to binary
+    rv = acvp_hexstr_to_bin((const unsigned char *)key_in, stc->key_in, stc->key_in_len);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Hex conversion failure (keyIn)");
+        return rv;
+    }
+
+    stc->tc_id = tc_id;
     stc->deferred = deferred;
-    
+
     return ACVP_SUCCESS;
 }
 
 /*
  * This function simply releases the data associated with
- * a test case.
+ * a test group.
  */
 static ACVP_RESULT acvp_kdf108_release_tc (ACVP_KDF108_TC *stc) {
     if (stc->key_in) free(stc->key_in);
-    if (stc->key_out) free(stc->key_out);
-    if (stc->fixed_data) free(stc->fixed_data);
-    
+
     memset(stc, 0x0, sizeof(ACVP_KDF108_TC));
     return ACVP_SUCCESS;
 }
@@ -162,9 +192,10 @@ ACVP_RESULT acvp_kdf108_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     JSON_Object *r_tobj = NULL; /* Response testobj */
 
     ACVP_CAPS_LIST *cap;
+    ACVP_KDF108_MODE_PARAMS *mode_obj = NULL;
     ACVP_KDF108_TC stc;
     ACVP_TEST_CASE tc;
-    ACVP_RESULT rv;
+    ACVP_RESULT rv = ACVP_SUCCESS;
 
     const char *alg_str = "KDF";
     ACVP_CIPHER alg_id = ACVP_KDF108;
@@ -172,20 +203,20 @@ ACVP_RESULT acvp_kdf108_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     ACVP_KDF108_MAC_MODE_VAL mac_mode = 0;
     ACVP_KDF108_FIXED_DATA_ORDER_VAL ctr_loc = 0;
     int key_out_bit_len, key_out_len, key_in_len, ctr_len, deferred;
-    unsigned char *key_in = NULL;
-    char *kdf_mode_str, *mac_mode_str, *key_in_str, *ctr_loc_str = NULL;
-    char *json_result;
+    const char *kdf_mode_str, *mac_mode_str, *key_in_str, *ctr_loc_str = NULL;
+    char *hex = NULL;
 
     /*
      * Get a reference to the abstracted test case
      */
     tc.tc.kdf108 = &stc;
+    memset(&stc, 0x0, sizeof(ACVP_KDF108_TC));
 
     /*
      * Get the crypto module handler for this hash algorithm
      */
     cap = acvp_locate_cap_entry(ctx, alg_id);
-    if (!cap) {
+    if (!cap || !cap->cap.kdf108_cap) {
         ACVP_LOG_ERR("ACVP server requesting unsupported capability");
         return (ACVP_UNSUPPORTED_OP);
     }
@@ -225,14 +256,10 @@ ACVP_RESULT acvp_kdf108_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
         key_out_bit_len = json_object_get_number(groupobj, "keyOutLength");
         ctr_len = json_object_get_number(groupobj, "counterLength");
         ctr_loc_str = json_object_get_string(groupobj, "counterLocation");
-
-        // Get the keyout byte length  (+1 for overflow bits)
-        key_out_len = (key_out_bit_len + 7) / 8;
-
-        if (key_out_len > ACVP_KDF108_KEYOUT_MAX) {
-            ACVP_LOG_ERR("ACVP server requesting unsupported key_out length (%d)",
-                         key_out_len);
-            return (ACVP_UNSUPPORTED_OP);
+        if (!kdf_mode_str || !mac_mode_str || !ctr_loc_str) {
+            ACVP_LOG_ERR("Missing kdfMode, macMode or counterLocation in KDF108 test group");
+            rv = ACVP_MALFORMED_JSON;
+            goto end;
         }
 
         /*
@@ -241,13 +268,17 @@ ACVP_RESULT acvp_kdf108_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
          */
         if (strncmp(kdf_mode_str, ACVP_MODE_COUNTER, 64) == 0) {
             kdf_mode = ACVP_KDF108_MODE_COUNTER;
+            mode_obj = &cap->cap.kdf108_cap->counter_mode;
         } else if (strncmp(kdf_mode_str, ACVP_MODE_FEEDBACK, 64) == 0) {
             kdf_mode = ACVP_KDF108_MODE_FEEDBACK;
+            mode_obj = &cap->cap.kdf108_cap->feedback_mode;
         } else if (strncmp(kdf_mode_str, ACVP_MODE_DPI, 64) == 0) {
             kdf_mode = ACVP_KDF108_MODE_DPI;
+            mode_obj = &cap->cap.kdf108_cap->dpi_mode;
         } else {
             ACVP_LOG_ERR("ACVP server requesting unsupported KDF108 mode");
-            return (ACVP_UNSUPPORTED_OP);
+            rv = ACVP_UNSUPPORTED_OP;
+            goto end;
         }
 
         /*
@@ -283,7 +314,8 @@ ACVP_RESULT acvp_kdf108_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             key_in_len = ACVP_BYTE_LEN_CMAC_TDES;
         } else {
             ACVP_LOG_ERR("ACVP server requesting unsupported KDF108 mac mode");
-            return (ACVP_UNSUPPORTED_OP);
+            rv = ACVP_UNSUPPORTED_OP;
+            goto end;
         }
 
         /*
@@ -302,9 +334,25 @@ ACVP_RESULT acvp_kdf108_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             ctr_loc = ACVP_KDF108_FIXED_DATA_ORDER_BEFORE_ITERATOR;
         } else {
             ACVP_LOG_ERR("ACVP server requesting unsupported KDF108 counter location");
-            return (ACVP_UNSUPPORTED_OP);
+            rv = ACVP_UNSUPPORTED_OP;
+            goto end;
         }
 
+        /*
+         * key_out is sized for the group, so keyOutLength only has
+         * to be within the lengths registered for the mode.
+         */
+        if (key_out_bit_len <= 0 ||
+            (mode_obj->supported_lens.max && key_out_bit_len > mode_obj->supported_lens.max)) {
+            ACVP_LOG_ERR("ACVP server requesting unsupported key_out length (%d bits)",
+                         key_out_bit_len);
+            rv = ACVP_UNSUPPORTED_OP;
+            goto end;
+        }
+
+        // Get the keyout byte length  (+1 for overflow bits)
+        key_out_len = (key_out_bit_len + 7) / 8;
+
         /*
          * Log Test Group information...
          */
@@ -315,6 +363,19 @@ ACVP_RESULT acvp_kdf108_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
         ACVP_LOG_INFO("    counterLen: %d", ctr_len);
         ACVP_LOG_INFO("    counterLoc: %s", ctr_loc_str);
 
+        rv = acvp_kdf108_init_group(ctx, &stc, kdf_mode, mac_mode, ctr_loc,
+                                    key_in_len, key_out_len, ctr_len);
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
+        free(hex);
+        hex = calloc(ACVP_KDF108_HEX_LEN(key_out_len), sizeof(char));
+        if (!hex) {
+            acvp_kdf108_release_tc(&stc);
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+
         tests = json_object_get_array(groupobj, "tests");
         t_cnt = json_array_get_count(tests);
         for (j = 0; j < t_cnt; j++) {
@@ -334,58 +395,58 @@ ACVP_RESULT acvp_kdf108_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
             ACVP_LOG_INFO("            keyIn: %s", key_in_str);
             ACVP_LOG_INFO("         deferred: %d", deferred);
 
-            /*
-             * Create a new test case in the response
-             */
-            r_tval = json_value_init_object();
-            r_tobj = json_value_get_object(r_tval);
-
-            json_object_set_number(r_tobj, "tcId", tc_id);
-
             /*
              * Setup the test case data that will be passed down to
-             * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
+             * the crypto module.  The buffers of the group are
+             * reused by each of its test cases.
              */
-            acvp_kdf108_init_tc(ctx, &stc, tc_id, kdf_mode, mac_mode,
-                                ctr_loc, key_in_str, key_in_len,
-                                key_out_len, ctr_len, deferred);
+            rv = acvp_kdf108_init_tc(ctx, &stc, tc_id, key_in_str, deferred);
+            if (rv != ACVP_SUCCESS) {
+                break;
+            }
 
             /* Process the current test vector... */
-            rv = (cap->crypto_handler)(&tc);
+            rv = acvp_call_crypto_handler(ctx, cap, &tc);
             if (rv != ACVP_SUCCESS) {
                 ACVP_LOG_ERR("crypto module failed the operation");
-                return ACVP_CRYPTO_MODULE_FAIL;
+                rv = ACVP_CRYPTO_MODULE_FAIL;
+                break;
             }
 
+            /*
+             * Create a new test case in the response
+             */
+            r_tval = json_value_init_object();
+            r_tobj = json_value_get_object(r_tval);
+
+            json_object_set_number(r_tobj, "tcId", tc_id);
+
             /*
              * Output the test case results using JSON
             */
-            rv = acvp_kdf108_output_tc(ctx, &stc, r_tobj);
+            rv = acvp_kdf108_output_tc(ctx, &stc, r_tobj, hex);
             if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("JSON output failure in kdf135 tpm module");
-                return rv;
+                ACVP_LOG_ERR("JSON output failure in kdf108 module");
+                json_value_free(r_tval);
+                break;
             }
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_kdf108_release_tc(&stc);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
         }
+
+        /*
+         * Release all the memory associated with the group
+         */
+        acvp_kdf108_release_tc(&stc);
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
     }
 
+end:
+    free(hex);
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
-
-    return ACVP_SUCCESS;
+    return rv;
 }
@@ -0,0 +1,263 @@
+/*****************************************************************************
+* Copyright (c) 2016, Cisco Systems, Inc.
+* All rights reserved.
+
+* Redistribution and use in source and binary forms, with or without modification, 
+* are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice, 
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation 
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+* USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "acvp.h"
+#include "acvp_lcl.h"
+#include "parson.h"
+
+/*
+ * This function releases the 'cnt' test cases held in 'stcs'
+ */
+static void acvp_kdf135_release_group (const ACVP_KDF135_OPS *ops, unsigned char *stcs, int cnt) {
+    int j;
+
+    if (!stcs) {
+        return;
+    }
+    for (j = 0; j < cnt; j++) {
+        (ops->release_tc)(stcs + j * ops->tc_size);
+    }
+    free(stcs);
+}
+
+/*
+ * This is the KAT handler shared by the kdf135 KDFs.  All the
+ * tests of a group, or of the whole vector set when ops->vs_batch
+ * is set, are parsed into one array of test cases before any of
+ * them is processed.  The array is then handed to the batch
+ * callback set with acvp_enable_kdf135_batch_cb() in a single
+ * call.  When there is none, the crypto handler is called for
+ * each test case in turn, from this thread, as for the other
+ * algorithms.  The results are output in the order of the tests.
+ */
+ACVP_RESULT acvp_kdf135_kat_handler_internal (ACVP_CTX *ctx, JSON_Object *obj, const ACVP_KDF135_OPS *ops) {
+    unsigned int tc_id;
+    JSON_Value *groupval;
+    JSON_Object *groupobj = NULL;
+    JSON_Value *testval;
+    JSON_Object *testobj = NULL;
+    JSON_Array *groups;
+    JSON_Array *tests;
+
+    JSON_Value *reg_arry_val = NULL;
+    JSON_Object *reg_obj = NULL;
+    JSON_Array *reg_arry = NULL;
+
+    int i, g, last, g_cnt;
+    int j, k, t_cnt = 0;
+
+    JSON_Value *r_vs_val = NULL;
+    JSON_Object *r_vs = NULL;
+    JSON_Array *r_tarr = NULL; /* Response testarray */
+    JSON_Value *r_tval = NULL; /* Response testval */
+    JSON_Object *r_tobj = NULL; /* Response testobj */
+    ACVP_CAPS_LIST *cap;
+    ACVP_TEST_BATCH batch;
+    ACVP_TEST_CASE *tcs = NULL;
+    unsigned char *stcs = NULL;
+    void *group = NULL;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    const char *alg_str = json_object_get_string(obj, "algorithm");
+
+    if (!alg_str) {
+        ACVP_LOG_ERR("unable to parse 'algorithm' from JSON");
+        return (ACVP_MALFORMED_JSON);
+    }
+
+    cap = acvp_locate_cap_entry(ctx, ops->cipher);
+    if (!cap) {
+        ACVP_LOG_ERR("ACVP server requesting unsupported capability %s : %d.", alg_str, ops->cipher);
+        return (ACVP_UNSUPPORTED_OP);
+    }
+
+    if (ops->group_size) {
+        group = calloc(1, ops->group_size);
+        if (!group) {
+            return ACVP_MALLOC_FAIL;
+        }
+    }
+
+    /*
+     * Create ACVP array for response
+     */
+    rv = acvp_create_array(&reg_obj, &reg_arry_val, &reg_arry);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("Failed to create JSON response struct. ");
+        free(group);
+        return (rv);
+    }
+
+    /*
+     * Start to build the JSON response
+     */
+    if (ctx->kat_resp) {
+        json_value_free(ctx->kat_resp);
+    }
+    ctx->kat_resp = reg_arry_val;
+    r_vs_val = json_value_init_object();
+    r_vs = json_value_get_object(r_vs_val);
+
+    json_object_set_number(r_vs, "vsId", ctx->vs_id);
+    json_object_set_string(r_vs, "algorithm", alg_str);
+    if (ops->mode) {
+        json_object_set_string(r_vs, "mode", ops->mode);
+    }
+    json_object_set_value(r_vs, "testResults", json_value_init_array());
+    r_tarr = json_object_get_array(r_vs, "testResults");
+
+    groups = json_object_get_array(obj, "testGroups");
+    g_cnt = json_array_get_count(groups);
+    for (i = 0; i < g_cnt; i = last) {
+        /*
+         * A batch holds the tests of one group, or of all the
+         * groups when the KDF asks for a vector set wide batch.
+         */
+        last = ops->vs_batch ? g_cnt : i + 1;
+        t_cnt = 0;
+        for (g = i; g < last; g++) {
+            groupobj = json_array_get_object(groups, g);
+            t_cnt += json_array_get_count(json_object_get_array(groupobj, "tests"));
+        }
+        if (!t_cnt) {
+            continue;
+        }
+
+        /*
+         * Setup all the test cases of the batch before any
+         * of them is passed down to the crypto module.
+         */
+        stcs = calloc(t_cnt, ops->tc_size);
+        tcs = calloc(t_cnt, sizeof(ACVP_TEST_CASE));
+        if (!stcs || !tcs) {
+            rv = ACVP_MALLOC_FAIL;
+            goto end;
+        }
+        k = 0;
+        for (g = i; g < last; g++) {
+            groupval = json_array_get_value(groups, g);
+            groupobj = json_value_get_object(groupval);
+
+            ACVP_LOG_INFO("    Test group: %d", g);
+
+            if (group) {
+                memset(group, 0x0, ops->group_size);
+            }
+            rv = (ops->parse_group)(ctx, groupobj, group);
+            if (rv != ACVP_SUCCESS) {
+                goto end;
+            }
+
+            tests = json_object_get_array(groupobj, "tests");
+            for (j = 0; j < (int)json_array_get_count(tests); j++, k++) {
+                testval = json_array_get_value(tests, j);
+                testobj = json_value_get_object(testval);
+
+                tc_id = (unsigned int) json_object_get_number(testobj, "tcId");
+
+                ACVP_LOG_INFO("        Test case: %d", j);
+                ACVP_LOG_INFO("             tcId: %d", tc_id);
+
+                (ops->bind)(&tcs[k], stcs + k * ops->tc_size);
+                rv = (ops->init_tc)(ctx, stcs + k * ops->tc_size, group, testobj, tc_id);
+                if (rv != ACVP_SUCCESS) {
+                    ACVP_LOG_ERR("Failed to initialize test case %d", tc_id);
+                    goto end;
+                }
+            }
+        }
+
+        /* Process the test vectors of the batch... */
+        if (cap->batch_handler) {
+            batch.cipher = ops->cipher;
+            batch.count = t_cnt;
+            batch.tcs = tcs;
+            rv = (cap->batch_handler)(&batch);
+            if (rv != ACVP_SUCCESS) {
+                ACVP_LOG_ERR("crypto module failed the batch operation");
+                rv = ACVP_CRYPTO_MODULE_FAIL;
+            }
+        } else {
+            for (k = 0; k < t_cnt; k++) {
+                rv = acvp_call_crypto_handler(ctx, cap, &tcs[k]);
+                if (rv != ACVP_SUCCESS) {
+                    ACVP_LOG_ERR("crypto module failed the operation");
+                    rv = ACVP_CRYPTO_MODULE_FAIL;
+                    break;
+                }
+            }
+        }
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
+
+        k = 0;
+        for (g = i; g < last; g++) {
+            tests = json_object_get_array(json_array_get_object(groups, g), "tests");
+            for (j = 0; j < (int)json_array_get_count(tests); j++, k++) {
+                /*
+                 * Create a new test case in the response
+                 */
+                r_tval = json_value_init_object();
+                r_tobj = json_value_get_object(r_tval);
+
+                json_object_set_number(r_tobj, "tcId",
+                                       json_object_get_number(json_array_get_object(tests, j), "tcId"));
+
+                /*
+                 * Output the test case results using JSON
+                 */
+                rv = (ops->output_tc)(ctx, stcs + k * ops->tc_size, r_tobj);
+                if (rv != ACVP_SUCCESS) {
+                    ACVP_LOG_ERR("JSON output failure in kdf135 module");
+                    json_value_free(r_tval);
+                    goto end;
+                }
+
+                /* Append the test response value to array */
+                json_array_append_value(r_tarr, r_tval);
+            }
+        }
+
+        /*
+         * Release all the memory associated with the test cases
+         */
+        acvp_kdf135_release_group(ops, stcs, t_cnt);
+        stcs = NULL;
+        free(tcs);
+        tcs = NULL;
+    }
+
+end:
+    acvp_kdf135_release_group(ops, stcs, t_cnt);
+    free(tcs);
+    free(group);
+    json_array_append_value(reg_arry, r_vs_val);
+
+    return rv;
+}
@@ -32,9 +32,54 @@
 #include "parson.h"
 
 /*
- * Forward prototypes for local functions
+ * The settings shared by all the tests of an IKEv1 test group
  */
-static ACVP_RESULT acvp_kdf135_ikev1_output_tc (ACVP_CTX *ctx, ACVP_KDF135_IKEV1_TC *stc, JSON_Object *tc_rsp) {
+typedef struct acvp_kdf135_ikev1_group_t {
+    unsigned char *hash_alg;
+    unsigned char *auth_method;
+    int init_nonce_len;
+    int resp_nonce_len;
+    int dh_secret_len;
+    int psk_len;
+} ACVP_KDF135_IKEV1_GROUP;
+
+static void acvp_kdf135_ikev1_bind (ACVP_TEST_CASE *tc, void *stc) {
+    tc->tc.kdf135_ikev1 = stc;
+}
+
+static ACVP_RESULT acvp_kdf135_ikev1_parse_group (ACVP_CTX *ctx, JSON_Object *groupobj, void *group_ptr) {
+    ACVP_KDF135_IKEV1_GROUP *group = group_ptr;
+
+    group->hash_alg = (unsigned char *) json_object_get_string(groupobj, "hashAlg");
+    group->auth_method = (unsigned char *) json_object_get_string(groupobj, "authenticationMethod");
+    group->init_nonce_len = json_object_get_number(groupobj, "nInitLength");
+    group->resp_nonce_len = json_object_get_number(groupobj, "nRespLength");
+    group->dh_secret_len = json_object_get_number(groupobj, "dhLength");
+    group->psk_len = json_object_get_number(groupobj, "preSharedKeyLength");
+    if (!group->hash_alg || !group->auth_method) {
+        ACVP_LOG_ERR("Missing hashAlg or authenticationMethod in IKEv1 test group");
+        return ACVP_MALFORMED_JSON;
+    }
+
+    ACVP_LOG_INFO("        hash alg: %s", group->hash_alg);
+    ACVP_LOG_INFO("     auth method: %s", group->auth_method);
+    ACVP_LOG_INFO("  init nonce len: %d", group->init_nonce_len);
+    ACVP_LOG_INFO("  resp nonce len: %d", group->resp_nonce_len);
+    ACVP_LOG_INFO("   dh secret len: %d", group->dh_secret_len);
+    ACVP_LOG_INFO("         psk len: %d", group->psk_len);
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * After the test case has been processed by the DUT, the results
+ * need to be JSON formated to be included in the vector set results
+ * file that will be uploaded to the server.  This routine handles
+ * the JSON processing for a single test case.
+ */
+static ACVP_RESULT acvp_kdf135_ikev1_output_tc (ACVP_CTX *ctx, void *tc_ptr, JSON_Object *tc_rsp) {
+    ACVP_KDF135_IKEV1_TC *stc = tc_ptr;
+
     json_object_set_string(tc_rsp, "sKeyId", (const char *)stc->s_key_id);
     json_object_set_string(tc_rsp, "sKeyIdD", (const char *)stc->s_key_id_d);
     json_object_set_string(tc_rsp, "sKeyIdA", (const char *)stc->s_key_id_a);
@@ -42,35 +87,39 @@ static ACVP_RESULT acvp_kdf135_ikev1_output_tc (ACVP_CTX *ctx, ACVP_KDF135_IKEV1
     return ACVP_SUCCESS;
 }
 
-static ACVP_RESULT acvp_kdf135_ikev1_init_tc (ACVP_CTX *ctx,
-                                              ACVP_KDF135_IKEV1_TC *stc,
-                                              unsigned int tc_id,
-                                              unsigned char *hash_alg,
-                                              unsigned char *auth_method,
-                                              int init_nonce_len,
-                                              int resp_nonce_len,
-                                              int dh_secret_len,
-                                              int psk_len,
-                                              unsigned char *init_nonce,
-                                              unsigned char *resp_nonce,
-                                              unsigned char *init_ckey,
-                                              unsigned char *resp_ckey,
-                                              unsigned char *gxy,
-                                              unsigned char *psk) {
-    ACVP_RESULT rv = ACVP_SUCCESS;
+static ACVP_RESULT acvp_kdf135_ikev1_init_tc (ACVP_CTX *ctx, void *tc_ptr, void *group_ptr,
+                                              JSON_Object *testobj, unsigned int tc_id) {
+    ACVP_KDF135_IKEV1_TC *stc = tc_ptr;
+    ACVP_KDF135_IKEV1_GROUP *group = group_ptr;
+    unsigned char *init_nonce = (unsigned char *)json_object_get_string(testobj, "nInit");
+    unsigned char *resp_nonce = (unsigned char *)json_object_get_string(testobj, "nResp");
+    unsigned char *init_ckey = (unsigned char *)json_object_get_string(testobj, "ckyInit");
+    unsigned char *resp_ckey = (unsigned char *)json_object_get_string(testobj, "ckyResp");
+    unsigned char *gxy = (unsigned char *)json_object_get_string(testobj, "gxy");
+    unsigned char *psk = (unsigned char *)json_object_get_string(testobj, "preSharedKey");
+
     memset(stc, 0x0, sizeof(ACVP_KDF135_IKEV1_TC));
 
+    if (!init_nonce || !resp_nonce || !init_ckey || !resp_ckey || !gxy) {
+        ACVP_LOG_ERR("Missing parameters - initalize KDF IKEv1 test case");
+        return ACVP_MALFORMED_JSON;
+    }
+    if (!psk) {
+        psk = (unsigned char *)"";
+    }
+
     stc->tc_id = tc_id;
+    stc->cipher = ACVP_KDF135_IKEV1;
 
     stc->hash_alg = calloc(ACVP_RSA_HASH_ALG_LEN_MAX, sizeof(char));
     if (!stc->hash_alg) { return ACVP_MALLOC_FAIL; }
-    memcpy(stc->hash_alg, hash_alg, strnlen((const char *)hash_alg, ACVP_RSA_HASH_ALG_LEN_MAX));
-    memcpy(stc->auth_method, auth_method, 3);
+    memcpy(stc->hash_alg, group->hash_alg, strnlen((const char *)group->hash_alg, ACVP_RSA_HASH_ALG_LEN_MAX));
+    memcpy(stc->auth_method, group->auth_method, strnlen((const char *)group->auth_method, 3));
 
-    stc->init_nonce_len = init_nonce_len;
-    stc->resp_nonce_len = resp_nonce_len;
-    stc->dh_secret_len = dh_secret_len;
-    stc->psk_len = psk_len;
+    stc->init_nonce_len = group->init_nonce_len;
+    stc->resp_nonce_len = group->resp_nonce_len;
+    stc->dh_secret_len = group->dh_secret_len;
+    stc->psk_len = group->psk_len;
 
     stc->init_nonce = calloc(ACVP_KDF135_IKE_NONCE_LEN_MAX, sizeof(char));
     if (!stc->init_nonce) { return ACVP_MALLOC_FAIL; }
@@ -96,10 +145,12 @@ static ACVP_RESULT acvp_kdf135_ikev1_init_tc (ACVP_CTX *ctx,
     if (!stc->psk) { return ACVP_MALLOC_FAIL; }
     memcpy(stc->psk, psk, strnlen((const char *)psk, ACVP_KDF135_PSK_LEN_MAX));
 
-    return rv;
+    return ACVP_SUCCESS;
 }
 
-static ACVP_RESULT acvp_kdf135_ikev1_release_tc (ACVP_KDF135_IKEV1_TC *stc) {
+static void acvp_kdf135_ikev1_release_tc (void *tc_ptr) {
+    ACVP_KDF135_IKEV1_TC *stc = tc_ptr;
+
     if (stc->hash_alg) { free(stc->hash_alg); }
     if (stc->init_nonce) { free(stc->init_nonce); }
     if (stc->resp_nonce) { free(stc->resp_nonce); }
@@ -111,180 +162,22 @@ static ACVP_RESULT acvp_kdf135_ikev1_release_tc (ACVP_KDF135_IKEV1_TC *stc) {
     if (stc->s_key_id_d) { free(stc->s_key_id_d); }
     if (stc->s_key_id_a) { free(stc->s_key_id_a); }
     if (stc->s_key_id_e) { free(stc->s_key_id_e); }
-    return ACVP_SUCCESS;
+    memset(stc, 0x0, sizeof(ACVP_KDF135_IKEV1_TC));
 }
 
+static const ACVP_KDF135_OPS acvp_kdf135_ikev1_ops = {
+    ACVP_KDF135_IKEV1,
+    sizeof(ACVP_KDF135_IKEV1_TC),
+    sizeof(ACVP_KDF135_IKEV1_GROUP),
+    NULL,
+    0,
+    acvp_kdf135_ikev1_bind,
+    acvp_kdf135_ikev1_parse_group,
+    acvp_kdf135_ikev1_init_tc,
+    acvp_kdf135_ikev1_output_tc,
+    acvp_kdf135_ikev1_release_tc
+};
 
 ACVP_RESULT acvp_kdf135_ikev1_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
-    unsigned int tc_id;
-    JSON_Value *groupval;
-    JSON_Object *groupobj = NULL;
-    JSON_Value *testval;
-    JSON_Object *testobj = NULL;
-    JSON_Array *groups;
-    JSON_Array *tests;
-
-    JSON_Value *reg_arry_val = NULL;
-    JSON_Object *reg_obj = NULL;
-    JSON_Array *reg_arry = NULL;
-
-    int i, g_cnt;
-    int j, t_cnt;
-
-    JSON_Value *r_vs_val = NULL;
-    JSON_Object *r_vs = NULL;
-    JSON_Array *r_tarr = NULL; /* Response testarray */
-    JSON_Value *r_tval = NULL; /* Response testval */
-    JSON_Object *r_tobj = NULL; /* Response testobj */
-    ACVP_CAPS_LIST *cap;
-    ACVP_KDF135_IKEV1_TC stc;
-    ACVP_TEST_CASE tc;
-    ACVP_RESULT rv;
-    const char *alg_str = json_object_get_string(obj, "algorithm");
-    ACVP_CIPHER alg_id;
-    char *json_result;
-
-    unsigned char *hash_alg = NULL, *auth_method = NULL, *init_nonce = NULL, *resp_nonce = NULL;
-    unsigned char *init_ckey = NULL, *resp_ckey = NULL, *gxy = NULL, *psk = NULL;
-    int init_nonce_len = 0, resp_nonce_len = 0, dh_secret_len = 0, psk_len = 0;
-
-    if (!alg_str) {
-        ACVP_LOG_ERR("unable to parse 'algorithm' from JSON for KDF SSH.");
-        return (ACVP_MALFORMED_JSON);
-    }
-
-    /*
-     * Get a reference to the abstracted test case
-     */
-    tc.tc.kdf135_ikev1 = &stc;
-    alg_id = ACVP_KDF135_IKEV1;
-    stc.cipher = alg_id;
-
-    cap = acvp_locate_cap_entry(ctx, alg_id);
-    if (!cap) {
-        ACVP_LOG_ERR("ACVP server requesting unsupported capability %s : %d.", alg_str, alg_id);
-        return (ACVP_UNSUPPORTED_OP);
-    }
-
-    /*
-     * Create ACVP array for response
-     */
-    rv = acvp_create_array(&reg_obj, &reg_arry_val, &reg_arry);
-    if (rv != ACVP_SUCCESS) {
-        ACVP_LOG_ERR("Failed to create JSON response struct. ");
-        return (rv);
-    }
-
-    /*
-     * Start to build the JSON response
-     */
-    if (ctx->kat_resp) {
-        json_value_free(ctx->kat_resp);
-    }
-    ctx->kat_resp = reg_arry_val;
-    r_vs_val = json_value_init_object();
-    r_vs = json_value_get_object(r_vs_val);
-
-    json_object_set_number(r_vs, "vsId", ctx->vs_id);
-    json_object_set_string(r_vs, "algorithm", alg_str);
-    json_object_set_value(r_vs, "testResults", json_value_init_array());
-    r_tarr = json_object_get_array(r_vs, "testResults");
-
-    groups = json_object_get_array(obj, "testGroups");
-    g_cnt = json_array_get_count(groups);
-    for (i = 0; i < g_cnt; i++) {
-        groupval = json_array_get_value(groups, i);
-        groupobj = json_value_get_object(groupval);
-
-        hash_alg = (unsigned char *) json_object_get_string(groupobj, "hashAlg");
-        auth_method = (unsigned char *) json_object_get_string(groupobj, "authenticationMethod");
-        init_nonce_len = json_object_get_number(groupobj, "nInitLength");
-        resp_nonce_len = json_object_get_number(groupobj, "nRespLength");
-        dh_secret_len = json_object_get_number(groupobj, "dhLength");
-        psk_len = json_object_get_number(groupobj, "preSharedKeyLength");
-
-        ACVP_LOG_INFO("\n    Test group: %d", i);
-        ACVP_LOG_INFO("        hash alg: %s", hash_alg);
-        ACVP_LOG_INFO("     auth method: %s", auth_method);
-        ACVP_LOG_INFO("  init nonce len: %d", init_nonce_len);
-        ACVP_LOG_INFO("  resp nonce len: %d", resp_nonce_len);
-        ACVP_LOG_INFO("   dh secret len: %d", dh_secret_len);
-        ACVP_LOG_INFO("         psk len: %d", psk_len);
-
-        tests = json_object_get_array(groupobj, "tests");
-        t_cnt = json_array_get_count(tests);
-
-        for (j = 0; j < t_cnt; j++) {
-            ACVP_LOG_INFO("Found new KDF IKEv1 test vector...");
-            testval = json_array_get_value(tests, j);
-            testobj = json_value_get_object(testval);
-
-            tc_id = (unsigned int) json_object_get_number(testobj, "tcId");
-            init_nonce = (unsigned char *)json_object_get_string(testobj, "nInit");
-            resp_nonce = (unsigned char *)json_object_get_string(testobj, "nResp");
-            init_ckey = (unsigned char *)json_object_get_string(testobj, "ckyInit");
-            resp_ckey = (unsigned char *)json_object_get_string(testobj, "ckyResp");
-            gxy = (unsigned char *)json_object_get_string(testobj, "gxy");
-            psk = (unsigned char *)json_object_get_string(testobj, "preSharedKey");
-
-            ACVP_LOG_INFO("        Test case: %d", j);
-            ACVP_LOG_INFO("             tcId: %d", tc_id);
-
-            /*
-             * Create a new test case in the response
-             */
-            r_tval = json_value_init_object();
-            r_tobj = json_value_get_object(r_tval);
-
-            json_object_set_number(r_tobj, "tcId", tc_id);
-
-            /*
-             * Setup the test case data that will be passed down to
-             * the crypto module2
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
-             */
-            acvp_kdf135_ikev1_init_tc(ctx, &stc, tc_id, hash_alg, auth_method,
-                                      init_nonce_len, resp_nonce_len,
-                                      dh_secret_len, psk_len,
-                                      init_nonce, resp_nonce,
-                                      init_ckey, resp_ckey,
-                                      gxy, psk);
-
-            /* Process the current test vector... */
-            rv = (cap->crypto_handler)(&tc);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("crypto module failed the KDF IKEv1 operation");
-                return ACVP_CRYPTO_MODULE_FAIL;
-            }
-
-            /*
-             * Output the test case results using JSON
-            */
-            rv = acvp_kdf135_ikev1_output_tc(ctx, &stc, r_tobj);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("JSON output failure in hash module");
-                return rv;
-            }
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_kdf135_ikev1_release_tc(&stc);
-
-            /* Append the test response value to array */
-            json_array_append_value(r_tarr, r_tval);
-        }
-    }
-
-    json_array_append_value(reg_arry, r_vs_val);
-
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
-
-    return ACVP_SUCCESS;
+    return acvp_kdf135_kat_handler_internal(ctx, obj, &acvp_kdf135_ikev1_ops);
 }
@@ -32,173 +32,29 @@
 #include "parson.h"
 
 /*
- * Forward prototypes for local functions
+ * The settings shared by all the tests of a SNMP test group
  */
-static ACVP_RESULT acvp_kdf135_snmp_output_tc (ACVP_CTX *ctx, ACVP_KDF135_SNMP_TC *stc, JSON_Object *tc_rsp);
-
-static ACVP_RESULT acvp_kdf135_snmp_init_tc (ACVP_CTX *ctx,
-                                             ACVP_KDF135_SNMP_TC *stc,
-                                             unsigned int tc_id,
-                                             ACVP_CIPHER alg_id,
-                                             char *engine_id,
-                                             const char *password,
-                                             unsigned int p_len);
-
-static ACVP_RESULT acvp_kdf135_snmp_release_tc (ACVP_KDF135_SNMP_TC *stc);
-
-
-ACVP_RESULT acvp_kdf135_snmp_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
-    unsigned int tc_id;
-    JSON_Value *groupval;
-    JSON_Object *groupobj = NULL;
-    JSON_Value *testval;
-    JSON_Object *testobj = NULL;
-    JSON_Array *groups;
-    JSON_Array *tests;
-
-    JSON_Value *reg_arry_val = NULL;
-    JSON_Object *reg_obj = NULL;
-    JSON_Array *reg_arry = NULL;
-
-    int i, g_cnt;
-    int j, t_cnt;
-
-    JSON_Value *r_vs_val = NULL;
-    JSON_Object *r_vs = NULL;
-    JSON_Array *r_tarr = NULL; /* Response testarray */
-    JSON_Value *r_tval = NULL; /* Response testval */
-    JSON_Object *r_tobj = NULL; /* Response testobj */
-    ACVP_CAPS_LIST *cap;
-    ACVP_KDF135_SNMP_TC stc;
-    ACVP_TEST_CASE tc;
-    ACVP_RESULT rv;
-    const char *alg_str = json_object_get_string(obj, "algorithm");
-    ACVP_CIPHER alg_id;
-    const char *password = NULL;
-    const char *engine_id = NULL;
+typedef struct acvp_kdf135_snmp_group_t {
     unsigned int p_len;
-    char *json_result;
-
-    if (!alg_str) {
-        ACVP_LOG_ERR("unable to parse 'algorithm' from JSON");
-        return (ACVP_MALFORMED_JSON);
-    }
+    const char *engine_id;
+} ACVP_KDF135_SNMP_GROUP;
 
-    /*
-     * Get a reference to the abstracted test case
-     */
-    tc.tc.kdf135_snmp = &stc;
-    alg_id = ACVP_KDF135_SNMP;
-    stc.cipher = alg_id;
-    
-    cap = acvp_locate_cap_entry(ctx, alg_id);
-    if (!cap) {
-        ACVP_LOG_ERR("ACVP server requesting unsupported capability");
-        return (ACVP_UNSUPPORTED_OP);
-    }
+static void acvp_kdf135_snmp_bind (ACVP_TEST_CASE *tc, void *stc) {
+    tc->tc.kdf135_snmp = stc;
+}
 
-    /*
-     * Create ACVP array for response
-     */
-    rv = acvp_create_array(&reg_obj, &reg_arry_val, &reg_arry);
-    if (rv != ACVP_SUCCESS) {
-        ACVP_LOG_ERR("Failed to create JSON response struct. ");
-        return (rv);
-    }
+static ACVP_RESULT acvp_kdf135_snmp_parse_group (ACVP_CTX *ctx, JSON_Object *groupobj, void *group_ptr) {
+    ACVP_KDF135_SNMP_GROUP *group = group_ptr;
 
-    /*
-     * Start to build the JSON response
-     */
-    if (ctx->kat_resp) {
-        json_value_free(ctx->kat_resp);
-    }
-    ctx->kat_resp = reg_arry_val;
-    r_vs_val = json_value_init_object();
-    r_vs = json_value_get_object(r_vs_val);
-
-    json_object_set_number(r_vs, "vsId", ctx->vs_id);
-    json_object_set_string(r_vs, "algorithm", alg_str);
-    json_object_set_value(r_vs, "testResults", json_value_init_array());
-    r_tarr = json_object_get_array(r_vs, "testResults");
-
-    groups = json_object_get_array(obj, "testGroups");
-    g_cnt = json_array_get_count(groups);
-    for (i = 0; i < g_cnt; i++) {
-        groupval = json_array_get_value(groups, i);
-        groupobj = json_value_get_object(groupval);
-
-
-        p_len = (unsigned int) json_object_get_number(groupobj, "passwordLength");
-        engine_id = json_object_get_string(groupobj, "engineId");
-
-        ACVP_LOG_INFO("    Test group: %d", i);
-        ACVP_LOG_INFO("          pLen: %d", p_len);
-        ACVP_LOG_INFO("      engineID: %s", engine_id);
-
-        tests = json_object_get_array(groupobj, "tests");
-        t_cnt = json_array_get_count(tests);
-        for (j = 0; j < t_cnt; j++) {
-            ACVP_LOG_INFO("Found new hash test vector...");
-            testval = json_array_get_value(tests, j);
-            testobj = json_value_get_object(testval);
-
-            tc_id = (unsigned int) json_object_get_number(testobj, "tcId");
-            password = json_object_get_string(testobj, "password");
-
-            ACVP_LOG_INFO("        Test case: %d", j);
-            ACVP_LOG_INFO("             tcId: %d", tc_id);
-            ACVP_LOG_INFO("         password: %s", password);
-
-            /*
-             * Create a new test case in the response
-             */
-            r_tval = json_value_init_object();
-            r_tobj = json_value_get_object(r_tval);
-
-            json_object_set_number(r_tobj, "tcId", tc_id);
-
-            /*
-             * Setup the test case data that will be passed down to
-             * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
-             */
-            acvp_kdf135_snmp_init_tc(ctx, &stc, tc_id, alg_id, engine_id, password, p_len);
-
-            /* Process the current test vector... */
-            rv = (cap->crypto_handler)(&tc);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("crypto module failed the operation");
-                return ACVP_CRYPTO_MODULE_FAIL;
-            }
-
-            /*
-             * Output the test case results using JSON
-            */
-            rv = acvp_kdf135_snmp_output_tc(ctx, &stc, r_tobj);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("JSON output failure in hash module");
-                return rv;
-            }
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_kdf135_snmp_release_tc(&stc);
-
-            /* Append the test response value to array */
-            json_array_append_value(r_tarr, r_tval);
-        }
+    group->p_len = (unsigned int) json_object_get_number(groupobj, "passwordLength");
+    group->engine_id = json_object_get_string(groupobj, "engineId");
+    if (!group->engine_id) {
+        ACVP_LOG_ERR("Missing engineId in SNMP test group");
+        return ACVP_MALFORMED_JSON;
     }
 
-    json_array_append_value(reg_arry, r_vs_val);
-
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
+    ACVP_LOG_INFO("          pLen: %d", group->p_len);
+    ACVP_LOG_INFO("      engineID: %s", group->engine_id);
 
     return ACVP_SUCCESS;
 }
@@ -209,28 +65,36 @@ ACVP_RESULT acvp_kdf135_snmp_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
  * file that will be uploaded to the server.  This routine handles
  * the JSON processing for a single test case.
  */
-static ACVP_RESULT acvp_kdf135_snmp_output_tc (ACVP_CTX *ctx, ACVP_KDF135_SNMP_TC *stc, JSON_Object *tc_rsp) {
-    json_object_set_string(tc_rsp, "sharedKey", stc->s_key);
+static ACVP_RESULT acvp_kdf135_snmp_output_tc (ACVP_CTX *ctx, void *tc_ptr, JSON_Object *tc_rsp) {
+    ACVP_KDF135_SNMP_TC *stc = tc_ptr;
+
+    json_object_set_string(tc_rsp, "sharedKey", (const char *)stc->s_key);
     return ACVP_SUCCESS;
 }
 
-static ACVP_RESULT acvp_kdf135_snmp_init_tc (ACVP_CTX *ctx,
-                                             ACVP_KDF135_SNMP_TC *stc,
-                                             unsigned int tc_id,
-                                             ACVP_CIPHER alg_id,
-                                             char *engine_id,
-                                             const char *password,
-                                             unsigned int p_len) {
+static ACVP_RESULT acvp_kdf135_snmp_init_tc (ACVP_CTX *ctx, void *tc_ptr, void *group_ptr,
+                                             JSON_Object *testobj, unsigned int tc_id) {
+    ACVP_KDF135_SNMP_TC *stc = tc_ptr;
+    ACVP_KDF135_SNMP_GROUP *group = group_ptr;
+    const char *password = json_object_get_string(testobj, "password");
+
     memset(stc, 0x0, sizeof(ACVP_KDF135_SNMP_TC));
 
+    if (!password) {
+        ACVP_LOG_ERR("Missing parameters - initalize KDF SNMP test case");
+        return ACVP_MALFORMED_JSON;
+    }
+
+    ACVP_LOG_INFO("         password: %s", password);
+
     stc->s_key = calloc(ACVP_KDF135_SNMP_SKEY_MAX*2, sizeof(char));
     if (!stc->s_key) { return ACVP_MALLOC_FAIL; }
     
     stc->tc_id = tc_id;
-    stc->cipher = alg_id;
-    stc->p_len = p_len;
+    stc->cipher = ACVP_KDF135_SNMP;
+    stc->p_len = group->p_len;
     stc->password = password;
-    stc->engine_id = engine_id;
+    stc->engine_id = (char *)group->engine_id;
 
     return ACVP_SUCCESS;
 }
@@ -239,9 +103,27 @@ static ACVP_RESULT acvp_kdf135_snmp_init_tc (ACVP_CTX *ctx,
  * This function simply releases the data associated with
  * a test case.
  */
-static ACVP_RESULT acvp_kdf135_snmp_release_tc (ACVP_KDF135_SNMP_TC *stc) {
+static void acvp_kdf135_snmp_release_tc (void *tc_ptr) {
+    ACVP_KDF135_SNMP_TC *stc = tc_ptr;
+
     free(stc->s_key);
 
     memset(stc, 0x0, sizeof(ACVP_KDF135_SNMP_TC));
-    return ACVP_SUCCESS;
+}
+
+static const ACVP_KDF135_OPS acvp_kdf135_snmp_ops = {
+    ACVP_KDF135_SNMP,
+    sizeof(ACVP_KDF135_SNMP_TC),
+    sizeof(ACVP_KDF135_SNMP_GROUP),
+    NULL,
+    0,
+    acvp_kdf135_snmp_bind,
+    acvp_kdf135_snmp_parse_group,
+    acvp_kdf135_snmp_init_tc,
+    acvp_kdf135_snmp_output_tc,
+    acvp_kdf135_snmp_release_tc
+};
+
+ACVP_RESULT acvp_kdf135_snmp_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
+    return acvp_kdf135_kat_handler_internal(ctx, obj, &acvp_kdf135_snmp_ops);
 }
@@ -31,13 +31,39 @@
 #include "acvp_lcl.h"
 #include "parson.h"
 
+/*
+ * The settings shared by all the tests of a SRTP test group
+ */
+typedef struct acvp_kdf135_srtp_group_t {
+    int aes_keylen;
+    unsigned char *kdr;
+} ACVP_KDF135_SRTP_GROUP;
+
+static void acvp_kdf135_srtp_bind (ACVP_TEST_CASE *tc, void *stc) {
+    tc->tc.kdf135_srtp = stc;
+}
+
+static ACVP_RESULT acvp_kdf135_srtp_parse_group (ACVP_CTX *ctx, JSON_Object *groupobj, void *group_ptr) {
+    ACVP_KDF135_SRTP_GROUP *group = group_ptr;
+
+    group->aes_keylen = (unsigned int) json_object_get_number(groupobj, "aesKeyLength");
+    group->kdr = (unsigned char *)json_object_get_string(groupobj, "kdr");
+
+    ACVP_LOG_INFO("           kdr: %s", group->kdr);
+    ACVP_LOG_INFO("    key length: %d", group->aes_keylen);
+
+    return ACVP_SUCCESS;
+}
+
 /*
  * After the test case has been processed by the DUT, the results
  * need to be JSON formated to be included in the vector set results
  * file that will be uploaded to the server.  This routine handles
  * the JSON processing for a single test case.
  */
-static ACVP_RESULT acvp_kdf135_srtp_output_tc (ACVP_CTX *ctx, ACVP_KDF135_SRTP_TC *stc, JSON_Object *tc_rsp) {
+static ACVP_RESULT acvp_kdf135_srtp_output_tc (ACVP_CTX *ctx, void *tc_ptr, JSON_Object *tc_rsp) {
+    ACVP_KDF135_SRTP_TC *stc = tc_ptr;
+
     json_object_set_string(tc_rsp, "srtpKe", (const char *)stc->srtp_ke);
     json_object_set_string(tc_rsp, "srtpKa", (const char *)stc->srtp_ka);
     json_object_set_string(tc_rsp, "srtpKs", (const char *)stc->srtp_ks);
@@ -50,7 +76,9 @@ static ACVP_RESULT acvp_kdf135_srtp_output_tc (ACVP_CTX *ctx, ACVP_KDF135_SRTP_T
  * This function simply releases the data associated with
  * a test case.
  */
-static ACVP_RESULT acvp_kdf135_srtp_release_tc (ACVP_KDF135_SRTP_TC *stc) {
+static void acvp_kdf135_srtp_release_tc (void *tc_ptr) {
+    ACVP_KDF135_SRTP_TC *stc = tc_ptr;
+
     free(stc->kdr);
     free(stc->master_key);
     free(stc->master_salt);
@@ -62,18 +90,19 @@ static ACVP_RESULT acvp_kdf135_srtp_release_tc (ACVP_KDF135_SRTP_TC *stc) {
     free(stc->srtcp_ke);
     free(stc->srtcp_ka);
     free(stc->srtcp_ks);
-    return ACVP_SUCCESS;
+    memset(stc, 0x0, sizeof(ACVP_KDF135_SRTP_TC));
 }
 
-static ACVP_RESULT acvp_kdf135_srtp_init_tc (ACVP_CTX *ctx,
-                                             ACVP_KDF135_SRTP_TC *stc,
-                                             unsigned int tc_id,
-                                             int aes_keylen,
-                                             unsigned char *kdr,
-                                             unsigned char *master_key,
-                                             unsigned char *master_salt,
-                                             unsigned char *index,
-                                             unsigned char *srtcp_index) {
+static ACVP_RESULT acvp_kdf135_srtp_init_tc (ACVP_CTX *ctx, void *tc_ptr, void *group_ptr,
+                                             JSON_Object *testobj, unsigned int tc_id) {
+    ACVP_KDF135_SRTP_TC *stc = tc_ptr;
+    ACVP_KDF135_SRTP_GROUP *group = group_ptr;
+    unsigned char *kdr = group->kdr;
+    unsigned char *master_key = (unsigned char *)json_object_get_string(testobj, "masterKey");
+    unsigned char *master_salt = (unsigned char *)json_object_get_string(testobj, "masterSalt");
+    unsigned char *index = (unsigned char *)json_object_get_string(testobj, "index");
+    unsigned char *srtcp_index = (unsigned char *)json_object_get_string(testobj, "srtcpIndex");
+
     memset(stc, 0x0, sizeof(ACVP_KDF135_SRTP_TC));
     
     if (!kdr || !master_key || !master_salt || !index || !srtcp_index) {
@@ -81,8 +110,14 @@ static ACVP_RESULT acvp_kdf135_srtp_init_tc (ACVP_CTX *ctx,
         return ACVP_INVALID_ARG;
     }
     
+    ACVP_LOG_INFO("        masterKey: %s", master_key);
+    ACVP_LOG_INFO("       masterSalt: %s", master_salt);
+    ACVP_LOG_INFO("            index: %s", index);
+    ACVP_LOG_INFO("       srtcpIndex: %s", srtcp_index);
+
     stc->tc_id = tc_id;
-    stc->aes_keylen = aes_keylen;
+    stc->cipher = ACVP_KDF135_SRTP;
+    stc->aes_keylen = group->aes_keylen;
     
     stc->kdr = calloc(ACVP_KDF135_SRTP_KDR_STR_MAX, sizeof(char));
     if (!stc->kdr) { return ACVP_MALLOC_FAIL; }
@@ -117,164 +152,19 @@ static ACVP_RESULT acvp_kdf135_srtp_init_tc (ACVP_CTX *ctx,
     return ACVP_SUCCESS;
 }
 
+static const ACVP_KDF135_OPS acvp_kdf135_srtp_ops = {
+    ACVP_KDF135_SRTP,
+    sizeof(ACVP_KDF135_SRTP_TC),
+    sizeof(ACVP_KDF135_SRTP_GROUP),
+    NULL,
+    1,
+    acvp_kdf135_srtp_bind,
+    acvp_kdf135_srtp_parse_group,
+    acvp_kdf135_srtp_init_tc,
+    acvp_kdf135_srtp_output_tc,
+    acvp_kdf135_srtp_release_tc
+};
+
 ACVP_RESULT acvp_kdf135_srtp_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
-    unsigned int tc_id;
-    JSON_Value *groupval;
-    JSON_Object *groupobj = NULL;
-    JSON_Value *testval;
-    JSON_Object *testobj = NULL;
-    JSON_Array *groups;
-    JSON_Array *tests;
-    
-    JSON_Value *reg_arry_val = NULL;
-    JSON_Object *reg_obj = NULL;
-    JSON_Array *reg_arry = NULL;
-    
-    int i, g_cnt;
-    int j, t_cnt;
-    
-    JSON_Value *r_vs_val = NULL;
-    JSON_Object *r_vs = NULL;
-    JSON_Array *r_tarr = NULL; /* Response testarray */
-    JSON_Value *r_tval = NULL; /* Response testval */
-    JSON_Object *r_tobj = NULL; /* Response testobj */
-    ACVP_CAPS_LIST *cap;
-    ACVP_KDF135_SRTP_TC stc;
-    ACVP_TEST_CASE tc;
-    ACVP_RESULT rv;
-    const char *alg_str = json_object_get_string(obj, "algorithm");
-    ACVP_CIPHER alg_id;
-    char *json_result;
-    
-    int aes_key_length;
-    unsigned char *kdr = NULL, *master_key = NULL, *master_salt = NULL, *index = NULL, *srtcp_index = NULL;
-    
-    if (!alg_str) {
-        ACVP_LOG_ERR("unable to parse 'algorithm' from JSON for KDF SSH.");
-        return (ACVP_MALFORMED_JSON);
-    }
-    
-    /*
-     * Get a reference to the abstracted test case
-     */
-    tc.tc.kdf135_srtp = &stc;
-    alg_id = ACVP_KDF135_SRTP;
-    stc.cipher = alg_id;
-    
-    cap = acvp_locate_cap_entry(ctx, alg_id);
-    if (!cap) {
-        ACVP_LOG_ERR("ACVP server requesting unsupported capability %s : %d.", alg_str, alg_id);
-        return (ACVP_UNSUPPORTED_OP);
-    }
-    
-    /*
-     * Create ACVP array for response
-     */
-    rv = acvp_create_array(&reg_obj, &reg_arry_val, &reg_arry);
-    if (rv != ACVP_SUCCESS) {
-        ACVP_LOG_ERR("Failed to create JSON response struct. ");
-        return (rv);
-    }
-    
-    /*
-     * Start to build the JSON response
-     */
-    if (ctx->kat_resp) {
-        json_value_free(ctx->kat_resp);
-    }
-    ctx->kat_resp = reg_arry_val;
-    r_vs_val = json_value_init_object();
-    r_vs = json_value_get_object(r_vs_val);
-    
-    json_object_set_number(r_vs, "vsId", ctx->vs_id);
-    json_object_set_string(r_vs, "algorithm", alg_str);
-    json_object_set_value(r_vs, "testResults", json_value_init_array());
-    r_tarr = json_object_get_array(r_vs, "testResults");
-    
-    groups = json_object_get_array(obj, "testGroups");
-    g_cnt = json_array_get_count(groups);
-    for (i = 0; i < g_cnt; i++) {
-        groupval = json_array_get_value(groups, i);
-        groupobj = json_value_get_object(groupval);
-        
-        aes_key_length = (unsigned int) json_object_get_number(groupobj, "aesKeyLength");
-        kdr = (unsigned char *)json_object_get_string(groupobj, "kdr");
-        
-        ACVP_LOG_INFO("\n    Test group: %d", i);
-        ACVP_LOG_INFO("           kdr: %s", kdr);
-        ACVP_LOG_INFO("    key length: %d", aes_key_length);
-        
-        tests = json_object_get_array(groupobj, "tests");
-        t_cnt = json_array_get_count(tests);
-        
-        for (j = 0; j < t_cnt; j++) {
-            ACVP_LOG_INFO("Found new KDF SRTP test vector...");
-            testval = json_array_get_value(tests, j);
-            testobj = json_value_get_object(testval);
-            
-            tc_id = (unsigned int) json_object_get_number(testobj, "tcId");
-            master_key = (unsigned char *)json_object_get_string(testobj, "masterKey");
-            master_salt = (unsigned char *)json_object_get_string(testobj, "masterSalt");
-            index = (unsigned char *)json_object_get_string(testobj, "index");
-            srtcp_index = (unsigned char *)json_object_get_string(testobj, "srtcpIndex");
-            
-            ACVP_LOG_INFO("        Test case: %d", j);
-            ACVP_LOG_INFO("             tcId: %d", tc_id);
-            ACVP_LOG_INFO("        masterKey: %s", master_key);
-            ACVP_LOG_INFO("       masterSalt: %s", master_salt);
-            ACVP_LOG_INFO("            index: %s", index);
-            ACVP_LOG_INFO("       srtcpIndex: %s", srtcp_index);
-            
-            /*
-             * Create a new test case in the response
-             */
-            r_tval = json_value_init_object();
-            r_tobj = json_value_get_object(r_tval);
-            
-            json_object_set_number(r_tobj, "tcId", tc_id);
-            
-            /*
-             * Setup the test case data that will be passed down to
-             * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
-             */
-            acvp_kdf135_srtp_init_tc(ctx, &stc, tc_id, aes_key_length, kdr, master_key, master_salt, index, srtcp_index);
-            
-            /* Process the current test vector... */
-            rv = (cap->crypto_handler)(&tc);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("crypto module failed the KDF SSH operation");
-                return ACVP_CRYPTO_MODULE_FAIL;
-            }
-            
-            /*
-             * Output the test case results using JSON
-            */
-            rv = acvp_kdf135_srtp_output_tc(ctx, &stc, r_tobj);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("JSON output failure in hash module");
-                return rv;
-            }
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_kdf135_srtp_release_tc(&stc);
-            
-            /* Append the test response value to array */
-            json_array_append_value(r_tarr, r_tval);
-        }
-    }
-    
-    json_array_append_value(reg_arry, r_vs_val);
-    
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
-    
-    return ACVP_SUCCESS;
+    return acvp_kdf135_kat_handler_internal(ctx, obj, &acvp_kdf135_srtp_ops);
 }
@@ -32,254 +32,79 @@
 #include "parson.h"
 
 /*
- * Forward prototypes for local functions
+ * The settings shared by all the tests of a SSH test group
  */
-static ACVP_RESULT acvp_kdf135_ssh_output_tc (ACVP_CTX *ctx, ACVP_KDF135_SSH_TC *stc,
-                                              JSON_Object *tc_rsp);
-
-static ACVP_RESULT acvp_kdf135_ssh_init_tc (ACVP_CTX *ctx,
-                                            ACVP_KDF135_SSH_TC *stc,
-                                            unsigned int tc_id,
-                                            ACVP_CIPHER alg_id,
-                                            unsigned int sha_type,
-                                            unsigned int e_key_len,
-                                            unsigned int i_key_len,
-                                            unsigned int iv_len,
-                                            unsigned int hash_len,
-                                            const char *shared_secret_k,
-                                            const char *hash_h,
-                                            const char *session_id);
-
-static ACVP_RESULT acvp_kdf135_ssh_release_tc (ACVP_KDF135_SSH_TC *stc);
-
-
-ACVP_RESULT acvp_kdf135_ssh_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
-    unsigned int tc_id;
-    JSON_Value *groupval;
-    JSON_Object *groupobj = NULL;
-    JSON_Value *testval;
-    JSON_Object *testobj = NULL;
-    JSON_Array *groups;
-    JSON_Array *tests;
-
-    JSON_Value *reg_arry_val = NULL;
-    JSON_Object *reg_obj = NULL;
-    JSON_Array *reg_arry = NULL;
-
-    int i, g_cnt;
-    int j, t_cnt;
-
-    JSON_Value *r_vs_val = NULL;
-    JSON_Object *r_vs = NULL;
-    JSON_Array *r_tarr = NULL; /* Response testarray */
-    JSON_Value *r_tval = NULL; /* Response testval */
-    JSON_Object *r_tobj = NULL; /* Response testobj */
-    ACVP_CAPS_LIST *cap;
-    ACVP_KDF135_SSH_TC stc;
-    ACVP_TEST_CASE tc;
-    ACVP_RESULT rv;
-
-    ACVP_CIPHER alg_id;
+typedef struct acvp_kdf135_ssh_group_t {
+    unsigned int sha_type;
     unsigned int e_key_len;
     unsigned int i_key_len;
     unsigned int iv_len;
     unsigned int hash_len;
-    unsigned int sha_type;
-    const char *alg_str = NULL;
-    const char *mode_str = NULL;
-    const char *sha_str = NULL;
-    const char *cipher_str = NULL;
-    const char *shared_secret_str = NULL;
-    const char *session_id_str = NULL;
-    const char *hash_str = NULL;
-    char *json_result;
-
-    alg_str = json_object_get_string(obj, "algorithm");
-    if (!alg_str) {
-        ACVP_LOG_ERR("unable to parse 'algorithm' from JSON");
-        return (ACVP_MALFORMED_JSON);
-    }
+} ACVP_KDF135_SSH_GROUP;
 
-    mode_str = json_object_get_string(obj, "mode");
-    if (!mode_str) {
-        ACVP_LOG_ERR("unable to parse 'mode' from JSON");
-        return (ACVP_MALFORMED_JSON);
-    }
+static void acvp_kdf135_ssh_bind (ACVP_TEST_CASE *tc, void *stc) {
+    tc->tc.kdf135_ssh = stc;
+}
 
-    /*
-     * Get a reference to the abstracted test case
-     */
-    tc.tc.kdf135_ssh = &stc;
+static ACVP_RESULT acvp_kdf135_ssh_parse_group (ACVP_CTX *ctx, JSON_Object *groupobj, void *group_ptr) {
+    ACVP_KDF135_SSH_GROUP *group = group_ptr;
+    const char *sha_str = NULL;
+    const char *cipher_str = NULL;
 
-    /*
-     * Get the crypto module handler for this hash algorithm
-     */
-    alg_id = ACVP_KDF135_SSH;
-    if (alg_id < ACVP_CIPHER_START) {
-        ACVP_LOG_ERR("unsupported algorithm (%s)", alg_str);
-        return (ACVP_UNSUPPORTED_OP);
-    }
-    cap = acvp_locate_cap_entry(ctx, alg_id);
-    if (!cap) {
-        ACVP_LOG_ERR("ACVP server requesting unsupported capability %s : %d.", alg_str, alg_id);
-        return (ACVP_UNSUPPORTED_OP);
+    // Get the expected (user will generate) key and iv lengths
+    cipher_str = json_object_get_string(groupobj, "cipher");
+    sha_str = json_object_get_string(groupobj, "hashAlg");
+    if (!cipher_str || !sha_str) {
+        ACVP_LOG_ERR("Missing cipher or hashAlg in SSH test group");
+        return ACVP_MALFORMED_JSON;
     }
 
     /*
-     * Create ACVP array for response
+     * Determine the encrypt key_len, inferred from cipher.
      */
-    rv = acvp_create_array(&reg_obj, &reg_arry_val, &reg_arry);
-    if (rv != ACVP_SUCCESS) {
-        ACVP_LOG_ERR("Failed to create JSON response struct. ");
-        return (rv);
+    if (!strncmp(cipher_str, "TDES", 4)) {
+        group->e_key_len = ACVP_KEY_LEN_TDES;
+        group->iv_len = ACVP_BLOCK_LEN_TDES;
+    } else if (!strncmp(cipher_str, "AES-128", 7)) {
+        group->e_key_len = ACVP_KEY_LEN_AES128;
+        group->iv_len = ACVP_BLOCK_LEN_AES128;
+    } else if (!strncmp(cipher_str, "AES-192", 7)) {
+        group->e_key_len = ACVP_KEY_LEN_AES192;
+        group->iv_len = ACVP_BLOCK_LEN_AES192;
+    } else if (!strncmp(cipher_str, "AES-256", 7)) {
+        group->e_key_len = ACVP_KEY_LEN_AES256;
+        group->iv_len = ACVP_BLOCK_LEN_AES256;
+    } else {
+        ACVP_LOG_ERR("Unsupported cipher type");
+        return ACVP_NO_CAP;
     }
 
     /*
-     * Start to build the JSON response
+     * Determine the sha mode to operate.
+     * Also infer the hash_len and integrity key_len.
      */
-    if (ctx->kat_resp) {
-        json_value_free(ctx->kat_resp);
-    }
-    ctx->kat_resp = reg_arry_val;
-    r_vs_val = json_value_init_object();
-    r_vs = json_value_get_object(r_vs_val);
-
-    json_object_set_number(r_vs, "vsId", ctx->vs_id);
-    json_object_set_string(r_vs, "algorithm", alg_str);
-    json_object_set_value(r_vs, "testResults", json_value_init_array());
-    r_tarr = json_object_get_array(r_vs, "testResults");
-
-    groups = json_object_get_array(obj, "testGroups");
-    g_cnt = json_array_get_count(groups);
-    for (i = 0; i < g_cnt; i++) {
-        groupval = json_array_get_value(groups, i);
-        groupobj = json_value_get_object(groupval);
-
-        // Get the expected (user will generate) key and iv lengths
-        cipher_str = json_object_get_string(groupobj, "cipher");
-        sha_str = json_object_get_string(groupobj, "hashAlg");
-
-        /*
-         * Determine the encrypt key_len, inferred from cipher.
-         */
-        if (!strncmp(cipher_str, "TDES", 4)) {
-            e_key_len = ACVP_KEY_LEN_TDES;
-            iv_len = ACVP_BLOCK_LEN_TDES;
-        } else if (!strncmp(cipher_str, "AES-128", 7)) {
-            e_key_len = ACVP_KEY_LEN_AES128;
-            iv_len = ACVP_BLOCK_LEN_AES128;
-        } else if (!strncmp(cipher_str, "AES-192", 7)) {
-            e_key_len = ACVP_KEY_LEN_AES192;
-            iv_len = ACVP_BLOCK_LEN_AES192;
-        } else if (!strncmp(cipher_str, "AES-256", 7)) {
-            e_key_len = ACVP_KEY_LEN_AES256;
-            iv_len = ACVP_BLOCK_LEN_AES256;
-        } else {
-            ACVP_LOG_ERR("Unsupported cipher type");
-            return ACVP_NO_CAP;
-        }
-
-        /*
-         * Determine the sha mode to operate.
-         * Also infer the hash_len and integrity key_len.
-         */
-        if (!strncmp(sha_str, "SHA-1", 5)) {
-            sha_type = ACVP_KDF135_SSH_CAP_SHA1;
-            i_key_len = hash_len = ACVP_BYTE_LEN_HMAC_SHA1;
-        } else if (!strncmp(sha_str, "SHA2-224", 8)) {
-            sha_type = ACVP_KDF135_SSH_CAP_SHA224;
-            i_key_len = hash_len = ACVP_BYTE_LEN_HMAC_SHA224;
-        } else if (!strncmp(sha_str, "SHA2-256", 8)) {
-            sha_type = ACVP_KDF135_SSH_CAP_SHA256;
-            i_key_len = hash_len = ACVP_BYTE_LEN_HMAC_SHA256;
-        } else if (!strncmp(sha_str, "SHA2-384", 8)) {
-            sha_type = ACVP_KDF135_SSH_CAP_SHA384;
-            i_key_len = hash_len = ACVP_BYTE_LEN_HMAC_SHA384;
-        } else if (!strncmp(sha_str, "SHA2-512", 8)) {
-            sha_type = ACVP_KDF135_SSH_CAP_SHA512;
-            i_key_len = hash_len = ACVP_BYTE_LEN_HMAC_SHA512;
-        } else {
-            ACVP_LOG_ERR("Unsupported sha type");
-            return ACVP_NO_CAP;
-        }
-
-        /*
-         * Log Test Group information...
-         */
-        ACVP_LOG_INFO("    Test group: %d", i);
-        ACVP_LOG_INFO("        cipher: %s", cipher_str);
-        ACVP_LOG_INFO("       hashAlg: %s", sha_str);
-
-        tests = json_object_get_array(groupobj, "tests");
-        t_cnt = json_array_get_count(tests);
-        for (j = 0; j < t_cnt; j++) {
-            ACVP_LOG_INFO("Found new KDF SSH test vector...");
-            testval = json_array_get_value(tests, j);
-            testobj = json_value_get_object(testval);
-
-            tc_id = (unsigned int) json_object_get_number(testobj, "tcId");
-            shared_secret_str = json_object_get_string(testobj, "k");
-            hash_str = json_object_get_string(testobj, "h");
-            session_id_str = json_object_get_string(testobj, "sessionId");
-
-            ACVP_LOG_INFO("        Test case: %d", j);
-            ACVP_LOG_INFO("             tcId: %d", tc_id);
-            ACVP_LOG_INFO("                k: %s", shared_secret_str);
-            ACVP_LOG_INFO("                h: %s", hash_str);
-            ACVP_LOG_INFO("       session_id: %s", session_id_str);
-
-            /*
-             * Create a new test case in the response
-             */
-            r_tval = json_value_init_object();
-            r_tobj = json_value_get_object(r_tval);
-
-            json_object_set_number(r_tobj, "tcId", tc_id);
-
-            /*
-             * Setup the test case data that will be passed down to
-             * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
-             */
-            acvp_kdf135_ssh_init_tc(ctx, &stc, tc_id, alg_id,
-                                    sha_type, e_key_len, i_key_len, iv_len, hash_len,
-                                    shared_secret_str, hash_str, session_id_str);
-
-            /* Process the current test vector... */
-            rv = (cap->crypto_handler)(&tc);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("crypto module failed the KDF SSH operation");
-                return ACVP_CRYPTO_MODULE_FAIL;
-            }
-
-            /*
-             * Output the test case results using JSON
-            */
-            rv = acvp_kdf135_ssh_output_tc(ctx, &stc, r_tobj);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("JSON output failure in hash module");
-                return rv;
-            }
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_kdf135_ssh_release_tc(&stc);
-
-            /* Append the test response value to array */
-            json_array_append_value(r_tarr, r_tval);
-        }
-    }
-
-    json_array_append_value(reg_arry, r_vs_val);
-
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
+    if (!strncmp(sha_str, "SHA-1", 5)) {
+        group->sha_type = ACVP_KDF135_SSH_CAP_SHA1;
+        group->i_key_len = group->hash_len = ACVP_BYTE_LEN_HMAC_SHA1;
+    } else if (!strncmp(sha_str, "SHA2-224", 8)) {
+        group->sha_type = ACVP_KDF135_SSH_CAP_SHA224;
+        group->i_key_len = group->hash_len = ACVP_BYTE_LEN_HMAC_SHA224;
+    } else if (!strncmp(sha_str, "SHA2-256", 8)) {
+        group->sha_type = ACVP_KDF135_SSH_CAP_SHA256;
+        group->i_key_len = group->hash_len = ACVP_BYTE_LEN_HMAC_SHA256;
+    } else if (!strncmp(sha_str, "SHA2-384", 8)) {
+        group->sha_type = ACVP_KDF135_SSH_CAP_SHA384;
+        group->i_key_len = group->hash_len = ACVP_BYTE_LEN_HMAC_SHA384;
+    } else if (!strncmp(sha_str, "SHA2-512", 8)) {
+        group->sha_type = ACVP_KDF135_SSH_CAP_SHA512;
+        group->i_key_len = group->hash_len = ACVP_BYTE_LEN_HMAC_SHA512;
     } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        ACVP_LOG_ERR("Unsupported sha type");
+        return ACVP_NO_CAP;
     }
-    json_free_serialized_string(json_result);
+
+    ACVP_LOG_INFO("        cipher: %s", cipher_str);
+    ACVP_LOG_INFO("       hashAlg: %s", sha_str);
 
     return ACVP_SUCCESS;
 }
@@ -290,11 +115,10 @@ ACVP_RESULT acvp_kdf135_ssh_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
  * file that will be uploaded to the server.  This routine handles
  * the JSON processing for a single test case.
  */
-static ACVP_RESULT acvp_kdf135_ssh_output_tc (ACVP_CTX *ctx,
-                                              ACVP_KDF135_SSH_TC *stc,
-                                              JSON_Object *tc_rsp) {
+static ACVP_RESULT acvp_kdf135_ssh_output_tc (ACVP_CTX *ctx, void *tc_ptr, JSON_Object *tc_rsp) {
+    ACVP_KDF135_SSH_TC *stc = tc_ptr;
     char *tmp = NULL;
-    int rv = 0;
+    ACVP_RESULT rv;
 
     if ((stc->iv_len * 2) > ACVP_KDF135_SSH_STR_OUT_MAX ||
         (stc->e_key_len * 2) > ACVP_KDF135_SSH_STR_OUT_MAX ||
@@ -316,7 +140,7 @@ static ACVP_RESULT acvp_kdf135_ssh_output_tc (ACVP_CTX *ctx,
                             stc->iv_len, (unsigned char *)tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("acvp_bin_to_hexstr() failure");
-        return rv;
+        goto end;
     }
     json_object_set_string(tc_rsp, "initialIvClient", tmp);
     memset(tmp, 0, ACVP_KDF135_SSH_STR_OUT_MAX);
@@ -325,7 +149,7 @@ static ACVP_RESULT acvp_kdf135_ssh_output_tc (ACVP_CTX *ctx,
                             stc->e_key_len, (unsigned char *)tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("acvp_bin_to_hexstr() failure");
-        return rv;
+        goto end;
     }
     json_object_set_string(tc_rsp, "encryptionKeyClient", tmp);
     memset(tmp, 0, ACVP_KDF135_SSH_STR_OUT_MAX);
@@ -334,7 +158,7 @@ static ACVP_RESULT acvp_kdf135_ssh_output_tc (ACVP_CTX *ctx,
                             stc->i_key_len, (unsigned char *)tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("acvp_bin_to_hexstr() failure");
-        return rv;
+        goto end;
     }
     json_object_set_string(tc_rsp, "integrityKeyClient", tmp);
     memset(tmp, 0, ACVP_KDF135_SSH_STR_OUT_MAX);
@@ -343,7 +167,7 @@ static ACVP_RESULT acvp_kdf135_ssh_output_tc (ACVP_CTX *ctx,
                             stc->iv_len, (unsigned char *)tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("acvp_bin_to_hexstr() failure");
-        return rv;
+        goto end;
     }
     json_object_set_string(tc_rsp, "initialIvServer", tmp);
     memset(tmp, 0, ACVP_KDF135_SSH_STR_OUT_MAX);
@@ -352,7 +176,7 @@ static ACVP_RESULT acvp_kdf135_ssh_output_tc (ACVP_CTX *ctx,
                             stc->e_key_len, (unsigned char *)tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("acvp_bin_to_hexstr() failure");
-        return rv;
+        goto end;
     }
     json_object_set_string(tc_rsp, "encryptionKeyServer", tmp);
     memset(tmp, 0, ACVP_KDF135_SSH_STR_OUT_MAX);
@@ -361,40 +185,43 @@ static ACVP_RESULT acvp_kdf135_ssh_output_tc (ACVP_CTX *ctx,
                             stc->i_key_len, (unsigned char *)tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("acvp_bin_to_hexstr() failure");
-        return rv;
+        goto end;
     }
     json_object_set_string(tc_rsp, "integrityKeyServer", tmp);
 
+end:
     free(tmp);
-
-    return ACVP_SUCCESS;
+    return rv;
 }
 
-static ACVP_RESULT acvp_kdf135_ssh_init_tc (ACVP_CTX *ctx,
-                                            ACVP_KDF135_SSH_TC *stc,
-                                            unsigned int tc_id,
-                                            ACVP_CIPHER alg_id,
-                                            unsigned int sha_type,
-                                            unsigned int e_key_len,
-                                            unsigned int i_key_len,
-                                            unsigned int iv_len,
-                                            unsigned int hash_len,
-                                            const char *shared_secret_k,
-                                            const char *hash_h,
-                                            const char *session_id)
-{
+static ACVP_RESULT acvp_kdf135_ssh_init_tc (ACVP_CTX *ctx, void *tc_ptr, void *group_ptr,
+                                            JSON_Object *testobj, unsigned int tc_id) {
+    ACVP_KDF135_SSH_TC *stc = tc_ptr;
+    ACVP_KDF135_SSH_GROUP *group = group_ptr;
+    const char *shared_secret_k = json_object_get_string(testobj, "k");
+    const char *hash_h = json_object_get_string(testobj, "h");
+    const char *session_id = json_object_get_string(testobj, "sessionId");
     unsigned int shared_secret_len = 0;
     unsigned int session_id_len = 0;
 
     memset(stc, 0x0, sizeof(ACVP_KDF135_SSH_TC));
 
+    if (!shared_secret_k || !hash_h || !session_id) {
+        ACVP_LOG_ERR("Missing parameters - initalize KDF SSH test case");
+        return ACVP_MALFORMED_JSON;
+    }
+
+    ACVP_LOG_INFO("                k: %s", shared_secret_k);
+    ACVP_LOG_INFO("                h: %s", hash_h);
+    ACVP_LOG_INFO("       session_id: %s", session_id);
+
     // Get the byte lengths
     shared_secret_len = strnlen(shared_secret_k, ACVP_KDF135_SSH_STR_IN_MAX) / 2;
     session_id_len = strnlen(session_id, ACVP_KDF135_SSH_STR_IN_MAX) / 2;
 
     stc->shared_secret_k = calloc(shared_secret_len, sizeof(unsigned char));
     if (!stc->shared_secret_k) { return ACVP_MALLOC_FAIL; }
-    stc->hash_h = calloc(hash_len, sizeof(unsigned char));
+    stc->hash_h = calloc(group->hash_len, sizeof(unsigned char));
     if (!stc->hash_h) { return ACVP_MALLOC_FAIL; }
     stc->session_id = calloc(session_id_len, sizeof(unsigned char));
     if (!stc->session_id) { return ACVP_MALLOC_FAIL; }
@@ -403,7 +230,7 @@ static ACVP_RESULT acvp_kdf135_ssh_init_tc (ACVP_CTX *ctx,
     acvp_hexstr_to_bin((const unsigned char*)shared_secret_k,
                        (unsigned char *)stc->shared_secret_k, shared_secret_len);
     acvp_hexstr_to_bin((const unsigned char*)hash_h,
-                       (unsigned char *)stc->hash_h, hash_len);
+                       (unsigned char *)stc->hash_h, group->hash_len);
     acvp_hexstr_to_bin((const unsigned char*)session_id,
                        (unsigned char *)stc->session_id, session_id_len);
 
@@ -424,13 +251,13 @@ static ACVP_RESULT acvp_kdf135_ssh_init_tc (ACVP_CTX *ctx,
     if (!stc->sc_integrity_key) { return ACVP_MALLOC_FAIL; }
 
     stc->tc_id = tc_id;
-    stc->cipher = alg_id;
-    stc->sha_type = sha_type;
-    stc->e_key_len = e_key_len;
-    stc->i_key_len = i_key_len;
-    stc->iv_len = iv_len;
+    stc->cipher = ACVP_KDF135_SSH;
+    stc->sha_type = group->sha_type;
+    stc->e_key_len = group->e_key_len;
+    stc->i_key_len = group->i_key_len;
+    stc->iv_len = group->iv_len;
     stc->shared_secret_len = shared_secret_len;
-    stc->hash_len = hash_len;
+    stc->hash_len = group->hash_len;
     stc->session_id_len = session_id_len;
 
     return ACVP_SUCCESS;
@@ -440,7 +267,9 @@ static ACVP_RESULT acvp_kdf135_ssh_init_tc (ACVP_CTX *ctx,
  * This function simply releases the data associated with
  * a test case.
  */
-static ACVP_RESULT acvp_kdf135_ssh_release_tc (ACVP_KDF135_SSH_TC *stc) {
+static void acvp_kdf135_ssh_release_tc (void *tc_ptr) {
+    ACVP_KDF135_SSH_TC *stc = tc_ptr;
+
     if (stc->shared_secret_k) free(stc->shared_secret_k);
     if (stc->hash_h) free(stc->hash_h);
     if (stc->session_id) free(stc->session_id);
@@ -452,6 +281,26 @@ static ACVP_RESULT acvp_kdf135_ssh_release_tc (ACVP_KDF135_SSH_TC *stc) {
     if (stc->sc_integrity_key) free(stc->sc_integrity_key);
 
     memset(stc, 0, sizeof(ACVP_KDF135_SSH_TC));
+}
 
-    return ACVP_SUCCESS;
+static const ACVP_KDF135_OPS acvp_kdf135_ssh_ops = {
+    ACVP_KDF135_SSH,
+    sizeof(ACVP_KDF135_SSH_TC),
+    sizeof(ACVP_KDF135_SSH_GROUP),
+    NULL,
+    0,
+    acvp_kdf135_ssh_bind,
+    acvp_kdf135_ssh_parse_group,
+    acvp_kdf135_ssh_init_tc,
+    acvp_kdf135_ssh_output_tc,
+    acvp_kdf135_ssh_release_tc
+};
+
+ACVP_RESULT acvp_kdf135_ssh_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
+    if (!json_object_get_string(obj, "mode")) {
+        ACVP_LOG_ERR("unable to parse 'mode' from JSON");
+        return (ACVP_MALFORMED_JSON);
+    }
+
+    return acvp_kdf135_kat_handler_internal(ctx, obj, &acvp_kdf135_ssh_ops);
 }
@@ -32,227 +32,58 @@
 #include "parson.h"
 
 /*
- * Forward prototypes for local functions
+ * The settings shared by all the tests of a TLS test group
  */
-static ACVP_RESULT acvp_kdf135_tls_output_tc (ACVP_CTX *ctx, ACVP_KDF135_TLS_TC *stc, JSON_Object *tc_rsp);
-
-static ACVP_RESULT acvp_kdf135_tls_init_tc (ACVP_CTX *ctx,
-                                            ACVP_KDF135_TLS_TC *stc,
-                                            unsigned int tc_id,
-                                            ACVP_CIPHER alg_id,
-                                            unsigned int method,
-                                            unsigned int sha,
-                                            unsigned int pm_len,
-                                            unsigned int kb_len,
-                                            const char *pm_secret,
-                                            const char *sh_rnd,
-                                            const char *ch_rnd,
-                                            const char *s_rnd,
-                                            const char *c_rnd);
-
-static ACVP_RESULT acvp_kdf135_tls_release_tc (ACVP_KDF135_TLS_TC *stc);
+typedef struct acvp_kdf135_tls_group_t {
+    unsigned int method;
+    unsigned int md;
+    unsigned int pm_len;
+    unsigned int kb_len;
+} ACVP_KDF135_TLS_GROUP;
 
+static void acvp_kdf135_tls_bind (ACVP_TEST_CASE *tc, void *stc) {
+    tc->tc.kdf135_tls = stc;
+}
 
-ACVP_RESULT acvp_kdf135_tls_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
-    unsigned int tc_id, meth, md;
-    JSON_Value *groupval;
-    JSON_Object *groupobj = NULL;
-    JSON_Value *testval;
-    JSON_Object *testobj = NULL;
-    JSON_Array *groups;
-    JSON_Array *tests;
-    
-    JSON_Value *reg_arry_val = NULL;
-    JSON_Object *reg_obj = NULL;
-    JSON_Array *reg_arry = NULL;
-    
-    int i, g_cnt;
-    int j, t_cnt;
-    
-    JSON_Value *r_vs_val = NULL;
-    JSON_Object *r_vs = NULL;
-    JSON_Array *r_tarr = NULL; /* Response testarray */
-    JSON_Value *r_tval = NULL; /* Response testval */
-    JSON_Object *r_tobj = NULL; /* Response testobj */
-    ACVP_CAPS_LIST *cap;
-    ACVP_KDF135_TLS_TC stc;
-    ACVP_TEST_CASE tc;
-    ACVP_HASH_TESTTYPE test_type;
-    ACVP_RESULT rv;
-    const char *alg_str = json_object_get_string(obj, "algorithm");
-    ACVP_CIPHER alg_id;
-    const char *pm_secret = NULL;
-    const char *sh_rnd = NULL;
-    const char *ch_rnd = NULL;
-    const char *s_rnd = NULL;
-    const char *c_rnd = NULL;
+static ACVP_RESULT acvp_kdf135_tls_parse_group (ACVP_CTX *ctx, JSON_Object *groupobj, void *group_ptr) {
+    ACVP_KDF135_TLS_GROUP *group = group_ptr;
     const char *method = NULL;
     const char *sha = NULL;
-    unsigned int kb_len, pm_len;
-    char *json_result;
-    
-    if (!alg_str) {
-        ACVP_LOG_ERR("unable to parse 'algorithm' from JSON");
-        return (ACVP_MALFORMED_JSON);
-    }
-    
-    /*
-     * Get a reference to the abstracted test case
-     */
-    tc.tc.kdf135_tls = &stc;
-    
-    /*
-     * Get the crypto module handler for this hash algorithm
-     */
-    alg_id = acvp_lookup_cipher_index(alg_str);
-    if (alg_id < ACVP_CIPHER_START) {
-        ACVP_LOG_ERR("unsupported algorithm (%s)", alg_str);
-        return (ACVP_UNSUPPORTED_OP);
-    }
-    cap = acvp_locate_cap_entry(ctx, alg_id);
-    if (!cap) {
-        ACVP_LOG_ERR("ACVP server requesting unsupported capability");
-        return (ACVP_UNSUPPORTED_OP);
-    }
-    
-    /*
-     * Create ACVP array for response
-     */
-    rv = acvp_create_array(&reg_obj, &reg_arry_val, &reg_arry);
-    if (rv != ACVP_SUCCESS) {
-        ACVP_LOG_ERR("Failed to create JSON response struct. ");
-        return (rv);
-    }
-    
-    /*
-     * Start to build the JSON response
-     */
-    if (ctx->kat_resp) {
-        json_value_free(ctx->kat_resp);
+
+    group->pm_len = (unsigned int) json_object_get_number(groupobj, "preMasterSecretLength");
+    group->kb_len = (unsigned int) json_object_get_number(groupobj, "keyBlockLength");
+    method = json_object_get_string(groupobj, "tlsVersion");
+    sha = json_object_get_string(groupobj, "hashAlg");
+    if (!method || !sha) {
+        ACVP_LOG_ERR("Missing tlsVersion or hashAlg in TLS test group");
+        return ACVP_MALFORMED_JSON;
     }
-    ctx->kat_resp = reg_arry_val;
-    r_vs_val = json_value_init_object();
-    r_vs = json_value_get_object(r_vs_val);
-    
-    json_object_set_number(r_vs, "vsId", ctx->vs_id);
-    json_object_set_string(r_vs, "algorithm", alg_str);
-    json_object_set_value(r_vs, "testResults", json_value_init_array());
-    r_tarr = json_object_get_array(r_vs, "testResults");
-    
-    groups = json_object_get_array(obj, "testGroups");
-    g_cnt = json_array_get_count(groups);
-    for (i = 0; i < g_cnt; i++) {
-        groupval = json_array_get_value(groups, i);
-        groupobj = json_value_get_object(groupval);
-        
-        
-        pm_len = (unsigned int) json_object_get_number(groupobj, "preMasterSecretLength");
-        kb_len = (unsigned int) json_object_get_number(groupobj, "keyBlockLength");
-        method = json_object_get_string(groupobj, "tlsVersion");
-        sha = json_object_get_string(groupobj, "hashAlg");
-        
-        if (!strncmp(method, "v1.2", 4)) {
-            meth = ACVP_KDF135_TLS12;
-        } else if (!strncmp(method, "v1.0/1.1", 8)) {
-            meth = ACVP_KDF135_TLS10_TLS11;
-        } else {
-            ACVP_LOG_ERR("Not TLS method");
-            return ACVP_NO_CAP;
-        }
-        
-        if (!strncmp(sha, "SHA2-256", 8)) {
-            md = ACVP_KDF135_TLS_CAP_SHA256;
-        } else if (!strncmp(sha, "SHA2-384", 8)) {
-            md = ACVP_KDF135_TLS_CAP_SHA384;
-        } else if (!strncmp(sha, "SHA2-512", 8)) {
-            md = ACVP_KDF135_TLS_CAP_SHA512;
-        } else {
-            ACVP_LOG_ERR("Not TLS SHA");
-            return ACVP_NO_CAP;
-        }
-        
-        ACVP_LOG_INFO("    Test group: %d", i);
-        ACVP_LOG_INFO("            pmLen: %d", pm_len);
-        ACVP_LOG_INFO("            kbLen: %d", kb_len);
-        ACVP_LOG_INFO("           method: %d", method);
-        ACVP_LOG_INFO("              sha: %d", sha);
-        
-        tests = json_object_get_array(groupobj, "tests");
-        t_cnt = json_array_get_count(tests);
-        for (j = 0; j < t_cnt; j++) {
-            ACVP_LOG_INFO("Found new hash test vector...");
-            testval = json_array_get_value(tests, j);
-            testobj = json_value_get_object(testval);
-            
-            tc_id = (unsigned int) json_object_get_number(testobj, "tcId");
-            pm_secret = json_object_get_string(testobj, "preMasterSecret");
-            sh_rnd = json_object_get_string(testobj, "serverHelloRandom");
-            ch_rnd = json_object_get_string(testobj, "clientHelloRandom");
-            s_rnd = json_object_get_string(testobj, "serverRandom");
-            c_rnd = json_object_get_string(testobj, "clientRandom");
-            test_type = (unsigned int) json_object_get_number(groupobj, "testType");
-            
-            ACVP_LOG_INFO("        Test case: %d", j);
-            ACVP_LOG_INFO("             tcId: %d", tc_id);
-            ACVP_LOG_INFO("         pmSecret: %s", pm_secret);
-            ACVP_LOG_INFO("            shRND: %s", sh_rnd);
-            ACVP_LOG_INFO("            chRND: %s", ch_rnd);
-            ACVP_LOG_INFO("             sRND: %s", s_rnd);
-            ACVP_LOG_INFO("             cRND: %s", c_rnd);
-            ACVP_LOG_INFO("         testtype: %s", test_type);
-            
-            /*
-             * Create a new test case in the response
-             */
-            r_tval = json_value_init_object();
-            r_tobj = json_value_get_object(r_tval);
-            
-            json_object_set_number(r_tobj, "tcId", tc_id);
-            
-            /*
-             * Setup the test case data that will be passed down to
-             * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
-             */
-            acvp_kdf135_tls_init_tc(ctx, &stc, tc_id, alg_id, meth, md, pm_len,
-                                    kb_len, pm_secret, sh_rnd, ch_rnd, s_rnd, c_rnd);
-            
-            /* Process the current test vector... */
-            rv = (cap->crypto_handler)(&tc);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("crypto module failed the operation");
-                return ACVP_CRYPTO_MODULE_FAIL;
-            }
-            
-            /*
-	     * Output the test case results using JSON
-	      */
-            rv = acvp_kdf135_tls_output_tc(ctx, &stc, r_tobj);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("JSON output failure in hash module");
-                return rv;
-            }
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_kdf135_tls_release_tc(&stc);
-            
-            /* Append the test response value to array */
-            json_array_append_value(r_tarr, r_tval);
-        }
+
+    if (!strncmp(method, "v1.2", 4)) {
+        group->method = ACVP_KDF135_TLS12;
+    } else if (!strncmp(method, "v1.0/1.1", 8)) {
+        group->method = ACVP_KDF135_TLS10_TLS11;
+    } else {
+        ACVP_LOG_ERR("Not TLS method");
+        return ACVP_NO_CAP;
     }
-    
-    json_array_append_value(reg_arry, r_vs_val);
-    
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
+
+    if (!strncmp(sha, "SHA2-256", 8)) {
+        group->md = ACVP_KDF135_TLS_CAP_SHA256;
+    } else if (!strncmp(sha, "SHA2-384", 8)) {
+        group->md = ACVP_KDF135_TLS_CAP_SHA384;
+    } else if (!strncmp(sha, "SHA2-512", 8)) {
+        group->md = ACVP_KDF135_TLS_CAP_SHA512;
     } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
+        ACVP_LOG_ERR("Not TLS SHA");
+        return ACVP_NO_CAP;
     }
-    json_free_serialized_string(json_result);
-    
+
+    ACVP_LOG_INFO("            pmLen: %d", group->pm_len);
+    ACVP_LOG_INFO("            kbLen: %d", group->kb_len);
+    ACVP_LOG_INFO("           method: %s", method);
+    ACVP_LOG_INFO("              sha: %s", sha);
+
     return ACVP_SUCCESS;
 }
 
@@ -262,7 +93,8 @@ ACVP_RESULT acvp_kdf135_tls_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
  * file that will be uploaded to the server.  This routine handles
  * the JSON processing for a single test case.
  */
-static ACVP_RESULT acvp_kdf135_tls_output_tc (ACVP_CTX *ctx, ACVP_KDF135_TLS_TC *stc, JSON_Object *tc_rsp) {
+static ACVP_RESULT acvp_kdf135_tls_output_tc (ACVP_CTX *ctx, void *tc_ptr, JSON_Object *tc_rsp) {
+    ACVP_KDF135_TLS_TC *stc = tc_ptr;
     char *tmp;
     ACVP_RESULT rv;
     
@@ -275,36 +107,44 @@ static ACVP_RESULT acvp_kdf135_tls_output_tc (ACVP_CTX *ctx, ACVP_KDF135_TLS_TC
     rv = acvp_bin_to_hexstr(stc->msecret1, stc->pm_len, (unsigned char *) tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (mac)");
-        return rv;
+        goto end;
     }
     json_object_set_string(tc_rsp, "masterSecret", tmp);
     
     rv = acvp_bin_to_hexstr(stc->kblock1, stc->kb_len, (unsigned char *) tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (mac)");
-        return rv;
+        goto end;
     }
     json_object_set_string(tc_rsp, "keyBlock", tmp);
     
+end:
     free(tmp);
-    
-    return ACVP_SUCCESS;
+    return rv;
 }
 
-static ACVP_RESULT acvp_kdf135_tls_init_tc (ACVP_CTX *ctx,
-                                            ACVP_KDF135_TLS_TC *stc,
-                                            unsigned int tc_id,
-                                            ACVP_CIPHER alg_id,
-                                            unsigned int method,
-                                            unsigned int md,
-                                            unsigned int pm_len,
-                                            unsigned int kb_len,
-                                            const char *pm_secret,
-                                            const char *sh_rnd,
-                                            const char *ch_rnd,
-                                            const char *s_rnd,
-                                            const char *c_rnd) {
+static ACVP_RESULT acvp_kdf135_tls_init_tc (ACVP_CTX *ctx, void *tc_ptr, void *group_ptr,
+                                            JSON_Object *testobj, unsigned int tc_id) {
+    ACVP_KDF135_TLS_TC *stc = tc_ptr;
+    ACVP_KDF135_TLS_GROUP *group = group_ptr;
+    const char *pm_secret = json_object_get_string(testobj, "preMasterSecret");
+    const char *sh_rnd = json_object_get_string(testobj, "serverHelloRandom");
+    const char *ch_rnd = json_object_get_string(testobj, "clientHelloRandom");
+    const char *s_rnd = json_object_get_string(testobj, "serverRandom");
+    const char *c_rnd = json_object_get_string(testobj, "clientRandom");
+
     memset(stc, 0x0, sizeof(ACVP_KDF135_TLS_TC));
+
+    if (!pm_secret || !sh_rnd || !ch_rnd || !s_rnd || !c_rnd) {
+        ACVP_LOG_ERR("Missing parameters - initalize KDF TLS test case");
+        return ACVP_MALFORMED_JSON;
+    }
+
+    ACVP_LOG_INFO("         pmSecret: %s", pm_secret);
+    ACVP_LOG_INFO("            shRND: %s", sh_rnd);
+    ACVP_LOG_INFO("            chRND: %s", ch_rnd);
+    ACVP_LOG_INFO("             sRND: %s", s_rnd);
+    ACVP_LOG_INFO("             cRND: %s", c_rnd);
     
     stc->pm_secret = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
     if (!stc->pm_secret) { return ACVP_MALLOC_FAIL; }
@@ -325,11 +165,6 @@ static ACVP_RESULT acvp_kdf135_tls_init_tc (ACVP_CTX *ctx,
     stc->kblock2 = calloc(1, ACVP_KDF135_TLS_MSG_MAX);
     if (!stc->kblock2) { return ACVP_MALLOC_FAIL; }
     
-    memset(stc->msecret1, 0, ACVP_KDF135_TLS_MSG_MAX);
-    memset(stc->msecret2, 0, ACVP_KDF135_TLS_MSG_MAX);
-    memset(stc->kblock1, 0, ACVP_KDF135_TLS_MSG_MAX);
-    memset(stc->kblock2, 0, ACVP_KDF135_TLS_MSG_MAX);
-    
     memcpy(stc->pm_secret, pm_secret, strnlen(pm_secret, ACVP_KDF135_TLS_MSG_MAX));
     memcpy(stc->sh_rnd, sh_rnd, strnlen(sh_rnd, ACVP_KDF135_TLS_MSG_MAX));
     memcpy(stc->ch_rnd, ch_rnd, strnlen(ch_rnd, ACVP_KDF135_TLS_MSG_MAX));
@@ -337,11 +172,11 @@ static ACVP_RESULT acvp_kdf135_tls_init_tc (ACVP_CTX *ctx,
     memcpy(stc->c_rnd, c_rnd, strnlen(c_rnd, ACVP_KDF135_TLS_MSG_MAX));
     
     stc->tc_id = tc_id;
-    stc->cipher = alg_id;
-    stc->pm_len = pm_len / 8;
-    stc->kb_len = kb_len / 8;
-    stc->method = method;
-    stc->md = md;
+    stc->cipher = ACVP_KDF135_TLS;
+    stc->pm_len = group->pm_len / 8;
+    stc->kb_len = group->kb_len / 8;
+    stc->method = group->method;
+    stc->md = group->md;
     
     return ACVP_SUCCESS;
 }
@@ -350,7 +185,9 @@ static ACVP_RESULT acvp_kdf135_tls_init_tc (ACVP_CTX *ctx,
  * This function simply releases the data associated with
  * a test case.
  */
-static ACVP_RESULT acvp_kdf135_tls_release_tc (ACVP_KDF135_TLS_TC *stc) {
+static void acvp_kdf135_tls_release_tc (void *tc_ptr) {
+    ACVP_KDF135_TLS_TC *stc = tc_ptr;
+
     free(stc->pm_secret);
     free(stc->sh_rnd);
     free(stc->ch_rnd);
@@ -362,5 +199,21 @@ static ACVP_RESULT acvp_kdf135_tls_release_tc (ACVP_KDF135_TLS_TC *stc) {
     free(stc->kblock2);
     
     memset(stc, 0x0, sizeof(ACVP_KDF135_TLS_TC));
-    return ACVP_SUCCESS;
+}
+
+static const ACVP_KDF135_OPS acvp_kdf135_tls_ops = {
+    ACVP_KDF135_TLS,
+    sizeof(ACVP_KDF135_TLS_TC),
+    sizeof(ACVP_KDF135_TLS_GROUP),
+    NULL,
+    0,
+    acvp_kdf135_tls_bind,
+    acvp_kdf135_tls_parse_group,
+    acvp_kdf135_tls_init_tc,
+    acvp_kdf135_tls_output_tc,
+    acvp_kdf135_tls_release_tc
+};
+
+ACVP_RESULT acvp_kdf135_tls_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
+    return acvp_kdf135_kat_handler_internal(ctx, obj, &acvp_kdf135_tls_ops);
 }
@@ -31,13 +31,25 @@
 #include "acvp_lcl.h"
 #include "parson.h"
 
+static void acvp_kdf135_tpm_bind (ACVP_TEST_CASE *tc, void *stc) {
+    tc->tc.kdf135_tpm = stc;
+}
+
+/*
+ * TPM test groups carry no settings for the test cases
+ */
+static ACVP_RESULT acvp_kdf135_tpm_parse_group (ACVP_CTX *ctx, JSON_Object *groupobj, void *group_ptr) {
+    return ACVP_SUCCESS;
+}
+
 /*
  * After the test case has been processed by the DUT, the results
  * need to be JSON formated to be included in the vector set results
  * file that will be uploaded to the server.  This routine handles
  * the JSON processing for a single test case.
  */
-static ACVP_RESULT acvp_kdf135_tpm_output_tc (ACVP_CTX *ctx, ACVP_KDF135_TPM_TC *stc, JSON_Object *tc_rsp) {
+static ACVP_RESULT acvp_kdf135_tpm_output_tc (ACVP_CTX *ctx, void *tc_ptr, JSON_Object *tc_rsp) {
+    ACVP_KDF135_TPM_TC *stc = tc_ptr;
     ACVP_RESULT rv;
     char *tmp;
     
@@ -50,6 +62,7 @@ static ACVP_RESULT acvp_kdf135_tpm_output_tc (ACVP_CTX *ctx, ACVP_KDF135_TPM_TC
     rv = acvp_bin_to_hexstr(stc->s_key, stc->skey_len, (unsigned char *) tmp);
     if (rv != ACVP_SUCCESS) {
         ACVP_LOG_ERR("hex conversion failure (s_key)");
+        free(tmp);
         return rv;
     }
     json_object_set_string(tc_rsp, "sKey", tmp);
@@ -58,34 +71,36 @@ static ACVP_RESULT acvp_kdf135_tpm_output_tc (ACVP_CTX *ctx, ACVP_KDF135_TPM_TC
     return ACVP_SUCCESS;
 }
 
-static ACVP_RESULT acvp_kdf135_tpm_init_tc (ACVP_CTX *ctx,
-                                            ACVP_KDF135_TPM_TC *stc,
-                                            unsigned int tc_id,
-                                            char *auth,
-                                            char *nonce_even,
-                                            char *nonce_odd
-) {
+/*
+ * The auth and nonce strings are owned by the vector set JSON,
+ * which outlives the test case.
+ */
+static ACVP_RESULT acvp_kdf135_tpm_init_tc (ACVP_CTX *ctx, void *tc_ptr, void *group_ptr,
+                                            JSON_Object *testobj, unsigned int tc_id) {
+    ACVP_KDF135_TPM_TC *stc = tc_ptr;
+    const char *auth = json_object_get_string(testobj, "auth");
+    const char *nonce_even = json_object_get_string(testobj, "nonceEven");
+    const char *nonce_odd = json_object_get_string(testobj, "nonceOdd");
+
     memset(stc, 0x0, sizeof(ACVP_KDF135_TPM_TC));
     
-    stc->auth = calloc(strlen(auth), sizeof(char));
-    if (!stc->auth) { return ACVP_MALLOC_FAIL; }
-    
-    stc->nonce_even = calloc(strlen(nonce_even), sizeof(char));
-    if (!stc->nonce_even) { return ACVP_MALLOC_FAIL; }
-    
-    stc->nonce_odd = calloc(strlen(nonce_odd), sizeof(char));
-    if (!stc->nonce_odd) { return ACVP_MALLOC_FAIL; }
-    
+    if (!auth || !nonce_even || !nonce_odd) {
+        ACVP_LOG_ERR("Missing parameters - initalize KDF TPM test case");
+        return ACVP_MALFORMED_JSON;
+    }
+
+    ACVP_LOG_INFO("             auth: %s", auth);
+    ACVP_LOG_INFO("       nonce_even: %s", nonce_even);
+    ACVP_LOG_INFO("        nonce_odd: %s", nonce_odd);
+
     stc->s_key = calloc(ACVP_KDF135_TPM_SKEY_MAX, sizeof(char));
     if (!stc->s_key) { return ACVP_MALLOC_FAIL; }
     
-    memset(stc->s_key, 0, ACVP_KDF135_TPM_SKEY_MAX);
-    
     stc->tc_id = tc_id;
     stc->cipher = ACVP_KDF135_TPM;
-    stc->auth = auth;
-    stc->nonce_odd = nonce_odd;
-    stc->nonce_even = nonce_even;
+    stc->auth = (char *)auth;
+    stc->nonce_odd = (char *)nonce_odd;
+    stc->nonce_even = (char *)nonce_even;
     
     return ACVP_SUCCESS;
 }
@@ -94,170 +109,27 @@ static ACVP_RESULT acvp_kdf135_tpm_init_tc (ACVP_CTX *ctx,
  * This function simply releases the data associated with
  * a test case.
  */
-static ACVP_RESULT acvp_kdf135_tpm_release_tc (ACVP_KDF135_TPM_TC *stc) {
-    free((void *) stc->auth);
+static void acvp_kdf135_tpm_release_tc (void *tc_ptr) {
+    ACVP_KDF135_TPM_TC *stc = tc_ptr;
+
     free(stc->s_key);
-    free(stc->nonce_even);
-    free(stc->nonce_odd);
     
     memset(stc, 0x0, sizeof(ACVP_KDF135_TPM_TC));
-    return ACVP_SUCCESS;
 }
 
-ACVP_RESULT acvp_kdf135_tpm_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
-    unsigned int tc_id;
-    JSON_Value *groupval;
-    JSON_Object *groupobj = NULL;
-    JSON_Value *testval;
-    JSON_Object *testobj = NULL;
-    JSON_Array *groups;
-    JSON_Array *tests;
-
-    JSON_Value *reg_arry_val = NULL;
-    JSON_Object *reg_obj = NULL;
-    JSON_Array *reg_arry = NULL;
-
-    int i, g_cnt;
-    int j, t_cnt;
-
-    JSON_Value *r_vs_val = NULL;
-    JSON_Object *r_vs = NULL;
-    JSON_Array *r_tarr = NULL; /* Response testarray */
-    JSON_Value *r_tval = NULL; /* Response testval */
-    JSON_Object *r_tobj = NULL; /* Response testobj */
-    ACVP_CAPS_LIST *cap;
-    ACVP_KDF135_TPM_TC stc;
-    ACVP_TEST_CASE tc;
-    ACVP_RESULT rv;
-    const char *alg_str = json_object_get_string(obj, "algorithm");
-    ACVP_CIPHER alg_id;
-    char *auth = NULL, *nonce_even = NULL, *nonce_odd = NULL;
-    char *json_result;
-
-    if (!alg_str) {
-        ACVP_LOG_ERR("unable to parse 'algorithm' from JSON");
-        return (ACVP_MALFORMED_JSON);
-    }
-
-    /*
-     * Get a reference to the abstracted test case
-     */
-    tc.tc.kdf135_tpm = &stc;
+static const ACVP_KDF135_OPS acvp_kdf135_tpm_ops = {
+    ACVP_KDF135_TPM,
+    sizeof(ACVP_KDF135_TPM_TC),
+    0,
+    NULL,
+    0,
+    acvp_kdf135_tpm_bind,
+    acvp_kdf135_tpm_parse_group,
+    acvp_kdf135_tpm_init_tc,
+    acvp_kdf135_tpm_output_tc,
+    acvp_kdf135_tpm_release_tc
+};
 
-    /*
-     * Get the crypto module handler for this hash algorithm
-     */
-    alg_id = acvp_lookup_cipher_index(alg_str);
-    if (alg_id < ACVP_CIPHER_START) {
-        ACVP_LOG_ERR("unsupported algorithm (%s)", alg_str);
-        return (ACVP_UNSUPPORTED_OP);
-    }
-    cap = acvp_locate_cap_entry(ctx, alg_id);
-    if (!cap) {
-        ACVP_LOG_ERR("ACVP server requesting unsupported capability");
-        return (ACVP_UNSUPPORTED_OP);
-    }
-
-    /*
-     * Create ACVP array for response
-     */
-    rv = acvp_create_array(&reg_obj, &reg_arry_val, &reg_arry);
-    if (rv != ACVP_SUCCESS) {
-        ACVP_LOG_ERR("Failed to create JSON response struct. ");
-        return (rv);
-    }
-
-    /*
-     * Start to build the JSON response
-     */
-    if (ctx->kat_resp) {
-        json_value_free(ctx->kat_resp);
-    }
-    ctx->kat_resp = reg_arry_val;
-    r_vs_val = json_value_init_object();
-    r_vs = json_value_get_object(r_vs_val);
-
-    json_object_set_number(r_vs, "vsId", ctx->vs_id);
-    json_object_set_string(r_vs, "algorithm", alg_str);
-    json_object_set_value(r_vs, "testResults", json_value_init_array());
-    r_tarr = json_object_get_array(r_vs, "testResults");
-
-    groups = json_object_get_array(obj, "testGroups");
-    g_cnt = json_array_get_count(groups);
-    for (i = 0; i < g_cnt; i++) {
-        groupval = json_array_get_value(groups, i);
-        groupobj = json_value_get_object(groupval);
-
-        ACVP_LOG_INFO("    Test group: %d", i);
-
-        tests = json_object_get_array(groupobj, "tests");
-        t_cnt = json_array_get_count(tests);
-        for (j = 0; j < t_cnt; j++) {
-            ACVP_LOG_INFO("Found new kdf135 tpm test vector...");
-            testval = json_array_get_value(tests, j);
-            testobj = json_value_get_object(testval);
-
-            tc_id = (unsigned int) json_object_get_number(testobj, "tcId");
-            auth = json_object_get_string(testobj, "auth");
-            nonce_even = json_object_get_string(testobj, "nonceEven");
-            nonce_odd = json_object_get_string(testobj, "nonceOdd");
-
-            ACVP_LOG_INFO("        Test case: %d", j);
-            ACVP_LOG_INFO("             tcId: %d", tc_id);
-            ACVP_LOG_INFO("             auth: %d", auth);
-            ACVP_LOG_INFO("       nonce_even: %d", nonce_even);
-            ACVP_LOG_INFO("        nonce_odd: %d", nonce_odd);
-
-            /*
-             * Create a new test case in the response
-             */
-            r_tval = json_value_init_object();
-            r_tobj = json_value_get_object(r_tval);
-
-            json_object_set_number(r_tobj, "tcId", tc_id);
-
-            /*
-             * Setup the test case data that will be passed down to
-             * the crypto module.
-             * TODO: this does mallocs, we can probably do the mallocs once for
-             *       the entire vector set to be more efficient
-             */
-            acvp_kdf135_tpm_init_tc(ctx, &stc, tc_id, auth, nonce_even, nonce_odd);
-
-            /* Process the current test vector... */
-            rv = (cap->crypto_handler)(&tc);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("crypto module failed the operation");
-                return ACVP_CRYPTO_MODULE_FAIL;
-            }
-
-            /*
-             * Output the test case results using JSON
-            */
-            rv = acvp_kdf135_tpm_output_tc(ctx, &stc, r_tobj);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("JSON output failure in kdf135 tpm module");
-                return rv;
-            }
-            /*
-             * Release all the memory associated with the test case
-             */
-            acvp_kdf135_tpm_release_tc(&stc);
-
-            /* Append the test response value to array */
-            json_array_append_value(r_tarr, r_tval);
-        }
-    }
-
-    json_array_append_value(reg_arry, r_vs_val);
-
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
-
-    return ACVP_SUCCESS;
+ACVP_RESULT acvp_kdf135_tpm_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
+    return acvp_kdf135_kat_handler_internal(ctx, obj, &acvp_kdf135_tpm_ops);
 }
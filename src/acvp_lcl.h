@@ -26,35 +26,54 @@
 #ifndef acvp_lcl_h
 #define acvp_lcl_h
 
+#include <stdio.h>
+#include <time.h>
 #include "parson.h"
 
 #define ACVP_VERSION    "0.4"
 
+/*
+ * The level is checked before the arguments of a log message are
+ * evaluated and formatted, so a disabled level costs nothing
+ */
+#define ACVP_LOG_ON(ctx, level) ((ctx) && ((ctx)->test_progress_cb || (ctx)->log_ring) && \
+                                 (ctx)->debug >= (level))
+
+#define ACVP_LOG_PAYLOAD_MAX 512    /* bytes of a request or response body that are logged */
+
 #ifndef ACVP_LOG_INFO
 #define ACVP_LOG_INFO(format, args ...) do { \
-        acvp_log_msg(ctx, ACVP_LOG_LVL_INFO, "***ACVP [INFO][%s:%d]--> " format "\n", \
-                __func__, __LINE__, ##args); \
+        if (ACVP_LOG_ON(ctx, ACVP_LOG_LVL_INFO)) { \
+            acvp_log_msg(ctx, ACVP_LOG_LVL_INFO, "***ACVP [INFO][%s:%d]--> " format "\n", \
+                    __func__, __LINE__, ##args); \
+        } \
 } while (0)
 #endif
 
 #ifndef ACVP_LOG_ERR
 #define ACVP_LOG_ERR(format, args ...) do { \
-        acvp_log_msg(ctx, ACVP_LOG_LVL_ERR, "***ACVP [ERR][%s:%d]--> " format "\n", \
-                __func__, __LINE__, ##args); \
+        if (ACVP_LOG_ON(ctx, ACVP_LOG_LVL_ERR)) { \
+            acvp_log_msg(ctx, ACVP_LOG_LVL_ERR, "***ACVP [ERR][%s:%d]--> " format "\n", \
+                    __func__, __LINE__, ##args); \
+        } \
 } while (0)
 #endif
 
 #ifndef ACVP_LOG_STATUS
 #define ACVP_LOG_STATUS(format, args ...) do { \
-        acvp_log_msg(ctx, ACVP_LOG_LVL_STATUS, "***ACVP [STATUS][%s:%d]--> " format "\n", \
-                __func__, __LINE__, ##args); \
+        if (ACVP_LOG_ON(ctx, ACVP_LOG_LVL_STATUS)) { \
+            acvp_log_msg(ctx, ACVP_LOG_LVL_STATUS, "***ACVP [STATUS][%s:%d]--> " format "\n", \
+                    __func__, __LINE__, ##args); \
+        } \
 } while (0)
 #endif
 
 #ifndef ACVP_LOG_WARN
 #define ACVP_LOG_WARN(format, args ...) do { \
-        acvp_log_msg(ctx, ACVP_LOG_LVL_WARN, "***ACVP [WARN][%s:%d]--> " format "\n", \
-                __func__, __LINE__, ##args); \
+        if (ACVP_LOG_ON(ctx, ACVP_LOG_LVL_WARN)) { \
+            acvp_log_msg(ctx, ACVP_LOG_LVL_WARN, "***ACVP [WARN][%s:%d]--> " format "\n", \
+                    __func__, __LINE__, ##args); \
+        } \
 } while (0)
 #endif
 
@@ -246,8 +265,6 @@
 #define ACVP_KDF135_IKE_COOKIE_LEN_MAX 32
 #define ACVP_KDF135_IKEV1_GXY_LEN_MAX 32
 
-#define ACVP_KDF108_STRING_MAX 1024 /**< 4096 bits max for keyout, 1024 characters */
-
 #define ACVP_HMAC_MSG_MAX       1024
 #define ACVP_HMAC_MAC_MAX       128       /**< 512 bits, 128 characters */
 #define ACVP_HMAC_KEY_MAX       131072    /**< 524288 bits, 131072 characters */
@@ -278,6 +295,8 @@
 #define ACVP_REG_BUF_MAX        1024*128
 #define ACVP_RETRY_TIME_MAX     60 /* seconds */
 #define ACVP_JWT_TOKEN_MAX      1024
+#define ACVP_OFFLINE_PATH_MAX   1024
+#define ACVP_OFFLINE_RESP_PREFIX "vsid_"
 
 #define ACVP_PATH_SEGMENT_DEFAULT ""
 
@@ -294,8 +313,32 @@ struct acvp_alg_handler_t {
     char *mode; /** < Should be NULL unless using an asymmetric alg */
 };
 
+/*
+ * Progress of a vector set, recorded in the session checkpoint
+ */
+typedef enum acvp_vs_state {
+    ACVP_VS_REGISTERED = 0,
+    ACVP_VS_DOWNLOADED,
+    ACVP_VS_COMPUTED,
+    ACVP_VS_UPLOADED,
+    ACVP_VS_VERIFIED        /* the test results show the vector set passed */
+} ACVP_VS_STATE;
+
+/*
+ * Disposition of a vector set in the test results
+ */
+typedef enum acvp_vs_disposition {
+    ACVP_DISP_UNKNOWN = 0,  /* the results were not retrieved */
+    ACVP_DISP_PASSED,
+    ACVP_DISP_FAILED,
+    ACVP_DISP_INCOMPLETE    /* the server has not finished verifying the response */
+} ACVP_VS_DISPOSITION;
+
 typedef struct acvp_vs_list_t {
     int vs_id;
+    ACVP_VS_STATE state;
+    ACVP_VS_DISPOSITION disposition;
+    char *response;     /* computed response not yet uploaded, only kept when checkpointing */
     struct acvp_vs_list_t *next;
 } ACVP_VS_LIST;
 
@@ -392,9 +435,30 @@ typedef struct acvp_sym_cipher_capability {
     int kw_mode;
 } ACVP_SYM_CIPHER_CAP;
 
+/*
+ * Optional callbacks used to feed a large message to the
+ * crypto module in chunks instead of a single buffer.
+ */
+typedef struct acvp_stream_cb_t {
+    ACVP_RESULT (*init) (ACVP_TEST_CASE *test_case);
+    ACVP_RESULT (*update) (ACVP_TEST_CASE *test_case);
+    ACVP_RESULT (*final) (ACVP_TEST_CASE *test_case);
+} ACVP_STREAM_CB;
+
+/*
+ * Optional callbacks invoked around each test group so the crypto
+ * module can set up state shared by every test case in the group.
+ */
+typedef struct acvp_group_cb_t {
+    ACVP_RESULT (*begin) (ACVP_TEST_CASE *test_case);
+    ACVP_RESULT (*end) (ACVP_TEST_CASE *test_case);
+} ACVP_GROUP_CB;
+
 typedef struct acvp_hash_capability {
     int in_bit;
     int in_empty;
+    int large_data;       /* bitmask of the large data test sizes in GiB */
+    ACVP_STREAM_CB stream;
 } ACVP_HASH_CAP;
 
 typedef struct acvp_kdf135_tls_capability {
@@ -465,6 +529,7 @@ typedef struct acvp_hmac_capability {
     int key_len_min;      // 8-524288
     int key_len_max;      // 8-524288
     ACVP_SL_LIST *mac_len;         // 32-512
+    ACVP_STREAM_CB stream;
 } ACVP_HMAC_CAP;
 
 typedef struct acvp_cmac_capability {
@@ -474,6 +539,7 @@ typedef struct acvp_cmac_capability {
     ACVP_SL_LIST *key_len; // 128,192,256
     ACVP_SL_LIST *keying_option; // 1 or 2
     int msg_len[5];
+    ACVP_STREAM_CB stream;
 } ACVP_CMAC_CAP;
 
 typedef struct acvp_drbg_cap_mode {
@@ -509,6 +575,7 @@ typedef struct acvp_cap_mode_list_t {
 typedef struct acvp_drbg_capability {
     ACVP_CIPHER cipher;
     ACVP_DRBG_CAP_MODE_LIST *drbg_cap_mode_list;
+    ACVP_GROUP_CB group;
 } ACVP_DRBG_CAP;
 
 struct acvp_drbg_mode_name_t {
@@ -547,6 +614,7 @@ typedef struct acvp_ecdsa_capability_t {
     ACVP_NAME_LIST *curves;
     ACVP_NAME_LIST *secret_gen_modes;
     ACVP_NAME_LIST *hash_algs;
+    ACVP_GROUP_CB group;
 } ACVP_ECDSA_CAP;
 
 typedef struct acvp_rsa_sig_capability_t {
@@ -579,6 +647,7 @@ typedef struct acvp_dsa_cap_mode_t {
 typedef struct acvp_dsa_capability {
     ACVP_CIPHER cipher;
     ACVP_DSA_CAP_MODE *dsa_cap_mode;
+    ACVP_GROUP_CB group;
 } ACVP_DSA_CAP;
 
 typedef struct acvp_kas_ecc_mac {
@@ -618,6 +687,7 @@ typedef struct acvp_kas_ecc_cap_mode_t {
 typedef struct acvp_kas_ecc_capability_t {
     ACVP_CIPHER cipher;
     ACVP_KAS_ECC_CAP_MODE *kas_ecc_mode;
+    ACVP_GROUP_CB group;
 } ACVP_KAS_ECC_CAP;
 
 typedef struct acvp_kas_ffc_mac {
@@ -655,6 +725,7 @@ typedef struct acvp_kas_ffc_cap_mode_t {
 typedef struct acvp_kas_ffc_capability_t {
     ACVP_CIPHER cipher;
     ACVP_KAS_FFC_CAP_MODE *kas_ffc_mode;
+    ACVP_GROUP_CB group;
 } ACVP_KAS_FFC_CAP;
 
 typedef struct acvp_caps_list_t {
@@ -690,6 +761,7 @@ typedef struct acvp_caps_list_t {
     } cap;
 
     ACVP_RESULT (*crypto_handler) (ACVP_TEST_CASE *test_case);
+    ACVP_RESULT (*batch_handler) (ACVP_TEST_BATCH *batch);
 
     struct acvp_caps_list_t *next;
 } ACVP_CAPS_LIST;
@@ -722,8 +794,41 @@ struct acvp_ctx_t {
     char *json_filename;
     int use_json;
 
+    char *offline_vectors;  /* directory or bundle file holding vector sets to process offline */
+    char *offline_resp_dir; /* directory the offline vector set responses are written to */
+
+    FILE *record_fp;        /* session archive the HTTP exchanges are appended to */
+    char *record_buf;       /* holds the HTTP response body being recorded */
+    int record_len;
+    int record_max;
+    void *record_writefunc; /* curl write function the recorded body is passed on to */
+    JSON_Value *replay_val; /* exchanges not yet served from the replayed session archive */
+    int replay_latency;     /* milliseconds added to each replayed exchange */
+
+    struct acvp_payload_dump_t *payload_dump;  /* full request and response bodies, written by a thread */
+    struct acvp_log_ring_t *log_ring;   /* events waiting for the event logger thread */
+    struct acvp_metrics_t *metrics;     /* per vector set metrics, NULL when disabled */
+
+    char *vs_cache_dir;     /* directory downloaded vector sets are cached in */
+    char *reg_cache_dir;    /* directory built registration messages are cached in */
+    char *reg_cache_key;    /* application's key for the enabled capabilities */
+
+    char *checkpoint_file;  /* session checkpoint, rewritten as the session progresses */
+    char *checkpoint_reg;   /* registration response saved in the checkpoint */
+
+    char *manifest_file;    /* capability manifest of the last passing run */
+    JSON_Value *manifest_val;   /* fingerprints loaded from the manifest */
+    JSON_Value *manifest_new;   /* fingerprints of the capabilities in this run */
+    int manifest_changed;   /* capabilities registered because they changed */
+
     int is_sample;
 
+    int hash_mct_no_msg;    /* omit the "msg" field from SHA MCT responses */
+
+    int worker_threads;     /* threads used to run test cases in parallel, 0 or 1 is serial */
+
+    int bn_binary;          /* big numbers are passed in the test case "bn" buffers */
+
     /* test session data */
     ACVP_VS_LIST *vs_list;
     char *jwt_token; /* access_token provided by server for authenticating REST calls */
@@ -760,8 +865,86 @@ ACVP_RESULT acvp_retrieve_vector_set_result (ACVP_CTX *ctx, int vs_id);
 
 ACVP_RESULT acvp_submit_vector_responses (ACVP_CTX *ctx);
 
+ACVP_RESULT acvp_load_replay_archive (ACVP_CTX *ctx, const char *archive);
+
+unsigned long long acvp_fnv_hash (const char *buf, int len);
+
+const char *acvp_build_id (void);
+
+ACVP_RESULT acvp_caps_fingerprint (ACVP_CTX *ctx, unsigned long long *fingerprint);
+
+unsigned long long acvp_cap_fingerprint (JSON_Value *cap_val);
+
+ACVP_RESULT acvp_vs_cache_load (ACVP_CTX *ctx, int vs_id);
+
+void acvp_vs_cache_store (ACVP_CTX *ctx, int vs_id);
+
+char *acvp_reg_cache_load (ACVP_CTX *ctx);
+
+void acvp_reg_cache_store (ACVP_CTX *ctx, const char *reg);
+
+ACVP_RESULT acvp_manifest_load (ACVP_CTX *ctx, const char *filename);
+
+int acvp_manifest_check (ACVP_CTX *ctx, JSON_Object *cap_obj, JSON_Value *cap_val);
+
+ACVP_RESULT acvp_manifest_save (ACVP_CTX *ctx);
+
+ACVP_RESULT acvp_checkpoint_save (ACVP_CTX *ctx);
+
+ACVP_RESULT acvp_checkpoint_load (ACVP_CTX *ctx, const char *filename);
+
+void acvp_checkpoint_vs (ACVP_CTX *ctx, int vs_id, ACVP_VS_STATE state);
+
+ACVP_RESULT acvp_checkpoint_restore_response (ACVP_CTX *ctx, int vs_id);
+
 void acvp_log_msg (ACVP_CTX *ctx, ACVP_LOG_LVL level, const char *format, ...);
 
+void acvp_log_payload (ACVP_CTX *ctx, ACVP_LOG_LVL level, const char *label, const char *buf);
+
+typedef struct acvp_payload_dump_t ACVP_PAYLOAD_DUMP;
+
+ACVP_RESULT acvp_payload_dump_start (ACVP_CTX *ctx, const char *filename);
+
+void acvp_payload_dump_stop (ACVP_CTX *ctx);
+
+char *acvp_redact_credentials (const char *body);
+
+typedef struct acvp_log_ring_t ACVP_LOG_RING;
+
+ACVP_RESULT acvp_log_ring_start (ACVP_CTX *ctx, ACVP_RESULT (*event_cb) (ACVP_LOG_EVENT *event), int ring_size);
+
+void acvp_log_ring_stop (ACVP_CTX *ctx);
+
+void acvp_log_event (ACVP_CTX *ctx, ACVP_LOG_EVENT_TYPE type, ACVP_LOG_LVL level, int tc_id,
+                     const char *msg, int field_cnt, ...);
+
+typedef struct acvp_metrics_t ACVP_METRICS;
+
+typedef struct acvp_metrics_timer_t {
+    struct timespec wall;
+    struct timespec cpu;
+} ACVP_METRICS_TIMER;
+
+ACVP_RESULT acvp_metrics_start (ACVP_CTX *ctx);
+
+void acvp_metrics_free (ACVP_CTX *ctx);
+
+void acvp_metrics_vs (ACVP_CTX *ctx, int vs_id);
+
+void acvp_metrics_timer_start (ACVP_CTX *ctx, ACVP_METRICS_TIMER *timer);
+
+void acvp_metrics_timer_stop (ACVP_CTX *ctx, ACVP_METRICS_PHASE phase, ACVP_METRICS_TIMER *timer);
+
+void acvp_metrics_bytes (ACVP_CTX *ctx, long long received, long long sent);
+
+void acvp_metrics_count_tests (ACVP_CTX *ctx, JSON_Object *obj);
+
+ACVP_RESULT acvp_call_crypto_handler (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc);
+
+const ACVP_VS_METRICS *acvp_metrics_list (ACVP_CTX *ctx);
+
+ACVP_RESULT acvp_metrics_export (ACVP_CTX *ctx, const char *filename);
+
 ACVP_RESULT acvp_hexstr_to_bin (const unsigned char *src, unsigned char *dest, int dest_max);
 
 ACVP_RESULT acvp_bin_to_bit (const unsigned char *in, int len, unsigned char *out);
@@ -817,6 +1000,29 @@ ACVP_RESULT acvp_kdf135_x963_kat_handler (ACVP_CTX *ctx, JSON_Object *obj);
 
 ACVP_RESULT acvp_kdf135_tpm_kat_handler (ACVP_CTX *ctx, JSON_Object *obj);
 
+/*
+ * The parts of a kdf135 KAT handler that differ between the KDFs.
+ * acvp_kdf135_kat_handler_internal() hands parse_group() a zeroed
+ * buffer of group_size bytes and passes it back to init_tc() for
+ * each test case of that group.  The test cases of a group are
+ * kept in one array of tc_size byte entries.
+ */
+typedef struct acvp_kdf135_ops_t {
+    ACVP_CIPHER cipher;
+    size_t tc_size;
+    size_t group_size;
+    const char *mode;       /* "mode" of the response, or NULL */
+    int vs_batch;           /* init_tc() copies every group setting into the
+                               test case, so one batch spans all the groups */
+    void (*bind) (ACVP_TEST_CASE *tc, void *stc);
+    ACVP_RESULT (*parse_group) (ACVP_CTX *ctx, JSON_Object *groupobj, void *group);
+    ACVP_RESULT (*init_tc) (ACVP_CTX *ctx, void *stc, void *group, JSON_Object *testobj, unsigned int tc_id);
+    ACVP_RESULT (*output_tc) (ACVP_CTX *ctx, void *stc, JSON_Object *tc_rsp);
+    void (*release_tc) (void *stc);
+} ACVP_KDF135_OPS;
+
+ACVP_RESULT acvp_kdf135_kat_handler_internal (ACVP_CTX *ctx, JSON_Object *obj, const ACVP_KDF135_OPS *ops);
+
 ACVP_RESULT acvp_kdf108_kat_handler (ACVP_CTX *ctx, JSON_Object *obj);
 
 ACVP_RESULT acvp_dsa_kat_handler (ACVP_CTX *ctx, JSON_Object *obj);
@@ -848,6 +1054,33 @@ unsigned int yes_or_no (ACVP_CTX *ctx, const char *text);
 
 ACVP_RESULT acvp_create_array (JSON_Object **obj, JSON_Value **val, JSON_Array **arry);
 
+void acvp_clear_tc_buf (unsigned char *buf, unsigned int used, unsigned int max);
+
+ACVP_RESULT acvp_run_crypto_handlers (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tcs, int tc_cnt);
+
+/*
+ * Number of ACVP_BN entries in the "bn" member of a test case
+ */
+#define ACVP_BN_CNT(bn) (sizeof(bn) / sizeof(ACVP_BN))
+
+ACVP_RESULT acvp_bn_alloc (ACVP_BN *bn, int cnt);
+
+void acvp_bn_free (ACVP_BN *bn, int cnt);
+
+ACVP_RESULT acvp_hexstr_to_bn (const char *src, ACVP_BN *bn);
+
+ACVP_RESULT acvp_bn_to_json (JSON_Object *obj, const char *name, ACVP_BN *bn);
+
+ACVP_RESULT acvp_stream_hex_msg (ACVP_CTX *ctx,
+                                 ACVP_STREAM_CB *cb,
+                                 ACVP_TEST_CASE *tc,
+                                 const unsigned char *content,
+                                 unsigned long long content_len,
+                                 unsigned long long full_len,
+                                 unsigned char *buf,
+                                 unsigned int buf_max,
+                                 unsigned int *chunk_len);
+
 ACVP_RESULT is_valid_tf_param (unsigned int value);
 
 ACVP_RESULT is_valid_hash_alg (char *value);
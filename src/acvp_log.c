@@ -0,0 +1,448 @@
+/*****************************************************************************
+* Copyright (c) 2016, Cisco Systems, Inc.
+* All rights reserved.
+
+* Redistribution and use in source and binary forms, with or without modification, 
+* are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice, 
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation 
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+* USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+#include "acvp.h"
+#include "acvp_lcl.h"
+
+/*
+ * A payload queued for the dump file, written by the dump thread
+ */
+typedef struct acvp_dump_entry_t {
+    time_t when;
+    char *label;
+    char *data;
+    int len;
+    struct acvp_dump_entry_t *next;
+} ACVP_DUMP_ENTRY;
+
+struct acvp_payload_dump_t {
+    FILE *fp;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    ACVP_DUMP_ENTRY *head;
+    ACVP_DUMP_ENTRY *tail;
+    int stop;
+};
+
+static void *acvp_payload_dump_main (void *arg) {
+    ACVP_PAYLOAD_DUMP *dump = (ACVP_PAYLOAD_DUMP *)arg;
+    ACVP_DUMP_ENTRY *entry;
+    char stamp[32];
+
+    pthread_mutex_lock(&dump->lock);
+    while (1) {
+        while (!dump->head && !dump->stop) {
+            pthread_cond_wait(&dump->cond, &dump->lock);
+        }
+        if (!dump->head) {
+            break;
+        }
+        entry = dump->head;
+        dump->head = entry->next;
+        if (!dump->head) {
+            dump->tail = NULL;
+        }
+        pthread_mutex_unlock(&dump->lock);
+
+        /*
+         * The file is written without holding the lock, so the
+         * session is never blocked by the disk
+         */
+        strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", gmtime(&entry->when));
+        fprintf(dump->fp, "=== %s %s %d bytes\n", stamp, entry->label, entry->len);
+        fwrite(entry->data, 1, entry->len, dump->fp);
+        fputs("\n", dump->fp);
+        free(entry->label);
+        free(entry->data);
+        free(entry);
+
+        pthread_mutex_lock(&dump->lock);
+        if (!dump->head) {
+            fflush(dump->fp);
+        }
+    }
+    pthread_mutex_unlock(&dump->lock);
+    return NULL;
+}
+
+/*
+ * Opens the payload dump file and starts the thread writing it
+ */
+ACVP_RESULT acvp_payload_dump_start (ACVP_CTX *ctx, const char *filename) {
+    ACVP_PAYLOAD_DUMP *dump;
+
+    acvp_payload_dump_stop(ctx);
+
+    dump = calloc(1, sizeof(ACVP_PAYLOAD_DUMP));
+    if (!dump) {
+        return ACVP_MALLOC_FAIL;
+    }
+    dump->fp = fopen(filename, "w");
+    if (!dump->fp) {
+        ACVP_LOG_ERR("Unable to open payload dump %s", filename);
+        free(dump);
+        return ACVP_INVALID_ARG;
+    }
+    pthread_mutex_init(&dump->lock, NULL);
+    pthread_cond_init(&dump->cond, NULL);
+    if (pthread_create(&dump->thread, NULL, acvp_payload_dump_main, dump)) {
+        ACVP_LOG_ERR("Unable to start the payload dump thread");
+        pthread_cond_destroy(&dump->cond);
+        pthread_mutex_destroy(&dump->lock);
+        fclose(dump->fp);
+        free(dump);
+        return ACVP_INVALID_ARG;
+    }
+
+    ctx->payload_dump = dump;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Writes out the queued payloads, stops the dump thread and
+ * closes the dump file
+ */
+void acvp_payload_dump_stop (ACVP_CTX *ctx) {
+    ACVP_PAYLOAD_DUMP *dump = ctx->payload_dump;
+
+    if (!dump) {
+        return;
+    }
+    pthread_mutex_lock(&dump->lock);
+    dump->stop = 1;
+    pthread_cond_signal(&dump->cond);
+    pthread_mutex_unlock(&dump->lock);
+    pthread_join(dump->thread, NULL);
+
+    pthread_cond_destroy(&dump->cond);
+    pthread_mutex_destroy(&dump->lock);
+    fclose(dump->fp);
+    free(dump);
+    ctx->payload_dump = NULL;
+}
+
+#define ACVP_REDACTED "<redacted>"
+
+/*
+ * Replaces the credentials in a request or response body: the TOTP
+ * password of the login and the access token handed out by the
+ * server.  Used for everything that writes bodies out, the session
+ * archive, the payload log and the payload dump.  The body is only
+ * parsed when it may hold one of them.  Returns the redacted body,
+ * to be freed with json_free_serialized_string(), or NULL when the
+ * body can be written as it is.
+ */
+char *acvp_redact_credentials (const char *body) {
+    static const char *fields[] = { "password", "accessToken" };
+    JSON_Value *val;
+    JSON_Array *arr;
+    JSON_Object *obj;
+    char *redacted;
+    int i, j, cnt;
+
+    if (!body || (!strstr(body, "\"password\"") && !strstr(body, "\"accessToken\""))) {
+        return NULL;
+    }
+    val = json_parse_string(body);
+    if (!val) {
+        return NULL;
+    }
+
+    /*
+     * ACVP messages are an array holding the version object and
+     * the message object
+     */
+    arr = json_value_get_array(val);
+    cnt = arr ? json_array_get_count(arr) : 1;
+    for (i = 0; i < cnt; i++) {
+        obj = arr ? json_array_get_object(arr, i) : json_value_get_object(val);
+        for (j = 0; obj && j < (int) (sizeof(fields) / sizeof(fields[0])); j++) {
+            if (json_object_get_string(obj, fields[j])) {
+                json_object_set_string(obj, fields[j], ACVP_REDACTED);
+            }
+        }
+    }
+    redacted = json_serialize_to_string(val);
+    json_value_free(val);
+    return redacted;
+}
+
+/*
+ * Queues a copy of a payload for the dump thread
+ */
+static void acvp_payload_dump_queue (ACVP_CTX *ctx, const char *label, const char *buf, int len) {
+    ACVP_PAYLOAD_DUMP *dump = ctx->payload_dump;
+    ACVP_DUMP_ENTRY *entry;
+
+    entry = calloc(1, sizeof(ACVP_DUMP_ENTRY));
+    if (!entry) {
+        return;
+    }
+    entry->data = malloc(len);
+    entry->label = strdup(label);
+    if (!entry->data || !entry->label) {
+        free(entry->data);
+        free(entry->label);
+        free(entry);
+        return;
+    }
+    memcpy(entry->data, buf, len);
+    entry->len = len;
+    entry->when = time(NULL);
+
+    pthread_mutex_lock(&dump->lock);
+    if (dump->tail) {
+        dump->tail->next = entry;
+    } else {
+        dump->head = entry;
+    }
+    dump->tail = entry;
+    pthread_cond_signal(&dump->cond);
+    pthread_mutex_unlock(&dump->lock);
+}
+
+/*
+ * Logs a request or response body.  At most ACVP_LOG_PAYLOAD_MAX
+ * bytes are formatted, no matter how large the body is, the whole
+ * body only goes to the payload dump when one is enabled.
+ */
+void acvp_log_payload (ACVP_CTX *ctx, ACVP_LOG_LVL level, const char *label, const char *buf) {
+    char *redacted;
+    int len;
+
+    if (!ctx || !buf) {
+        return;
+    }
+    if (!ctx->payload_dump && !ACVP_LOG_ON(ctx, level)) {
+        return;
+    }
+
+    redacted = acvp_redact_credentials(buf);
+    if (redacted) {
+        buf = redacted;
+    }
+    len = strlen(buf);
+    if (ctx->payload_dump) {
+        acvp_payload_dump_queue(ctx, label, buf, len);
+    }
+    if (ACVP_LOG_ON(ctx, level)) {
+        acvp_log_msg(ctx, level, "***ACVP [PAYLOAD]--> %s (%d bytes) %.*s%s\n", label, len,
+                     len > ACVP_LOG_PAYLOAD_MAX ? ACVP_LOG_PAYLOAD_MAX : len, buf,
+                     len > ACVP_LOG_PAYLOAD_MAX ? "..." : "");
+    }
+    if (redacted) {
+        json_free_serialized_string(redacted);
+    }
+}
+
+/*
+ * Ring buffer of events for the event logger.  The session only
+ * copies an event into the ring, the logger thread delivers the
+ * events to the application.
+ */
+struct acvp_log_ring_t {
+    ACVP_RESULT (*event_cb) (ACVP_LOG_EVENT *event);
+    ACVP_LOG_EVENT *events;
+    int size;
+    int head;           /* next event to deliver */
+    int count;          /* events waiting in the ring */
+    int dropped;        /* events dropped since the last delivery */
+    int stop;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static void *acvp_log_ring_main (void *arg) {
+    ACVP_LOG_RING *ring = (ACVP_LOG_RING *)arg;
+    ACVP_LOG_EVENT event, drop_event;
+    struct timeval now;
+    int dropped;
+
+    pthread_mutex_lock(&ring->lock);
+    while (1) {
+        while (!ring->count && !ring->dropped && !ring->stop) {
+            pthread_cond_wait(&ring->cond, &ring->lock);
+        }
+        if (!ring->count && !ring->dropped) {
+            break;
+        }
+        dropped = ring->dropped;
+        ring->dropped = 0;
+        if (ring->count) {
+            memcpy(&event, &ring->events[ring->head], sizeof(ACVP_LOG_EVENT));
+            ring->head = (ring->head + 1) % ring->size;
+            ring->count--;
+        } else {
+            event.type = ACVP_EVENT_DROPPED;
+        }
+        pthread_mutex_unlock(&ring->lock);
+
+        /*
+         * The application's logger is called without the lock
+         * held, so the session can keep adding events
+         */
+        if (dropped) {
+            memset(&drop_event, 0x0, sizeof(ACVP_LOG_EVENT));
+            drop_event.type = ACVP_EVENT_DROPPED;
+            drop_event.level = ACVP_LOG_LVL_WARN;
+            gettimeofday(&now, NULL);
+            drop_event.timestamp = (long long) now.tv_sec * 1000000 + now.tv_usec;
+            snprintf(drop_event.msg, ACVP_LOG_MSG_MAX, "%d events dropped, the event ring is full", dropped);
+            drop_event.field_cnt = 1;
+            strcpy(drop_event.fields[0].key, "dropped");
+            snprintf(drop_event.fields[0].value, ACVP_LOG_VALUE_MAX, "%d", dropped);
+            (ring->event_cb)(&drop_event);
+        }
+        if (event.type != ACVP_EVENT_DROPPED) {
+            (ring->event_cb)(&event);
+        }
+
+        pthread_mutex_lock(&ring->lock);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return NULL;
+}
+
+/*
+ * Allocates the event ring and starts the thread delivering
+ * the events to event_cb
+ */
+ACVP_RESULT acvp_log_ring_start (ACVP_CTX *ctx, ACVP_RESULT (*event_cb) (ACVP_LOG_EVENT *event), int ring_size) {
+    ACVP_LOG_RING *ring;
+
+    acvp_log_ring_stop(ctx);
+
+    ring = calloc(1, sizeof(ACVP_LOG_RING));
+    if (!ring) {
+        return ACVP_MALLOC_FAIL;
+    }
+    ring->events = calloc(ring_size, sizeof(ACVP_LOG_EVENT));
+    if (!ring->events) {
+        free(ring);
+        return ACVP_MALLOC_FAIL;
+    }
+    ring->size = ring_size;
+    ring->event_cb = event_cb;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->cond, NULL);
+    if (pthread_create(&ring->thread, NULL, acvp_log_ring_main, ring)) {
+        ACVP_LOG_ERR("Unable to start the event logger thread");
+        pthread_cond_destroy(&ring->cond);
+        pthread_mutex_destroy(&ring->lock);
+        free(ring->events);
+        free(ring);
+        return ACVP_INVALID_ARG;
+    }
+
+    ctx->log_ring = ring;
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Delivers the events left in the ring and stops the logger thread
+ */
+void acvp_log_ring_stop (ACVP_CTX *ctx) {
+    ACVP_LOG_RING *ring = ctx->log_ring;
+
+    if (!ring) {
+        return;
+    }
+    pthread_mutex_lock(&ring->lock);
+    ring->stop = 1;
+    pthread_cond_signal(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+    pthread_join(ring->thread, NULL);
+
+    /*
+     * Log messages go back to the test_progress_cb
+     */
+    ctx->log_ring = NULL;
+    pthread_cond_destroy(&ring->cond);
+    pthread_mutex_destroy(&ring->lock);
+    free(ring->events);
+    free(ring);
+}
+
+/*
+ * Adds an event to the ring.  The fields are given as field_cnt
+ * pairs of key and value strings.  This never waits for the
+ * logger, when the ring is full the event is dropped.
+ */
+void acvp_log_event (ACVP_CTX *ctx, ACVP_LOG_EVENT_TYPE type, ACVP_LOG_LVL level, int tc_id,
+                     const char *msg, int field_cnt, ...) {
+    ACVP_LOG_RING *ring;
+    ACVP_LOG_EVENT event;
+    struct timeval now;
+    va_list arguments;
+    const char *key, *value;
+    int i;
+
+    if (!ctx || !ctx->log_ring || ctx->debug < level) {
+        return;
+    }
+    ring = ctx->log_ring;
+
+    event.type = type;
+    event.level = level;
+    event.vs_id = ctx->vs_id;
+    event.tc_id = tc_id;
+    gettimeofday(&now, NULL);
+    event.timestamp = (long long) now.tv_sec * 1000000 + now.tv_usec;
+    snprintf(event.msg, ACVP_LOG_MSG_MAX, "%s", msg ? msg : "");
+
+    if (field_cnt > ACVP_LOG_FIELD_MAX) {
+        field_cnt = ACVP_LOG_FIELD_MAX;
+    }
+    event.field_cnt = field_cnt;
+    va_start(arguments, field_cnt);
+    for (i = 0; i < field_cnt; i++) {
+        key = va_arg(arguments, const char *);
+        value = va_arg(arguments, const char *);
+        snprintf(event.fields[i].key, ACVP_LOG_KEY_MAX, "%s", key);
+        snprintf(event.fields[i].value, ACVP_LOG_VALUE_MAX, "%s", value ? value : "");
+    }
+    va_end(arguments);
+
+    pthread_mutex_lock(&ring->lock);
+    if (ring->count == ring->size) {
+        ring->dropped++;
+    } else {
+        memcpy(&ring->events[(ring->head + ring->count) % ring->size], &event,
+               sizeof(ACVP_LOG_EVENT) - (ACVP_LOG_FIELD_MAX - field_cnt) * sizeof(ACVP_LOG_FIELD));
+        ring->count++;
+        pthread_cond_signal(&ring->cond);
+    }
+    pthread_mutex_unlock(&ring->lock);
+}
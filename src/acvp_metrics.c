@@ -0,0 +1,340 @@
+/*****************************************************************************
+* Copyright (c) 2016, Cisco Systems, Inc.
+* All rights reserved.
+
+* Redistribution and use in source and binary forms, with or without modification, 
+* are permitted provided that the following conditions are met:
+*
+* 1. Redistributions of source code must retain the above copyright notice, 
+*    this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation 
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE 
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+* USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "acvp.h"
+#include "acvp_lcl.h"
+
+/*
+ * The metrics of all vector sets of the session.  The lock
+ * protects the callback statistics, the crypto handler may be
+ * called from several worker threads at once.
+ */
+struct acvp_metrics_t {
+    pthread_mutex_t lock;
+    ACVP_VS_METRICS *list;
+    ACVP_VS_METRICS *cur;
+};
+
+static const char *acvp_metrics_phase_name[ACVP_PHASE_MAX] = {
+    "download",
+    "parse",
+    "process",
+    "serialize",
+    "upload"
+};
+
+static double acvp_metrics_elapsed (struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+ACVP_RESULT acvp_metrics_start (ACVP_CTX *ctx) {
+    ACVP_METRICS *metrics;
+
+    if (ctx->metrics) {
+        return ACVP_SUCCESS;
+    }
+    metrics = calloc(1, sizeof(ACVP_METRICS));
+    if (!metrics) {
+        return ACVP_MALLOC_FAIL;
+    }
+    pthread_mutex_init(&metrics->lock, NULL);
+    ctx->metrics = metrics;
+    return ACVP_SUCCESS;
+}
+
+void acvp_metrics_free (ACVP_CTX *ctx) {
+    ACVP_METRICS *metrics = ctx->metrics;
+    ACVP_VS_METRICS *vs, *next;
+
+    if (!metrics) {
+        return;
+    }
+    for (vs = metrics->list; vs; vs = next) {
+        next = vs->next;
+        free(vs);
+    }
+    pthread_mutex_destroy(&metrics->lock);
+    free(metrics);
+    ctx->metrics = NULL;
+}
+
+/*
+ * Selects the vector set the following measurements are added to,
+ * a vector set that is processed again keeps adding to its metrics
+ */
+void acvp_metrics_vs (ACVP_CTX *ctx, int vs_id) {
+    ACVP_METRICS *metrics = ctx->metrics;
+    ACVP_VS_METRICS *vs, *last = NULL;
+
+    if (!metrics) {
+        return;
+    }
+    for (vs = metrics->list; vs; vs = vs->next) {
+        if (vs->vs_id == vs_id) {
+            metrics->cur = vs;
+            return;
+        }
+        last = vs;
+    }
+    vs = calloc(1, sizeof(ACVP_VS_METRICS));
+    if (!vs) {
+        metrics->cur = NULL;
+        return;
+    }
+    vs->vs_id = vs_id;
+    if (last) {
+        last->next = vs;
+    } else {
+        metrics->list = vs;
+    }
+    metrics->cur = vs;
+}
+
+void acvp_metrics_timer_start (ACVP_CTX *ctx, ACVP_METRICS_TIMER *timer) {
+    if (!ctx->metrics) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &timer->wall);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &timer->cpu);
+}
+
+/*
+ * Adds the wall and CPU time since acvp_metrics_timer_start() to
+ * a phase of the current vector set.  The CPU time is that of the
+ * whole process, so it includes the worker threads.
+ */
+void acvp_metrics_timer_stop (ACVP_CTX *ctx, ACVP_METRICS_PHASE phase, ACVP_METRICS_TIMER *timer) {
+    struct timespec wall, cpu;
+    ACVP_VS_METRICS *vs;
+
+    if (!ctx->metrics || !ctx->metrics->cur) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &wall);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+    vs = ctx->metrics->cur;
+    vs->wall[phase] += acvp_metrics_elapsed(&timer->wall, &wall);
+    vs->cpu[phase] += acvp_metrics_elapsed(&timer->cpu, &cpu);
+}
+
+void acvp_metrics_bytes (ACVP_CTX *ctx, long long received, long long sent) {
+    if (!ctx->metrics || !ctx->metrics->cur) {
+        return;
+    }
+    ctx->metrics->cur->bytes_received += received;
+    ctx->metrics->cur->bytes_sent += sent;
+}
+
+/*
+ * Counts the test groups and test cases of a vector set
+ */
+void acvp_metrics_count_tests (ACVP_CTX *ctx, JSON_Object *obj) {
+    JSON_Array *groups;
+    ACVP_VS_METRICS *vs;
+    int i, cnt;
+
+    if (!ctx->metrics || !ctx->metrics->cur) {
+        return;
+    }
+    vs = ctx->metrics->cur;
+    groups = json_object_get_array(obj, "testGroups");
+    cnt = json_array_get_count(groups);
+    vs->test_groups = cnt;
+    vs->test_cases = 0;
+    for (i = 0; i < cnt; i++) {
+        vs->test_cases += json_array_get_count(json_object_get_array(json_array_get_object(groups, i), "tests"));
+    }
+}
+
+/*
+ * Returns the id of the test case a crypto handler was called for,
+ * 0 for the KAS test cases which do not carry one
+ */
+static int acvp_tc_id (ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc) {
+    switch (cap->cap_type) {
+    case ACVP_SYM_TYPE:
+        return tc->tc.symmetric->tc_id;
+    case ACVP_HASH_TYPE:
+        return tc->tc.hash->tc_id;
+    case ACVP_DRBG_TYPE:
+        return tc->tc.drbg->tc_id;
+    case ACVP_HMAC_TYPE:
+        return tc->tc.hmac->tc_id;
+    case ACVP_CMAC_TYPE:
+        return tc->tc.cmac->tc_id;
+    case ACVP_RSA_KEYGEN_TYPE:
+        return tc->tc.rsa_keygen->tc_id;
+    case ACVP_RSA_SIGGEN_TYPE:
+    case ACVP_RSA_SIGVER_TYPE:
+        return tc->tc.rsa_sig->tc_id;
+    case ACVP_ECDSA_KEYGEN_TYPE:
+    case ACVP_ECDSA_KEYVER_TYPE:
+    case ACVP_ECDSA_SIGGEN_TYPE:
+    case ACVP_ECDSA_SIGVER_TYPE:
+        return tc->tc.ecdsa->tc_id;
+    case ACVP_DSA_TYPE:
+        return tc->tc.dsa->tc_id;
+    case ACVP_KDF135_TLS_TYPE:
+        return tc->tc.kdf135_tls->tc_id;
+    case ACVP_KDF135_SNMP_TYPE:
+        return tc->tc.kdf135_snmp->tc_id;
+    case ACVP_KDF135_SSH_TYPE:
+        return tc->tc.kdf135_ssh->tc_id;
+    case ACVP_KDF135_SRTP_TYPE:
+        return tc->tc.kdf135_srtp->tc_id;
+    case ACVP_KDF135_IKEV2_TYPE:
+        return tc->tc.kdf135_ikev2->tc_id;
+    case ACVP_KDF135_IKEV1_TYPE:
+        return tc->tc.kdf135_ikev1->tc_id;
+    case ACVP_KDF135_X963_TYPE:
+        return tc->tc.kdf135_x963->tc_id;
+    case ACVP_KDF135_TPM_TYPE:
+        return tc->tc.kdf135_tpm->tc_id;
+    case ACVP_KDF108_TYPE:
+        return tc->tc.kdf108->tc_id;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Invokes the crypto handler for a test case.  With metrics enabled
+ * the latency of the call is added to the callback histogram of the
+ * current vector set.  A failed call is reported as an
+ * ACVP_EVENT_TC_FAIL event, except for the tag and wrap failures
+ * which are the expected result of a decrypt test.
+ */
+ACVP_RESULT acvp_call_crypto_handler (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tc) {
+    ACVP_METRICS *metrics = ctx->metrics;
+    struct timespec start, end;
+    ACVP_VS_METRICS *vs;
+    ACVP_RESULT rv;
+    double secs;
+    int bucket;
+
+    if (!metrics) {
+        rv = (cap->crypto_handler)(tc);
+        goto end;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rv = (cap->crypto_handler)(tc);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    secs = acvp_metrics_elapsed(&start, &end);
+
+    /*
+     * Bucket i holds the calls that took less than 2^i microseconds
+     */
+    for (bucket = 0; bucket < ACVP_METRICS_HIST_MAX - 1; bucket++) {
+        if (secs * 1e6 < (double) (1 << bucket)) {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&metrics->lock);
+    vs = metrics->cur;
+    if (vs) {
+        vs->callbacks++;
+        vs->callback_time += secs;
+        if (secs > vs->callback_max) {
+            vs->callback_max = secs;
+        }
+        vs->callback_hist[bucket]++;
+    }
+    pthread_mutex_unlock(&metrics->lock);
+
+end:
+    if (rv != ACVP_SUCCESS && rv != ACVP_CRYPTO_TAG_FAIL && rv != ACVP_CRYPTO_WRAP_FAIL) {
+        acvp_log_event(ctx, ACVP_EVENT_TC_FAIL, ACVP_LOG_LVL_ERR, acvp_tc_id(cap, tc), NULL, 0);
+    }
+    return rv;
+}
+
+const ACVP_VS_METRICS *acvp_metrics_list (ACVP_CTX *ctx) {
+    return ctx->metrics ? ctx->metrics->list : NULL;
+}
+
+/*
+ * Writes the metrics of all vector sets as JSON
+ */
+ACVP_RESULT acvp_metrics_export (ACVP_CTX *ctx, const char *filename) {
+    JSON_Value *val, *vs_val, *phase_val, *cb_val;
+    JSON_Object *vs_obj, *phases_obj, *cb_obj;
+    JSON_Array *vs_arr, *hist_arr;
+    ACVP_VS_METRICS *vs;
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    int i;
+
+    val = json_value_init_object();
+    json_object_set_value(json_value_get_object(val), "vectorSets", json_value_init_array());
+    vs_arr = json_object_get_array(json_value_get_object(val), "vectorSets");
+
+    for (vs = ctx->metrics ? ctx->metrics->list : NULL; vs; vs = vs->next) {
+        vs_val = json_value_init_object();
+        vs_obj = json_value_get_object(vs_val);
+        json_object_set_number(vs_obj, "vsId", vs->vs_id);
+
+        json_object_set_value(vs_obj, "phases", json_value_init_object());
+        phases_obj = json_object_get_object(vs_obj, "phases");
+        for (i = 0; i < ACVP_PHASE_MAX; i++) {
+            phase_val = json_value_init_object();
+            json_object_set_number(json_value_get_object(phase_val), "wall", vs->wall[i]);
+            json_object_set_number(json_value_get_object(phase_val), "cpu", vs->cpu[i]);
+            json_object_set_value(phases_obj, acvp_metrics_phase_name[i], phase_val);
+        }
+
+        json_object_set_number(vs_obj, "bytesReceived", vs->bytes_received);
+        json_object_set_number(vs_obj, "bytesSent", vs->bytes_sent);
+        json_object_set_number(vs_obj, "testGroups", vs->test_groups);
+        json_object_set_number(vs_obj, "testCases", vs->test_cases);
+
+        cb_val = json_value_init_object();
+        cb_obj = json_value_get_object(cb_val);
+        json_object_set_number(cb_obj, "count", vs->callbacks);
+        json_object_set_number(cb_obj, "total", vs->callback_time);
+        json_object_set_number(cb_obj, "max", vs->callback_max);
+        json_object_set_value(cb_obj, "histogram", json_value_init_array());
+        hist_arr = json_object_get_array(cb_obj, "histogram");
+        for (i = 0; i < ACVP_METRICS_HIST_MAX; i++) {
+            json_array_append_number(hist_arr, vs->callback_hist[i]);
+        }
+        json_object_set_value(vs_obj, "callbacks", cb_val);
+
+        json_array_append_value(vs_arr, vs_val);
+    }
+
+    if (json_serialize_to_file_pretty(val, filename) != JSONSuccess) {
+        ACVP_LOG_ERR("Unable to write metrics to %s", filename);
+        rv = ACVP_INVALID_ARG;
+    }
+    json_value_free(val);
+    return rv;
+}
@@ -40,12 +40,33 @@
  * the JSON processing for a single test case.
  */
 static ACVP_RESULT acvp_rsa_output_tc (ACVP_CTX *ctx, ACVP_RSA_KEYGEN_TC *stc, JSON_Object *tc_rsp) {
-    
-    json_object_set_string(tc_rsp, "p", (const char *)stc->p);
-    json_object_set_string(tc_rsp, "q", (const char *)stc->q);
-    json_object_set_string(tc_rsp, "n", (const char *)stc->n);
-    json_object_set_string(tc_rsp, "d", (const char *)stc->d);
-    json_object_set_string(tc_rsp, "e", (const char *)stc->e);
+    ACVP_RESULT rv;
+
+    if (ctx->bn_binary) {
+        rv = acvp_bn_to_json(tc_rsp, "p", &stc->bn.p);
+        if (rv == ACVP_SUCCESS) {
+            rv = acvp_bn_to_json(tc_rsp, "q", &stc->bn.q);
+        }
+        if (rv == ACVP_SUCCESS) {
+            rv = acvp_bn_to_json(tc_rsp, "n", &stc->bn.n);
+        }
+        if (rv == ACVP_SUCCESS) {
+            rv = acvp_bn_to_json(tc_rsp, "d", &stc->bn.d);
+        }
+        if (rv == ACVP_SUCCESS) {
+            rv = acvp_bn_to_json(tc_rsp, "e", &stc->bn.e);
+        }
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("ERROR: hex conversion failure in RSA keygen module");
+            return rv;
+        }
+    } else {
+        json_object_set_string(tc_rsp, "p", (const char *)stc->p);
+        json_object_set_string(tc_rsp, "q", (const char *)stc->q);
+        json_object_set_string(tc_rsp, "n", (const char *)stc->n);
+        json_object_set_string(tc_rsp, "d", (const char *)stc->d);
+        json_object_set_string(tc_rsp, "e", (const char *)stc->e);
+    }
     
     if (strncmp(stc->key_format, "crt", 8) == 0) {
         json_object_set_string(tc_rsp, "xP", (const char *)stc->xp);
@@ -94,6 +115,7 @@ static ACVP_RESULT acvp_rsa_keygen_release_tc (ACVP_RSA_KEYGEN_TC *stc) {
     if (stc->q) { free(stc->q); }
     if (stc->n) { free(stc->n); }
     if (stc->d) { free(stc->d); }
+    acvp_bn_free((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
 
     return ACVP_SUCCESS;
 }
@@ -122,9 +144,18 @@ static ACVP_RESULT acvp_rsa_keygen_init_tc (ACVP_CTX *ctx,
     stc->rand_pq = rand_pq;
     stc->modulo = modulo;
     
-    stc->e = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
-    if (!stc->e) { return ACVP_MALLOC_FAIL; }
-    strncpy((char *)stc->e, e, strnlen(e, ACVP_RSA_EXP_LEN_MAX));
+    if (ctx->bn_binary) {
+        rv = acvp_bn_alloc((ACVP_BN *)&stc->bn, ACVP_BN_CNT(stc->bn));
+        if (rv != ACVP_SUCCESS) { return rv; }
+        if (e) {
+            rv = acvp_hexstr_to_bn(e, &stc->bn.e);
+            if (rv != ACVP_SUCCESS) { return rv; }
+        }
+    } else {
+        stc->e = calloc(ACVP_RSA_EXP_LEN_MAX, sizeof(char));
+        if (!stc->e) { return ACVP_MALLOC_FAIL; }
+        strncpy((char *)stc->e, e, strnlen(e, ACVP_RSA_EXP_LEN_MAX));
+    }
     
     stc->seed = calloc(ACVP_RSA_SEEDLEN_MAX, sizeof(char));
     if (!stc->seed) { return ACVP_MALLOC_FAIL; }
@@ -183,12 +214,12 @@ ACVP_RESULT acvp_rsa_keygen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
     JSON_Value *r_tval = NULL; /* Response testval */
     JSON_Object *r_tobj = NULL; /* Response testobj */
     ACVP_CAPS_LIST *cap;
-    ACVP_RSA_KEYGEN_TC stc;
-    ACVP_TEST_CASE tc;
-    ACVP_RESULT rv;
+    ACVP_RSA_KEYGEN_TC *stcs = NULL;
+    ACVP_TEST_CASE *tcs = NULL;
+    ACVP_RESULT rv = ACVP_SUCCESS;
     
     ACVP_CIPHER alg_id;
-    char *json_result = NULL, *rand_pq_str = NULL;
+    char *rand_pq_str = NULL;
     unsigned int mod = 0;
     int info_gen_by_server, rand_pq, seed_len;
     char *pub_exp_mode, *key_format, *prime_test;
@@ -202,7 +233,6 @@ ACVP_RESULT acvp_rsa_keygen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
         return (ACVP_MALFORMED_JSON);
     }
     
-    tc.tc.rsa_keygen = &stc;
     mode_str = (char *) json_object_get_string(obj, "mode");
     
     alg_id = ACVP_RSA_KEYGEN;
@@ -268,7 +298,24 @@ ACVP_RESULT acvp_rsa_keygen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
 
         tests = json_object_get_array(groupobj, "tests");
         t_cnt = json_array_get_count(tests);
-        
+        if (!t_cnt) {
+            continue;
+        }
+
+        /*
+         * Each test case is a full prime search, so set up all
+         * the test cases in the group first and let
+         * acvp_run_crypto_handlers() spread them across the
+         * worker threads.  Each one gets its own test case.
+         */
+        stcs = calloc(t_cnt, sizeof(ACVP_RSA_KEYGEN_TC));
+        tcs = calloc(t_cnt, sizeof(ACVP_TEST_CASE));
+        if (!stcs || !tcs) {
+            ACVP_LOG_ERR("ERROR: Unable to malloc test cases");
+            rv = ACVP_MALLOC_FAIL;
+            goto key_err;
+        }
+
         for (j = 0; j < t_cnt; j++) {
             ACVP_LOG_INFO("Found new RSA test vector...");
             testval = json_array_get_value(tests, j);
@@ -277,14 +324,6 @@ ACVP_RESULT acvp_rsa_keygen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
 
             ACVP_LOG_INFO("        Test case: %d", j);
             ACVP_LOG_INFO("             tcId: %d", tc_id);
-            
-            /*
-             * Create a new test case in the response
-             */
-            r_tval = json_value_init_object();
-            r_tobj = json_value_get_object(r_tval);
-
-            json_object_set_number(r_tobj, "tcId", tc_id);
 
             /*
              * Retrieve values from JSON and initialize the tc
@@ -301,54 +340,66 @@ ACVP_RESULT acvp_rsa_keygen_kat_handler (ACVP_CTX *ctx, JSON_Object *obj) {
                 seed = (char *) json_object_get_string(testobj, "seed");
                 seed_len = strnlen(seed, ACVP_RSA_SEEDLEN_MAX);
             }
-    
-            rv = acvp_rsa_keygen_init_tc(ctx, &stc, tc_id, info_gen_by_server, hash_alg, key_format,
+
+            tcs[j].tc.rsa_keygen = &stcs[j];
+            rv = acvp_rsa_keygen_init_tc(ctx, &stcs[j], tc_id, info_gen_by_server, hash_alg, key_format,
                                          pub_exp_mode, mod, prime_test, rand_pq, e_str, seed, seed_len,
                                          bitlen1, bitlen2, bitlen3, bitlen4);
-
-            /* Process the current test vector... */
-            if (rv == ACVP_SUCCESS) {
-                rv = (cap->crypto_handler)(&tc);
-                if (rv != ACVP_SUCCESS) {
-                    ACVP_LOG_ERR("ERROR: crypto module failed the operation");
-                    rv = ACVP_CRYPTO_MODULE_FAIL;
-                    goto key_err;
-                }
+            if (rv != ACVP_SUCCESS) {
+                ACVP_LOG_ERR("ERROR: Unable to initialize test case %d", tc_id);
+                goto key_err;
             }
+        }
+
+        /* Process the test vectors of the group... */
+        rv = acvp_run_crypto_handlers(ctx, cap, tcs, t_cnt);
+        if (rv != ACVP_SUCCESS) {
+            goto key_err;
+        }
 
+        for (j = 0; j < t_cnt; j++) {
             /*
-             * Output the test case results using JSON
+             * Create a new test case in the response
              */
-            rv = acvp_rsa_output_tc(ctx, &stc, r_tobj);
-            if (rv != ACVP_SUCCESS) {
-                ACVP_LOG_ERR("ERROR: JSON output failure in hash module");
-                goto key_err;
-            }
-            
+            r_tval = json_value_init_object();
+            r_tobj = json_value_get_object(r_tval);
+
+            json_object_set_number(r_tobj, "tcId", stcs[j].tc_id);
+
             /*
-             * Release all the memory associated with the test case
+             * Output the test case results using JSON
              */
-            key_err:
-                acvp_rsa_keygen_release_tc(&stc);
+            rv = acvp_rsa_output_tc(ctx, &stcs[j], r_tobj);
 
             /* Append the test response value to array */
             json_array_append_value(r_tarr, r_tval);
             if (rv != ACVP_SUCCESS) {
-                goto end;
+                ACVP_LOG_ERR("ERROR: JSON output failure in hash module");
+                goto key_err;
             }
         }
+
+        /*
+         * Release all the memory associated with the test cases
+         */
+        key_err:
+        if (stcs) {
+            for (j = 0; j < t_cnt; j++) {
+                acvp_rsa_keygen_release_tc(&stcs[j]);
+            }
+        }
+        free(stcs);
+        free(tcs);
+        stcs = NULL;
+        tcs = NULL;
+        if (rv != ACVP_SUCCESS) {
+            goto end;
+        }
     }
 
     end:
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
     return rv;
 }
 
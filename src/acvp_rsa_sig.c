@@ -175,7 +175,7 @@ static ACVP_RESULT acvp_rsa_sig_kat_handler_internal (ACVP_CTX *ctx, JSON_Object
     ACVP_TEST_CASE tc;
     
     ACVP_CIPHER alg_id;
-    char *json_result = NULL, *mode_str;
+    char *mode_str;
     unsigned int mod = 0;
     unsigned char *msg, *signature;
     char *e_str = NULL, *n_str = NULL;
@@ -286,7 +286,7 @@ static ACVP_RESULT acvp_rsa_sig_kat_handler_internal (ACVP_CTX *ctx, JSON_Object
             
             /* Process the current test vector... */
             if (rv == ACVP_SUCCESS) {
-                rv = (cap->crypto_handler)(&tc);
+                rv = acvp_call_crypto_handler(ctx, cap, &tc);
                 if (rv != ACVP_SUCCESS) {
                     ACVP_LOG_ERR("ERROR: crypto module failed the operation");
                     rv = ACVP_CRYPTO_MODULE_FAIL;
@@ -321,13 +321,6 @@ static ACVP_RESULT acvp_rsa_sig_kat_handler_internal (ACVP_CTX *ctx, JSON_Object
     end:
     json_array_append_value(reg_arry, r_vs_val);
 
-    json_result = json_serialize_to_string_pretty(ctx->kat_resp);
-    if (ctx->debug == ACVP_LOG_LVL_VERBOSE) {
-        printf("\n\n%s\n\n", json_result);
-    } else {
-        ACVP_LOG_INFO("\n\n%s\n\n", json_result);
-    }
-    json_free_serialized_string(json_result);
     return rv;
 }
 
@@ -34,6 +34,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include "acvp.h"
 #include "acvp_lcl.h"
 
@@ -91,6 +92,225 @@ static void acvp_curl_log_peer_cert (ACVP_CTX *ctx, CURL *hnd) {
     }
 }
 
+typedef size_t (*ACVP_CURL_WRITE_FUNC) (void *ptr, size_t size, size_t nmemb, void *userdata);
+
+/*
+ * Returns the path portion of a URL.  The server name and port
+ * are not part of a recorded exchange, which allows a session
+ * archive to be replayed with any server configuration.
+ */
+static const char *acvp_url_path (const char *url) {
+    const char *path;
+
+    path = strstr(url, "://");
+    if (!path) {
+        return url;
+    }
+    path = strchr(path + 3, '/');
+    return path ? path : url;
+}
+
+/*
+ * This is the curl write callback used while recording.  It keeps
+ * a copy of the HTTP body for the session archive and passes the
+ * data on to the write function used by the request.
+ */
+static size_t acvp_curl_write_record_func (void *ptr, size_t size, size_t nmemb, void *userdata) {
+    ACVP_CTX *ctx = (ACVP_CTX *) userdata;
+    int len = size * nmemb;
+    int max;
+    char *buf;
+
+    if (ctx->record_len + len + 1 > ctx->record_max) {
+        max = ctx->record_max ? ctx->record_max : ACVP_REG_BUF_MAX;
+        while (ctx->record_len + len + 1 > max) {
+            max *= 2;
+        }
+        buf = realloc(ctx->record_buf, max);
+        if (!buf) {
+            fprintf(stderr, "\nmalloc failed in curl write record func\n");
+            return 0;
+        }
+        ctx->record_buf = buf;
+        ctx->record_max = max;
+    }
+    memcpy(&ctx->record_buf[ctx->record_len], ptr, len);
+    ctx->record_len += len;
+    ctx->record_buf[ctx->record_len] = 0;
+
+    if (!ctx->record_writefunc) {
+        return nmemb;
+    }
+    return ((ACVP_CURL_WRITE_FUNC) ctx->record_writefunc)(ptr, size, nmemb, userdata);
+}
+
+/*
+ * Appends a single HTTP exchange to the session archive.  Each
+ * exchange is written as one line of JSON so the archive can be
+ * flushed as the session progresses.  Credentials are redacted
+ * before they are written.
+ */
+static void acvp_record_exchange (ACVP_CTX *ctx, const char *method, char *url, char *data, long http_code) {
+    JSON_Value *val;
+    JSON_Object *obj;
+    char *line;
+    char *req, *rsp;
+
+    req = acvp_redact_credentials(data);
+    rsp = acvp_redact_credentials(ctx->record_len ? ctx->record_buf : NULL);
+
+    val = json_value_init_object();
+    obj = json_value_get_object(val);
+    json_object_set_string(obj, "method", method);
+    json_object_set_string(obj, "url", acvp_url_path(url));
+    if (data) {
+        json_object_set_string(obj, "request", req ? req : data);
+    }
+    json_object_set_number(obj, "status", http_code);
+    json_object_set_string(obj, "response", rsp ? rsp : (ctx->record_len ? ctx->record_buf : ""));
+    if (req) {
+        json_free_serialized_string(req);
+    }
+    if (rsp) {
+        json_free_serialized_string(rsp);
+    }
+
+    line = json_serialize_to_string(val);
+    if (line) {
+        fprintf(ctx->record_fp, "%s\n", line);
+        fflush(ctx->record_fp);
+        json_free_serialized_string(line);
+    } else {
+        ACVP_LOG_ERR("Unable to record %s %s", method, acvp_url_path(url));
+    }
+    json_value_free(val);
+    ctx->record_len = 0;
+}
+
+/*
+ * This function stands in for the server when a session archive
+ * is replayed.  The first unused exchange with the same method and
+ * path is handed to the write function of the request, just as curl
+ * would, and then removed so that repeated requests (e.g. retries)
+ * are served in the order they were recorded.
+ *
+ * Return value is the recorded HTTP status, or 0 when the archive
+ * holds no matching exchange.
+ */
+static long acvp_replay_exchange (ACVP_CTX *ctx, const char *method, char *url, void *writefunc) {
+    JSON_Array *exchanges;
+    JSON_Object *obj;
+    const char *path = acvp_url_path(url);
+    const char *rsp;
+    long http_code;
+    int i, cnt, len;
+
+    exchanges = json_value_get_array(ctx->replay_val);
+    cnt = json_array_get_count(exchanges);
+    for (i = 0; i < cnt; i++) {
+        obj = json_array_get_object(exchanges, i);
+        if (strcmp(json_object_get_string(obj, "method"), method) ||
+            strcmp(json_object_get_string(obj, "url"), path)) {
+            continue;
+        }
+
+        if (ctx->replay_latency) {
+            sleep(ctx->replay_latency / 1000);
+            usleep((ctx->replay_latency % 1000) * 1000);
+        }
+
+        http_code = json_object_get_number(obj, "status");
+        rsp = json_object_get_string(obj, "response");
+        len = strlen(rsp);
+        ctx->read_ctr = 0;
+        if (writefunc && len) {
+            if (((ACVP_CURL_WRITE_FUNC) writefunc)((void *) rsp, 1, len, ctx) != (size_t) len) {
+                ACVP_LOG_ERR("Unable to replay %s %s", method, path);
+                http_code = 0;
+            }
+        }
+        json_array_remove(exchanges, i);
+        return (http_code);
+    }
+
+    ACVP_LOG_ERR("Session archive has no exchange for %s %s", method, path);
+    return 0;
+}
+
+/*
+ * Loads the exchanges of a session archive written while recording,
+ * these are served by acvp_replay_exchange() instead of the server.
+ */
+ACVP_RESULT acvp_load_replay_archive (ACVP_CTX *ctx, const char *archive) {
+    ACVP_RESULT rv = ACVP_SUCCESS;
+    FILE *fp;
+    char *buf, *line, *next;
+    long size;
+    JSON_Value *val;
+    JSON_Object *obj;
+    int cnt = 0;
+
+    fp = fopen(archive, "r");
+    if (!fp) {
+        ACVP_LOG_ERR("Unable to open session archive %s", archive);
+        return ACVP_INVALID_ARG;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    buf = calloc(1, size + 1);
+    if (!buf) {
+        fclose(fp);
+        return ACVP_MALLOC_FAIL;
+    }
+    if (fread(buf, 1, size, fp) != (size_t) size) {
+        ACVP_LOG_ERR("Unable to read session archive %s", archive);
+        fclose(fp);
+        free(buf);
+        return ACVP_INVALID_ARG;
+    }
+    fclose(fp);
+
+    if (ctx->replay_val) {
+        json_value_free(ctx->replay_val);
+    }
+    ctx->replay_val = json_value_init_array();
+
+    for (line = buf; line && *line; line = next) {
+        next = strchr(line, '\n');
+        if (next) {
+            *next++ = 0;
+        }
+        if (!*line) {
+            continue;
+        }
+        val = json_parse_string(line);
+        obj = json_value_get_object(val);
+        if (!obj || !json_object_get_string(obj, "method") ||
+            !json_object_get_string(obj, "url") ||
+            !json_object_get_string(obj, "response")) {
+            ACVP_LOG_ERR("Malformed exchange %d in session archive %s", cnt + 1, archive);
+            if (val) {
+                json_value_free(val);
+            }
+            rv = ACVP_MALFORMED_JSON;
+            break;
+        }
+        json_array_append_value(json_value_get_array(ctx->replay_val), val);
+        cnt++;
+    }
+    free(buf);
+
+    if (rv != ACVP_SUCCESS) {
+        json_value_free(ctx->replay_val);
+        ctx->replay_val = NULL;
+        return rv;
+    }
+
+    ACVP_LOG_STATUS("Replaying %d exchanges from session archive %s", cnt, archive);
+    return ACVP_SUCCESS;
+}
+
 /*
  * This function uses libcurl to send a simple HTTP GET
  * request with no Content-Type header.
@@ -107,9 +327,14 @@ static void acvp_curl_log_peer_cert (ACVP_CTX *ctx, CURL *hnd) {
  */
 static long acvp_curl_http_get (ACVP_CTX *ctx, char *url, void *writefunc) {
     long http_code = 0;
+    char status[16];
     CURL *hnd;
     struct curl_slist *slist;
 
+    if (ctx->replay_val) {
+        return acvp_replay_exchange(ctx, "GET", url, writefunc);
+    }
+
     slist = NULL;
     /*
      * Create the Authorzation header if needed
@@ -143,6 +368,16 @@ static long acvp_curl_http_get (ACVP_CTX *ctx, char *url, void *writefunc) {
         curl_easy_setopt(hnd, CURLOPT_SSLKEYTYPE, "PEM");
         curl_easy_setopt(hnd, CURLOPT_SSLKEY, ctx->tls_key);
     }
+    /*
+     * When recording, the HTTP data is copied to the session
+     * archive on its way to the callback function
+     */
+    if (ctx->record_fp) {
+        ctx->record_len = 0;
+        ctx->record_writefunc = writefunc;
+        writefunc = &acvp_curl_write_record_func;
+    }
+
     /*
      * If the caller wants the HTTP data from the server
      * set the callback function
@@ -173,6 +408,15 @@ static long acvp_curl_http_get (ACVP_CTX *ctx, char *url, void *writefunc) {
         ACVP_LOG_ERR("HTTP response: %d\n", (int) http_code);
     }
 
+    if (ctx->record_fp) {
+        acvp_record_exchange(ctx, "GET", url, NULL, http_code);
+    }
+    if (ctx->log_ring) {
+        snprintf(status, sizeof(status), "%ld", http_code);
+        acvp_log_event(ctx, ACVP_EVENT_HTTP, ACVP_LOG_LVL_INFO, 0, NULL, 3, "method", "GET",
+                       "path", acvp_url_path(url), "status", status);
+    }
+
     curl_easy_cleanup(hnd);
     hnd = NULL;
     if (slist) {
@@ -200,10 +444,15 @@ static long acvp_curl_http_get (ACVP_CTX *ctx, char *url, void *writefunc) {
  */
 static long acvp_curl_http_post (ACVP_CTX *ctx, char *url, char *data, void *writefunc) {
     long http_code = 0;
+    char status[16];
     CURL *hnd;
     CURLcode crv;
     struct curl_slist *slist;
 
+    if (ctx->replay_val) {
+        return acvp_replay_exchange(ctx, "POST", url, writefunc);
+    }
+
     /*
      * Set the Content-Type header in the HTTP request
      */
@@ -248,6 +497,16 @@ static long acvp_curl_http_post (ACVP_CTX *ctx, char *url, char *data, void *wri
         curl_easy_setopt(hnd, CURLOPT_SSLKEY, ctx->tls_key);
     }
 
+    /*
+     * When recording, the HTTP data is copied to the session
+     * archive on its way to the callback function
+     */
+    if (ctx->record_fp) {
+        ctx->record_len = 0;
+        ctx->record_writefunc = writefunc;
+        writefunc = &acvp_curl_write_record_func;
+    }
+
     /*
      * If the caller wants the HTTP data from the server
      * set the callback function
@@ -281,6 +540,15 @@ static long acvp_curl_http_post (ACVP_CTX *ctx, char *url, char *data, void *wri
         ACVP_LOG_ERR("HTTP response: %d\n", (int) http_code);
     }
 
+    if (ctx->record_fp) {
+        acvp_record_exchange(ctx, "POST", url, data, http_code);
+    }
+    if (ctx->log_ring) {
+        snprintf(status, sizeof(status), "%ld", http_code);
+        acvp_log_event(ctx, ACVP_EVENT_HTTP, ACVP_LOG_LVL_INFO, 0, NULL, 3, "method", "POST",
+                       "path", acvp_url_path(url), "status", status);
+    }
+
     curl_easy_cleanup(hnd);
     hnd = NULL;
     curl_slist_free_all(slist);
@@ -470,7 +738,14 @@ ACVP_RESULT acvp_retrieve_sample_answers (ACVP_CTX *ctx, int vs_id) {
      * Update user with status
      */
     ACVP_LOG_STATUS("Successfully received sample answers from ACVP server");
-    printf("\n%s\n\n", ctx->ans_buf);
+    if (ctx->ans_buf) {
+        /*
+         * The answers are the output of a sample session, they are
+         * printed whole rather than logged as a payload
+         */
+        printf("\n%s\n\n", ctx->ans_buf);
+        acvp_log_payload(ctx, ACVP_LOG_LVL_VERBOSE, "Sample answers", ctx->ans_buf);
+    }
     
     free(ctx->ans_buf);
     ctx->ans_buf = NULL;
@@ -497,7 +772,7 @@ ACVP_RESULT acvp_send_register (ACVP_CTX *ctx, char *reg) {
     rv = acvp_curl_http_post(ctx, url, reg, &acvp_curl_write_register_func);
     if (rv != HTTP_OK) {
         ACVP_LOG_ERR("Unable to register with ACVP server. curl rv=%d\n", rv);
-        ACVP_LOG_ERR("%s\n", ctx->reg_buf);
+        acvp_log_payload(ctx, ACVP_LOG_LVL_ERR, "Response", ctx->reg_buf);
         return ACVP_TRANSPORT_FAIL;
     }
 
@@ -536,7 +811,7 @@ ACVP_RESULT acvp_retrieve_vector_set (ACVP_CTX *ctx, int vs_id) {
                 rv = acvp_curl_http_get(ctx, url, &acvp_curl_write_kat_func);
                 if (rv != HTTP_OK) {
                     ACVP_LOG_ERR("Unable to get vector set from ACVP server. curl rv=%d\n", rv);
-                    ACVP_LOG_ERR("%s\n", ctx->kat_buf);
+                    acvp_log_payload(ctx, ACVP_LOG_LVL_ERR, "Response", ctx->kat_buf);
                     return ACVP_TRANSPORT_FAIL;
                 }
             }
@@ -586,13 +861,20 @@ ACVP_RESULT acvp_submit_vector_responses (ACVP_CTX *ctx) {
     char url[512]; //TODO: 512 is an arbitrary limit
     char *resp;
     ACVP_RESULT result;
+    ACVP_METRICS_TIMER timer;
 
     memset(url, 0x0, 512);
     snprintf(url, 511, "https://%s:%d/%svalidation/acvp/vectors?vsId=%d", ctx->server_name, ctx->server_port,
              ctx->path_segment, ctx->vs_id);
 
+    acvp_metrics_timer_start(ctx, &timer);
     resp = json_serialize_to_string_pretty(ctx->kat_resp);
+    acvp_metrics_timer_stop(ctx, ACVP_PHASE_SERIALIZE, &timer);
+    acvp_log_payload(ctx, ACVP_LOG_LVL_INFO, "POST", resp);
+    acvp_metrics_bytes(ctx, 0, resp ? strlen(resp) : 0);
+    acvp_metrics_timer_start(ctx, &timer);
     rv = acvp_curl_http_post(ctx, url, resp, &acvp_curl_write_upld_func);
+    acvp_metrics_timer_stop(ctx, ACVP_PHASE_UPLOAD, &timer);
     json_value_free(ctx->kat_resp);
     ctx->kat_resp = NULL;
     json_free_serialized_string(resp);
@@ -605,7 +887,7 @@ ACVP_RESULT acvp_submit_vector_responses (ACVP_CTX *ctx) {
                 rv = acvp_curl_http_post(ctx, url, resp, &acvp_curl_write_upld_func);
                 if (rv != HTTP_OK) {
                     ACVP_LOG_ERR("Unable to get vector responses from ACVP server. curl rv=%d\n", rv);
-                    ACVP_LOG_ERR("%s\n", ctx->upld_buf);
+                    acvp_log_payload(ctx, ACVP_LOG_LVL_ERR, "Response", ctx->upld_buf);
                     return ACVP_TRANSPORT_FAIL;
                 }
             }
@@ -642,7 +924,7 @@ ACVP_RESULT acvp_retrieve_vector_set_result (ACVP_CTX *ctx, int vs_id) {
                 rv = acvp_curl_http_get(ctx, url, &acvp_curl_write_kat_func);
                 if (rv != HTTP_OK) {
                     ACVP_LOG_ERR("Unable to get vector result from server. curl rv=%d\n", rv);
-                    ACVP_LOG_ERR("%s\n", ctx->kat_buf);
+                    acvp_log_payload(ctx, ACVP_LOG_LVL_ERR, "Response", ctx->kat_buf);
                     return ACVP_TRANSPORT_FAIL;
                 }
             }
@@ -26,6 +26,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <pthread.h>
 #include "acvp.h"
 #include "acvp_lcl.h"
 
@@ -49,7 +51,15 @@ void acvp_log_msg (ACVP_CTX *ctx, ACVP_LOG_LVL level, const char *format, ...) {
     va_list arguments;
     char tmp[1024 * 2];
 
-    if (ctx && ctx->test_progress_cb && (ctx->debug >= level)) {
+    if (ctx && ctx->log_ring && (ctx->debug >= level)) {
+        /*
+         * Hand the message to the event logger thread
+         */
+        va_start(arguments, format);
+        vsnprintf(tmp, ACVP_LOG_MSG_MAX, format, arguments);
+        va_end(arguments);
+        acvp_log_event(ctx, ACVP_EVENT_MSG, level, 0, tmp, 0);
+    } else if (ctx && ctx->test_progress_cb && (ctx->debug >= level)) {
         /*
          * Pull the arguments from the stack and invoke
          * the logger function
@@ -394,6 +404,82 @@ ACVP_RESULT acvp_hexstr_to_bin (const unsigned char *src, unsigned char *dest, i
     return ACVP_SUCCESS;
 }
 
+/*
+ * The binary big numbers of a test case are carved out of a
+ * single allocation of 'cnt' * ACVP_BN_MAX bytes, so a test
+ * case costs one malloc no matter how many values it has.
+ */
+ACVP_RESULT acvp_bn_alloc (ACVP_BN *bn, int cnt) {
+    unsigned char *buf;
+    int i;
+
+    buf = calloc(cnt, ACVP_BN_MAX);
+    if (!buf) {
+        return ACVP_MALLOC_FAIL;
+    }
+    for (i = 0; i < cnt; i++) {
+        bn[i].val = buf + (i * ACVP_BN_MAX);
+        bn[i].len = 0;
+    }
+    return ACVP_SUCCESS;
+}
+
+void acvp_bn_free (ACVP_BN *bn, int cnt) {
+    free(bn[0].val);
+    memset(bn, 0x0, cnt * sizeof(ACVP_BN));
+}
+
+/*
+ * Decode a hex big number from the vector set into a binary
+ * big number.  Unlike acvp_hexstr_to_bin() an odd number of
+ * hex digits is allowed, the value is left padded with a zero
+ * nibble.
+ */
+ACVP_RESULT acvp_hexstr_to_bn (const char *src, ACVP_BN *bn) {
+    int src_len, i = 0, j = 0;
+
+    if (!src || !bn || !bn->val) {
+        return ACVP_INVALID_ARG;
+    }
+
+    src_len = (int) strlen(src);
+    if ((src_len + 1) / 2 > ACVP_BN_MAX) {
+        return ACVP_DATA_TOO_LARGE;
+    }
+
+    if (src_len & 1) {
+        bn->val[j++] = acvp_char_to_int(src[i++]);
+    }
+    while (i < src_len) {
+        bn->val[j++] = (acvp_char_to_int(src[i]) << 4) | acvp_char_to_int(src[i + 1]);
+        i += 2;
+    }
+    bn->len = j;
+
+    return ACVP_SUCCESS;
+}
+
+/*
+ * Hex encode a binary big number set by the crypto module
+ * and add it to the test case response.
+ */
+ACVP_RESULT acvp_bn_to_json (JSON_Object *obj, const char *name, ACVP_BN *bn) {
+    char tmp[(ACVP_BN_MAX * 2) + 1];
+    ACVP_RESULT rv;
+
+    if (!bn->val || bn->len < 0 || bn->len > ACVP_BN_MAX) {
+        return ACVP_DATA_TOO_LARGE;
+    }
+    rv = acvp_bin_to_hexstr(bn->val, bn->len, (unsigned char *) tmp);
+    if (rv != ACVP_SUCCESS) {
+        return rv;
+    }
+    if (json_object_set_string(obj, name, tmp) != JSONSuccess) {
+        return ACVP_JSON_ERR;
+    }
+    return ACVP_SUCCESS;
+}
+
 /*
  * Local - helper function for acvp_hexstring_to_bytes
  * Used to convert a hexadecimal character to it's byte
@@ -495,6 +581,95 @@ ACVP_RESULT acvp_create_array (JSON_Object **obj, JSON_Value **val, JSON_Array *
     return (result);
 }
 
+/*
+ * Test case buffers are allocated once per vector set and
+ * re-used for every test case.  This function zeroes the
+ * portion of such a buffer that was used by the previous
+ * test case, clamped to the size of the buffer.
+ */
+void acvp_clear_tc_buf (unsigned char *buf, unsigned int used, unsigned int max) {
+    if (!buf) {
+        return;
+    }
+    if (used > max) {
+        used = max;
+    }
+    memset(buf, 0x0, used);
+}
+
+/*
+ * This function feeds a message to the crypto module in chunks
+ * using the init/update/final stream callbacks.  The message is
+ * 'full_len' bytes long and is built by repeating the hex
+ * encoded 'content' of 'content_len' bytes.  For a message that
+ * isn't expanded both lengths are the same.  Each chunk is
+ * decoded straight from the hex source into 'buf', which the
+ * test case references as its message, and 'chunk_len' is set
+ * to the number of bytes in the chunk before calling update.
+ */
+ACVP_RESULT acvp_stream_hex_msg (ACVP_CTX *ctx,
+                                 ACVP_STREAM_CB *cb,
+                                 ACVP_TEST_CASE *tc,
+                                 const unsigned char *content,
+                                 unsigned long long content_len,
+                                 unsigned long long full_len,
+                                 unsigned char *buf,
+                                 unsigned int buf_max,
+                                 unsigned int *chunk_len) {
+    unsigned long long remaining = full_len;
+    unsigned long long pos = 0;
+    unsigned int i, n;
+    ACVP_RESULT rv;
+
+    if (!cb || !cb->init || !cb->update || !cb->final) {
+        return ACVP_INVALID_ARG;
+    }
+    if (!content || !buf || !buf_max || !chunk_len) {
+        return ACVP_INVALID_ARG;
+    }
+    if (!content_len && full_len) {
+        return ACVP_INVALID_ARG;
+    }
+    if (strnlen((const char *) content, content_len * 2) < content_len * 2) {
+        ACVP_LOG_ERR("Hex content shorter than content length");
+        return ACVP_MALFORMED_JSON;
+    }
+
+    *chunk_len = 0;
+    rv = cb->init(tc);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("crypto module failed the stream init");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+
+    while (remaining) {
+        n = remaining > buf_max ? buf_max : (unsigned int) remaining;
+        for (i = 0; i < n; i++) {
+            buf[i] = (acvp_char_to_int(content[pos * 2]) << 4) +
+                     acvp_char_to_int(content[pos * 2 + 1]);
+            if (++pos == content_len) {
+                pos = 0;
+            }
+        }
+        *chunk_len = n;
+        rv = cb->update(tc);
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("crypto module failed the stream update");
+            return ACVP_CRYPTO_MODULE_FAIL;
+        }
+        remaining -= n;
+    }
+
+    *chunk_len = 0;
+    rv = cb->final(tc);
+    if (rv != ACVP_SUCCESS) {
+        ACVP_LOG_ERR("crypto module failed the stream final");
+        return ACVP_CRYPTO_MODULE_FAIL;
+    }
+
+    return ACVP_SUCCESS;
+}
+
 /*
  * This function returns a string that describes the error
  * code passed in.
@@ -519,7 +694,8 @@ char *acvp_lookup_error_string (ACVP_RESULT rv) {
             {ACVP_DATA_TOO_LARGE, "Data too large"},
             {ACVP_DUP_CIPHER, "Duplicate cipher, may have already registered"},
             {ACVP_TOTP_DECODE_FAIL, "Failed to base64 decode TOTP seed"},
-            {ACVP_TOTP_MISSING_SEED, "Missing TOTP seed"}
+            {ACVP_TOTP_MISSING_SEED, "Missing TOTP seed"},
+            {ACVP_TEST_FAIL, "One or more vector sets did not pass"}
     };
     
     for (i = 0; i < ACVP_RESULT_MAX-1; i++) {
@@ -529,3 +705,111 @@ char *acvp_lookup_error_string (ACVP_RESULT rv) {
     }
     return "Unknown error";
 }
+
+/*
+ * State shared by the threads of acvp_run_crypto_handlers().
+ * The lock serializes picking the next test case, recording
+ * the result and calling the progress callback.
+ */
+typedef struct acvp_worker_pool_t {
+    ACVP_CTX *ctx;
+    ACVP_CAPS_LIST *cap;
+    ACVP_TEST_CASE *tcs;
+    int tc_cnt;
+    int next;
+    int done;
+    ACVP_RESULT rv;
+    pthread_mutex_t lock;
+} ACVP_WORKER_POOL;
+
+static void *acvp_worker_main (void *arg) {
+    ACVP_WORKER_POOL *pool = (ACVP_WORKER_POOL *)arg;
+    ACVP_CTX *ctx = pool->ctx;
+    ACVP_RESULT rv;
+    int idx;
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->rv != ACVP_SUCCESS || pool->next >= pool->tc_cnt) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        idx = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+
+        rv = acvp_call_crypto_handler(ctx, pool->cap, &pool->tcs[idx]);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->done++;
+        if (rv != ACVP_SUCCESS) {
+            ACVP_LOG_ERR("crypto module failed the operation");
+            if (pool->rv == ACVP_SUCCESS) {
+                pool->rv = ACVP_CRYPTO_MODULE_FAIL;
+            }
+        } else {
+            ACVP_LOG_STATUS("vsId %d: %d of %d test cases done", ctx->vs_id, pool->done, pool->tc_cnt);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+/*
+ * This function invokes the crypto handler for each of the
+ * 'tc_cnt' test cases in 'tcs'.  The test cases must not share
+ * any state.  Up to ctx->worker_threads threads are used, the
+ * caller's thread is used when that is 0 or 1, or when no
+ * thread could be started.  Once a test case fails no new ones
+ * are started.  The results are left in the test cases, so the
+ * caller outputs them in the original order.
+ */
+ACVP_RESULT acvp_run_crypto_handlers (ACVP_CTX *ctx, ACVP_CAPS_LIST *cap, ACVP_TEST_CASE *tcs, int tc_cnt) {
+    ACVP_WORKER_POOL pool;
+    pthread_t *threads = NULL;
+    int thread_cnt, started = 0, i;
+
+    if (!ctx) {
+        return ACVP_NO_CTX;
+    }
+    if (!cap || !tcs) {
+        return ACVP_INVALID_ARG;
+    }
+
+    memset(&pool, 0x0, sizeof(ACVP_WORKER_POOL));
+    pool.ctx = ctx;
+    pool.cap = cap;
+    pool.tcs = tcs;
+    pool.tc_cnt = tc_cnt;
+    pool.rv = ACVP_SUCCESS;
+    if (pthread_mutex_init(&pool.lock, NULL)) {
+        return ACVP_MALLOC_FAIL;
+    }
+
+    thread_cnt = ctx->worker_threads;
+    if (thread_cnt > tc_cnt) {
+        thread_cnt = tc_cnt;
+    }
+    if (thread_cnt > 1) {
+        threads = calloc(thread_cnt, sizeof(pthread_t));
+    }
+    if (threads) {
+        for (i = 0; i < thread_cnt; i++) {
+            if (pthread_create(&threads[started], NULL, acvp_worker_main, &pool)) {
+                ACVP_LOG_WARN("Unable to start worker thread %d, using %d", i, started);
+                break;
+            }
+            started++;
+        }
+    }
+
+    if (!started) {
+        acvp_worker_main(&pool);
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    pthread_mutex_destroy(&pool.lock);
+    return pool.rv;
+}